@@ -0,0 +1,267 @@
+/**
+ * @file dfmodules_subprocess_writer.cxx
+ *
+ * Writer process of the SubprocessDataStore.  It attaches to the two shared
+ * memory rings that the SubprocessDataStore created, whose file descriptors
+ * it inherits, creates the DataStore that the SubprocessDataStore asks for,
+ * and writes the records that it receives through the request ring with it.
+ * Each completed write, and the outcome of each command, is reported back
+ * through the reply ring.  It is not meant to be started by hand.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/DataStore.hpp"
+#include "dfmodules/SharedMemoryRing.hpp"
+#include "dfmodules/SubprocessWriterProtocol.hpp"
+
+#include "logging/Logging.hpp"
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::dfmodules;
+
+namespace {
+
+const std::chrono::milliseconds s_request_poll_time(100);
+const std::chrono::milliseconds s_reply_timeout(60000);
+const std::chrono::microseconds s_min_retry_time(1000);
+const std::chrono::microseconds s_max_retry_time(100000);
+
+class Writer
+{
+public:
+  Writer(std::unique_ptr<SharedMemoryRing> request_ring, std::unique_ptr<SharedMemoryRing> reply_ring, pid_t parent_pid)
+    : m_request_ring(std::move(request_ring))
+    , m_reply_ring(std::move(reply_ring))
+    , m_parent_pid(parent_pid)
+  {}
+
+  /**
+   * @brief Handles the requests until a kShutdown request arrives, the parent closes
+   * the request ring, or the parent process has exited
+   */
+  void run()
+  {
+    while (true) {
+      uint32_t type = 0; // NOLINT(build/unsigned)
+      size_t size = 0;
+      const char* payload = m_request_ring->peek_message(type, size, s_request_poll_time);
+      if (payload == nullptr) {
+        if (m_request_ring->is_closed() || parent_has_exited()) {
+          return;
+        }
+        send_completions();
+        continue;
+      }
+
+      auto message_type = static_cast<subprocesswriter::MessageType>(type);
+      if (message_type == subprocesswriter::MessageType::kShutdown) {
+        m_request_ring->consume_message();
+        return;
+      }
+      if (message_type == subprocesswriter::MessageType::kTriggerRecord) {
+        // the record is copied out of the ring, since the DataStore may keep it
+        std::unique_ptr<daqdataformats::TriggerRecord> tr_ptr = subprocesswriter::make_trigger_record(payload, size);
+        m_request_ring->consume_message();
+        write_record(tr_ptr);
+      } else if (message_type == subprocesswriter::MessageType::kTimeSlice) {
+        std::unique_ptr<daqdataformats::TimeSlice> ts_ptr = subprocesswriter::make_time_slice(payload, size);
+        m_request_ring->consume_message();
+        write_record(ts_ptr);
+      } else {
+        std::string command_payload(payload, size);
+        m_request_ring->consume_message();
+        handle_command(message_type, command_payload);
+      }
+    }
+  }
+
+  /**
+   * @brief Destroys the DataStore, which closes its files
+   */
+  void shutdown()
+  {
+    if (m_data_store.get() != nullptr) {
+      send_completions();
+      m_data_store.reset();
+    }
+  }
+
+private:
+  std::unique_ptr<SharedMemoryRing> m_request_ring;
+  std::unique_ptr<SharedMemoryRing> m_reply_ring;
+  std::unique_ptr<DataStore> m_data_store;
+  pid_t m_parent_pid;
+
+  /**
+   * @brief Whether the DAQ application that started this process has exited, in which
+   * case this process has been re-parented.  PR_SET_PDEATHSIG is not used for this, since
+   * it fires when the thread that started this process exits, rather than the process.
+   */
+  bool parent_has_exited() const { return getppid() != m_parent_pid; }
+
+  void handle_command(subprocesswriter::MessageType type, const std::string& payload)
+  {
+    std::string details;
+    try {
+      if (type == subprocesswriter::MessageType::kConfigure) {
+        m_data_store = make_data_store(nlohmann::json::parse(payload));
+      } else if (m_data_store.get() == nullptr) {
+        throw std::runtime_error("the DataStore has not been configured");
+      } else if (type == subprocesswriter::MessageType::kPrepareRun) {
+        subprocesswriter::RunCommand command;
+        std::memcpy(&command, payload.data(), sizeof(command));
+        m_data_store->prepare_for_run(command.run_number);
+      } else if (type == subprocesswriter::MessageType::kFinishRun) {
+        subprocesswriter::RunCommand command;
+        std::memcpy(&command, payload.data(), sizeof(command));
+        m_data_store->finish_with_run(command.run_number);
+        // all the writes have completed, and their completions precede the acknowledgement
+        send_completions();
+      } else {
+        throw std::runtime_error("unknown command " + std::to_string(static_cast<uint32_t>(type))); // NOLINT
+      }
+    } catch (std::exception const& excpt) {
+      details = excpt.what();
+    }
+    subprocesswriter::Ack ack{ type, details.empty() };
+    send_reply(subprocesswriter::MessageType::kAck, ack, details);
+  }
+
+  /**
+   * @brief Writes the record, retrying as long as the DataStore reports retryable problems.
+   * If the DataStore does not report completions itself, the write is reported here.
+   */
+  template<typename T>
+  void write_record(std::unique_ptr<T>& record_ptr)
+  {
+    subprocesswriter::Completion completion{};
+    if constexpr (std::is_same_v<T, daqdataformats::TriggerRecord>) {
+      completion.record_number = record_ptr->get_header_ref().get_trigger_number();
+      completion.record_type = subprocesswriter::MessageType::kTriggerRecord;
+      completion.sequence_number = record_ptr->get_header_ref().get_sequence_number();
+    } else {
+      completion.record_number = record_ptr->get_header().timeslice_number;
+      completion.record_type = subprocesswriter::MessageType::kTimeSlice;
+    }
+
+    std::string details;
+    auto retry_time = s_min_retry_time;
+    while (true) {
+      try {
+        if (m_data_store.get() == nullptr) {
+          throw std::runtime_error("the DataStore has not been configured");
+        }
+        m_data_store->write(record_ptr);
+        break;
+      } catch (RetryableDataStoreProblem const& excpt) {
+        if (m_request_ring->is_closed() || parent_has_exited()) {
+          details = excpt.what();
+          break;
+        }
+        send_completions();
+        std::this_thread::sleep_for(retry_time);
+        retry_time = std::min(retry_time * 2, s_max_retry_time);
+      } catch (std::exception const& excpt) {
+        details = excpt.what();
+        break;
+      }
+    }
+
+    // failed writes are reported right away, and so are the TriggerRecords of a DataStore
+    // that does not report completions itself; the others are reported when it does so
+    completion.success = details.empty();
+    bool is_trigger_record = (completion.record_type == subprocesswriter::MessageType::kTriggerRecord);
+    if (!completion.success || (is_trigger_record && !m_data_store->reports_write_completions())) {
+      send_reply(subprocesswriter::MessageType::kCompletion, completion, details);
+    }
+    send_completions();
+  }
+
+  /**
+   * @brief Forwards the completions and the failures that the DataStore has reported
+   */
+  void send_completions()
+  {
+    if (m_data_store.get() == nullptr || !m_data_store->reports_write_completions()) {
+      return;
+    }
+    for (auto const& record_id : m_data_store->take_completed_records()) {
+      subprocesswriter::Completion completion{
+        record_id.first, subprocesswriter::MessageType::kTriggerRecord, record_id.second, 1
+      };
+      send_reply(subprocesswriter::MessageType::kCompletion, completion, "");
+    }
+    for (auto const& record_id : m_data_store->take_failed_records()) {
+      subprocesswriter::Completion completion{
+        record_id.first, subprocesswriter::MessageType::kTriggerRecord, record_id.second, 0
+      };
+      send_reply(subprocesswriter::MessageType::kCompletion,
+                 completion,
+                 "the DataStore of the writer process failed to write it, see the log of the writer process");
+    }
+  }
+
+  template<typename T>
+  void send_reply(subprocesswriter::MessageType type, const T& reply, const std::string& details)
+  {
+    // nobody reads the replies once the parent process has exited
+    if (parent_has_exited()) {
+      return;
+    }
+    if (!subprocesswriter::send_message(*m_reply_ring, type, reply, details, s_reply_timeout)) {
+      std::cerr << "Unable to send a reply to the parent process, which does not read them" << std::endl;
+    }
+  }
+};
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+  if (argc != 4) {
+    std::cerr << "Usage: " << argv[0] << " <request ring file descriptor> <reply ring file descriptor> <name>"
+              << std::endl;
+    std::cerr << "  This application is started by the SubprocessDataStore." << std::endl;
+    return 1;
+  }
+
+  // the writer process does not outlive the DAQ application, which it checks while it waits for requests
+  const pid_t parent_pid = getppid();
+  if (parent_pid == 1) {
+    return 2;
+  }
+
+  const std::string name = argv[3];
+  try {
+    Writer writer(SharedMemoryRing::attach(name + "_requests", std::stoi(argv[1])),
+                  SharedMemoryRing::attach(name + "_replies", std::stoi(argv[2])),
+                  parent_pid);
+    writer.run();
+    writer.shutdown();
+  } catch (ers::Issue const& excpt) {
+    ers::fatal(excpt);
+    return 3;
+  } catch (std::exception const& excpt) {
+    std::cerr << "The writer process " << name << " failed: " << excpt.what() << std::endl;
+    return 3;
+  }
+  return 0;
+}
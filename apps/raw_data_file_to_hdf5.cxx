@@ -0,0 +1,104 @@
+/**
+ * @file raw_data_file_to_hdf5.cxx
+ *
+ * Application that converts a raw data file that was written by the
+ * RawDataStore into an HDF5 file with the standard hdf5libs layout.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/RawDataFileReader.hpp"
+
+#include "detchannelmaps/HardwareMapService.hpp"
+#include "hdf5libs/HDF5RawDataFile.hpp"
+#include "hdf5libs/hdf5filelayout/Nljs.hpp"
+#include "hdf5libs/hdf5filelayout/Structs.hpp"
+
+#include "logging/Logging.hpp"
+#include "nlohmann/json.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+using namespace dunedaq;
+
+void
+print_usage(const char* program_name)
+{
+  std::cout << "Usage: " << program_name
+            << " <input raw data file> <output HDF5 file> <hardware map file> [file layout JSON file]" << std::endl;
+  std::cout << "  The file layout JSON file contains an hdf5libs FileLayoutParams object, e.g. the "
+            << "\"file_layout_parameters\" of an HDF5DataStore configuration.  If it is not specified, "
+            << "the default file layout is used." << std::endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+  if (argc < 4 || argc > 5) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  const std::string input_file_name = argv[1];
+  const std::string output_file_name = argv[2];
+  const std::string hardware_map_file = argv[3];
+
+  try {
+    hdf5libs::hdf5filelayout::FileLayoutParams layout_params;
+    if (argc == 5) {
+      std::ifstream layout_stream(argv[4]);
+      if (!layout_stream.is_open()) {
+        std::cerr << "Unable to open the file layout JSON file \"" << argv[4] << "\"" << std::endl;
+        return 2;
+      }
+      nlohmann::json layout_json;
+      layout_stream >> layout_json;
+      layout_params = layout_json.get<hdf5libs::hdf5filelayout::FileLayoutParams>();
+    }
+
+    dfmodules::RawDataFileReader reader(input_file_name);
+    auto const& file_header = reader.get_file_header();
+
+    auto hw_map_service = std::make_shared<detchannelmaps::HardwareMapService>(hardware_map_file);
+    hdf5libs::HDF5RawDataFile output_file(output_file_name,
+                                          file_header.run_number,
+                                          file_header.file_index,
+                                          file_header.writer_identifier,
+                                          layout_params,
+                                          hw_map_service,
+                                          ".writing",
+                                          HighFive::File::Create);
+    output_file.write_attribute("operational_environment", std::string(file_header.operational_environment));
+
+    size_t trigger_record_count = 0;
+    size_t time_slice_count = 0;
+    while (reader.read_next_block()) {
+      auto const& block_header = reader.get_block_header();
+      if (block_header.block_type == dfmodules::rawdatafile::BlockType::kTriggerRecord) {
+        output_file.write(*reader.get_trigger_record());
+        ++trigger_record_count;
+      } else if (block_header.block_type == dfmodules::rawdatafile::BlockType::kTimeSlice) {
+        output_file.write(*reader.get_time_slice());
+        ++time_slice_count;
+      } else {
+        std::cerr << "Skipping a data block of unknown type " << static_cast<uint32_t>(block_header.block_type) // NOLINT
+                  << " (record number " << block_header.record_number << ")" << std::endl;
+      }
+    }
+
+    std::cout << "Converted " << trigger_record_count << " TriggerRecords and " << time_slice_count
+              << " TimeSlices from " << input_file_name << " to " << output_file_name << std::endl;
+  } catch (ers::Issue const& excpt) {
+    ers::fatal(excpt);
+    return 3;
+  } catch (std::exception const& excpt) {
+    std::cerr << "Conversion failed: " << excpt.what() << std::endl;
+    return 3;
+  }
+
+  return 0;
+}
@@ -18,10 +18,13 @@
 #include "utilities/NamedObject.hpp"
 #include "cetlib/BasicPluginFactory.h"
 #include "cetlib/compiler_macros.h"
+#include "daqdataformats/Fragment.hpp"
+#include "daqdataformats/SourceID.hpp"
 #include "daqdataformats/TimeSlice.hpp"
 #include "daqdataformats/TriggerRecord.hpp"
 #include "daqdataformats/Types.hpp"
 #include "logging/Logging.hpp"
+#include "opmonlib/InfoCollector.hpp"
 
 #include "nlohmann/json.hpp"
 
@@ -29,6 +32,7 @@
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #ifndef EXTERN_C_FUNC_DECLARE_START
@@ -94,6 +98,11 @@ namespace dfmodules {
 class DataStore : public utilities::NamedObject
 {
 public:
+  /**
+   * @brief Identifies a record in a run: the trigger (or timeslice) number and the sequence number
+   */
+  using record_id_t = std::pair<uint64_t, daqdataformats::sequence_number_t>; // NOLINT(build/unsigned)
+
   /**
    * @brief DataStore Constructor
    * @param name Name of the DataStore instance
@@ -114,6 +123,122 @@ public:
    */
   virtual void write(const daqdataformats::TimeSlice& ts) = 0;
 
+  /**
+   * @brief Writes the TriggerRecord into the DataStore, allowing the DataStore
+   * to take ownership of it.
+   * DataStore implementations that complete the write at a later time (e.g. on a
+   * background thread) move the record out of tr_ptr.  If an exception is thrown,
+   * tr_ptr is left untouched so that the caller can retry the operation.
+   * The default implementation writes synchronously and leaves tr_ptr untouched.
+   * @param tr_ptr TriggerRecord to write.
+   */
+  virtual void write(std::unique_ptr<daqdataformats::TriggerRecord>& tr_ptr) { write(*tr_ptr); }
+
+  /**
+   * @brief Writes the TimeSlice into the DataStore, allowing the DataStore
+   * to take ownership of it.  The same conventions apply as for the
+   * TriggerRecord version of this method.
+   * @param ts_ptr TimeSlice to write.
+   */
+  virtual void write(std::unique_ptr<daqdataformats::TimeSlice>& ts_ptr) { write(*ts_ptr); }
+
+  /**
+   * @brief Writes a batch of TriggerRecords into the DataStore.
+   * Each entry that has been written (or handed over to the DataStore for writing)
+   * is reset to a null pointer, and null entries are skipped.  If an exception is
+   * thrown, the entries that have not been written yet are left untouched, so that
+   * the caller can find the one that failed (the first non-null entry) and retry
+   * the rest.  The default implementation writes the TriggerRecords one at a time.
+   * @param tr_batch TriggerRecords to write.
+   */
+  virtual void write(std::vector<std::unique_ptr<daqdataformats::TriggerRecord>>& tr_batch)
+  {
+    for (auto& tr_ptr : tr_batch) {
+      if (tr_ptr.get() != nullptr) {
+        write(tr_ptr);
+        tr_ptr.reset();
+      }
+    }
+  }
+
+  /**
+   * @brief Writes a batch of TimeSlices into the DataStore.  The same conventions
+   * apply as for the TriggerRecord version of this method.
+   * @param ts_batch TimeSlices to write.
+   */
+  virtual void write(std::vector<std::unique_ptr<daqdataformats::TimeSlice>>& ts_batch)
+  {
+    for (auto& ts_ptr : ts_batch) {
+      if (ts_ptr.get() != nullptr) {
+        write(ts_ptr);
+        ts_ptr.reset();
+      }
+    }
+  }
+
+  /**
+   * @brief Whether the TriggerRecords may still be on their way to disk when write()
+   * returns.  If so, the DataStore reports the TriggerRecords whose writes have
+   * completed with take_completed_records(), and the caller should wait for that
+   * before it considers a TriggerRecord as stored.
+   * The default implementation returns false.
+   */
+  virtual bool reports_write_completions() const { return false; }
+
+  /**
+   * @brief Returns the TriggerRecords whose writes have completed since the previous
+   * call: their data is durable on disk.  This method does not wait for writes to
+   * complete, and all writes have completed once finish_with_run() has returned.
+   * The default implementation returns an empty list.
+   */
+  virtual std::vector<record_id_t> take_completed_records() { return {}; }
+
+  /**
+   * @brief Returns the TriggerRecords whose writes have failed since the previous call,
+   * after write() had returned.  The problems have been reported, and these TriggerRecords
+   * are not returned by take_completed_records().
+   * The default implementation returns an empty list.
+   */
+  virtual std::vector<record_id_t> take_failed_records() { return {}; }
+
+  /**
+   * @brief Returns the identifiers of the records of the specified run that can be
+   * read from the DataStore, in increasing order.
+   * The default implementation throws a GeneralDataStoreProblem, since reading is
+   * not supported by all DataStores.
+   */
+  virtual std::vector<record_id_t> get_record_ids(daqdataformats::run_number_t /*run_number*/)
+  {
+    throw GeneralDataStoreProblem(ERS_HERE, get_name(), "listing the records of a run, which is not supported");
+  }
+
+  /**
+   * @brief Reads a TriggerRecord from the DataStore.
+   * @return the TriggerRecord, or a null pointer if the DataStore does not have it.
+   * The default implementation throws a GeneralDataStoreProblem.
+   */
+  virtual std::unique_ptr<daqdataformats::TriggerRecord> read_trigger_record(
+    daqdataformats::run_number_t /*run_number*/,
+    daqdataformats::trigger_number_t /*trigger_number*/,
+    daqdataformats::sequence_number_t /*sequence_number*/)
+  {
+    throw GeneralDataStoreProblem(ERS_HERE, get_name(), "reading a TriggerRecord, which is not supported");
+  }
+
+  /**
+   * @brief Reads one Fragment of a TriggerRecord from the DataStore.
+   * @return the Fragment, or a null pointer if the DataStore does not have the TriggerRecord.
+   * The default implementation throws a GeneralDataStoreProblem.
+   */
+  virtual std::unique_ptr<daqdataformats::Fragment> read_fragment(
+    daqdataformats::run_number_t /*run_number*/,
+    daqdataformats::trigger_number_t /*trigger_number*/,
+    daqdataformats::sequence_number_t /*sequence_number*/,
+    const daqdataformats::SourceID& /*source_id*/)
+  {
+    throw GeneralDataStoreProblem(ERS_HERE, get_name(), "reading a Fragment, which is not supported");
+  }
+
   /**
    * @brief Informs the DataStore that writes or reads of data blocks associated
    * with the specified run number will soon be requested.
@@ -130,6 +255,13 @@ public:
    */
   virtual void finish_with_run(daqdataformats::run_number_t run_number) = 0;
 
+  /**
+   * @brief Fills the operational monitoring information of the DataStore.
+   * This is called by the DAQModule that owns the DataStore, as part of its
+   * own get_info() call.  The default implementation doesn't report anything.
+   */
+  virtual void get_info(opmonlib::InfoCollector& /*ci*/, int /*level*/) {}
+
 private:
   DataStore(const DataStore&) = delete;
   DataStore& operator=(const DataStore&) = delete;
@@ -10,6 +10,7 @@
 #include "dfmodules/CommonIssues.hpp"
 #include "dfmodules/datawriter/Nljs.hpp"
 #include "dfmodules/datawriterinfo/InfoNljs.hpp"
+#include "dfmodules/datawriterlaneinfo/InfoNljs.hpp"
 
 #include "appfwk/DAQModuleHelper.hpp"
 #include "daqdataformats/Fragment.hpp"
@@ -20,7 +21,10 @@
 #include "rcif/cmd/Nljs.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <functional>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <thread>
@@ -48,7 +52,10 @@ DataWriter::DataWriter(const std::string& name)
   : dunedaq::appfwk::DAQModule(name)
   , m_queue_timeout(100)
   , m_data_storage_is_enabled(true)
+  , m_max_records_per_batch(1)
+  , m_max_records_per_wakeup(1)
   , m_thread(std::bind(&DataWriter::do_work, this, std::placeholders::_1))
+  , m_last_info_time(std::chrono::steady_clock::now())
 {
   register_command("conf", &DataWriter::do_conf);
   register_command("start", &DataWriter::do_start);
@@ -69,7 +76,7 @@ DataWriter::init(const data_t& init_data)
 }
 
 void
-DataWriter::get_info(opmonlib::InfoCollector& ci, int /*level*/)
+DataWriter::get_info(opmonlib::InfoCollector& ci, int level)
 {
   datawriterinfo::Info dwi;
 
@@ -81,8 +88,76 @@ DataWriter::get_info(opmonlib::InfoCollector& ci, int /*level*/)
   dwi.new_bytes_output = m_bytes_output.exchange(0);
   dwi.writing_time = m_writing_ms.exchange(0);
 
+  auto now = std::chrono::steady_clock::now();
+  double interval_seconds = std::chrono::duration<double>(now - m_last_info_time).count();
+  m_last_info_time = now;
+  if (interval_seconds > 0) {
+    dwi.bytes_per_second = static_cast<uint64_t>(dwi.new_bytes_output / interval_seconds); // NOLINT(build/unsigned)
+  }
+
+  LatencyHistogram::Snapshot snapshot = m_queue_wait_latency.get_and_reset();
+  dwi.queue_wait_p50_us = snapshot.p50_us;
+  dwi.queue_wait_p90_us = snapshot.p90_us;
+  dwi.queue_wait_p99_us = snapshot.p99_us;
+  dwi.queue_wait_max_us = snapshot.max_us;
+  snapshot = m_write_latency.get_and_reset();
+  dwi.write_p50_us = snapshot.p50_us;
+  dwi.write_p90_us = snapshot.p90_us;
+  dwi.write_p99_us = snapshot.p99_us;
+  dwi.write_max_us = snapshot.max_us;
+  snapshot = m_token_send_latency.get_and_reset();
+  dwi.token_send_p50_us = snapshot.p50_us;
+  dwi.token_send_p90_us = snapshot.p90_us;
+  dwi.token_send_p99_us = snapshot.p99_us;
+  dwi.token_send_max_us = snapshot.max_us;
+  snapshot = m_end_to_end_latency.get_and_reset();
+  dwi.end_to_end_p50_us = snapshot.p50_us;
+  dwi.end_to_end_p90_us = snapshot.p90_us;
+  dwi.end_to_end_p99_us = snapshot.p99_us;
+  dwi.end_to_end_max_us = snapshot.max_us;
+
+  std::lock_guard<std::mutex> lk(m_data_writer_mutex);
+  dwi.records_awaiting_completion = 0;
+  dwi.queued_records = 0;
+  for (auto& lane : m_lanes) {
+    dwi.records_awaiting_completion += lane->records_awaiting_completion_count.load();
+    std::lock_guard<std::mutex> queue_lock(lane->queue_mutex);
+    dwi.queued_records += lane->queue.size();
+  }
+  dwi.writer_lanes = m_lanes.size();
+  dwi.backlog_bytes = m_backlog_bytes.load();
+  dwi.tokens_released_early = m_tokens_released_early.load();
+  dwi.records_not_written = m_records_not_written.load();
+
   ci.add(dwi);
+
+  for (auto& lane : m_lanes) {
+    opmonlib::InfoCollector data_store_ci;
+    lane->data_store->get_info(data_store_ci, level);
+    if (m_lanes.size() == 1) {
+      ci.add(lane->data_store->get_name(), data_store_ci);
+      continue;
+    }
+
+    datawriterlaneinfo::Info dwli;
+    dwli.records_written = lane->records_written_tot.load();
+    dwli.new_records_written = lane->records_written.exchange(0);
+    dwli.bytes_output = lane->bytes_output_tot.load();
+    dwli.new_bytes_output = lane->bytes_output.exchange(0);
+    dwli.pending_bytes = lane->pending_bytes.load();
+    dwli.records_awaiting_completion = lane->records_awaiting_completion_count.load();
+    {
+      std::lock_guard<std::mutex> queue_lock(lane->queue_mutex);
+      dwli.queued_records = lane->queue.size();
+    }
+
+    opmonlib::InfoCollector lane_ci;
+    lane_ci.add(dwli);
+    lane_ci.add(lane->data_store->get_name(), data_store_ci);
+    ci.add("lane" + std::to_string(lane->index), lane_ci);
+  }
 }
+
 void
 DataWriter::do_conf(const data_t& payload)
 {
@@ -98,18 +173,71 @@ DataWriter::do_conf(const data_t& payload)
   }
   m_max_write_retry_time_usec = conf_params.max_write_retry_time_usec;
   m_write_retry_time_increase_factor = conf_params.write_retry_time_increase_factor;
+  m_max_records_per_batch = static_cast<size_t>(std::max(conf_params.max_records_per_batch, 1));
+  m_max_records_per_wakeup = static_cast<size_t>(std::max(conf_params.max_records_per_wakeup, 1));
   m_trigger_decision_connection = conf_params.decision_connection;
+  if (conf_params.lane_dispatch == "trigger-number") {
+    m_dispatch_to_least_loaded_lane = false;
+  } else if (conf_params.lane_dispatch == "least-loaded") {
+    m_dispatch_to_least_loaded_lane = true;
+  } else {
+    throw InvalidLaneDispatchMode(ERS_HERE, get_name(), conf_params.lane_dispatch);
+  }
+  size_t number_of_lanes = static_cast<size_t>(std::max(conf_params.num_writer_threads, 1));
+  TLOG_DEBUG(TLVL_CONFIG) << get_name() << ": number of writer lanes is " << number_of_lanes;
+  m_token_release_budget_bytes = conf_params.token_release_budget_bytes;
+  TLOG_DEBUG(TLVL_CONFIG) << get_name() << ": token release budget is " << m_token_release_budget_bytes << " bytes";
+
+  // each lane writes its own files, so its DataStore needs its own name and writer identifier,
+  // and so does the DataStore that a DataStore wraps (e.g. the one of a SubprocessDataStore)
+  std::function<void(data_t&, const std::string&)> add_lane_suffix = [&](data_t& params,
+                                                                          const std::string& lane_suffix) {
+    params["name"] = params.value("name", std::string()) + "_" + lane_suffix;
+    data_t& filename_params = params["filename_parameters"];
+    if (!filename_params.is_object()) {
+      filename_params = data_t::object();
+    }
+    std::string writer_identifier = filename_params.value("writer_identifier", std::string());
+    filename_params["writer_identifier"] =
+      writer_identifier.empty() ? lane_suffix : writer_identifier + "_" + lane_suffix;
+    if (params.contains("data_store_parameters") && params["data_store_parameters"].is_object()) {
+      add_lane_suffix(params["data_store_parameters"], lane_suffix);
+    }
+  };
 
-  // create the DataStore instance here
+  // create the DataStore instances here, one per lane
+  std::vector<std::unique_ptr<WriterLane>> lanes;
   try {
-    m_data_writer = make_data_store(payload["data_store_parameters"]);
+    for (size_t idx = 0; idx < number_of_lanes; ++idx) {
+      data_t data_store_params = payload["data_store_parameters"];
+      if (number_of_lanes > 1) {
+        add_lane_suffix(data_store_params, "lane" + std::to_string(idx));
+      }
+
+      auto lane = std::make_unique<WriterLane>();
+      lane->index = idx;
+      lane->data_store = make_data_store(data_store_params);
+      // ensure that we have a valid dataWriter instance
+      if (lane->data_store.get() == nullptr) {
+        throw InvalidDataWriter(ERS_HERE, get_name());
+      }
+      // with early token release, the TriggerRecords are written by the lane threads, so that
+      // the receiving thread can send their tokens while they wait to be written
+      if (number_of_lanes > 1 || m_token_release_budget_bytes > 0) {
+        WriterLane* lane_ptr = lane.get();
+        lane->thread.reset(new dunedaq::utilities::WorkerThread(
+          [this, lane_ptr](std::atomic<bool>& running_flag) { do_lane_work(*lane_ptr, running_flag); }));
+      }
+      lanes.push_back(std::move(lane));
+    }
+  } catch (const InvalidDataWriter&) {
+    throw;
   } catch (const ers::Issue& excpt) {
     throw UnableToConfigure(ERS_HERE, get_name(), excpt);
   }
-
-  // ensure that we have a valid dataWriter instance
-  if (m_data_writer.get() == nullptr) {
-    throw InvalidDataWriter(ERS_HERE, get_name());
+  {
+    std::lock_guard<std::mutex> lk(m_data_writer_mutex);
+    m_lanes = std::move(lanes);
   }
 
   TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Sending initial TriggerDecisionToken to DFO to announce my presence";
@@ -150,20 +278,42 @@ DataWriter::do_start(const data_t& payload)
   if (m_data_storage_is_enabled) {
 
     // ensure that we have a valid dataWriter instance
-    if (m_data_writer.get() == nullptr) {
+    if (m_lanes.empty()) {
       // this check is done essentially to notify the user
       // in case the "start" has been called before the "conf"
       ers::fatal(InvalidDataWriter(ERS_HERE, get_name()));
     }
-    
-    try {
-      m_data_writer->prepare_for_run(m_run_number);
-    } catch (const ers::Issue& excpt) {
-      throw UnableToStart(ERS_HERE, get_name(), m_run_number, excpt);
+
+    for (size_t idx = 0; idx < m_lanes.size(); ++idx) {
+      try {
+        m_lanes[idx]->data_store->prepare_for_run(m_run_number);
+      } catch (const ers::Issue& excpt) {
+        // the lanes that have already been prepared for the run are finished with it again
+        for (size_t prepared_idx = 0; prepared_idx < idx; ++prepared_idx) {
+          try {
+            m_lanes[prepared_idx]->data_store->finish_with_run(m_run_number);
+          } catch (const std::exception& cleanup_excpt) {
+            ers::warning(ProblemDuringStop(ERS_HERE, get_name(), m_run_number, cleanup_excpt));
+          }
+        }
+        throw UnableToStart(ERS_HERE, get_name(), m_run_number, excpt);
+      }
     }
   }
 
   m_seqno_counts.clear();
+  for (auto& lane : m_lanes) {
+    lane->queue.clear();
+    lane->pending_bytes = 0;
+    lane->records_awaiting_completion.clear();
+    lane->records_awaiting_completion_count = 0;
+    lane->reports_completions = m_data_storage_is_enabled && lane->data_store->reports_write_completions();
+    lane->records_written = 0;
+    lane->records_written_tot = 0;
+    lane->bytes_output = 0;
+    lane->bytes_output_tot = 0;
+    lane->writing_us_tot = 0;
+  }
   
   m_records_received = 0;
   m_records_received_tot = 0;
@@ -172,12 +322,19 @@ DataWriter::do_start(const data_t& payload)
   m_bytes_output = 0;
   m_bytes_output_tot = 0;
   m_tokens_sent = 0;
+  m_backlog_bytes = 0;
+  m_tokens_released_early = 0;
+  m_records_not_written = 0;
 
   m_running.store(true);
 
+  // the lanes are started before the receiving thread, which queues TriggerRecords for them
+  for (auto& lane : m_lanes) {
+    if (lane->thread.get() != nullptr) {
+      lane->thread->start_working_thread(get_name() + "-" + std::to_string(lane->index));
+    }
+  }
   m_thread.start_working_thread(get_name());
-  //iomanager::IOManager::get()->add_callback<std::unique_ptr<daqdataformats::TriggerRecord>>( m_trigger_record_connection,
-  //											     bind( &DataWriter::receive_trigger_record, this, std::placeholders::_1) );
 
   TLOG() << get_name() << " successfully started for run number " << m_run_number;
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_start() method";
@@ -190,17 +347,47 @@ DataWriter::do_stop(const data_t& /*args*/)
 
   m_running.store(false);
   m_thread.stop_working_thread(); 
-  //iomanager::IOManager::get()->remove_callback<std::unique_ptr<daqdataformats::TriggerRecord>>( m_trigger_record_connection );
+
+  // the lanes write the TriggerRecords that are still queued for them before they stop
+  for (auto& lane : m_lanes) {
+    if (lane->thread.get() != nullptr && lane->thread->thread_running()) {
+      lane->thread->stop_working_thread();
+    }
+  }
 
   // 04-Feb-2021, KAB: added this call to allow DataStore to finish up with this run.
   // I've put this call fairly late in this method so that any draining of queues
   // (or whatever) can take place before we finalize things in the DataStore.
   if (m_data_storage_is_enabled) {
-    try {
-      m_data_writer->finish_with_run(m_run_number);
-    } catch (const std::exception& excpt) {
-      ers::error(ProblemDuringStop(ERS_HERE, get_name(), m_run_number, excpt));
+    for (auto& lane : m_lanes) {
+      try {
+        lane->data_store->finish_with_run(m_run_number);
+      } catch (const std::exception& excpt) {
+        ers::error(ProblemDuringStop(ERS_HERE, get_name(), m_run_number, excpt));
+      }
+    }
+  }
+
+  for (auto& lane : m_lanes) {
+    // all of the writes have completed once the DataStore has finished with the run
+    if (lane->reports_completions) {
+      send_tokens_for_completed_records(*lane);
+      for (auto const& entry : lane->records_awaiting_completion) {
+        release_from_backlog(entry.second);
+      }
+      lane->records_awaiting_completion.clear();
+      lane->records_awaiting_completion_count = 0;
+    }
+
+    // bytes per microsecond are MB/s
+    double average_writing_rate = 0;
+    if (lane->writing_us_tot.load() > 0) {
+      average_writing_rate = static_cast<double>(lane->bytes_output_tot.load()) / lane->writing_us_tot.load();
     }
+    TLOG() << get_name() << (m_lanes.size() > 1 ? " lane " + std::to_string(lane->index) : std::string())
+           << ": A hdf5 file of size: " << lane->bytes_output_tot
+           << " bytes has been created with the average writing rate: " << average_writing_rate
+           << " MB/s. The file contains " << lane->records_written_tot << " trigger records.";
   }
 
   TLOG() << get_name() << " successfully stopped for run number " << m_run_number;
@@ -212,171 +399,496 @@ DataWriter::do_scrap(const data_t& /*payload*/)
 {
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_scrap() method";
 
-  // clear/reset the DataStore instance here
-  m_data_writer.reset();
+  // clear/reset the DataStore instances here
+  {
+    std::lock_guard<std::mutex> lk(m_data_writer_mutex);
+    m_lanes.clear();
+  }
 
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_scrap() method";
 }
 
 void
-DataWriter::receive_trigger_record(std::unique_ptr<daqdataformats::TriggerRecord> & trigger_record_ptr)
+DataWriter::receive_trigger_records(std::vector<std::unique_ptr<daqdataformats::TriggerRecord>>& trigger_records)
 {
-  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": receiving a new TR ptr";
-
-  ++m_records_received;
-  ++m_records_received_tot;
-  TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Obtained the TriggerRecord for trigger number "
-			      << trigger_record_ptr->get_header_ref().get_trigger_number() << "."
-			      << trigger_record_ptr->get_header_ref().get_sequence_number()
-			      << ", run number " << trigger_record_ptr->get_header_ref().get_run_number()
-			      << " off the input connection";
-
-  if (trigger_record_ptr->get_header_ref().get_run_number() != m_run_number) {
-    ers::error(InvalidRunNumber(ERS_HERE, get_name(), "TriggerRecord", trigger_record_ptr->get_header_ref().get_run_number(),
-                                m_run_number, trigger_record_ptr->get_header_ref().get_trigger_number(),
-                                trigger_record_ptr->get_header_ref().get_sequence_number()));
-    return;
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": receiving " << trigger_records.size() << " new TR ptrs";
+
+  // The DataStore may take ownership of the TriggerRecords when they are written (e.g. when
+  // it writes asynchronously), so the values that are needed after the write are saved here.
+  std::vector<TriggerRecordInfo> records_to_write_infos;
+  std::vector<TriggerRecordInfo> records_not_to_write_infos;
+  std::vector<std::unique_ptr<daqdataformats::TriggerRecord>> records_to_write;
+
+  auto receive_time = std::chrono::steady_clock::now();
+  for (auto& trigger_record_ptr : trigger_records) {
+    ++m_records_received;
+    ++m_records_received_tot;
+    TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Obtained the TriggerRecord for trigger number "
+                                << trigger_record_ptr->get_header_ref().get_trigger_number() << "."
+                                << trigger_record_ptr->get_header_ref().get_sequence_number() << ", run number "
+                                << trigger_record_ptr->get_header_ref().get_run_number() << " off the input connection";
+
+    if (trigger_record_ptr->get_header_ref().get_run_number() != m_run_number) {
+      ers::error(InvalidRunNumber(ERS_HERE,
+                                  get_name(),
+                                  "TriggerRecord",
+                                  trigger_record_ptr->get_header_ref().get_run_number(),
+                                  m_run_number,
+                                  trigger_record_ptr->get_header_ref().get_trigger_number(),
+                                  trigger_record_ptr->get_header_ref().get_sequence_number()));
+      continue;
+    }
+
+    TriggerRecordInfo record_info;
+    record_info.trigger_number = trigger_record_ptr->get_header_ref().get_trigger_number();
+    record_info.sequence_number = trigger_record_ptr->get_header_ref().get_sequence_number();
+    record_info.max_sequence_number = trigger_record_ptr->get_header_ref().get_max_sequence_number();
+    record_info.run_number = trigger_record_ptr->get_header_ref().get_run_number();
+    record_info.size_bytes = trigger_record_ptr->get_total_size_bytes();
+    record_info.receive_time = receive_time;
+
+    // 03-Feb-2021, KAB: adding support for a data-storage prescale.
+    // In this "if" statement, I deliberately compare the result of (N mod prescale) to 1
+    // instead of zero, since I think that it would be nice to always get the first event
+    // written out.
+    if (m_data_storage_is_enabled &&
+        (m_data_storage_prescale <= 1 || ((m_records_received_tot.load() % m_data_storage_prescale) == 1))) {
+      records_to_write_infos.push_back(record_info);
+      records_to_write.push_back(std::move(trigger_record_ptr));
+    } else {
+      records_not_to_write_infos.push_back(record_info);
+    }
   }
 
-  // 03-Feb-2021, KAB: adding support for a data-storage prescale.
-  // In this "if" statement, I deliberately compare the result of (N mod prescale) to 1
-  // instead of zero, since I think that it would be nice to always get the first event
-  // written out.
-  if (m_data_storage_prescale <= 1 || ((m_records_received_tot.load() % m_data_storage_prescale) == 1)) {
-    
-    if (m_data_storage_is_enabled) {
-
-      std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
-      
-      bool should_retry = true;
-      size_t retry_wait_usec = m_min_write_retry_time_usec;
-      do {
-	should_retry = false;
-	try {
-    TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Writing started for trigger record number: " << m_records_received_tot;
-
-double_t start_writing_timestamp = std::chrono::duration_cast<std::chrono::microseconds>(system_clock::now().time_since_epoch()).count();
-	  m_data_writer->write(*trigger_record_ptr);
-double_t stop_writing_timestamp = std::chrono::duration_cast<std::chrono::microseconds>(system_clock::now().time_since_epoch()).count();
-
-TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Writing stopped for trigger record number: " << m_records_received_tot;
-
-	  ++m_records_written;
-	  ++m_records_written_tot;
-	
-  TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Number of written trigger records: " << m_records_written_tot;
-
-    m_bytes_output += trigger_record_ptr->get_total_size_bytes();
-	  m_bytes_output_tot += trigger_record_ptr->get_total_size_bytes();
-
-double_t writing_time = stop_writing_timestamp - start_writing_timestamp;
-TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Writing time is: " << writing_time << " microseconds";
-TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Size of trigger record is: " << m_bytes_for_one_tr << " bytes";
-writing_time_tot += writing_time;
-
-double_t writing_rate = m_bytes_for_one_tr/writing_time;
-writing_rate_tot += writing_rate;
-TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Writing rate is: " << writing_rate << " MB/s";
-average_writing_rate =  writing_rate_tot/m_records_written_tot;
-
-	} catch (const RetryableDataStoreProblem& excpt) {
-	  should_retry = true;
-	  ers::error(DataWritingProblem(ERS_HERE,
-					get_name(),
-					trigger_record_ptr->get_header_ref().get_trigger_number(),
-					trigger_record_ptr->get_header_ref().get_sequence_number(),
-					trigger_record_ptr->get_header_ref().get_run_number(),
-					excpt));
-	  if (retry_wait_usec > m_max_write_retry_time_usec) {
-	    retry_wait_usec = m_max_write_retry_time_usec;
-	  }
-	  usleep(retry_wait_usec);
-	  retry_wait_usec *= m_write_retry_time_increase_factor;
-	} catch (const std::exception& excpt) {
-	  ers::error(DataWritingProblem(ERS_HERE,
-					get_name(),
-					trigger_record_ptr->get_header_ref().get_trigger_number(),
-					trigger_record_ptr->get_header_ref().get_sequence_number(),
-					trigger_record_ptr->get_header_ref().get_run_number(),
-					excpt));
-	}
-      } while (should_retry && m_running.load());
-
-      std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
-      std::chrono::milliseconds writing_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-      m_writing_ms += writing_time.count();
-    } //  if m_data_storage_is_enabled
+  // the TriggerRecords stay in the backlog until they have been written, or until the DataStore
+  // reports that their data is on disk; while the backlog fits in the budget, their tokens are
+  // sent as soon as they have been queued
+  for (auto& record_info : records_to_write_infos) {
+    uint64_t backlog_bytes = (m_backlog_bytes += record_info.size_bytes); // NOLINT(build/unsigned)
+    record_info.token_released_early =
+      (m_token_release_budget_bytes > 0 && backlog_bytes <= m_token_release_budget_bytes);
   }
-  
-  bool send_trigger_complete_message = true;
-  if (trigger_record_ptr->get_header_ref().get_max_sequence_number() > 0) {
-    send_trigger_complete_message = false;
-    daqdataformats::trigger_number_t trigno = trigger_record_ptr->get_header_ref().get_trigger_number();
-    if (m_seqno_counts.count(trigno) > 0) {
-      ++m_seqno_counts[trigno];
+
+  // the tokens of the TriggerRecords that are not written, and the ones that are released early,
+  // are sent together once all of the TriggerRecords have been handed on
+  std::vector<TriggerRecordInfo> tokens_due = std::move(records_not_to_write_infos);
+  if (!records_to_write.empty()) {
+    if (m_lanes.front()->thread.get() == nullptr) {
+      // the TriggerRecords are written in batches of at most m_max_records_per_batch, and the
+      // tokens of all of them are sent together once the last batch has been written
+      WriterLane& lane = *m_lanes.front();
+      std::vector<std::unique_ptr<daqdataformats::TriggerRecord>> batch;
+      std::vector<TriggerRecordInfo> batch_infos;
+      for (size_t first = 0; first < records_to_write.size(); first += m_max_records_per_batch) {
+        size_t last = std::min(first + m_max_records_per_batch, records_to_write.size());
+        batch.clear();
+        for (size_t idx = first; idx < last; ++idx) {
+          batch.push_back(std::move(records_to_write[idx]));
+        }
+        batch_infos.assign(records_to_write_infos.begin() + first, records_to_write_infos.begin() + last);
+        write_trigger_records(lane, batch, batch_infos);
+      }
+      send_tokens_for_written_records(lane, records_to_write_infos);
     } else {
-      m_seqno_counts[trigno] = 1;
+      for (size_t idx = 0; idx < records_to_write.size(); ++idx) {
+        // queueing a TriggerRecord that does not fit in the budget may wait for room in its lane,
+        // so the tokens that are already due are sent first
+        if (!records_to_write_infos[idx].token_released_early) {
+          send_tokens_if_complete(tokens_due);
+          tokens_due.clear();
+        }
+        queue_for_lane(select_lane(records_to_write_infos[idx]),
+                       std::move(records_to_write[idx]),
+                       records_to_write_infos[idx]);
+        if (records_to_write_infos[idx].token_released_early) {
+          ++m_tokens_released_early;
+          tokens_due.push_back(records_to_write_infos[idx]);
+        }
+      }
     }
-    // in the following comparison GT (>) is used since the counts are one-based and the
-    // max sequence number is zero-based.
-    if (m_seqno_counts[trigno] > trigger_record_ptr->get_header_ref().get_max_sequence_number()) {
-      send_trigger_complete_message = true;
-      m_seqno_counts.erase(trigno);
-    } else {
-      // by putting this TLOG call in an "else" clause, we avoid resurrecting the "trigno"
-      // entry in the map after erasing it above. In other words, if we move this TLOG outside
-      // the "else" clause, the map will forever increase in size.
-      TLOG_DEBUG(TLVL_SEQNO_MAP_CONTENTS) << get_name() << ": the sequence number count for trigger number " << trigno
-					  << " is " << m_seqno_counts[trigno] << " (number of entries "
-					  << "in the seqno map is " << m_seqno_counts.size() << ").";
+  }
+  send_tokens_if_complete(tokens_due);
+
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": operations completed for " << trigger_records.size()
+                                      << " TRs";
+}
+
+DataWriter::WriterLane&
+DataWriter::select_lane(const TriggerRecordInfo& record_info)
+{
+  if (!m_dispatch_to_least_loaded_lane) {
+    // all of the sequence numbers of a trigger go to the same lane
+    return *m_lanes[record_info.trigger_number % m_lanes.size()];
+  }
+  WriterLane* least_loaded_lane = m_lanes.front().get();
+  for (auto const& lane : m_lanes) {
+    if (lane->pending_bytes.load() < least_loaded_lane->pending_bytes.load()) {
+      least_loaded_lane = lane.get();
     }
   }
-  if (send_trigger_complete_message) {
-    TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Pushing the TriggerDecisionToken for trigger number "
-				<< trigger_record_ptr->get_header_ref().get_trigger_number()
-				<< " onto the relevant output queue";
-    dfmessages::TriggerDecisionToken token;
-    token.run_number = m_run_number;
-    token.trigger_number = trigger_record_ptr->get_header_ref().get_trigger_number();
-    token.decision_destination = m_trigger_decision_connection;
-
-    bool wasSentSuccessfully = false;
-    do { 
-      try {
-	m_token_output -> send( std::move(token), m_queue_timeout );
-	wasSentSuccessfully = true;
-  ++m_tokens_sent;
-  TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Token number: " << m_tokens_sent << " has been sent.";
-      } catch (const ers::Issue& excpt) {
-	std::ostringstream oss_warn;
-	oss_warn << "Send with sender \"" << m_token_output -> get_name() << "\" failed";
-	ers::warning(iomanager::OperationFailed(ERS_HERE, oss_warn.str(), excpt));
+  return *least_loaded_lane;
+}
+
+void
+DataWriter::queue_for_lane(WriterLane& lane,
+                           std::unique_ptr<daqdataformats::TriggerRecord> trigger_record,
+                           const TriggerRecordInfo& record_info)
+{
+  std::unique_lock<std::mutex> lk(lane.queue_mutex);
+  // a lane holds at most one batch beyond the one that it is writing, so that a slow lane
+  // holds back the input connection, unless the TriggerRecord fits in the budget for early
+  // token release; at stop, the TriggerRecord is queued regardless, since the lane writes
+  // everything that is queued before it stops
+  while (!record_info.token_released_early && lane.queue.size() >= m_max_records_per_batch && m_running.load()) {
+    lane.queue_cv.wait_for(lk, m_queue_timeout);
+  }
+  lane.queue.emplace_back(std::move(trigger_record), record_info);
+  lane.pending_bytes += record_info.size_bytes;
+  lk.unlock();
+  lane.queue_cv.notify_all();
+}
+
+void
+DataWriter::write_trigger_records(WriterLane& lane,
+                                  std::vector<std::unique_ptr<daqdataformats::TriggerRecord>>& trigger_records,
+                                  const std::vector<TriggerRecordInfo>& record_infos)
+{
+  std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+  for (auto const& record_info : record_infos) {
+    m_queue_wait_latency.record(start_time - record_info.receive_time);
+  }
+
+  // entries are nulled by the DataStore as they are written, and dropped entries are
+  // nulled here, so this keeps track of which null entries have already been counted
+  std::vector<bool> is_accounted_for(trigger_records.size(), false);
+  std::vector<bool> is_dropped(trigger_records.size(), false);
+  auto first_unwritten_index = [&]() {
+    return static_cast<size_t>(
+      std::distance(trigger_records.begin(),
+                    std::find_if(trigger_records.begin(), trigger_records.end(), [](auto const& tr_ptr) {
+                      return tr_ptr.get() != nullptr;
+                    })));
+  };
+  // the DataStore may also fail after the last entry has been written, in which case the
+  // problem is reported for the last entry
+  auto failed_index = [&]() { return std::min(first_unwritten_index(), trigger_records.size() - 1); };
+
+  bool should_retry = true;
+  size_t retry_wait_usec = m_min_write_retry_time_usec;
+  do {
+    should_retry = false;
+    TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Writing started for a batch of " << trigger_records.size()
+                                << " trigger records";
+
+    auto start_writing_time = std::chrono::steady_clock::now();
+    try {
+      lane.data_store->write(trigger_records);
+    } catch (const RetryableDataStoreProblem& excpt) {
+      should_retry = (first_unwritten_index() < trigger_records.size());
+      auto const& record_info = record_infos[failed_index()];
+      ers::error(DataWritingProblem(ERS_HERE,
+                                    get_name(),
+                                    record_info.trigger_number,
+                                    record_info.sequence_number,
+                                    record_info.run_number,
+                                    excpt));
+      if (retry_wait_usec > m_max_write_retry_time_usec) {
+        retry_wait_usec = m_max_write_retry_time_usec;
+      }
+      usleep(retry_wait_usec);
+      retry_wait_usec *= m_write_retry_time_increase_factor;
+    } catch (const std::exception& excpt) {
+      // the first entry that has not been written is the one that failed; it is dropped,
+      // and the rest of the batch is written
+      size_t index_of_failure = failed_index();
+      auto const& record_info = record_infos[index_of_failure];
+      ers::error(DataWritingProblem(ERS_HERE,
+                                    get_name(),
+                                    record_info.trigger_number,
+                                    record_info.sequence_number,
+                                    record_info.run_number,
+                                    excpt));
+      if (trigger_records[index_of_failure].get() != nullptr) {
+        trigger_records[index_of_failure].reset();
+        is_accounted_for[index_of_failure] = true;
+        is_dropped[index_of_failure] = true;
+      }
+      should_retry = (first_unwritten_index() < trigger_records.size());
+    }
+    auto writing_duration = std::chrono::steady_clock::now() - start_writing_time;
+    m_write_latency.record(writing_duration);
+    auto writing_us = std::chrono::duration_cast<std::chrono::microseconds>(writing_duration).count();
+    lane.writing_us_tot += writing_us;
+
+    // the TriggerRecords that are still on their way to disk are counted as written once
+    // the DataStore reports that their writes have completed
+    size_t bytes_written = 0;
+    for (size_t idx = 0; idx < trigger_records.size(); ++idx) {
+      if (trigger_records[idx].get() == nullptr && !is_accounted_for[idx]) {
+        is_accounted_for[idx] = true;
+        bytes_written += record_infos[idx].size_bytes;
+        if (lane.reports_completions) {
+          lane.records_awaiting_completion[DataStore::record_id_t(record_infos[idx].trigger_number,
+                                                                  record_infos[idx].sequence_number)] =
+            record_infos[idx];
+        } else {
+          count_written_record(lane, record_infos[idx]);
+        }
       }
-    } while (!wasSentSuccessfully && m_running.load());
+    }
+    if (lane.reports_completions) {
+      lane.records_awaiting_completion_count = lane.records_awaiting_completion.size();
+    }
+    TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Number of written trigger records: " << m_records_written_tot;
+
+    if (bytes_written > 0 && writing_us > 0) {
+      TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Wrote " << bytes_written << " bytes in " << writing_us
+                                  << " microseconds, a writing rate of "
+                                  << static_cast<double>(bytes_written) / writing_us << " MB/s";
+    }
+  } while (should_retry && m_running.load());
 
+  // the entries that were dropped, or that were given up on when the run was stopped, have not
+  // been written
+  for (size_t idx = 0; idx < trigger_records.size(); ++idx) {
+    if (is_dropped[idx] || trigger_records[idx].get() != nullptr) {
+      count_unwritten_record(record_infos[idx]);
+    }
   }
-  
-  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": operations completed for TR";
-} // NOLINT(readability/fn_size)
+
+  std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+  std::chrono::milliseconds writing_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+  m_writing_ms += writing_time.count();
+}
+
+void
+DataWriter::send_tokens_for_written_records(WriterLane& lane, const std::vector<TriggerRecordInfo>& record_infos)
+{
+  // the tokens of the TriggerRecords that are still on their way to disk are sent
+  // once the DataStore reports that their writes have completed
+  std::vector<TriggerRecordInfo> tokens_due;
+  for (auto const& record_info : record_infos) {
+    if (lane.records_awaiting_completion.count(
+          DataStore::record_id_t(record_info.trigger_number, record_info.sequence_number)) == 0) {
+      release_from_backlog(record_info);
+      if (!record_info.token_released_early) {
+        tokens_due.push_back(record_info);
+      }
+    }
+  }
+  send_tokens_if_complete(tokens_due);
+}
+
+void
+DataWriter::send_tokens_if_complete(const std::vector<TriggerRecordInfo>& record_infos)
+{
+  if (record_infos.empty()) {
+    return;
+  }
+
+  // the tokens of all of the TriggerRecords are sent together, with a single lock
+  std::lock_guard<std::mutex> lk(m_token_mutex);
+  for (auto const& record_info : record_infos) {
+    bool send_trigger_complete_message = true;
+    if (record_info.max_sequence_number > 0) {
+      send_trigger_complete_message = false;
+      daqdataformats::trigger_number_t trigno = record_info.trigger_number;
+      if (m_seqno_counts.count(trigno) > 0) {
+        ++m_seqno_counts[trigno];
+      } else {
+        m_seqno_counts[trigno] = 1;
+      }
+      // in the following comparison GT (>) is used since the counts are one-based and the
+      // max sequence number is zero-based.
+      if (m_seqno_counts[trigno] > record_info.max_sequence_number) {
+        send_trigger_complete_message = true;
+        m_seqno_counts.erase(trigno);
+      } else {
+        // by putting this TLOG call in an "else" clause, we avoid resurrecting the "trigno"
+        // entry in the map after erasing it above. In other words, if we move this TLOG outside
+        // the "else" clause, the map will forever increase in size.
+        TLOG_DEBUG(TLVL_SEQNO_MAP_CONTENTS) << get_name() << ": the sequence number count for trigger number "
+                                            << trigno << " is " << m_seqno_counts[trigno] << " (number of entries "
+                                            << "in the seqno map is " << m_seqno_counts.size() << ").";
+      }
+    }
+    if (send_trigger_complete_message) {
+      send_token(record_info);
+    }
+  }
+}
+
+void
+DataWriter::send_token(const TriggerRecordInfo& record_info)
+{
+  TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Pushing the TriggerDecisionToken for trigger number "
+                              << record_info.trigger_number << " onto the relevant output queue";
+  dfmessages::TriggerDecisionToken token;
+  token.run_number = m_run_number;
+  token.trigger_number = record_info.trigger_number;
+  token.decision_destination = m_trigger_decision_connection;
+
+  auto start_sending_time = std::chrono::steady_clock::now();
+  bool wasSentSuccessfully = false;
+  do {
+    try {
+      m_token_output->send(std::move(token), m_queue_timeout);
+      wasSentSuccessfully = true;
+      ++m_tokens_sent;
+      TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": Token number: " << m_tokens_sent << " has been sent.";
+    } catch (const ers::Issue& excpt) {
+      std::ostringstream oss_warn;
+      oss_warn << "Send with sender \"" << m_token_output->get_name() << "\" failed";
+      ers::warning(iomanager::OperationFailed(ERS_HERE, oss_warn.str(), excpt));
+    }
+  } while (!wasSentSuccessfully && m_running.load());
+
+  auto end_sending_time = std::chrono::steady_clock::now();
+  m_token_send_latency.record(end_sending_time - start_sending_time);
+  // for a trigger with several sequence numbers, this is the time since the last one was received
+  m_end_to_end_latency.record(end_sending_time - record_info.receive_time);
+}
+
+void
+DataWriter::send_tokens_for_completed_records(WriterLane& lane)
+{
+  // the tokens of the TriggerRecords whose writes have failed are sent as well, since the
+  // DFO would otherwise wait for them forever
+  std::vector<TriggerRecordInfo> tokens_due;
+  for (bool write_failed : { false, true }) {
+    auto record_ids =
+      write_failed ? lane.data_store->take_failed_records() : lane.data_store->take_completed_records();
+    for (auto const& record_id : record_ids) {
+      auto iter = lane.records_awaiting_completion.find(record_id);
+      if (iter == lane.records_awaiting_completion.end()) {
+        continue;
+      }
+      TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": The write of TriggerRecord " << record_id.first << "."
+                                  << record_id.second << (write_failed ? " has failed" : " has completed");
+      if (write_failed) {
+        count_unwritten_record(iter->second);
+      } else {
+        count_written_record(lane, iter->second);
+      }
+      release_from_backlog(iter->second);
+      if (!iter->second.token_released_early) {
+        tokens_due.push_back(iter->second);
+      }
+      lane.records_awaiting_completion.erase(iter);
+    }
+  }
+  lane.records_awaiting_completion_count = lane.records_awaiting_completion.size();
+  send_tokens_if_complete(tokens_due);
+}
+
+void
+DataWriter::count_written_record(WriterLane& lane, const TriggerRecordInfo& record_info)
+{
+  ++m_records_written;
+  ++m_records_written_tot;
+  ++lane.records_written;
+  ++lane.records_written_tot;
+  m_bytes_output += record_info.size_bytes;
+  m_bytes_output_tot += record_info.size_bytes;
+  lane.bytes_output += record_info.size_bytes;
+  lane.bytes_output_tot += record_info.size_bytes;
+}
 
 void
-DataWriter::do_work(std::atomic<bool>& running_flag) {
+DataWriter::count_unwritten_record(const TriggerRecordInfo& record_info)
+{
+  ++m_records_not_written;
+  // the DFO already considers a TriggerRecord whose token has been sent as done, so it is reported individually
+  if (record_info.token_released_early) {
+    ers::error(RecordNotWrittenAfterTokenRelease(
+      ERS_HERE, get_name(), record_info.trigger_number, record_info.sequence_number, record_info.run_number));
+  }
+}
+
+void
+DataWriter::release_from_backlog(const TriggerRecordInfo& record_info)
+{
+  m_backlog_bytes -= record_info.size_bytes;
+}
+
+void
+DataWriter::do_work(std::atomic<bool>& running_flag)
+{
+  std::vector<std::unique_ptr<daqdataformats::TriggerRecord>> trigger_records;
   while (running_flag.load()) {
-	  try {
-		std::unique_ptr<daqdataformats::TriggerRecord> tr = m_tr_receiver-> receive(std::chrono::milliseconds(10));   
-                receive_trigger_record(tr);
-    TLOG_DEBUG(TLVL_RECEIVE_TR) << get_name() << ": Received a new TR";
-	  }
-	  catch(const iomanager::TimeoutExpired& excpt) {
-	  }
-	  catch(const ers::Issue & excpt) {
-		ers::warning(excpt);
-	  }
+    trigger_records.clear();
+
+    // wait for the first TriggerRecord, and then take all of the ones that are already waiting
+    // in the same wakeup, so that they are handed on and their tokens are sent together
+    try {
+      auto trigger_record = m_tr_receiver->try_receive(std::chrono::milliseconds(10));
+      while (trigger_record.has_value()) {
+        trigger_records.push_back(std::move(*trigger_record));
+        if (trigger_records.size() >= m_max_records_per_wakeup) {
+          break;
+        }
+        trigger_record = m_tr_receiver->try_receive(iomanager::Receiver::s_no_block);
+      }
+    } catch (const ers::Issue& excpt) {
+      ers::warning(excpt);
+    }
+
+    if (!trigger_records.empty()) {
+      TLOG_DEBUG(TLVL_RECEIVE_TR) << get_name() << ": Received " << trigger_records.size() << " new TRs";
+      receive_trigger_records(trigger_records);
+    }
+
+    // completions are also picked up while no new TriggerRecords arrive; lanes with
+    // their own threads do this themselves
+    if (m_lanes.front()->thread.get() == nullptr && m_lanes.front()->reports_completions &&
+        !m_lanes.front()->records_awaiting_completion.empty()) {
+      send_tokens_for_completed_records(*m_lanes.front());
+    }
   }
+}
 
-TLOG() << get_name() << ": A hdf5 file of size: " << m_bytes_output_tot << " bytes has been created with the average writing rate: "
-    	 << average_writing_rate << " MB/s. The file contains " << m_records_written_tot << " trigger records.";  
+void
+DataWriter::do_lane_work(WriterLane& lane, std::atomic<bool>& running_flag)
+{
+  std::vector<std::unique_ptr<daqdataformats::TriggerRecord>> trigger_records;
+  std::vector<TriggerRecordInfo> record_infos;
+  // the TriggerRecords that are still queued when the lane is stopped are written before it exits
+  while (true) {
+    trigger_records.clear();
+    record_infos.clear();
+    {
+      std::unique_lock<std::mutex> lk(lane.queue_mutex);
+      if (lane.queue.empty()) {
+        if (!running_flag.load()) {
+          break;
+        }
+        lane.queue_cv.wait_for(lk, std::chrono::milliseconds(10));
+      }
+      while (!lane.queue.empty() && trigger_records.size() < m_max_records_per_batch) {
+        trigger_records.push_back(std::move(lane.queue.front().first));
+        record_infos.push_back(lane.queue.front().second);
+        lane.queue.pop_front();
+      }
+    }
 
+    if (!trigger_records.empty()) {
+      lane.queue_cv.notify_all(); // there is room in the queue again
+      TLOG_DEBUG(TLVL_RECEIVE_TR) << get_name() << ": Lane " << lane.index << " took " << trigger_records.size()
+                                  << " TRs off its queue";
+      write_trigger_records(lane, trigger_records, record_infos);
+      size_t batch_bytes = 0;
+      for (auto const& record_info : record_infos) {
+        batch_bytes += record_info.size_bytes;
+      }
+      lane.pending_bytes -= batch_bytes;
+      send_tokens_for_written_records(lane, record_infos);
+    }
+
+    // completions are also picked up while no new TriggerRecords arrive
+    if (lane.reports_completions && !lane.records_awaiting_completion.empty()) {
+      send_tokens_for_completed_records(lane);
+    }
+  }
 }
 
 } // namespace dfmodules
@@ -10,6 +10,7 @@
 #define DFMODULES_PLUGINS_DATAWRITER_HPP_
 
 #include "dfmodules/DataStore.hpp"
+#include "dfmodules/LatencyHistogram.hpp"
 
 #include "appfwk/DAQModule.hpp"
 #include "daqdataformats/TriggerRecord.hpp"
@@ -18,10 +19,15 @@
 #include "iomanager/Sender.hpp"
 #include "utilities/WorkerThread.hpp"
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace dunedaq {
@@ -55,7 +61,61 @@ private:
   void do_scrap(const data_t&);
 
   // Callback
-  void receive_trigger_record(std::unique_ptr<daqdataformats::TriggerRecord>&);
+  struct TriggerRecordInfo
+  {
+    daqdataformats::trigger_number_t trigger_number;
+    daqdataformats::sequence_number_t sequence_number;
+    daqdataformats::sequence_number_t max_sequence_number;
+    daqdataformats::run_number_t run_number;
+    size_t size_bytes;
+    std::chrono::steady_clock::time_point receive_time;
+    bool token_released_early = false; // the token was sent when the TriggerRecord was queued
+  };
+
+  /**
+   * @brief A writer lane owns one DataStore, which writes its own files.  With more than
+   * one lane, each lane has its own thread, which writes the TriggerRecords that the
+   * receiving thread has queued for it; a single lane is written by the receiving thread.
+   */
+  struct WriterLane
+  {
+    size_t index = 0;
+    std::unique_ptr<DataStore> data_store;
+
+    // TriggerRecords that are waiting for the thread of the lane
+    std::deque<std::pair<std::unique_ptr<daqdataformats::TriggerRecord>, TriggerRecordInfo>> queue;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::unique_ptr<dunedaq::utilities::WorkerThread> thread;
+    std::atomic<size_t> pending_bytes = { 0 }; // queued or being written, used to find the least-loaded lane
+
+    // TriggerRecords that have been handed to a DataStore that reports the completion of its
+    // writes, and whose tokens are only sent once their data is on disk
+    bool reports_completions = false;
+    std::map<DataStore::record_id_t, TriggerRecordInfo> records_awaiting_completion;
+
+    // Metrics, which are also added to the totals of the DataWriter
+    std::atomic<uint64_t> records_written = { 0 };                   // NOLINT(build/unsigned)
+    std::atomic<uint64_t> records_written_tot = { 0 };               // NOLINT(build/unsigned)
+    std::atomic<uint64_t> bytes_output = { 0 };                      // NOLINT(build/unsigned)
+    std::atomic<uint64_t> bytes_output_tot = { 0 };                  // NOLINT(build/unsigned)
+    std::atomic<uint64_t> records_awaiting_completion_count = { 0 }; // NOLINT(build/unsigned)
+    std::atomic<uint64_t> writing_us_tot = { 0 };                    // NOLINT(build/unsigned)
+  };
+
+  void receive_trigger_records(std::vector<std::unique_ptr<daqdataformats::TriggerRecord>>&);
+  WriterLane& select_lane(const TriggerRecordInfo&);
+  void queue_for_lane(WriterLane&, std::unique_ptr<daqdataformats::TriggerRecord>, const TriggerRecordInfo&);
+  void write_trigger_records(WriterLane&,
+                             std::vector<std::unique_ptr<daqdataformats::TriggerRecord>>&,
+                             const std::vector<TriggerRecordInfo>&);
+  void send_tokens_for_written_records(WriterLane&, const std::vector<TriggerRecordInfo>&);
+  void send_tokens_if_complete(const std::vector<TriggerRecordInfo>&);
+  void send_token(const TriggerRecordInfo&);
+  void send_tokens_for_completed_records(WriterLane&);
+  void count_written_record(WriterLane&, const TriggerRecordInfo&);
+  void count_unwritten_record(const TriggerRecordInfo&);
+  void release_from_backlog(const TriggerRecordInfo&);
   std::atomic<bool> m_running = false;
 
   // Configuration
@@ -67,6 +127,10 @@ private:
   size_t m_min_write_retry_time_usec;
   size_t m_max_write_retry_time_usec;
   int m_write_retry_time_increase_factor;
+  size_t m_max_records_per_batch;
+  size_t m_max_records_per_wakeup;
+  bool m_dispatch_to_least_loaded_lane = false;
+  size_t m_token_release_budget_bytes = 0;
 
   // Connections
   std::string m_trigger_record_connection;
@@ -76,12 +140,15 @@ private:
   using token_sender_t = iomanager::SenderConcept<dfmessages::TriggerDecisionToken>;
   std::shared_ptr<token_sender_t> m_token_output;
   std::string m_trigger_decision_connection;
+  std::mutex m_token_mutex; // protects the sending of tokens and m_seqno_counts against concurrent lanes
 
   // Worker(s)
   dunedaq::utilities::WorkerThread m_thread;
   void do_work(std::atomic<bool>&);
+  void do_lane_work(WriterLane&, std::atomic<bool>&);
 
-  std::unique_ptr<DataStore> m_data_writer;
+  std::vector<std::unique_ptr<WriterLane>> m_lanes;
+  std::mutex m_data_writer_mutex; // protects the creation and deletion of the lanes against get_info() calls
 
   // Metrics
   std::atomic<uint64_t> m_records_received = { 0 };     // NOLINT(build/unsigned)
@@ -92,20 +159,21 @@ private:
   std::atomic<uint64_t> m_bytes_output_tot = { 0 };     // NOLINT(build/unsigned)
   std::atomic<uint64_t> m_writing_ms = { 0 };           // NOLINT(build/unsigned)
   std::atomic<uint64_t> m_tokens_sent = { 0 };     // NOLINT(build/unsigned)
-  std::atomic<uint64_t> m_bytes_for_one_tr = { 0 };         // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_backlog_bytes = { 0 };         // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_tokens_released_early = { 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_records_not_written = { 0 };   // NOLINT(build/unsigned)
+  std::chrono::steady_clock::time_point m_last_info_time; // the start of the interval of the bytes_per_second metric
+
+  // Latencies of the steps of handling a TriggerRecord: the wait between its reception and the
+  // start of its write, each call to the DataStore, the sending of its token, and the whole
+  // time from its reception until its token has been sent
+  LatencyHistogram m_queue_wait_latency;
+  LatencyHistogram m_write_latency;
+  LatencyHistogram m_token_send_latency;
+  LatencyHistogram m_end_to_end_latency;
 
-  double_t writing_time_tot;
-  double_t average_writing_rate;
-  double_t writing_rate_tot;
-  
   // Other
   std::map<daqdataformats::trigger_number_t, size_t> m_seqno_counts;
-
-  inline double elapsed_seconds(std::chrono::steady_clock::time_point then,
-                                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) const
-  {
-    return std::chrono::duration_cast<std::chrono::seconds>(now - then).count();
-  }
 };
 } // namespace dfmodules
 
@@ -117,6 +185,13 @@ ERS_DECLARE_ISSUE_BASE(dfmodules,
                        ((std::string)name),
                        ERS_EMPTY)
 
+ERS_DECLARE_ISSUE_BASE(dfmodules,
+                       InvalidLaneDispatchMode,
+                       appfwk::GeneralDAQModuleIssue,
+                       "The lane dispatch mode \"" << mode << "\" is not one of \"trigger-number\" or \"least-loaded\"",
+                       ((std::string)name),
+                       ((std::string)mode))
+
 ERS_DECLARE_ISSUE_BASE(dfmodules,
                        DataWritingProblem,
                        appfwk::GeneralDAQModuleIssue,
@@ -125,6 +200,14 @@ ERS_DECLARE_ISSUE_BASE(dfmodules,
                        ((std::string)name),
                        ((size_t)trnum)((size_t)seqnum)((size_t)runnum))
 
+ERS_DECLARE_ISSUE_BASE(dfmodules,
+                       RecordNotWrittenAfterTokenRelease,
+                       appfwk::GeneralDAQModuleIssue,
+                       "TriggerRecord number " << trnum << "." << seqnum << " in run " << runnum
+                                               << " was not written, although its token has already been sent",
+                       ((std::string)name),
+                       ((size_t)trnum)((size_t)seqnum)((size_t)runnum))
+
 ERS_DECLARE_ISSUE_BASE(dfmodules,
                        InvalidRunNumber,
                        appfwk::GeneralDAQModuleIssue,
@@ -12,26 +12,58 @@
 #ifndef DFMODULES_PLUGINS_HDF5DATASTORE_HPP_
 #define DFMODULES_PLUGINS_HDF5DATASTORE_HPP_
 
+#include "HDF5FileCache.hpp"
 #include "HDF5FileUtils.hpp"
 #include "dfmodules/DataStore.hpp"
+#include "dfmodules/DiskSpaceMonitor.hpp"
+#include "dfmodules/FileSummaryFile.hpp"
+#include "dfmodules/FragmentCompressor.hpp"
+#include "dfmodules/HDF5FileFlusher.hpp"
+#include "dfmodules/HDF5FileTuning.hpp"
+#include "dfmodules/LatencyHistogram.hpp"
+#include "dfmodules/OutputDirectorySelector.hpp"
+#include "dfmodules/PackedRecordFile.hpp"
+#include "dfmodules/RecordIndexFile.hpp"
+#include "dfmodules/SliceStreamFile.hpp"
+#include "dfmodules/StagedFileMover.hpp"
 #include "dfmodules/hdf5datastore/Nljs.hpp"
 #include "dfmodules/hdf5datastore/Structs.hpp"
+#include "dfmodules/hdf5datastoreinfo/InfoNljs.hpp"
 
 #include "hdf5libs/HDF5RawDataFile.hpp"
 #include "hdf5libs/hdf5filelayout/Nljs.hpp"
 #include "hdf5libs/hdf5filelayout/Structs.hpp"
 
 #include "appfwk/DAQModule.hpp"
+#include "detdataformats/trigger/TriggerPrimitive.hpp"
 #include "logging/Logging.hpp"
 
 #include "boost/date_time/posix_time/posix_time.hpp"
 #include "boost/lexical_cast.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <cstdlib>
+#include <deque>
+#include <filesystem>
 #include <functional>
+#include <future>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <sstream>
 #include <string>
-#include <sys/statvfs.h>
+#include <system_error>
+#include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -50,11 +82,12 @@ ERS_DECLARE_ISSUE_BASE(dfmodules,
                        ((std::string)selected_operation))
 
 ERS_DECLARE_ISSUE_BASE(dfmodules,
-                       FileOperationProblem,
+                       InvalidRecordLayout,
                        appfwk::GeneralDAQModuleIssue,
-                       "A problem was encountered when opening or closing file \"" << filename << "\"",
+                       "Selected record layout \"" << selected_layout
+                                                    << "\" is NOT supported. Please update the configuration file.",
                        ((std::string)name),
-                       ((std::string)filename))
+                       ((std::string)selected_layout))
 
 ERS_DECLARE_ISSUE_BASE(dfmodules,
                        InvalidHDF5Dataset,
@@ -65,29 +98,29 @@ ERS_DECLARE_ISSUE_BASE(dfmodules,
                        ((std::string)data_set)((std::string)filename))
 
 ERS_DECLARE_ISSUE_BASE(dfmodules,
-                       InvalidOutputPath,
+                       EmptyDataBlockList,
                        appfwk::GeneralDAQModuleIssue,
-                       "The specified output destination, \"" << output_path
-                                                              << "\", is not a valid file system path on this server.",
+                       "There was a request to write out a list of data blocks, but the list was empty. "
+                         << "Ignoring this request",
                        ((std::string)name),
-                       ((std::string)output_path))
+                       ERS_EMPTY)
 
 ERS_DECLARE_ISSUE_BASE(dfmodules,
-                       InsufficientDiskSpace,
+                       AsyncWriteQueueFull,
                        appfwk::GeneralDAQModuleIssue,
-                       "There is insufficient free space on the disk associated with output file path \""
-                         << path << "\". There are " << free_bytes << " bytes free, and the "
-                         << "required minimum is " << needed_bytes << " bytes based on " << criteria << ".",
+                       "The queue of data blocks that are waiting to be written is full (" << queued_records
+                         << " data blocks, " << queued_bytes << " bytes).",
                        ((std::string)name),
-                       ((std::string)path)((size_t)free_bytes)((size_t)needed_bytes)((std::string)criteria))
+                       ((size_t)queued_records)((size_t)queued_bytes))
 
 ERS_DECLARE_ISSUE_BASE(dfmodules,
-                       EmptyDataBlockList,
+                       AsyncWriteFailed,
                        appfwk::GeneralDAQModuleIssue,
-                       "There was a request to write out a list of data blocks, but the list was empty. "
-                         << "Ignoring this request",
+                       "A problem was encountered when writing " << record_type << " number " << record_number
+                                                                 << " in run " << run_number
+                                                                 << " on the background I/O thread",
                        ((std::string)name),
-                       ERS_EMPTY)
+                       ((std::string)record_type)((size_t)record_number)((size_t)run_number))
 
 // Re-enable coverage checking LCOV_EXCL_STOP
 namespace dfmodules {
@@ -103,7 +136,8 @@ public:
   enum
   {
     TLVL_BASIC = 2,
-    TLVL_FILE_SIZE = 5
+    TLVL_FILE_SIZE = 5,
+    TLVL_ASYNC_WRITE = 6
   };
 
   /**
@@ -116,6 +150,12 @@ public:
     , m_basic_name_of_open_file("")
     , m_open_flags_of_open_file(0)
     , m_run_number(0)
+    , m_async_queued_bytes(0)
+    , m_io_thread_should_stop(false)
+    , m_current_directory(0)
+    , m_record_number_of_open_file(std::numeric_limits<uint64_t>::max()) // NOLINT(build/unsigned)
+    , m_precreated_file_index(0)
+    , m_precreated_file_directory(0)
   {
     TLOG_DEBUG(TLVL_BASIC) << get_name() << ": Configuration: " << conf;
 
@@ -132,6 +172,15 @@ public:
       m_free_space_safety_factor_for_write = 1.1;
     }
 
+    m_async_write_enabled = m_config_params.async_write_parameters.enabled;
+    m_async_max_queued_bytes = m_config_params.async_write_parameters.max_queued_bytes;
+    m_async_max_queued_records = static_cast<size_t>(std::max(m_config_params.async_write_parameters.max_queued_records, 1));
+
+    m_precreate_next_file = m_config_params.file_rollover_parameters.precreate_next_file;
+    m_precreate_fill_fraction = m_config_params.file_rollover_parameters.precreate_fill_fraction;
+    m_close_in_background = m_config_params.file_rollover_parameters.close_in_background;
+    m_close_at_run_stop_in_background = m_config_params.file_rollover_parameters.close_at_run_stop_in_background;
+
     m_file_index = 0;
     m_recorded_size = 0;
 
@@ -142,13 +191,136 @@ public:
       throw InvalidOperationMode(ERS_HERE, get_name(), m_operation_mode);
     }
 
+    // in the packed layout, each record is written as a single data dataset and an
+    // index table, instead of one dataset per Fragment
+    if (m_config_params.record_layout != "hierarchical" && m_config_params.record_layout != "packed") {
+      throw InvalidRecordLayout(ERS_HERE, get_name(), m_config_params.record_layout);
+    }
+    m_packed_layout = (m_config_params.record_layout == "packed");
+
+    // in the appended TimeSlice layout, the TriggerPrimitives of each SourceID are
+    // appended to one extendible dataset, instead of new datasets for each TimeSlice
+    auto const& ts_layout_params = m_config_params.time_slice_layout_parameters;
+    if (ts_layout_params.layout != "per-record" && ts_layout_params.layout != "appended") {
+      throw InvalidRecordLayout(ERS_HERE, get_name(), ts_layout_params.layout);
+    }
+    m_append_time_slices = (ts_layout_params.layout == "appended");
+    m_time_slice_chunk_size = ts_layout_params.chunk_size_bytes;
+
+    // the output files can be distributed over several directories; when none are
+    // listed in the striping parameters, all files are written to directory_path
+    std::vector<OutputDirectorySelector::DirectoryConfig> output_directories;
+    for (auto const& dir : m_config_params.striping_parameters.output_directories) {
+      output_directories.push_back({ dir.path, dir.weight });
+    }
+    if (output_directories.empty()) {
+      output_directories.push_back({ m_path, 1 });
+    }
+
+    // the free space on the output disks is sampled periodically on separate threads,
+    // so that writes don't need to make a statvfs call for each data block
+    m_directory_selector.reset(new OutputDirectorySelector(
+      get_name(),
+      output_directories,
+      std::chrono::milliseconds(m_config_params.free_space_sampling_interval_ms),
+      m_config_params.striping_parameters.min_write_rate_bytes_per_second,
+      std::chrono::milliseconds(m_config_params.striping_parameters.excluded_directory_retry_interval_ms)));
+
     // 05-Apr-2022, KAB: added warning message when the output destination
     // is not a valid directory.
-    struct statvfs vfs_results;
-    int retval = statvfs(m_path.c_str(), &vfs_results);
-    if (retval != 0) {
-      ers::warning(InvalidOutputPath(ERS_HERE, get_name(), m_path));
+    for (size_t idx = 0; idx < m_directory_selector->get_number_of_directories(); ++idx) {
+      if (!m_directory_selector->get_disk_space_monitor(idx).is_path_valid()) {
+        ers::warning(InvalidOutputPath(ERS_HERE, get_name(), m_directory_selector->get_path(idx)));
+      }
+    }
+    m_directory_selector->start_monitoring();
+
+    // in the two-tier storage mode, the output directories are fast staging areas, and
+    // each file is moved to the bulk directory on a helper thread once it has been closed
+    auto const& tiered_params = m_config_params.tiered_storage_parameters;
+    if (tiered_params.enabled) {
+      if (tiered_params.bulk_directory_path.empty()) {
+        throw InvalidOutputPath(ERS_HERE, get_name(), tiered_params.bulk_directory_path);
+      }
+      StagedFileMover::Policy mover_policy;
+      mover_policy.destination_directory = tiered_params.bulk_directory_path;
+      mover_policy.max_bytes_per_second = tiered_params.max_bytes_per_second;
+      mover_policy.staging_high_water_mark = tiered_params.staging_high_water_mark;
+      m_file_mover.reset(new StagedFileMover(get_name(), mover_policy));
+    }
+
+    // the Fragment payloads are compressed on a pool of worker threads, when any
+    // compression rules are configured
+    std::vector<FragmentCompressor::Rule> compression_rules;
+    for (auto const& rule : m_config_params.compression_parameters.rules) {
+      compression_rules.push_back({ rule.fragment_type,
+                                    rule.detector_group_type,
+                                    FragmentCompressor::string_to_codec(rule.codec),
+                                    rule.level });
+    }
+    if (!compression_rules.empty()) {
+      m_fragment_compressor.reset(
+        new FragmentCompressor(get_name(),
+                               compression_rules,
+                               static_cast<size_t>(std::max(m_config_params.compression_parameters.number_of_threads, 1)),
+                               m_config_params.compression_parameters.min_fragment_size_bytes));
+    }
+
+    // the files are created with tuned HDF5 property lists, when any of the
+    // tuning parameters differs from the HDF5 defaults
+    auto const& tuning_params = m_config_params.file_tuning_parameters;
+    HDF5FileTuning::Settings tuning_settings;
+    tuning_settings.alignment_bytes = tuning_params.alignment_bytes;
+    tuning_settings.alignment_threshold_bytes = tuning_params.alignment_threshold_bytes;
+    tuning_settings.metadata_block_size_bytes = tuning_params.metadata_block_size_bytes;
+    tuning_settings.metadata_cache_initial_size_bytes = tuning_params.metadata_cache_initial_size_bytes;
+    tuning_settings.metadata_cache_max_size_bytes = tuning_params.metadata_cache_max_size_bytes;
+    tuning_settings.page_buffer_size_bytes = tuning_params.page_buffer_size_bytes;
+    tuning_settings.file_space_strategy = tuning_params.file_space_strategy;
+    tuning_settings.file_space_page_size_bytes = tuning_params.file_space_page_size_bytes;
+    tuning_settings.sieve_buffer_size_bytes = tuning_params.sieve_buffer_size_bytes;
+    tuning_settings.libver_low = tuning_params.libver_low;
+    tuning_settings.libver_high = tuning_params.libver_high;
+    tuning_settings.preallocate = tuning_params.preallocate_to_max_file_size;
+    if (HDF5FileTuning::is_tuning_requested(tuning_settings)) {
+      m_file_tuning.reset(new HDF5FileTuning(get_name(), tuning_settings));
+    }
+
+    // the open file is flushed to disk according to the configured policy, beyond
+    // the flushes that the HDF5 library does when its buffers fill up
+    auto const& flush_params = m_config_params.flush_parameters;
+    HDF5FileFlusher::Policy flush_policy;
+    flush_policy.records_between_flushes = static_cast<size_t>(std::max(flush_params.records_between_flushes, 0));
+    flush_policy.bytes_between_flushes = flush_params.bytes_between_flushes;
+    flush_policy.time_between_flushes = std::chrono::milliseconds(std::max(flush_params.ms_between_flushes, 0));
+    flush_policy.sync_at_close = flush_params.sync_at_close;
+    flush_policy.flush_in_background = flush_params.flush_in_background;
+    if (HDF5FileFlusher::is_flushing_requested(flush_policy)) {
+      m_file_flusher.reset(new HDF5FileFlusher(get_name(), flush_policy, HDF5FileUtils::get_hdf5_mutex()));
+    }
+
+    m_write_record_index = m_config_params.write_record_index;
+    m_write_file_summary = m_config_params.write_file_summary;
+
+    m_read_cache.reset(new HDF5FileCache(static_cast<size_t>(std::max(m_config_params.max_open_files_for_reading, 1))));
+  }
+
+  /**
+   * @brief Stops the background I/O thread, if it is running, after the
+   * data blocks that are still in its queue have been written, and waits
+   * for any file operations that are running on helper threads.
+   */
+  ~HDF5DataStore()
+  {
+    try {
+      stop_io_thread();
+      discard_precreated_file();
+      // wait for any file closes that are still in progress, and report their problems
+      reap_background_closes([](const BackgroundClose&) { return true; }, false);
+    } catch (...) { // NOLINT(runtime/exceptions)
+      // exceptions must not escape from the destructor
     }
+    m_background_closes.clear();
   }
 
   /**
@@ -157,45 +329,36 @@ public:
    * into HDF5 format. Operational mode
    * defined in the configuration file.
    *
+   * When asynchronous writing is enabled, the caller keeps the TriggerRecord, so
+   * rather than copying it, it is written here once the background I/O thread has
+   * written the data blocks that were queued before it.
    */
   virtual void write(const daqdataformats::TriggerRecord& tr)
   {
-
-    // check if there is sufficient space for this data block
-    size_t current_free_space = get_free_space(m_path);
-    size_t tr_size = tr.get_total_size_bytes();
-    if (current_free_space < (m_free_space_safety_factor_for_write * tr_size)) {
-      std::ostringstream msg_oss;
-      msg_oss << "a safety factor of " << m_free_space_safety_factor_for_write << " times the trigger record size";
-      InsufficientDiskSpace issue(ERS_HERE,
-                                  get_name(),
-                                  m_path,
-                                  current_free_space,
-                                  (m_free_space_safety_factor_for_write * tr_size),
-                                  msg_oss.str());
-      std::string msg = "writing a trigger record to file " + m_file_handle->get_file_name();
-      throw RetryableDataStoreProblem(ERS_HERE, get_name(), msg, issue);
+    if (m_async_write_enabled) {
+      std::unique_lock<std::mutex> lk(m_async_queue_mutex);
+      m_async_queue_cv.wait(lk, [&]() { return m_async_queue.empty(); });
+      write_trigger_record(tr);
+      m_completed_records.emplace_back(tr.get_header_ref().get_trigger_number(),
+                                       tr.get_header_ref().get_sequence_number());
+      return;
     }
+    write_trigger_record(tr);
+  }
 
-    // check if a new file should be opened for this data block
-    increment_file_index_if_needed(tr_size);
-
-    // determine the filename from Storage Key + configuration parameters
-    std::string full_filename =
-      get_file_name(tr.get_header_ref().get_trigger_number(), tr.get_header_ref().get_run_number());
-
-    try {
-      open_file_if_needed(full_filename, HighFive::File::OpenOrCreate);
-    } catch (std::exception const& excpt) {
-      throw FileOperationProblem(ERS_HERE, get_name(), full_filename, excpt);
-    } catch (...) { // NOLINT(runtime/exceptions)
-      // NOLINT here because we *ARE* re-throwing the exception!
-      throw FileOperationProblem(ERS_HERE, get_name(), full_filename);
+  /**
+   * @brief HDF5DataStore write()
+   * When asynchronous writing is enabled, ownership of the TriggerRecord is
+   * handed to the background I/O thread, otherwise it is written immediately.
+   * A RetryableDataStoreProblem is thrown if the queue of the I/O thread is full.
+   */
+  virtual void write(std::unique_ptr<daqdataformats::TriggerRecord>& tr_ptr)
+  {
+    if (m_async_write_enabled) {
+      enqueue_for_io_thread(tr_ptr);
+      return;
     }
-
-    // write the data block
-    m_file_handle->write(tr);
-    m_recorded_size = m_file_handle->get_recorded_size();
+    write_trigger_record(*tr_ptr);
   }
 
   /**
@@ -204,44 +367,119 @@ public:
    * into HDF5 format. Operational mode
    * defined in the configuration file.
    *
+   * When asynchronous writing is enabled, the TimeSlice is written here once the
+   * background I/O thread has written the data blocks that were queued before it.
    */
   virtual void write(const daqdataformats::TimeSlice& ts)
   {
+    if (m_async_write_enabled) {
+      std::unique_lock<std::mutex> lk(m_async_queue_mutex);
+      m_async_queue_cv.wait(lk, [&]() { return m_async_queue.empty(); });
+      write_time_slice(ts);
+      return;
+    }
+    write_time_slice(ts);
+  }
 
-    // check if there is sufficient space for this data block
-    size_t current_free_space = get_free_space(m_path);
-    size_t ts_size = ts.get_total_size_bytes();
-    if (current_free_space < (m_free_space_safety_factor_for_write * ts_size)) {
-      std::ostringstream msg_oss;
-      msg_oss << "a safety factor of " << m_free_space_safety_factor_for_write << " times the time slice size";
-      InsufficientDiskSpace issue(ERS_HERE,
-                                  get_name(),
-                                  m_path,
-                                  current_free_space,
-                                  (m_free_space_safety_factor_for_write * ts_size),
-                                  msg_oss.str());
-      std::string msg = "writing a time slice to file " + m_file_handle->get_file_name();
-      throw RetryableDataStoreProblem(ERS_HERE, get_name(), msg, issue);
+  /**
+   * @brief HDF5DataStore write()
+   * When asynchronous writing is enabled, ownership of the TimeSlice is
+   * handed to the background I/O thread, otherwise it is written immediately.
+   * A RetryableDataStoreProblem is thrown if the queue of the I/O thread is full.
+   */
+  virtual void write(std::unique_ptr<daqdataformats::TimeSlice>& ts_ptr)
+  {
+    if (m_async_write_enabled) {
+      enqueue_for_io_thread(ts_ptr);
+      return;
     }
+    write_time_slice(*ts_ptr);
+  }
 
-    // check if a new file should be opened for this data block
-    increment_file_index_if_needed(ts_size);
+  /**
+   * @brief HDF5DataStore write()
+   * Writes a batch of TriggerRecords.  When asynchronous writing is enabled,
+   * the whole batch is handed to the background I/O thread at once, otherwise
+   * consecutive TriggerRecords that go into the same file are written together.
+   */
+  virtual void write(std::vector<std::unique_ptr<daqdataformats::TriggerRecord>>& tr_batch)
+  {
+    if (m_async_write_enabled) {
+      enqueue_batch_for_io_thread(tr_batch);
+      return;
+    }
+    write_data_block_batch(tr_batch);
+  }
 
-    // determine the filename from Storage Key + configuration parameters
-    std::string full_filename = get_file_name(ts.get_header().timeslice_number, ts.get_header().run_number);
+  /**
+   * @brief HDF5DataStore write()
+   * Writes a batch of TimeSlices, in the same way as the batches of TriggerRecords.
+   */
+  virtual void write(std::vector<std::unique_ptr<daqdataformats::TimeSlice>>& ts_batch)
+  {
+    if (m_async_write_enabled) {
+      enqueue_batch_for_io_thread(ts_batch);
+      return;
+    }
+    write_data_block_batch(ts_batch);
+  }
 
-    try {
-      open_file_if_needed(full_filename, HighFive::File::OpenOrCreate);
-    } catch (std::exception const& excpt) {
-      throw FileOperationProblem(ERS_HERE, get_name(), full_filename, excpt);
-    } catch (...) { // NOLINT(runtime/exceptions)
-      // NOLINT here because we *ARE* re-throwing the exception!
-      throw FileOperationProblem(ERS_HERE, get_name(), full_filename);
+  /**
+   * @brief When asynchronous writing is enabled, the TriggerRecords are reported
+   * once the background I/O thread has written them.
+   */
+  bool reports_write_completions() const { return m_async_write_enabled; }
+
+  /**
+   * @brief Returns the TriggerRecords that have been written since the previous call.
+   */
+  std::vector<record_id_t> take_completed_records()
+  {
+    std::vector<record_id_t> completed_records;
+    std::lock_guard<std::mutex> lk(m_async_queue_mutex);
+    completed_records.swap(m_completed_records);
+    return completed_records;
+  }
+
+  /**
+   * @brief Returns the TriggerRecords that the background I/O thread has failed to
+   * write since the previous call (the failures have been reported).
+   */
+  std::vector<record_id_t> take_failed_records()
+  {
+    std::vector<record_id_t> failed_records;
+    std::lock_guard<std::mutex> lk(m_async_queue_mutex);
+    failed_records.swap(m_failed_records);
+    return failed_records;
+  }
+
+  /**
+   * @brief Fills the operational monitoring information of the HDF5DataStore.
+   */
+  void get_info(opmonlib::InfoCollector& ci, int level)
+  {
+    m_directory_selector->get_info(ci, level);
+    if (m_fragment_compressor.get() != nullptr) {
+      opmonlib::InfoCollector compression_ci;
+      m_fragment_compressor->get_info(compression_ci, level);
+      ci.add("compression", compression_ci);
     }
 
-    // write the data block
-    m_file_handle->write(ts);
-    m_recorded_size = m_file_handle->get_recorded_size();
+    add_latency_info(ci, "free_space_check_latency", m_free_space_check_latency);
+    add_latency_info(ci, "file_name_latency", m_file_name_latency);
+    add_latency_info(ci, "file_open_latency", m_file_open_latency);
+    add_latency_info(ci, "write_latency", m_write_latency);
+    add_latency_info(ci, "close_latency", m_close_latency);
+    if (m_file_flusher.get() != nullptr) {
+      add_latency_info(ci, "flush_latency", m_file_flusher->get_flush_latency());
+      add_latency_info(ci, "sync_latency", m_file_flusher->get_sync_latency());
+    }
+    if (m_file_mover.get() != nullptr) {
+      opmonlib::InfoCollector mover_ci;
+      m_file_mover->get_info(mover_ci, level);
+      ci.add("staged_file_mover", mover_ci);
+      add_latency_info(ci, "move_latency", m_file_mover->get_move_latency());
+    }
   }
 
   /**
@@ -257,26 +495,71 @@ public:
   {
     m_run_number = run_number;
 
-    struct statvfs vfs_results;
-    TLOG_DEBUG(TLVL_BASIC) << get_name() << ": Preparing to get the statvfs results for path: \"" << m_path << "\"";
+    // the last files of the previous runs may still be being closed; only the ones with the
+    // same run number need to be finished first, since the new files could reuse the names of the
+    // files that are still being closed
+    reap_background_closes(
+      [run_number](const BackgroundClose& background_close) { return background_close.run_number == run_number; },
+      false);
 
-    int retval = statvfs(m_path.c_str(), &vfs_results);
-    TLOG_DEBUG(TLVL_BASIC) << get_name() << ": statvfs return code is " << retval;
-    if (retval != 0) {
-      throw InvalidOutputPath(ERS_HERE, get_name(), m_path);
+    TLOG_DEBUG(TLVL_BASIC) << get_name() << ": Preparing to get the statvfs results for the output directories";
+
+    // all directories are put back into the rotation at the start of a run, and the
+    // run can start as long as at least one of them is usable
+    std::vector<size_t> invalid_directories = m_directory_selector->reset();
+    size_t number_of_directories = m_directory_selector->get_number_of_directories();
+    for (size_t idx : invalid_directories) {
+      if (invalid_directories.size() == number_of_directories) {
+        throw InvalidOutputPath(ERS_HERE, get_name(), m_directory_selector->get_path(idx));
+      }
+      ers::warning(InvalidOutputPath(ERS_HERE, get_name(), m_directory_selector->get_path(idx)));
     }
 
-    size_t free_space = vfs_results.f_bsize * vfs_results.f_bavail;
-    TLOG_DEBUG(TLVL_BASIC) << get_name() << ": Free space on disk with path \"" << m_path << "\" is " << free_space
-                           << " bytes. This will be compared with the maximum size of a single file ("
-                           << m_max_file_size << ") as a simple test to see if there is enough free space.";
-    if (free_space < m_max_file_size) {
-      throw InsufficientDiskSpace(
-        ERS_HERE, get_name(), m_path, free_space, m_max_file_size, "the configured maximum size of a single file");
+    std::optional<size_t> first_directory = m_directory_selector->select(m_max_file_size);
+    if (!first_directory.has_value() && !m_background_closes.empty()) {
+      // files that are still being closed may hold disk space that is released when they are closed
+      reap_background_closes([](const BackgroundClose&) { return true; }, false);
+      m_directory_selector->reset();
+      first_directory = m_directory_selector->select(m_max_file_size);
+    }
+    if (!first_directory.has_value()) {
+      size_t free_space = m_directory_selector->get_disk_space_monitor(m_current_directory).get_measured_free_space();
+      throw InsufficientDiskSpace(ERS_HERE,
+                                  get_name(),
+                                  m_directory_selector->get_path(m_current_directory),
+                                  free_space,
+                                  m_max_file_size,
+                                  "the configured maximum size of a single file");
     }
+    m_current_directory = *first_directory;
+    if (m_file_mover.get() != nullptr &&
+        !std::filesystem::is_directory(m_file_mover->get_policy().destination_directory)) {
+      throw InvalidOutputPath(ERS_HERE, get_name(), m_file_mover->get_policy().destination_directory);
+    }
+    TLOG_DEBUG(TLVL_BASIC) << get_name() << ": the first file of run " << run_number << " will be written to \""
+                           << m_directory_selector->get_path(m_current_directory) << "\"";
 
     m_file_index = 0;
     m_recorded_size = 0;
+
+    // files from an earlier run with the same number may be overwritten when the
+    // unique filename suffix is disabled, so the cached file contents are forgotten
+    m_read_cache->clear();
+
+    // re-read the hardware map at the start of each run, in case it has changed
+    {
+      std::lock_guard<std::mutex> hdf5_lock(HDF5FileUtils::get_hdf5_mutex());
+      m_hw_map_service.reset();
+    }
+
+    if (m_async_write_enabled) {
+      {
+        std::lock_guard<std::mutex> lk(m_async_queue_mutex);
+        m_completed_records.clear();
+        m_failed_records.clear();
+      }
+      start_io_thread();
+    }
   }
 
   /**
@@ -288,19 +571,100 @@ public:
    */
   void finish_with_run(daqdataformats::run_number_t /*run_number*/)
   {
+    // write out everything that is still queued before the file is closed
+    stop_io_thread();
+
+    discard_precreated_file();
+
     if (m_file_handle.get() != nullptr) {
-      std::string open_filename = m_file_handle->get_file_name();
       try {
-        m_file_handle.reset();
-        m_run_number = 0;
-      } catch (std::exception const& excpt) {
-        m_run_number = 0;
-        throw FileOperationProblem(ERS_HERE, get_name(), open_filename, excpt);
+        if (m_file_flusher.get() != nullptr) {
+          m_file_flusher->finish_file();
+        }
+        write_file_summary();
+        close_layout_writers();
+        if (m_close_at_run_stop_in_background) {
+          close_file_in_background(std::move(m_file_handle));
+        } else {
+          close_file(std::move(m_file_handle));
+        }
       } catch (...) { // NOLINT(runtime/exceptions)
         m_run_number = 0;
+        reap_background_closes(false);
         // NOLINT here because we *ARE* re-throwing the exception!
-        throw FileOperationProblem(ERS_HERE, get_name(), open_filename);
+        throw;
+      }
+    }
+    m_run_number = 0;
+    // the closes that are still in progress are reported when they have finished, at the latest
+    // by the prepare_for_run() of a run with the same number, or by the destructor
+    reap_background_closes(!m_close_at_run_stop_in_background);
+  }
+
+  /**
+   * @brief Returns the records of the specified run that are in the files that have been
+   * closed, in all of the output directories.  Files that are still being written are not
+   * included.
+   */
+  std::vector<record_id_t> get_record_ids(daqdataformats::run_number_t run_number)
+  {
+    std::set<record_id_t> record_ids;
+    try {
+      for (auto const& file_name : get_closed_files_of_run(run_number)) {
+        std::set<record_id_t> file_record_ids = m_read_cache->get_record_ids(file_name);
+        record_ids.insert(file_record_ids.begin(), file_record_ids.end());
+      }
+    } catch (std::exception const& excpt) {
+      throw GeneralDataStoreProblem(
+        ERS_HERE, get_name(), "listing the records of run " + std::to_string(run_number), excpt);
+    }
+    return std::vector<record_id_t>(record_ids.begin(), record_ids.end());
+  }
+
+  /**
+   * @brief Reads a TriggerRecord from the file that contains it.  The file stays open
+   * in the read cache, so that subsequent reads from the same file are fast.
+   */
+  std::unique_ptr<daqdataformats::TriggerRecord> read_trigger_record(daqdataformats::run_number_t run_number,
+                                                                     daqdataformats::trigger_number_t trigger_number,
+                                                                     daqdataformats::sequence_number_t sequence_number)
+  {
+    record_id_t record_id = std::make_pair(trigger_number, sequence_number);
+    try {
+      std::string file_name = find_file_of_record(run_number, record_id);
+      if (file_name.empty()) {
+        return nullptr;
+      }
+      return m_read_cache->read_trigger_record(file_name, record_id);
+    } catch (std::exception const& excpt) {
+      throw GeneralDataStoreProblem(ERS_HERE,
+                                    get_name(),
+                                    "reading trigger record " + std::to_string(trigger_number) + "." +
+                                      std::to_string(sequence_number) + " of run " + std::to_string(run_number),
+                                    excpt);
+    }
+  }
+
+  /**
+   * @brief Reads one Fragment of a TriggerRecord from the file that contains it
+   */
+  std::unique_ptr<daqdataformats::Fragment> read_fragment(daqdataformats::run_number_t run_number,
+                                                          daqdataformats::trigger_number_t trigger_number,
+                                                          daqdataformats::sequence_number_t sequence_number,
+                                                          const daqdataformats::SourceID& source_id)
+  {
+    record_id_t record_id = std::make_pair(trigger_number, sequence_number);
+    try {
+      std::string file_name = find_file_of_record(run_number, record_id);
+      if (file_name.empty()) {
+        return nullptr;
       }
+      return m_read_cache->read_fragment(file_name, record_id, source_id);
+    } catch (std::exception const& excpt) {
+      std::ostringstream description_oss;
+      description_oss << "reading the fragment from " << source_id << " of trigger record " << trigger_number << "."
+                      << sequence_number << " of run " << run_number;
+      throw GeneralDataStoreProblem(ERS_HERE, get_name(), description_oss.str(), excpt);
     }
   }
 
@@ -310,6 +674,9 @@ private:
   HDF5DataStore(HDF5DataStore&&) = delete;
   HDF5DataStore& operator=(HDF5DataStore&&) = delete;
 
+  // suffix of the names of files that are still being written
+  inline static const std::string s_in_progress_suffix = ".writing";
+
   std::unique_ptr<hdf5libs::HDF5RawDataFile> m_file_handle;
   hdf5libs::hdf5filelayout::FileLayoutParams m_file_layout_params;
   std::string m_basic_name_of_open_file;
@@ -330,107 +697,984 @@ private:
   size_t m_max_file_size;
   bool m_disable_unique_suffix;
   float m_free_space_safety_factor_for_write;
+  bool m_async_write_enabled;
+  size_t m_async_max_queued_bytes;
+  size_t m_async_max_queued_records;
+
+  // Asynchronous writing
+  struct QueuedDataBlock
+  {
+    std::unique_ptr<daqdataformats::TriggerRecord> trigger_record;
+    std::unique_ptr<daqdataformats::TimeSlice> time_slice;
+    size_t size_bytes;
+  };
+  std::deque<QueuedDataBlock> m_async_queue;
+  size_t m_async_queued_bytes;
+  std::mutex m_async_queue_mutex;
+  std::condition_variable m_async_queue_cv;
+  std::thread m_io_thread;
+  bool m_io_thread_should_stop;
+  std::vector<record_id_t> m_completed_records; // TriggerRecords written since the last take_completed_records()
+  std::vector<record_id_t> m_failed_records;    // TriggerRecords that could not be written
+
+  // Output directories, and the free space on their disks
+  std::unique_ptr<OutputDirectorySelector> m_directory_selector;
+  size_t m_current_directory;
+  uint64_t m_record_number_of_open_file; // NOLINT(build/unsigned)
+
+  // File rollover
+  bool m_precreate_next_file;
+  float m_precreate_fill_fraction;
+  bool m_close_in_background;
+  bool m_close_at_run_stop_in_background;
+  std::shared_ptr<detchannelmaps::HardwareMapService> m_hw_map_service;
+  std::future<std::unique_ptr<hdf5libs::HDF5RawDataFile>> m_precreated_file;
+  std::string m_precreated_file_basic_name;
+  size_t m_precreated_file_index;
+  size_t m_precreated_file_directory;
+  struct BackgroundClose
+  {
+    std::string file_name;
+    daqdataformats::run_number_t run_number;
+    std::future<void> result;
+  };
+  std::list<BackgroundClose> m_background_closes;
+
+  // Two-tier storage, with the closed files moved from the staging directories to bulk storage
+  std::unique_ptr<StagedFileMover> m_file_mover;
+
+  // Compression of the Fragment payloads
+  std::unique_ptr<FragmentCompressor> m_fragment_compressor;
+
+  // HDF5 file-creation and file-access tuning
+  std::unique_ptr<HDF5FileTuning> m_file_tuning;
+
+  // Flushing of the output files to disk
+  std::unique_ptr<HDF5FileFlusher> m_file_flusher;
+
+  // Record index (side-car) files, keyed by the in-progress name of their HDF5 file
+  bool m_write_record_index;
+  std::map<std::string, std::unique_ptr<RecordIndexWriter>> m_record_index_writers;
+  std::mutex m_record_index_mutex;
+  RecordIndexWriter* m_record_index_of_open_file = nullptr;
+
+  // Summary columns of the records in the open file, written into it when it is closed
+  bool m_write_file_summary;
+  FileSummaryWriter m_file_summary;
+
+  // Packed record layout, written through a second open of the output file
+  bool m_packed_layout;
+  std::unique_ptr<PackedRecordWriter> m_packed_writer;
+
+  // Appended TimeSlice layout, also written through a second open of the output file
+  bool m_append_time_slices;
+  size_t m_time_slice_chunk_size;
+  std::unique_ptr<SliceStreamWriter> m_slice_stream_writer;
+
+  // Files that are open for reading, and the records that they contain
+  std::unique_ptr<HDF5FileCache> m_read_cache;
+
+  // Latencies of the phases of the write operation
+  LatencyHistogram m_free_space_check_latency;
+  LatencyHistogram m_file_name_latency;
+  LatencyHistogram m_file_open_latency; // includes the close of the previous file, when it is done in the foreground
+  LatencyHistogram m_write_latency;
+  LatencyHistogram m_close_latency;
+
+  static void add_latency_info(opmonlib::InfoCollector& ci, const std::string& phase, LatencyHistogram& histogram)
+  {
+    LatencyHistogram::Snapshot snapshot = histogram.get_and_reset();
+    hdf5datastoreinfo::Info info;
+    info.count = snapshot.count;
+    info.sum_us = snapshot.sum_us;
+    info.min_us = snapshot.min_us;
+    info.max_us = snapshot.max_us;
+    info.p50_us = snapshot.p50_us;
+    info.p90_us = snapshot.p90_us;
+    info.p99_us = snapshot.p99_us;
+    info.below_10us = snapshot.bucket_counts[0];
+    info.below_100us = snapshot.bucket_counts[1];
+    info.below_1ms = snapshot.bucket_counts[2];
+    info.below_10ms = snapshot.bucket_counts[3];
+    info.below_100ms = snapshot.bucket_counts[4];
+    info.below_1s = snapshot.bucket_counts[5];
+    info.at_least_1s = snapshot.bucket_counts[6];
+    opmonlib::InfoCollector phase_ci;
+    phase_ci.add(info);
+    ci.add(phase, phase_ci);
+  }
 
   // std::unique_ptr<HDF5KeyTranslator> m_key_translator_ptr;
 
   /**
-   * @brief Translates the specified input parameters into the appropriate filename.
+   * @brief Writes the TriggerRecord to the current output file, opening
+   * a new file first, if needed.  This is the synchronous part of the
+   * write operation, and it is called either from write() or from the
+   * background I/O thread.
    */
-  std::string get_file_name(uint64_t record_number, // NOLINT(build/unsigned)
-                            daqdataformats::run_number_t run_number)
-  {
-    std::ostringstream work_oss;
-    work_oss << m_config_params.directory_path;
-    if (work_oss.str().length() > 0) {
-      work_oss << "/";
-    }
-    work_oss << m_config_params.filename_parameters.overall_prefix;
-    if (work_oss.str().length() > 0) {
-      work_oss << "_";
-    }
+  void write_trigger_record(const daqdataformats::TriggerRecord& tr) { write_data_block(tr); }
 
-    work_oss << m_config_params.filename_parameters.run_number_prefix;
-    work_oss << std::setw(m_config_params.filename_parameters.digits_for_run_number) << std::setfill('0') << run_number;
-    work_oss << "_";
-    if (m_config_params.mode == "one-event-per-file") {
+  /**
+   * @brief Writes the TimeSlice to the current output file, opening
+   * a new file first, if needed.  This is the synchronous part of the
+   * write operation, and it is called either from write() or from the
+   * background I/O thread.
+   */
+  void write_time_slice(const daqdataformats::TimeSlice& ts) { write_data_block(ts); }
 
-      work_oss << m_config_params.filename_parameters.trigger_number_prefix;
-      work_oss << std::setw(m_config_params.filename_parameters.digits_for_trigger_number) << std::setfill('0')
-               << record_number;
-    } else if (m_config_params.mode == "all-per-file") {
+  static uint64_t get_record_number(const daqdataformats::TriggerRecord& tr) // NOLINT(build/unsigned)
+  {
+    return tr.get_header_ref().get_trigger_number();
+  }
+  static uint64_t get_record_number(const daqdataformats::TimeSlice& ts) // NOLINT(build/unsigned)
+  {
+    return ts.get_header().timeslice_number;
+  }
+  static daqdataformats::sequence_number_t get_sequence_number(const daqdataformats::TriggerRecord& tr)
+  {
+    return tr.get_header_ref().get_sequence_number();
+  }
+  static daqdataformats::sequence_number_t get_sequence_number(const daqdataformats::TimeSlice& /*ts*/) { return 0; }
+  static daqdataformats::run_number_t get_run_number(const daqdataformats::TriggerRecord& tr)
+  {
+    return tr.get_header_ref().get_run_number();
+  }
+  static daqdataformats::run_number_t get_run_number(const daqdataformats::TimeSlice& ts)
+  {
+    return ts.get_header().run_number;
+  }
+  static std::string get_block_description(const daqdataformats::TriggerRecord& /*tr*/) { return "trigger record"; }
+  static std::string get_block_description(const daqdataformats::TimeSlice& /*ts*/) { return "time slice"; }
 
-      work_oss << m_config_params.filename_parameters.file_index_prefix;
-      work_oss << std::setw(m_config_params.filename_parameters.digits_for_file_index) << std::setfill('0')
-               << m_file_index;
+  /**
+   * @brief Returns whether the Fragments of the data block are compressed before it is written.
+   * TimeSlices are not compressed in the appended layout, whose datasets hold the TriggerPrimitive
+   * rows of the payloads as they are.
+   */
+  template<typename T>
+  bool should_compress() const
+  {
+    if constexpr (std::is_same_v<T, daqdataformats::TimeSlice>) {
+      if (m_append_time_slices) {
+        return false;
+      }
     }
-    work_oss << "_" << m_config_params.filename_parameters.writer_identifier;
-    work_oss << ".hdf5";
-    return work_oss.str();
+    return m_fragment_compressor.get() != nullptr;
   }
 
-  void increment_file_index_if_needed(size_t size_of_next_write)
+  /**
+   * @brief Writes the data block, after compressing its Fragments, if configured.
+   */
+  template<typename T>
+  void write_data_block(const T& data_block)
   {
-    if ((m_recorded_size + size_of_next_write) > m_max_file_size && m_recorded_size > 0) {
-      ++m_file_index;
-      m_recorded_size = 0;
+    if (should_compress<T>()) {
+      std::unique_ptr<T> compressed_block = m_fragment_compressor->compress(data_block);
+      write_uncompressed_data_block(*compressed_block);
+      return;
     }
+    write_uncompressed_data_block(data_block);
   }
 
-  void open_file_if_needed(const std::string& file_name, unsigned open_flags = HighFive::File::ReadOnly)
+  template<typename T>
+  void write_uncompressed_data_block(const T& data_block)
   {
+    size_t block_size = prepare_file_for_data_block(data_block);
 
-    if (m_file_handle.get() == nullptr || m_basic_name_of_open_file.compare(file_name) ||
-        m_open_flags_of_open_file != open_flags) {
+    auto write_start_time = std::chrono::steady_clock::now();
+    {
+      std::lock_guard<std::mutex> hdf5_lock(HDF5FileUtils::get_hdf5_mutex());
+      write_to_open_file(data_block);
+    }
+    auto write_time = std::chrono::steady_clock::now() - write_start_time;
+    m_write_latency.record(write_time);
+    add_to_record_index(data_block);
+    finish_data_block_writes(1, block_size, write_time, get_run_number(data_block));
+  }
+
+  /**
+   * @brief Writes a batch of data blocks, after compressing their Fragments, if configured.
+   * Data blocks are reset to null pointers once they have been written; if an exception
+   * is thrown, the remaining ones are untouched.
+   */
+  template<typename T>
+  void write_data_block_batch(std::vector<std::unique_ptr<T>>& batch)
+  {
+    if (!should_compress<T>()) {
+      write_uncompressed_data_block_batch(batch);
+      return;
+    }
 
-      // 04-Feb-2021, KAB: adding unique substrings to the filename
-      std::string unique_filename = file_name;
-      time_t now = time(0);
-      std::string file_creation_timestamp = boost::posix_time::to_iso_string(boost::posix_time::from_time_t(now));
-      if (!m_disable_unique_suffix) {
-        // timestamp substring
-        size_t ufn_len = unique_filename.length();
-        if (ufn_len > 6) { // len GT 6 gives us some confidence that we have at least x.hdf5
-          std::string timestamp_substring = "_" + file_creation_timestamp;
-          TLOG_DEBUG(TLVL_BASIC) << get_name() << ": timestamp substring for filename: " << timestamp_substring;
-          unique_filename.insert(ufn_len - 5, timestamp_substring);
+    // the compressed copies are written, and the entries of the original batch
+    // are reset when their copies have been written
+    std::vector<std::unique_ptr<T>> compressed_batch;
+    for (auto const& block_ptr : batch) {
+      compressed_batch.push_back(block_ptr.get() != nullptr ? m_fragment_compressor->compress(*block_ptr) : nullptr);
+    }
+    auto reset_written_entries = [&]() {
+      for (size_t idx = 0; idx < batch.size(); ++idx) {
+        if (compressed_batch[idx].get() == nullptr) {
+          batch[idx].reset();
         }
       }
+    };
+    try {
+      write_uncompressed_data_block_batch(compressed_batch);
+    } catch (...) { // NOLINT(runtime/exceptions)
+      reset_written_entries();
+      // NOLINT here because we *ARE* re-throwing the exception!
+      throw;
+    }
+    reset_written_entries();
+  }
 
-      // close an existing open file
-      if (m_file_handle.get() != nullptr) {
-        std::string open_filename = m_file_handle->get_file_name();
-        try {
-          m_file_handle.reset();
-        } catch (std::exception const& excpt) {
-          throw FileOperationProblem(ERS_HERE, get_name(), open_filename, excpt);
-        } catch (...) { // NOLINT(runtime/exceptions)
-          // NOLINT here because we *ARE* re-throwing the exception!
-          throw FileOperationProblem(ERS_HERE, get_name(), open_filename);
-        }
+  /**
+   * @brief Writes a batch of data blocks as they are.  Consecutive data blocks that go
+   * into the same file are written as a group: the directory selection, free-space check,
+   * and file lookup are done for the first data block of the group, and the group is
+   * written while the HDF5 mutex is held once.
+   */
+  template<typename T>
+  void write_uncompressed_data_block_batch(std::vector<std::unique_ptr<T>>& batch)
+  {
+    auto group_begin = batch.begin();
+    while (group_begin != batch.end()) {
+      if (group_begin->get() == nullptr) {
+        ++group_begin;
+        continue;
       }
 
-      // opening file for the first time OR something changed in the name or the way of opening the file
-      TLOG_DEBUG(TLVL_BASIC) << get_name() << ": going to open file " << unique_filename << " with open_flags "
-                             << std::to_string(open_flags);
-      m_basic_name_of_open_file = file_name;
-      m_open_flags_of_open_file = open_flags;
-      try {
-        std::shared_ptr<detchannelmaps::HardwareMapService> hw_map_svc(
-          new detchannelmaps::HardwareMapService(m_hardware_map_file));
-        m_file_handle.reset(new hdf5libs::HDF5RawDataFile(unique_filename,
-                                                          m_run_number,
-                                                          m_file_index,
-                                                          m_config_params.filename_parameters.writer_identifier,
-                                                          m_file_layout_params,
-                                                          hw_map_svc,
-                                                          ".writing",
-                                                          open_flags));
-      } catch (std::exception const& excpt) {
-        throw FileOperationProblem(ERS_HERE, get_name(), unique_filename, excpt);
-      } catch (...) { // NOLINT(runtime/exceptions)
+      size_t group_size = prepare_file_for_data_block(**group_begin);
+      auto group_end = std::next(group_begin);
+      while (group_end != batch.end() && group_end->get() != nullptr &&
+             fits_in_open_file(**group_end, group_size)) {
+        group_size += (*group_end)->get_total_size_bytes();
+        ++group_end;
+      }
+
+      auto write_start_time = std::chrono::steady_clock::now();
+      auto written_end = group_begin;
+      size_t bytes_written = 0;
+      // the data blocks that have been written are accounted for, also when a later one in the group fails,
+      // so that the file size that the rollover is based on stays correct
+      auto finish_written_blocks = [&]() {
+        if (written_end == group_begin) {
+          return;
+        }
+        daqdataformats::run_number_t run_number = get_run_number(**group_begin);
+        for (auto iter = group_begin; iter != written_end; ++iter) {
+          add_to_record_index(**iter);
+          iter->reset();
+        }
+        finish_data_block_writes(static_cast<size_t>(std::distance(group_begin, written_end)),
+                                 bytes_written,
+                                 std::chrono::steady_clock::now() - write_start_time,
+                                 run_number);
+      };
+      try {
+        std::lock_guard<std::mutex> hdf5_lock(HDF5FileUtils::get_hdf5_mutex());
+        auto block_start_time = std::chrono::steady_clock::now();
+        for (; written_end != group_end; ++written_end) {
+          write_to_open_file(**written_end);
+          bytes_written += (*written_end)->get_total_size_bytes();
+          auto block_end_time = std::chrono::steady_clock::now();
+          m_write_latency.record(block_end_time - block_start_time);
+          block_start_time = block_end_time;
+        }
+      } catch (...) { // NOLINT(runtime/exceptions)
+        finish_written_blocks();
         // NOLINT here because we *ARE* re-throwing the exception!
-        throw FileOperationProblem(ERS_HERE, get_name(), unique_filename);
+        throw;
+      }
+      finish_written_blocks();
+      group_begin = group_end;
+    }
+  }
+
+  /**
+   * @brief Writes the data block to the open file, in the configured record layout.
+   * The HDF5 mutex needs to be held by the caller.
+   */
+  template<typename T>
+  void write_to_open_file(const T& data_block)
+  {
+    if constexpr (std::is_same_v<T, daqdataformats::TimeSlice>) {
+      if (m_slice_stream_writer.get() != nullptr) {
+        m_slice_stream_writer->write(data_block);
+        return;
+      }
+    }
+    if (m_packed_writer.get() != nullptr) {
+      m_packed_writer->write(data_block,
+                             get_record_group_name(get_record_number(data_block), get_sequence_number(data_block)));
+      return;
+    }
+    m_file_handle->write(data_block);
+  }
+
+  /**
+   * @brief Makes sure that the file that the specified data block should be written to
+   * is open, and that there is sufficient free space for it.
+   * @return the size of the data block
+   */
+  template<typename T>
+  size_t prepare_file_for_data_block(const T& data_block)
+  {
+    size_t block_size = data_block.get_total_size_bytes();
+    uint64_t record_number = get_record_number(data_block); // NOLINT(build/unsigned)
+    std::string block_description = get_block_description(data_block);
+
+    // check if a new file should be opened for this data block, and in which directory
+    auto phase_start_time = std::chrono::steady_clock::now();
+    select_output_directory_if_needed(block_size, record_number);
+
+    // check if there is sufficient space for this data block
+    size_t current_free_space =
+      m_directory_selector->get_disk_space_monitor(m_current_directory).get_predicted_free_space();
+    if (current_free_space < (m_free_space_safety_factor_for_write * block_size)) {
+      std::ostringstream msg_oss;
+      msg_oss << "a safety factor of " << m_free_space_safety_factor_for_write << " times the " << block_description
+              << " size";
+      InsufficientDiskSpace issue(ERS_HERE,
+                                  get_name(),
+                                  m_directory_selector->get_path(m_current_directory),
+                                  current_free_space,
+                                  (m_free_space_safety_factor_for_write * block_size),
+                                  msg_oss.str());
+      std::string msg = "writing a " + block_description + " to file " +
+                        (m_file_handle.get() != nullptr ? m_file_handle->get_file_name() : m_basic_name_of_open_file);
+      throw RetryableDataStoreProblem(ERS_HERE, get_name(), msg, issue);
+    }
+    auto phase_end_time = std::chrono::steady_clock::now();
+    m_free_space_check_latency.record(phase_end_time - phase_start_time);
+
+    // determine the filename from Storage Key + configuration parameters
+    phase_start_time = phase_end_time;
+    std::string full_filename = get_file_name(record_number, get_run_number(data_block));
+    m_file_name_latency.record(std::chrono::steady_clock::now() - phase_start_time);
+
+    try {
+      open_file_if_needed(full_filename, HighFive::File::OpenOrCreate);
+    } catch (std::exception const& excpt) {
+      throw FileOperationProblem(ERS_HERE, get_name(), full_filename, excpt);
+    } catch (...) { // NOLINT(runtime/exceptions)
+      // NOLINT here because we *ARE* re-throwing the exception!
+      throw FileOperationProblem(ERS_HERE, get_name(), full_filename);
+    }
+    m_record_number_of_open_file = record_number;
+    return block_size;
+  }
+
+  /**
+   * @brief Whether the specified data block can be written to the open file right after
+   * the bytes_before_it that are already planned for it, without any of the checks that
+   * prepare_file_for_data_block() does producing a different outcome.
+   */
+  template<typename T>
+  bool fits_in_open_file(const T& data_block, size_t bytes_before_it)
+  {
+    size_t block_size = data_block.get_total_size_bytes();
+    if (m_operation_mode == "one-event-per-file") {
+      if (get_record_number(data_block) != m_record_number_of_open_file) {
+        return false;
+      }
+    } else if ((m_recorded_size + bytes_before_it + block_size) > m_max_file_size) {
+      return false;
+    }
+    size_t bytes_needed = static_cast<size_t>(m_free_space_safety_factor_for_write * (bytes_before_it + block_size));
+    return m_directory_selector->is_usable(m_current_directory, bytes_needed);
+  }
+
+  /**
+   * @brief Does the bookkeeping that follows the writing of one or more data blocks
+   * to the open file, and flushes the file to disk when the flush policy says so.
+   */
+  void finish_data_block_writes(size_t blocks_written,
+                                size_t bytes_written,
+                                std::chrono::steady_clock::duration write_time,
+                                daqdataformats::run_number_t run_number)
+  {
+    m_recorded_size =
+      (m_packed_writer.get() != nullptr) ? m_packed_writer->get_recorded_size() : m_file_handle->get_recorded_size();
+    if (m_slice_stream_writer.get() != nullptr) {
+      m_recorded_size += m_slice_stream_writer->get_recorded_size();
+    }
+    m_directory_selector->record_write(m_current_directory, bytes_written, write_time);
+    if (m_file_flusher.get() != nullptr) {
+      m_file_flusher->record_write(blocks_written, bytes_written);
+    }
+
+    precreate_next_file_if_needed(run_number);
+  }
+
+  /**
+   * @brief Appends the index entry of a data block that has been written to the side-car
+   * file of the open file, and its row to the summary of the open file.  A problem with
+   * the side-car file is reported, but it does not make the write fail, since the data
+   * block itself has been written.
+   */
+  template<typename T>
+  void add_to_record_index(const T& data_block)
+  {
+    if (m_write_file_summary) {
+      m_file_summary.add(data_block);
+    }
+    if (m_record_index_of_open_file == nullptr) {
+      return;
+    }
+    try {
+      m_record_index_of_open_file->append(make_record_index_entry(data_block));
+    } catch (ers::Issue const& excpt) {
+      ers::warning(excpt);
+    }
+  }
+
+  recordindex::Entry make_record_index_entry(const daqdataformats::TriggerRecord& tr) const
+  {
+    auto const& trh = tr.get_header_ref();
+    recordindex::Entry entry;
+    entry.record_number = trh.get_trigger_number();
+    entry.sequence_number = trh.get_sequence_number();
+    entry.record_type = recordindex::RecordType::kTriggerRecord;
+    entry.timestamp = trh.get_trigger_timestamp();
+    entry.trigger_type = trh.get_trigger_type();
+    entry.size_bytes = tr.get_total_size_bytes();
+    recordindex::copy_group_path(entry.group_path,
+                                 get_record_group_name(trh.get_trigger_number(), trh.get_sequence_number()));
+    return entry;
+  }
+
+  recordindex::Entry make_record_index_entry(const daqdataformats::TimeSlice& ts) const
+  {
+    auto const& tsh = ts.get_header();
+    recordindex::Entry entry;
+    entry.record_number = tsh.timeslice_number;
+    entry.record_type = recordindex::RecordType::kTimeSlice;
+    entry.size_bytes = ts.get_total_size_bytes();
+    recordindex::copy_group_path(entry.group_path,
+                                 m_append_time_slices ? std::string(slicestream::s_group_name)
+                                                      : get_record_group_name(tsh.timeslice_number, 0));
+    return entry;
+  }
+
+  /**
+   * @brief Returns the name of the top-level group of a record, following the file layout parameters
+   */
+  std::string get_record_group_name(uint64_t record_number, // NOLINT(build/unsigned)
+                                    daqdataformats::sequence_number_t sequence_number) const
+  {
+    std::ostringstream name_oss;
+    name_oss << m_file_layout_params.record_name_prefix << std::setw(m_file_layout_params.digits_for_record_number)
+             << std::setfill('0') << record_number;
+    if (m_file_layout_params.digits_for_sequence_number > 0) {
+      name_oss << "." << std::setw(m_file_layout_params.digits_for_sequence_number) << std::setfill('0')
+               << sequence_number;
+    }
+    return name_oss.str();
+  }
+
+  /**
+   * @brief Creates the side-car record index file of the HDF5 file with the specified in-progress name
+   */
+  void create_record_index(const std::string& open_filename, size_t file_index)
+  {
+    recordindex::FileHeader index_header;
+    index_header.run_number = m_run_number;
+    index_header.file_index = file_index;
+    auto index_writer = std::make_unique<RecordIndexWriter>(
+      get_closed_file_name(open_filename) + recordindex::s_side_car_suffix, index_header);
+    std::lock_guard<std::mutex> lk(m_record_index_mutex);
+    m_record_index_writers[open_filename] = std::move(index_writer);
+  }
+
+  /**
+   * @brief Returns the record index of the HDF5 file with the specified in-progress name,
+   * or a null pointer if there is none, and removes it from the list of open record indices
+   */
+  std::unique_ptr<RecordIndexWriter> take_record_index(const std::string& open_filename)
+  {
+    std::lock_guard<std::mutex> lk(m_record_index_mutex);
+    auto iter = m_record_index_writers.find(open_filename);
+    if (iter == m_record_index_writers.end()) {
+      return nullptr;
+    }
+    std::unique_ptr<RecordIndexWriter> index_writer = std::move(iter->second);
+    m_record_index_writers.erase(iter);
+    return index_writer;
+  }
+
+  RecordIndexWriter* find_record_index(const std::string& open_filename)
+  {
+    std::lock_guard<std::mutex> lk(m_record_index_mutex);
+    auto iter = m_record_index_writers.find(open_filename);
+    return (iter != m_record_index_writers.end()) ? iter->second.get() : nullptr;
+  }
+
+  /**
+   * @brief Adds the specified data block to the queue of the background I/O thread,
+   * taking ownership of it.  If the queue is already at its configured limit, a
+   * RetryableDataStoreProblem is thrown and the caller keeps ownership of the data block.
+   * A single data block that is larger than the byte limit is accepted when the queue is empty.
+   */
+  template<typename T>
+  void enqueue_for_io_thread(std::unique_ptr<T>& block_ptr)
+  {
+    {
+      std::lock_guard<std::mutex> lk(m_async_queue_mutex);
+      enqueue_while_locked(block_ptr);
+    }
+    m_async_queue_cv.notify_all();
+  }
+
+  /**
+   * @brief Adds the data blocks in the batch to the queue of the background I/O thread,
+   * taking ownership of them, with a single lock of the queue.  When the queue fills up
+   * part of the way through the batch, the data blocks that were queued are left as
+   * null pointers in the batch and a RetryableDataStoreProblem is thrown for the rest.
+   */
+  template<typename T>
+  void enqueue_batch_for_io_thread(std::vector<std::unique_ptr<T>>& batch)
+  {
+    std::unique_lock<std::mutex> lk(m_async_queue_mutex);
+    try {
+      for (auto& block_ptr : batch) {
+        if (block_ptr.get() != nullptr) {
+          enqueue_while_locked(block_ptr);
+        }
+      }
+    } catch (...) { // NOLINT(runtime/exceptions)
+      lk.unlock();
+      m_async_queue_cv.notify_all();
+      // NOLINT here because we *ARE* re-throwing the exception!
+      throw;
+    }
+    lk.unlock();
+    m_async_queue_cv.notify_all();
+  }
+
+  /**
+   * @brief Adds the data block to the queue of the background I/O thread.
+   * The m_async_queue_mutex needs to be held by the caller.
+   */
+  template<typename T>
+  void enqueue_while_locked(std::unique_ptr<T>& block_ptr)
+  {
+    size_t block_size = block_ptr->get_total_size_bytes();
+    if (!m_io_thread.joinable()) {
+      throw GeneralDataStoreProblem(
+        ERS_HERE, get_name(), "queueing a data block for writing while the background I/O thread is not running");
+    }
+    if (!m_async_queue.empty() && (m_async_queue.size() >= m_async_max_queued_records ||
+                                   (m_async_queued_bytes + block_size) > m_async_max_queued_bytes)) {
+      AsyncWriteQueueFull issue(ERS_HERE, get_name(), m_async_queue.size(), m_async_queued_bytes);
+      throw RetryableDataStoreProblem(ERS_HERE, get_name(), "queueing a data block for writing", issue);
+    }
+
+    QueuedDataBlock queued_block;
+    queued_block.size_bytes = block_size;
+    if constexpr (std::is_same_v<T, daqdataformats::TriggerRecord>) {
+      queued_block.trigger_record = std::move(block_ptr);
+    } else {
+      queued_block.time_slice = std::move(block_ptr);
+    }
+    m_async_queue.push_back(std::move(queued_block));
+    m_async_queued_bytes += block_size;
+    TLOG_DEBUG(TLVL_ASYNC_WRITE) << get_name() << ": queued a data block of " << block_size << " bytes, the queue has "
+                                 << m_async_queue.size() << " entries and " << m_async_queued_bytes << " bytes";
+  }
+
+  void start_io_thread()
+  {
+    stop_io_thread();
+    {
+      std::lock_guard<std::mutex> lk(m_async_queue_mutex);
+      m_io_thread_should_stop = false;
+    }
+    m_io_thread = std::thread(&HDF5DataStore::io_thread_work, this);
+  }
+
+  /**
+   * @brief Tells the background I/O thread to stop once its queue is empty,
+   * and waits for that to happen.
+   */
+  void stop_io_thread()
+  {
+    if (!m_io_thread.joinable()) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lk(m_async_queue_mutex);
+      m_io_thread_should_stop = true;
+    }
+    m_async_queue_cv.notify_all();
+    m_io_thread.join();
+  }
+
+  /**
+   * @brief The work loop of the background I/O thread.  Data blocks stay in the queue
+   * (and count against its limits) until they have been written.  Writes that fail with a
+   * RetryableDataStoreProblem are retried with an increasing delay, except when the
+   * thread has been asked to stop, in which case the data block is reported and dropped.
+   * Each TriggerRecord is added to the completed or to the failed records once it is done.
+   */
+  void io_thread_work()
+  {
+    const std::chrono::microseconds min_retry_wait(1000);
+    const std::chrono::microseconds max_retry_wait(1000000);
+    std::chrono::microseconds retry_wait = min_retry_wait;
+
+    std::unique_lock<std::mutex> lk(m_async_queue_mutex);
+    while (true) {
+      m_async_queue_cv.wait(lk, [&]() { return !m_async_queue.empty() || m_io_thread_should_stop; });
+      if (m_async_queue.empty()) {
+        break;
+      }
+
+      // references to deque elements stay valid while other elements are appended
+      QueuedDataBlock& queued_block = m_async_queue.front();
+      bool stopping = m_io_thread_should_stop;
+      lk.unlock();
+
+      bool done = true;
+      bool failed = false;
+      try {
+        if (queued_block.trigger_record.get() != nullptr) {
+          write_trigger_record(*queued_block.trigger_record);
+        } else {
+          write_time_slice(*queued_block.time_slice);
+        }
+        retry_wait = min_retry_wait;
+      } catch (const RetryableDataStoreProblem& excpt) {
+        if (stopping) {
+          report_async_write_failure(queued_block, excpt);
+          failed = true;
+        } else {
+          ers::warning(excpt);
+          done = false;
+        }
+      } catch (const ers::Issue& excpt) {
+        report_async_write_failure(queued_block, excpt);
+        failed = true;
+      } catch (const std::exception& excpt) {
+        report_async_write_failure(queued_block, excpt);
+        failed = true;
+      }
+
+      lk.lock();
+      if (done) {
+        if (queued_block.trigger_record.get() != nullptr) {
+          auto const& trh = queued_block.trigger_record->get_header_ref();
+          record_id_t record_id(trh.get_trigger_number(), trh.get_sequence_number());
+          if (failed) {
+            m_failed_records.push_back(record_id);
+          } else {
+            m_completed_records.push_back(record_id);
+          }
+        }
+        m_async_queued_bytes -= queued_block.size_bytes;
+        m_async_queue.pop_front();
+        // write() of a record that the caller keeps waits for the queue to be empty
+        m_async_queue_cv.notify_all();
+      } else {
+        m_async_queue_cv.wait_for(lk, retry_wait, [&]() { return m_io_thread_should_stop; });
+        retry_wait = std::min(retry_wait * 2, max_retry_wait);
+      }
+    }
+    TLOG_DEBUG(TLVL_ASYNC_WRITE) << get_name() << ": the background I/O thread is exiting";
+  }
+
+  template<typename E>
+  void report_async_write_failure(const QueuedDataBlock& queued_block, const E& excpt)
+  {
+    if (queued_block.trigger_record.get() != nullptr) {
+      auto const& trh = queued_block.trigger_record->get_header_ref();
+      ers::error(AsyncWriteFailed(
+        ERS_HERE, get_name(), "TriggerRecord", trh.get_trigger_number(), trh.get_run_number(), excpt));
+    } else {
+      auto const& tsh = queued_block.time_slice->get_header();
+      ers::error(AsyncWriteFailed(ERS_HERE, get_name(), "TimeSlice", tsh.timeslice_number, tsh.run_number, excpt));
+    }
+  }
+
+  /**
+   * @brief Returns the full names of the files of the specified run, in all of the
+   * output directories, that have been closed.  Only the files of this writer are
+   * included, and the list is sorted by name, which puts the files of each directory
+   * in the order in which they were written.
+   */
+  std::vector<std::string> get_closed_files_of_run(daqdataformats::run_number_t run_number)
+  {
+    std::ostringstream prefix_oss;
+    prefix_oss << m_config_params.filename_parameters.run_number_prefix;
+    prefix_oss << std::setw(m_config_params.filename_parameters.digits_for_run_number) << std::setfill('0')
+               << run_number << "_";
+    std::string run_prefix = prefix_oss.str();
+    std::string writer_substring = "_" + m_config_params.filename_parameters.writer_identifier;
+    const std::string file_suffix = ".hdf5";
+
+    // closed files are in the output directories, or in the bulk directory once they have been moved
+    std::vector<std::string> directory_paths;
+    for (size_t idx = 0; idx < m_directory_selector->get_number_of_directories(); ++idx) {
+      directory_paths.push_back(m_directory_selector->get_path(idx));
+    }
+    if (m_file_mover.get() != nullptr) {
+      directory_paths.push_back(m_file_mover->get_policy().destination_directory);
+    }
+
+    std::vector<std::string> file_list;
+    for (auto const& directory_path : directory_paths) {
+      // the same prefix as in get_file_name()
+      std::string file_prefix = m_config_params.filename_parameters.overall_prefix;
+      if (!directory_path.empty() || !file_prefix.empty()) {
+        file_prefix += "_";
+      }
+      file_prefix += run_prefix;
+
+      std::error_code error_code;
+      for (auto const& entry : std::filesystem::directory_iterator(directory_path, error_code)) {
+        std::string file_name = entry.path().filename().string();
+        if (file_name.size() > file_prefix.size() + file_suffix.size() && file_name.rfind(file_prefix, 0) == 0 &&
+            file_name.compare(file_name.size() - file_suffix.size(), file_suffix.size(), file_suffix) == 0 &&
+            file_name.find(writer_substring, file_prefix.size()) != std::string::npos) {
+          file_list.push_back(entry.path().string());
+        }
       }
+    }
+    std::sort(file_list.begin(), file_list.end());
+    return file_list;
+  }
+
+  /**
+   * @brief Returns the full name of the closed file that contains the specified record,
+   * or an empty string if there is none.
+   */
+  std::string find_file_of_record(daqdataformats::run_number_t run_number, const record_id_t& record_id)
+  {
+    for (auto const& file_name : get_closed_files_of_run(run_number)) {
+      if (m_read_cache->has_record(file_name, record_id)) {
+        return file_name;
+      }
+    }
+    return "";
+  }
+
+  /**
+   * @brief Translates the specified input parameters into the appropriate filename.
+   */
+  std::string get_file_name(uint64_t record_number, // NOLINT(build/unsigned)
+                            daqdataformats::run_number_t run_number)
+  {
+    std::ostringstream work_oss;
+    work_oss << m_directory_selector->get_path(m_current_directory);
+    if (work_oss.str().length() > 0) {
+      work_oss << "/";
+    }
+    work_oss << m_config_params.filename_parameters.overall_prefix;
+    if (work_oss.str().length() > 0) {
+      work_oss << "_";
+    }
+
+    work_oss << m_config_params.filename_parameters.run_number_prefix;
+    work_oss << std::setw(m_config_params.filename_parameters.digits_for_run_number) << std::setfill('0') << run_number;
+    work_oss << "_";
+    if (m_config_params.mode == "one-event-per-file") {
+
+      work_oss << m_config_params.filename_parameters.trigger_number_prefix;
+      work_oss << std::setw(m_config_params.filename_parameters.digits_for_trigger_number) << std::setfill('0')
+               << record_number;
+    } else if (m_config_params.mode == "all-per-file") {
+
+      work_oss << m_config_params.filename_parameters.file_index_prefix;
+      work_oss << std::setw(m_config_params.filename_parameters.digits_for_file_index) << std::setfill('0')
+               << m_file_index;
+    }
+    work_oss << "_" << m_config_params.filename_parameters.writer_identifier;
+    work_oss << ".hdf5";
+    return work_oss.str();
+  }
+
+  bool increment_file_index_if_needed(size_t size_of_next_write)
+  {
+    if ((m_recorded_size + size_of_next_write) > m_max_file_size && m_recorded_size > 0) {
+      ++m_file_index;
+      m_recorded_size = 0;
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Returns the free space that a directory needs to have to be chosen for a new file
+   */
+  size_t get_free_space_needed_for_new_file(size_t size_of_next_write) const
+  {
+    size_t needed_for_write = static_cast<size_t>(m_free_space_safety_factor_for_write * size_of_next_write);
+    if (m_operation_mode == "all-per-file") {
+      return std::max(needed_for_write, static_cast<size_t>(m_max_file_size));
+    }
+    return needed_for_write;
+  }
+
+  /**
+   * @brief Moves to the next output directory when a new file is started.  When the
+   * current directory becomes unusable (its disk is full, or it has been taken out of
+   * the rotation because it is slow), the current file is finished early, so that
+   * writing can continue in a different directory.
+   */
+  void select_output_directory_if_needed(size_t size_of_next_write,
+                                         uint64_t record_number) // NOLINT(build/unsigned)
+  {
+    bool new_file = increment_file_index_if_needed(size_of_next_write);
+    if (m_operation_mode == "one-event-per-file") {
+      new_file = (m_file_handle.get() == nullptr || record_number != m_record_number_of_open_file);
+    }
+
+    size_t needed_free_space = get_free_space_needed_for_new_file(size_of_next_write);
+    bool switch_directory = false;
+    if (!new_file && m_directory_selector->get_number_of_directories() > 1 &&
+        !m_directory_selector->is_usable(
+          m_current_directory, static_cast<size_t>(m_free_space_safety_factor_for_write * size_of_next_write))) {
+      switch_directory = true;
+    }
+    if (!new_file && !switch_directory) {
+      return;
+    }
+
+    // the pre-created file (if any) already determined the directory of the next file, and the
+    // rotation only moves on now that it is used
+    std::optional<size_t> next_directory;
+    if (new_file && m_precreated_file.valid() && m_file_index == m_precreated_file_index &&
+        m_directory_selector->is_usable(m_precreated_file_directory, needed_free_space)) {
+      next_directory = m_precreated_file_directory;
+      m_directory_selector->commit(*next_directory, needed_free_space);
+    } else {
+      next_directory = m_directory_selector->select(needed_free_space);
+    }
+    if (!next_directory.has_value() || (switch_directory && *next_directory == m_current_directory)) {
+      // no (other) directory is usable, the free space check for the write decides what happens
+      return;
+    }
+
+    if (switch_directory && m_operation_mode == "all-per-file" && m_recorded_size > 0) {
+      ++m_file_index;
+      m_recorded_size = 0;
+    }
+    if (*next_directory != m_current_directory) {
+      TLOG_DEBUG(TLVL_BASIC) << get_name() << ": switching from output directory \""
+                             << m_directory_selector->get_path(m_current_directory) << "\" to \""
+                             << m_directory_selector->get_path(*next_directory) << "\"";
+    }
+    m_current_directory = *next_directory;
+  }
+
+  void open_file_if_needed(const std::string& file_name, unsigned open_flags = HighFive::File::ReadOnly)
+  {
+
+    if (m_file_handle.get() == nullptr || m_basic_name_of_open_file.compare(file_name) ||
+        m_open_flags_of_open_file != open_flags) {
+      auto open_start_time = std::chrono::steady_clock::now();
+
+      // close an existing open file
+      m_record_index_of_open_file = nullptr;
+      if (m_file_handle.get() != nullptr) {
+        if (m_file_flusher.get() != nullptr) {
+          m_file_flusher->finish_file();
+        }
+        write_file_summary();
+        close_layout_writers();
+        if (m_close_in_background) {
+          close_file_in_background(std::move(m_file_handle));
+        } else {
+          close_file(std::move(m_file_handle));
+        }
+      }
+      reap_background_closes(false);
+
+      // opening file for the first time OR something changed in the name or the way of opening the file
+      m_basic_name_of_open_file = file_name;
+      m_open_flags_of_open_file = open_flags;
+
+      // use the file that was created ahead of time, if it is the one that we need
+      std::unique_ptr<hdf5libs::HDF5RawDataFile> precreated_file = take_precreated_file(file_name, open_flags);
+      if (precreated_file.get() != nullptr) {
+        m_file_handle = std::move(precreated_file);
+        TLOG_DEBUG(TLVL_BASIC) << get_name() << ": switched to the pre-created file "
+                               << m_file_handle->get_file_name();
+      } else {
+        m_file_handle = create_file(file_name, m_file_index, open_flags);
+      }
+      m_record_index_of_open_file = find_record_index(m_file_handle->get_file_name());
+      if ((m_packed_layout || m_append_time_slices) && open_flags != HighFive::File::ReadOnly) {
+        std::lock_guard<std::mutex> hdf5_lock(HDF5FileUtils::get_hdf5_mutex());
+        if (m_packed_layout) {
+          m_packed_writer.reset(new PackedRecordWriter(m_file_handle->get_file_name()));
+        }
+        if (m_append_time_slices) {
+          m_slice_stream_writer.reset(new SliceStreamWriter(m_file_handle->get_file_name(),
+                                                            sizeof(detdataformats::trigger::TriggerPrimitive),
+                                                            m_time_slice_chunk_size));
+        }
+      }
+      if (m_file_flusher.get() != nullptr && open_flags != HighFive::File::ReadOnly) {
+        m_file_flusher->start_file(m_file_handle->get_file_name());
+      }
+      m_directory_selector->record_file_started(m_current_directory);
+      m_file_open_latency.record(std::chrono::steady_clock::now() - open_start_time);
+    } else {
+      TLOG_DEBUG(TLVL_BASIC) << get_name() << ": Pointer file to  " << m_basic_name_of_open_file
+                             << " was already opened with open_flags " << std::to_string(m_open_flags_of_open_file);
+    }
+  }
+
+  /**
+   * @brief Creates (or opens) the HDF5RawDataFile with the specified basic name,
+   * adding the unique suffix to the filename, if configured.  This method may be
+   * called from a helper thread when the next file is created ahead of time.
+   */
+  std::unique_ptr<hdf5libs::HDF5RawDataFile> create_file(const std::string& file_name,
+                                                         size_t file_index,
+                                                         unsigned open_flags)
+  {
+    // 04-Feb-2021, KAB: adding unique substrings to the filename
+    std::string unique_filename = file_name;
+    time_t now = time(0);
+    std::string file_creation_timestamp = boost::posix_time::to_iso_string(boost::posix_time::from_time_t(now));
+    if (!m_disable_unique_suffix) {
+      // timestamp substring
+      size_t ufn_len = unique_filename.length();
+      if (ufn_len > 6) { // len GT 6 gives us some confidence that we have at least x.hdf5
+        std::string timestamp_substring = "_" + file_creation_timestamp;
+        TLOG_DEBUG(TLVL_BASIC) << get_name() << ": timestamp substring for filename: " << timestamp_substring;
+        unique_filename.insert(ufn_len - 5, timestamp_substring);
+      }
+    }
+
+    TLOG_DEBUG(TLVL_BASIC) << get_name() << ": going to open file " << unique_filename << " with open_flags "
+                           << std::to_string(open_flags);
+    std::unique_ptr<hdf5libs::HDF5RawDataFile> file_handle;
+    try {
+      std::lock_guard<std::mutex> hdf5_lock(HDF5FileUtils::get_hdf5_mutex());
+      // the HardwareMapService is created once and shared by all of the files that
+      // are written, since parsing the hardware map file is expensive
+      if (m_hw_map_service.get() == nullptr) {
+        m_hw_map_service.reset(new detchannelmaps::HardwareMapService(m_hardware_map_file));
+      }
+
+      // the tuned file stays open until the HDF5RawDataFile has opened it, so that
+      // the HDF5RawDataFile shares its access properties
+      std::unique_ptr<HDF5FileTuning::PreparedFile> prepared_file;
+      if (m_file_tuning.get() != nullptr && open_flags != HighFive::File::ReadOnly) {
+        prepared_file = m_file_tuning->prepare_file(unique_filename + s_in_progress_suffix, m_max_file_size);
+      }
+      file_handle.reset(new hdf5libs::HDF5RawDataFile(unique_filename,
+                                                      m_run_number,
+                                                      file_index,
+                                                      m_config_params.filename_parameters.writer_identifier,
+                                                      m_file_layout_params,
+                                                      m_hw_map_service,
+                                                      s_in_progress_suffix,
+                                                      open_flags));
+      prepared_file.reset();
 
       if (open_flags == HighFive::File::ReadOnly) {
         TLOG_DEBUG(TLVL_BASIC) << get_name() << "Opened HDF5 file read-only.";
@@ -438,23 +1682,254 @@ private:
         TLOG_DEBUG(TLVL_BASIC) << get_name() << "Created HDF5 file (" << unique_filename << ").";
 
         // write attributes that aren't being handled by the HDF5RawDataFile right now
-        // m_file_handle->write_attribute("data_format_version",(int)m_key_translator_ptr->get_current_version());
-        m_file_handle->write_attribute("operational_environment", (std::string)m_config_params.operational_environment);
+        // file_handle->write_attribute("data_format_version",(int)m_key_translator_ptr->get_current_version());
+        file_handle->write_attribute("operational_environment", (std::string)m_config_params.operational_environment);
+        if (m_fragment_compressor.get() != nullptr) {
+          file_handle->write_attribute("fragment_compression", m_fragment_compressor->get_description());
+        }
+        if (m_write_record_index) {
+          create_record_index(file_handle->get_file_name(), file_index);
+        }
       }
-    } else {
-      TLOG_DEBUG(TLVL_BASIC) << get_name() << ": Pointer file to  " << m_basic_name_of_open_file
-                             << " was already opened with open_flags " << std::to_string(m_open_flags_of_open_file);
+    } catch (std::exception const& excpt) {
+      throw FileOperationProblem(ERS_HERE, get_name(), unique_filename, excpt);
+    } catch (...) { // NOLINT(runtime/exceptions)
+      // NOLINT here because we *ARE* re-throwing the exception!
+      throw FileOperationProblem(ERS_HERE, get_name(), unique_filename);
+    }
+    return file_handle;
+  }
+
+  /**
+   * @brief Writes the summary of the records in the open file into the file, before it
+   * is closed.  As with the in-file record index, a file without its summary is still
+   * valid, so a problem is reported but does not prevent the file from being closed.
+   */
+  void write_file_summary()
+  {
+    if (!m_write_file_summary) {
+      return;
+    }
+    try {
+      std::lock_guard<std::mutex> hdf5_lock(HDF5FileUtils::get_hdf5_mutex());
+      m_file_summary.write_to_hdf5_file(m_file_handle->get_file_name());
+    } catch (ers::Issue const& excpt) {
+      ers::warning(excpt);
+    }
+    m_file_summary.clear();
+  }
+
+  /**
+   * @brief Releases the second opens of the output file that the packed records and the
+   * appended TimeSlices are written through, which needs to happen before the
+   * HDF5RawDataFile closes the file.
+   */
+  void close_layout_writers()
+  {
+    if (m_packed_writer.get() != nullptr || m_slice_stream_writer.get() != nullptr) {
+      std::lock_guard<std::mutex> hdf5_lock(HDF5FileUtils::get_hdf5_mutex());
+      m_packed_writer.reset();
+      m_slice_stream_writer.reset();
     }
   }
 
-  size_t get_free_space(const std::string& the_path)
+  /**
+   * @brief Closes the specified file, which flushes it, writes the closing
+   * attributes, and renames it to remove the ".writing" suffix.  In the two-tier
+   * storage mode, the closed file is then queued to be moved to bulk storage,
+   * unless it is not an output file (a pre-created file that was not used).
+   */
+  void close_file(std::unique_ptr<hdf5libs::HDF5RawDataFile> file_handle, bool is_output_file = true)
   {
-    struct statvfs vfs_results;
-    int retval = statvfs(the_path.c_str(), &vfs_results);
-    if (retval != 0) {
-      return 0;
+    std::string open_filename = file_handle->get_file_name();
+    std::unique_ptr<RecordIndexWriter> index_writer = take_record_index(open_filename);
+    auto close_start_time = std::chrono::steady_clock::now();
+    try {
+      std::lock_guard<std::mutex> hdf5_lock(HDF5FileUtils::get_hdf5_mutex());
+      if (index_writer.get() != nullptr) {
+        // a file without its in-file index is still valid, since the side-car file has the same information
+        try {
+          index_writer->write_to_hdf5_file(open_filename);
+        } catch (ers::Issue const& excpt) {
+          ers::warning(excpt);
+        }
+        index_writer->close();
+      }
+      file_handle.reset();
+    } catch (std::exception const& excpt) {
+      throw FileOperationProblem(ERS_HERE, get_name(), open_filename, excpt);
+    } catch (...) { // NOLINT(runtime/exceptions)
+      // NOLINT here because we *ARE* re-throwing the exception!
+      throw FileOperationProblem(ERS_HERE, get_name(), open_filename);
+    }
+    m_close_latency.record(std::chrono::steady_clock::now() - close_start_time);
+    if (m_file_tuning.get() != nullptr) {
+      m_file_tuning->release_unused_space(get_closed_file_name(open_filename));
+    }
+    if (m_file_flusher.get() != nullptr) {
+      m_file_flusher->sync_closed_file(get_closed_file_name(open_filename));
+    }
+    if (m_file_mover.get() != nullptr && is_output_file) {
+      // the side-car index is moved first, so that the moved file can be read with it
+      std::string closed_filename = get_closed_file_name(open_filename);
+      if (index_writer.get() != nullptr) {
+        m_file_mover->add_file(closed_filename + recordindex::s_side_car_suffix);
+      }
+      m_file_mover->add_file(closed_filename);
+    }
+  }
+
+  /**
+   * @brief Returns the name that a file has after it was closed, which is its
+   * in-progress name without the ".writing" suffix.
+   */
+  static std::string get_closed_file_name(const std::string& open_filename)
+  {
+    std::string closed_filename = open_filename;
+    if (closed_filename.size() > s_in_progress_suffix.size() &&
+        closed_filename.compare(closed_filename.size() - s_in_progress_suffix.size(),
+                                s_in_progress_suffix.size(),
+                                s_in_progress_suffix) == 0) {
+      closed_filename.erase(closed_filename.size() - s_in_progress_suffix.size());
+    }
+    return closed_filename;
+  }
+
+  void close_file_in_background(std::unique_ptr<hdf5libs::HDF5RawDataFile> file_handle)
+  {
+    TLOG_DEBUG(TLVL_BASIC) << get_name() << ": closing file " << file_handle->get_file_name() << " in the background";
+    std::string file_name = file_handle->get_file_name();
+    m_background_closes.push_back(BackgroundClose{
+      file_name,
+      m_run_number,
+      std::async(std::launch::async,
+                 [this, handle = std::move(file_handle)]() mutable { close_file(std::move(handle)); }) });
+  }
+
+  /**
+   * @brief Reports the results of file closes that were done in the background.
+   * If wait_for_all is true, this method waits for all outstanding closes to complete,
+   * and it re-throws the first problem that was found; otherwise it only looks at
+   * the closes that have already finished and reports problems as errors.
+   */
+  void reap_background_closes(bool wait_for_all)
+  {
+    reap_background_closes([wait_for_all](const BackgroundClose&) { return wait_for_all; }, wait_for_all);
+  }
+
+  /**
+   * @brief Reports the results of file closes that were done in the background.  This
+   * method waits for the closes for which must_wait returns true, and of the others, it
+   * only looks at the ones that have already finished.  Problems are reported as errors,
+   * except that the first one is re-thrown when rethrow_first_problem is true.
+   */
+  void reap_background_closes(const std::function<bool(const BackgroundClose&)>& must_wait,
+                              bool rethrow_first_problem)
+  {
+    std::unique_ptr<FileOperationProblem> first_problem;
+    for (auto iter = m_background_closes.begin(); iter != m_background_closes.end();) {
+      if (!must_wait(*iter) && iter->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        ++iter;
+        continue;
+      }
+      TLOG_DEBUG(TLVL_BASIC) << get_name() << ": the background close of file " << iter->file_name << " has finished";
+      try {
+        iter->result.get();
+      } catch (FileOperationProblem const& excpt) {
+        if (rethrow_first_problem && first_problem.get() == nullptr) {
+          first_problem.reset(new FileOperationProblem(excpt));
+        } else {
+          ers::error(excpt);
+        }
+      }
+      iter = m_background_closes.erase(iter);
+    }
+    if (first_problem.get() != nullptr) {
+      throw *first_problem;
+    }
+  }
+
+  /**
+   * @brief Starts the creation of the next file on a helper thread once the
+   * current file has passed the configured fill fraction.  This is only done in
+   * "all-per-file" mode, where the name of the next file is known in advance.
+   */
+  void precreate_next_file_if_needed(daqdataformats::run_number_t run_number)
+  {
+    if (!m_precreate_next_file || m_operation_mode != "all-per-file" || m_precreated_file.valid() ||
+        m_file_handle.get() == nullptr) {
+      return;
+    }
+    if (static_cast<double>(m_recorded_size) < m_precreate_fill_fraction * static_cast<double>(m_max_file_size)) {
+      return;
+    }
+
+    // the file may still be discarded, so the rotation of the directories is not moved on yet
+    std::optional<size_t> next_directory = m_directory_selector->peek(get_free_space_needed_for_new_file(0));
+    if (!next_directory.has_value()) {
+      return;
+    }
+
+    size_t next_file_index = m_file_index + 1;
+    size_t saved_file_index = m_file_index;
+    size_t saved_directory = m_current_directory;
+    m_file_index = next_file_index;
+    m_current_directory = *next_directory;
+    m_precreated_file_basic_name = get_file_name(0, run_number);
+    m_file_index = saved_file_index;
+    m_current_directory = saved_directory;
+    m_precreated_file_index = next_file_index;
+    m_precreated_file_directory = *next_directory;
+
+    TLOG_DEBUG(TLVL_BASIC) << get_name() << ": starting the pre-creation of file " << m_precreated_file_basic_name;
+    m_precreated_file =
+      std::async(std::launch::async, [this, next_file_name = m_precreated_file_basic_name, next_file_index]() {
+        return create_file(next_file_name, next_file_index, HighFive::File::OpenOrCreate);
+      });
+  }
+
+  /**
+   * @brief Returns the file that was created ahead of time, if it matches the
+   * requested file, and a null pointer otherwise.  A pre-created file that does
+   * not match is discarded.
+   */
+  std::unique_ptr<hdf5libs::HDF5RawDataFile> take_precreated_file(const std::string& file_name, unsigned open_flags)
+  {
+    if (!m_precreated_file.valid()) {
+      return nullptr;
+    }
+    if (file_name != m_precreated_file_basic_name || m_file_index != m_precreated_file_index ||
+        open_flags != HighFive::File::OpenOrCreate) {
+      discard_precreated_file();
+      return nullptr;
+    }
+    // any problem that was found during the creation is re-thrown here
+    return m_precreated_file.get();
+  }
+
+  /**
+   * @brief Closes and removes a file that was created ahead of time but not used.
+   */
+  void discard_precreated_file()
+  {
+    if (!m_precreated_file.valid()) {
+      return;
+    }
+    try {
+      std::unique_ptr<hdf5libs::HDF5RawDataFile> unused_file = m_precreated_file.get();
+      // the file is renamed to drop the ".writing" suffix when it is closed
+      std::string unused_filename = get_closed_file_name(unused_file->get_file_name());
+      close_file(std::move(unused_file), false);
+      TLOG_DEBUG(TLVL_BASIC) << get_name() << ": removing the unused pre-created file " << unused_filename;
+      std::remove(unused_filename.c_str());
+      if (m_write_record_index) {
+        std::remove((unused_filename + recordindex::s_side_car_suffix).c_str());
+      }
+    } catch (ers::Issue const& excpt) {
+      ers::warning(excpt);
+    } catch (std::exception const& excpt) {
+      ers::warning(FileOperationProblem(ERS_HERE, get_name(), m_precreated_file_basic_name, excpt));
     }
-    return vfs_results.f_bsize * vfs_results.f_bavail;
   }
 };
 
@@ -0,0 +1,252 @@
+/**
+ * @file HDF5FileCache.hpp
+ *
+ * HDF5FileCache keeps a bounded number of HDF5RawDataFiles open for reading,
+ * closing the least recently used one when another file needs to be opened.
+ * The list of records in each file is remembered after the file has been closed,
+ * since it does not change once the file has been written.  It is taken from the
+ * side-car record index of the file (see RecordIndexFormat.hpp), when there is one,
+ * so that the file does not need to be opened to find out which records it has.
+ * Files that were written in the packed record layout (see PackedRecordFormat.hpp)
+ * are read with a PackedRecordReader instead.  Fragments whose payloads were
+ * compressed when they were written (see FragmentCompressor.hpp) are returned
+ * decompressed.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_PLUGINS_HDF5FILECACHE_HPP_
+#define DFMODULES_PLUGINS_HDF5FILECACHE_HPP_
+
+#include "HDF5FileUtils.hpp"
+#include "dfmodules/FragmentCompressor.hpp"
+#include "dfmodules/PackedRecordFile.hpp"
+#include "dfmodules/RecordIndexFile.hpp"
+
+#include "daqdataformats/Fragment.hpp"
+#include "daqdataformats/SourceID.hpp"
+#include "daqdataformats/TriggerRecord.hpp"
+#include "hdf5libs/HDF5RawDataFile.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+
+namespace dunedaq {
+namespace dfmodules {
+
+class HDF5FileCache
+{
+public:
+  using record_id_t = std::pair<uint64_t, daqdataformats::sequence_number_t>; // NOLINT(build/unsigned)
+
+  /**
+   * @brief HDF5FileCache Constructor
+   * @param max_open_files The maximum number of files that are kept open (at least one).
+   */
+  explicit HDF5FileCache(size_t max_open_files)
+    : m_max_open_files(max_open_files > 0 ? max_open_files : 1)
+  {}
+
+  HDF5FileCache(const HDF5FileCache&) = delete;            ///< HDF5FileCache is not copy-constructible
+  HDF5FileCache& operator=(const HDF5FileCache&) = delete; ///< HDF5FileCache is not copy-assignable
+  HDF5FileCache(HDF5FileCache&&) = delete;                 ///< HDF5FileCache is not move-constructible
+  HDF5FileCache& operator=(HDF5FileCache&&) = delete;      ///< HDF5FileCache is not move-assignable
+
+  /**
+   * @brief Returns the records in the specified file
+   */
+  std::set<record_id_t> get_record_ids(const std::string& file_name)
+  {
+    std::lock_guard<std::mutex> lk(m_cache_mutex);
+    return get_record_ids_while_locked(file_name);
+  }
+
+  /**
+   * @brief Returns whether the specified file contains the record
+   */
+  bool has_record(const std::string& file_name, const record_id_t& record_id)
+  {
+    std::lock_guard<std::mutex> lk(m_cache_mutex);
+    return get_record_ids_while_locked(file_name).count(record_id) > 0;
+  }
+
+  /**
+   * @brief Reads the complete TriggerRecord from the file
+   */
+  std::unique_ptr<daqdataformats::TriggerRecord> read_trigger_record(const std::string& file_name,
+                                                                     const record_id_t& record_id)
+  {
+    std::unique_ptr<daqdataformats::TriggerRecord> tr_ptr;
+    {
+      std::lock_guard<std::mutex> lk(m_cache_mutex);
+      OpenFile& open_file = get_open_file(file_name);
+      std::lock_guard<std::mutex> hdf5_lock(HDF5FileUtils::get_hdf5_mutex());
+      if (open_file.packed_file.get() != nullptr) {
+        tr_ptr = open_file.packed_file->read_trigger_record(record_id);
+      } else {
+        tr_ptr = std::make_unique<daqdataformats::TriggerRecord>(open_file.file->get_trigger_record(record_id));
+      }
+    }
+    return decompress_fragments(std::move(tr_ptr));
+  }
+
+  /**
+   * @brief Reads one Fragment of the record from the file
+   */
+  std::unique_ptr<daqdataformats::Fragment> read_fragment(const std::string& file_name,
+                                                          const record_id_t& record_id,
+                                                          const daqdataformats::SourceID& source_id)
+  {
+    std::unique_ptr<daqdataformats::Fragment> frag_ptr;
+    {
+      std::lock_guard<std::mutex> lk(m_cache_mutex);
+      OpenFile& open_file = get_open_file(file_name);
+      std::lock_guard<std::mutex> hdf5_lock(HDF5FileUtils::get_hdf5_mutex());
+      if (open_file.packed_file.get() != nullptr) {
+        frag_ptr = open_file.packed_file->read_fragment(record_id, source_id);
+      } else {
+        frag_ptr = open_file.file->get_frag_ptr(record_id, source_id);
+      }
+    }
+    if (frag_ptr.get() != nullptr && FragmentCompressor::is_compressed(*frag_ptr)) {
+      return FragmentCompressor::decompress_fragment(*frag_ptr);
+    }
+    return frag_ptr;
+  }
+
+  /**
+   * @brief Closes all of the open files and forgets the lists of records
+   */
+  void clear()
+  {
+    std::lock_guard<std::mutex> lk(m_cache_mutex);
+    std::lock_guard<std::mutex> hdf5_lock(HDF5FileUtils::get_hdf5_mutex());
+    m_open_files.clear();
+    m_lru_file_names.clear();
+    m_record_ids_by_file.clear();
+  }
+
+  size_t get_number_of_open_files()
+  {
+    std::lock_guard<std::mutex> lk(m_cache_mutex);
+    return m_open_files.size();
+  }
+
+private:
+  struct OpenFile
+  {
+    std::unique_ptr<hdf5libs::HDF5RawDataFile> file;
+    std::unique_ptr<PackedRecordReader> packed_file; ///< used instead of file, for files in the packed layout
+    std::list<std::string>::iterator lru_position;
+  };
+
+  /**
+   * @brief Returns the TriggerRecord with the payloads of its compressed Fragments restored,
+   * or the TriggerRecord itself if none of its Fragments are compressed
+   */
+  static std::unique_ptr<daqdataformats::TriggerRecord> decompress_fragments(
+    std::unique_ptr<daqdataformats::TriggerRecord> tr_ptr)
+  {
+    auto const& fragments = tr_ptr->get_fragments_ref();
+    if (std::none_of(fragments.begin(), fragments.end(), [](auto const& frag_ptr) {
+          return FragmentCompressor::is_compressed(*frag_ptr);
+        })) {
+      return tr_ptr;
+    }
+    auto tr_copy = std::make_unique<daqdataformats::TriggerRecord>(tr_ptr->get_header_ref());
+    for (auto const& frag_ptr : fragments) {
+      tr_copy->add_fragment(FragmentCompressor::decompress_fragment(*frag_ptr));
+    }
+    return tr_copy;
+  }
+
+  /**
+   * @brief Returns the open file, opening it (and closing the least recently used
+   * file, if needed) if it is not open yet.  The m_cache_mutex needs to be held by the caller.
+   */
+  OpenFile& get_open_file(const std::string& file_name)
+  {
+    auto iter = m_open_files.find(file_name);
+    if (iter != m_open_files.end()) {
+      m_lru_file_names.splice(m_lru_file_names.begin(), m_lru_file_names, iter->second.lru_position);
+      return iter->second;
+    }
+
+    std::lock_guard<std::mutex> hdf5_lock(HDF5FileUtils::get_hdf5_mutex());
+    while (m_open_files.size() >= m_max_open_files) {
+      m_open_files.erase(m_lru_file_names.back());
+      m_lru_file_names.pop_back();
+    }
+    OpenFile open_file;
+    if (PackedRecordReader::is_packed_file(file_name)) {
+      open_file.packed_file.reset(new PackedRecordReader(file_name));
+    } else {
+      open_file.file.reset(new hdf5libs::HDF5RawDataFile(file_name));
+    }
+    m_lru_file_names.push_front(file_name);
+    open_file.lru_position = m_lru_file_names.begin();
+    return m_open_files.emplace(file_name, std::move(open_file)).first->second;
+  }
+
+  /**
+   * @brief The m_cache_mutex needs to be held by the caller.
+   */
+  const std::set<record_id_t>& get_record_ids_while_locked(const std::string& file_name)
+  {
+    auto iter = m_record_ids_by_file.find(file_name);
+    if (iter != m_record_ids_by_file.end()) {
+      return iter->second;
+    }
+
+    std::set<record_id_t> record_ids;
+    std::string index_file_name = file_name + recordindex::s_side_car_suffix;
+    bool have_index = false;
+    if (std::filesystem::exists(index_file_name)) {
+      try {
+        RecordIndexReader index_reader(index_file_name);
+        for (auto const& entry : index_reader.get_entries()) {
+          record_ids.insert(std::make_pair(entry.record_number, entry.sequence_number));
+        }
+        have_index = true;
+      } catch (ers::Issue const& excpt) {
+        ers::warning(excpt);
+      }
+    }
+    if (!have_index) {
+      OpenFile& open_file = get_open_file(file_name);
+      std::lock_guard<std::mutex> hdf5_lock(HDF5FileUtils::get_hdf5_mutex());
+      if (open_file.packed_file.get() != nullptr) {
+        for (auto const& record_id : open_file.packed_file->get_record_ids()) {
+          record_ids.insert(record_id);
+        }
+      } else {
+        for (auto const& record_id : open_file.file->get_all_record_ids()) {
+          record_ids.insert(record_id);
+        }
+      }
+    }
+    return m_record_ids_by_file.emplace(file_name, std::move(record_ids)).first->second;
+  }
+
+  size_t m_max_open_files;
+  std::map<std::string, OpenFile> m_open_files;
+  std::list<std::string> m_lru_file_names; ///< most recently used first
+  std::map<std::string, std::set<record_id_t>> m_record_ids_by_file;
+  std::mutex m_cache_mutex;
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_PLUGINS_HDF5FILECACHE_HPP_
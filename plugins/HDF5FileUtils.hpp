@@ -18,6 +18,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <mutex>
 #include <regex>
 #include <string>
 #include <vector>
@@ -30,6 +31,18 @@
 namespace dunedaq {
 namespace dfmodules {
 namespace HDF5FileUtils {
+/**
+ * @brief Returns the mutex that serializes calls into the HDF5 library.
+ * The HDF5 library is not re-entrant, so files must not be created, written,
+ * or closed concurrently from different threads.
+ */
+inline std::mutex&
+get_hdf5_mutex()
+{
+  static std::mutex s_hdf5_mutex;
+  return s_hdf5_mutex;
+}
+
 /**
  * @brief Retrieve top HDF5 group
  */
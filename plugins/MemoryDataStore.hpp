@@ -0,0 +1,104 @@
+/**
+ * @file MemoryDataStore.hpp
+ *
+ * An implementation of the DataStore interface that keeps the most recent
+ * TriggerRecords and TimeSlices in a ring buffer in memory, instead of writing
+ * them to disk.  Consumers in the same process (e.g. data-quality monitoring or
+ * an online trigger) find the ring by the name of the DataStore, with
+ * MemoryRecordRing::find(), and read the records back from it.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_PLUGINS_MEMORYDATASTORE_HPP_
+#define DFMODULES_PLUGINS_MEMORYDATASTORE_HPP_
+
+#include "dfmodules/DataStore.hpp"
+#include "dfmodules/MemoryRecordRing.hpp"
+#include "dfmodules/memorydatastore/Nljs.hpp"
+#include "dfmodules/memorydatastore/Structs.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <memory>
+
+namespace dunedaq {
+namespace dfmodules {
+
+/**
+ * @brief MemoryDataStore keeps the data blocks in an in-memory ring
+ */
+class MemoryDataStore : public DataStore
+{
+
+public:
+  enum
+  {
+    TLVL_BASIC = 2
+  };
+
+  /**
+   * @brief MemoryDataStore Constructor
+   * @param conf Configuration of the MemoryDataStore (see memorydatastore.jsonnet)
+   */
+  explicit MemoryDataStore(const nlohmann::json& conf)
+    : DataStore(conf.value("name", "data_store"))
+  {
+    TLOG_DEBUG(TLVL_BASIC) << get_name() << ": Configuration: " << conf;
+
+    auto config_params = conf.get<memorydatastore::ConfParams>();
+    size_t max_records = config_params.max_records > 0 ? config_params.max_records : 0;
+    m_ring = MemoryRecordRing::create(get_name(), config_params.capacity_bytes, max_records);
+  }
+
+  /**
+   * @brief MemoryDataStore write()
+   * Copies the TriggerRecord into the ring, dropping the oldest records if needed.
+   */
+  virtual void write(const daqdataformats::TriggerRecord& tr) { m_ring->add(tr); }
+
+  /**
+   * @brief MemoryDataStore write()
+   * Copies the TimeSlice into the ring, dropping the oldest records if needed.
+   */
+  virtual void write(const daqdataformats::TimeSlice& ts) { m_ring->add(ts); }
+
+  /**
+   * @brief Fills the operational monitoring information of the MemoryDataStore.
+   */
+  void get_info(opmonlib::InfoCollector& ci, int level) { m_ring->get_info(ci, level); }
+
+  /**
+   * @brief Informs the MemoryDataStore that writes of data blocks associated
+   * with the specified run number will soon be requested.  The records of the
+   * previous run are dropped from the ring.
+   */
+  void prepare_for_run(daqdataformats::run_number_t /*run_number*/) { m_ring->clear(); }
+
+  /**
+   * @brief Informs the MemoryDataStore that writes of data blocks associated
+   * with the specified run number have finished, for now.  The records stay
+   * in the ring, so that consumers can still read them.
+   */
+  void finish_with_run(daqdataformats::run_number_t /*run_number*/) {}
+
+  /**
+   * @brief Returns the ring that this DataStore writes into
+   */
+  std::shared_ptr<MemoryRecordRing> get_ring() const { return m_ring; }
+
+private:
+  MemoryDataStore(const MemoryDataStore&) = delete;
+  MemoryDataStore& operator=(const MemoryDataStore&) = delete;
+  MemoryDataStore(MemoryDataStore&&) = delete;
+  MemoryDataStore& operator=(MemoryDataStore&&) = delete;
+
+  std::shared_ptr<MemoryRecordRing> m_ring;
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_PLUGINS_MEMORYDATASTORE_HPP_
@@ -0,0 +1,403 @@
+/**
+ * @file RawDataStore.hpp
+ *
+ * An implementation of the DataStore interface that writes TriggerRecords
+ * and TimeSlices into flat binary files, using page-aligned buffers and
+ * direct I/O.  The files can be converted to the standard HDF5 layout
+ * offline with the raw_data_file_to_hdf5 application.
+ *
+ * Optionally, the writes are submitted through an io_uring queue, which keeps
+ * several of them in flight.  In that mode, the TriggerRecords are reported as
+ * completed (see DataStore::take_completed_records()) once a sync that covers
+ * their data has completed, and the data that has been written is synced at
+ * most every sync_interval_ms.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_PLUGINS_RAWDATASTORE_HPP_
+#define DFMODULES_PLUGINS_RAWDATASTORE_HPP_
+
+#include "dfmodules/CommonIssues.hpp"
+#include "dfmodules/DataStore.hpp"
+#include "dfmodules/DiskSpaceMonitor.hpp"
+#include "dfmodules/IoUringWriteEngine.hpp"
+#include "dfmodules/RawDataFileWriter.hpp"
+#include "dfmodules/rawdatastore/Nljs.hpp"
+#include "dfmodules/rawdatastore/Structs.hpp"
+
+#include "logging/Logging.hpp"
+
+#include "boost/date_time/posix_time/posix_time.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <deque>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace dfmodules {
+
+/**
+ * @brief RawDataStore writes the data blocks into flat binary files
+ */
+class RawDataStore : public DataStore
+{
+
+public:
+  enum
+  {
+    TLVL_BASIC = 2,
+    TLVL_FILE_SIZE = 5
+  };
+
+  /**
+   * @brief RawDataStore Constructor
+   * @param conf Configuration of the RawDataStore (see rawdatastore.jsonnet)
+   */
+  explicit RawDataStore(const nlohmann::json& conf)
+    : DataStore(conf.value("name", "data_store"))
+    , m_run_number(0)
+    , m_run_number_of_open_file(0)
+    , m_file_index(0)
+  {
+    TLOG_DEBUG(TLVL_BASIC) << get_name() << ": Configuration: " << conf;
+
+    m_config_params = conf.get<rawdatastore::ConfParams>();
+    m_path = m_config_params.directory_path;
+    m_max_file_size = m_config_params.max_file_size_bytes;
+    m_free_space_safety_factor_for_write = m_config_params.free_space_safety_factor_for_write;
+    if (m_free_space_safety_factor_for_write < 1.1) {
+      m_free_space_safety_factor_for_write = 1.1;
+    }
+
+    m_disk_space_monitor.reset(new DiskSpaceMonitor(
+      get_name(), m_path, std::chrono::milliseconds(m_config_params.free_space_sampling_interval_ms)));
+    if (!m_disk_space_monitor->is_path_valid()) {
+      ers::warning(InvalidOutputPath(ERS_HERE, get_name(), m_path));
+    }
+    m_disk_space_monitor->start_monitoring();
+
+    // the writes are submitted through io_uring when it is enabled and the kernel supports
+    // it, otherwise they are done with pwrite()
+    auto const& io_uring_params = m_config_params.io_uring_parameters;
+    if (io_uring_params.enabled) {
+      try {
+        m_write_engine.reset(
+          new IoUringWriteEngine(get_name(),
+                                 static_cast<size_t>(std::max(io_uring_params.queue_depth, 1)),
+                                 static_cast<size_t>(std::max(io_uring_params.number_of_buffers, 2)),
+                                 m_config_params.write_buffer_size_bytes));
+      } catch (IoUringProblem const& excpt) {
+        ers::warning(excpt);
+      }
+      m_sync_interval = std::chrono::milliseconds(std::max(io_uring_params.sync_interval_ms, 0));
+    }
+  }
+
+  /**
+   * @brief RawDataStore write()
+   * Appends the TriggerRecord to the current output file.
+   */
+  virtual void write(const daqdataformats::TriggerRecord& tr)
+  {
+    auto const& trh = tr.get_header_ref();
+    size_t tr_size = tr.get_total_size_bytes();
+    check_free_space(tr_size, "trigger record");
+    open_file_if_needed(trh.get_run_number(), tr_size);
+
+    try {
+      m_file_handle->write(tr);
+    } catch (ers::Issue const& excpt) {
+      throw FileOperationProblem(ERS_HERE, get_name(), m_file_handle->get_in_progress_file_name(), excpt);
+    }
+    m_disk_space_monitor->record_bytes_written(tr_size);
+
+    if (m_write_engine.get() != nullptr) {
+      m_records_in_open_file.emplace_back(record_id_t(trh.get_trigger_number(), trh.get_sequence_number()),
+                                          m_file_handle->get_recorded_size());
+      update_completed_records();
+    }
+  }
+
+  /**
+   * @brief RawDataStore write()
+   * Appends the TimeSlice to the current output file.
+   */
+  virtual void write(const daqdataformats::TimeSlice& ts)
+  {
+    size_t ts_size = ts.get_total_size_bytes();
+    check_free_space(ts_size, "time slice");
+    open_file_if_needed(ts.get_header().run_number, ts_size);
+
+    try {
+      m_file_handle->write(ts);
+    } catch (ers::Issue const& excpt) {
+      throw FileOperationProblem(ERS_HERE, get_name(), m_file_handle->get_in_progress_file_name(), excpt);
+    }
+    m_disk_space_monitor->record_bytes_written(ts_size);
+  }
+
+  /**
+   * @brief Whether the writes are submitted through io_uring, in which case the
+   * TriggerRecords are reported once a sync that covers them has completed.
+   */
+  bool reports_write_completions() const { return m_write_engine.get() != nullptr; }
+
+  /**
+   * @brief Returns the TriggerRecords whose data has been synced to disk since the
+   * previous call.
+   */
+  std::vector<record_id_t> take_completed_records()
+  {
+    update_completed_records();
+    std::vector<record_id_t> completed_records;
+    completed_records.swap(m_completed_records);
+    return completed_records;
+  }
+
+  /**
+   * @brief Returns the TriggerRecords whose file could not be closed properly since the
+   * previous call.
+   */
+  std::vector<record_id_t> take_failed_records()
+  {
+    std::vector<record_id_t> failed_records;
+    failed_records.swap(m_failed_records);
+    return failed_records;
+  }
+
+  /**
+   * @brief Fills the operational monitoring information of the RawDataStore.
+   */
+  void get_info(opmonlib::InfoCollector& ci, int level)
+  {
+    opmonlib::InfoCollector disk_space_ci;
+    m_disk_space_monitor->get_info(disk_space_ci, level);
+    ci.add("disk_space", disk_space_ci);
+  }
+
+  /**
+   * @brief Informs the RawDataStore that writes of data blocks associated
+   * with the specified run number will soon be requested.
+   * This method throws an exception if the output path is not valid or the
+   * free space on the output disk is too small.
+   */
+  void prepare_for_run(daqdataformats::run_number_t run_number)
+  {
+    m_run_number = run_number;
+
+    if (!m_disk_space_monitor->sample()) {
+      throw InvalidOutputPath(ERS_HERE, get_name(), m_path);
+    }
+    size_t free_space = m_disk_space_monitor->get_measured_free_space();
+    if (free_space < m_max_file_size) {
+      throw InsufficientDiskSpace(
+        ERS_HERE, get_name(), m_path, free_space, m_max_file_size, "the configured maximum size of a single file");
+    }
+
+    m_file_index = 0;
+    m_completed_records.clear();
+    m_failed_records.clear();
+  }
+
+  /**
+   * @brief Informs the RawDataStore that writes of data blocks associated
+   * with the specified run number have finished, for now.  The current
+   * output file is closed.
+   */
+  void finish_with_run(daqdataformats::run_number_t /*run_number*/)
+  {
+    m_run_number = 0;
+    close_file();
+  }
+
+private:
+  RawDataStore(const RawDataStore&) = delete;
+  RawDataStore& operator=(const RawDataStore&) = delete;
+  RawDataStore(RawDataStore&&) = delete;
+  RawDataStore& operator=(RawDataStore&&) = delete;
+
+  // declared before the file, which uses it until it is closed
+  std::unique_ptr<IoUringWriteEngine> m_write_engine;
+  std::chrono::milliseconds m_sync_interval{ 0 };
+  std::chrono::steady_clock::time_point m_last_sync_time;
+
+  std::unique_ptr<RawDataFileWriter> m_file_handle;
+  daqdataformats::run_number_t m_run_number;
+  daqdataformats::run_number_t m_run_number_of_open_file;
+
+  // Total number of generated files
+  size_t m_file_index;
+
+  // Configuration
+  rawdatastore::ConfParams m_config_params;
+  std::string m_path;
+  size_t m_max_file_size;
+  float m_free_space_safety_factor_for_write;
+
+  // Free space on the output disk
+  std::unique_ptr<DiskSpaceMonitor> m_disk_space_monitor;
+
+  // TriggerRecords in the open file that have not been synced yet, with the size of the
+  // file after each of them, and the ones that have completed or failed
+  std::deque<std::pair<record_id_t, size_t>> m_records_in_open_file;
+  std::vector<record_id_t> m_completed_records;
+  std::vector<record_id_t> m_failed_records;
+
+  /**
+   * @brief Moves the TriggerRecords whose data has been synced to the list of completed
+   * ones, and starts the next sync, if there are TriggerRecords waiting for one and the
+   * sync interval has passed.
+   */
+  void update_completed_records()
+  {
+    if (m_file_handle.get() == nullptr || m_records_in_open_file.empty()) {
+      return;
+    }
+    try {
+      m_file_handle->poll_completions();
+      size_t durable_size = m_file_handle->get_durable_size();
+      while (!m_records_in_open_file.empty() && m_records_in_open_file.front().second <= durable_size) {
+        m_completed_records.push_back(m_records_in_open_file.front().first);
+        m_records_in_open_file.pop_front();
+      }
+
+      auto now = std::chrono::steady_clock::now();
+      if (!m_records_in_open_file.empty() && !m_file_handle->is_sync_in_flight() &&
+          now - m_last_sync_time >= m_sync_interval) {
+        m_file_handle->sync();
+        m_last_sync_time = now;
+      }
+    } catch (ers::Issue const& excpt) {
+      // the problem is reported again by the next write, or when the file is closed
+      ers::error(FileOperationProblem(ERS_HERE, get_name(), m_file_handle->get_in_progress_file_name(), excpt));
+    }
+  }
+
+  void check_free_space(size_t block_size, const std::string& block_description)
+  {
+    size_t current_free_space = m_disk_space_monitor->get_predicted_free_space();
+    if (current_free_space < (m_free_space_safety_factor_for_write * block_size)) {
+      std::ostringstream msg_oss;
+      msg_oss << "a safety factor of " << m_free_space_safety_factor_for_write << " times the " << block_description
+              << " size";
+      InsufficientDiskSpace issue(ERS_HERE,
+                                  get_name(),
+                                  m_path,
+                                  current_free_space,
+                                  (m_free_space_safety_factor_for_write * block_size),
+                                  msg_oss.str());
+      std::string msg = "writing a " + block_description + " to a raw data file in " + m_path;
+      throw RetryableDataStoreProblem(ERS_HERE, get_name(), msg, issue);
+    }
+  }
+
+  /**
+   * @brief Opens a new output file when there is no open file, when the run
+   * number changes, or when the next data block would take the current file
+   * beyond the maximum file size.
+   */
+  void open_file_if_needed(daqdataformats::run_number_t run_number, size_t size_of_next_write)
+  {
+    if (m_file_handle.get() != nullptr) {
+      // a data block that is larger than the maximum file size is written to the current file, if it is empty
+      if (run_number == m_run_number_of_open_file &&
+          ((m_file_handle->get_recorded_size() + size_of_next_write) <= m_max_file_size ||
+           m_file_handle->get_recorded_size() <= sizeof(rawdatafile::FileHeader))) {
+        return;
+      }
+      close_file();
+      if (run_number == m_run_number_of_open_file) {
+        ++m_file_index;
+      }
+    }
+
+    std::string file_name = get_file_name(run_number);
+
+    rawdatafile::FileHeader file_header;
+    file_header.run_number = run_number;
+    file_header.file_index = m_file_index;
+    file_header.creation_time = static_cast<uint64_t>(time(0)); // NOLINT(build/unsigned)
+    rawdatafile::copy_string(file_header.writer_identifier, m_config_params.filename_parameters.writer_identifier);
+    rawdatafile::copy_string(file_header.operational_environment, m_config_params.operational_environment);
+
+    TLOG_DEBUG(TLVL_BASIC) << get_name() << ": going to open file " << file_name;
+    try {
+      m_file_handle.reset(new RawDataFileWriter(file_name,
+                                                file_header,
+                                                m_config_params.write_buffer_size_bytes,
+                                                m_config_params.use_direct_io,
+                                                ".writing",
+                                                m_write_engine.get()));
+    } catch (ers::Issue const& excpt) {
+      throw FileOperationProblem(ERS_HERE, get_name(), file_name, excpt);
+    }
+    m_run_number_of_open_file = run_number;
+  }
+
+  void close_file()
+  {
+    if (m_file_handle.get() == nullptr) {
+      return;
+    }
+    std::unique_ptr<RawDataFileWriter> file_handle = std::move(m_file_handle);
+    TLOG_DEBUG(TLVL_FILE_SIZE) << get_name() << ": closing file " << file_handle->get_file_name() << ", size "
+                               << file_handle->get_recorded_size() << " bytes";
+    // the TriggerRecords of the file are complete once it has been closed, and have failed if closing it fails
+    std::deque<std::pair<record_id_t, size_t>> records_in_file;
+    records_in_file.swap(m_records_in_open_file);
+    try {
+      file_handle->close();
+    } catch (ers::Issue const& excpt) {
+      for (auto const& record : records_in_file) {
+        m_failed_records.push_back(record.first);
+      }
+      throw FileOperationProblem(ERS_HERE, get_name(), file_handle->get_file_name(), excpt);
+    }
+    for (auto const& record : records_in_file) {
+      m_completed_records.push_back(record.first);
+    }
+  }
+
+  /**
+   * @brief Translates the specified input parameters into the appropriate filename.
+   */
+  std::string get_file_name(daqdataformats::run_number_t run_number)
+  {
+    auto const& fnp = m_config_params.filename_parameters;
+    std::ostringstream work_oss;
+    work_oss << m_config_params.directory_path;
+    if (work_oss.str().length() > 0) {
+      work_oss << "/";
+    }
+    work_oss << fnp.overall_prefix;
+    if (work_oss.str().length() > 0) {
+      work_oss << "_";
+    }
+    work_oss << fnp.run_number_prefix;
+    work_oss << std::setw(fnp.digits_for_run_number) << std::setfill('0') << run_number;
+    work_oss << "_";
+    work_oss << fnp.file_index_prefix;
+    work_oss << std::setw(fnp.digits_for_file_index) << std::setfill('0') << m_file_index;
+    work_oss << "_" << fnp.writer_identifier;
+    if (!m_config_params.disable_unique_filename_suffix) {
+      work_oss << "_" << boost::posix_time::to_iso_string(boost::posix_time::from_time_t(time(0)));
+    }
+    work_oss << ".bin";
+    return work_oss.str();
+  }
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_PLUGINS_RAWDATASTORE_HPP_
@@ -0,0 +1,512 @@
+/**
+ * @file SubprocessDataStore.hpp
+ *
+ * An implementation of the DataStore interface that hands the TriggerRecords
+ * and TimeSlices to a separate writer process (dfmodules_subprocess_writer),
+ * which writes them with its own DataStore, e.g. an HDF5DataStore.  The records
+ * are serialized into a shared memory ring, and the writer process reports each
+ * completed write back through a second ring, so the TriggerRecords are reported
+ * as completed (see DataStore::take_completed_records()) only once the writer
+ * process has written them.  A problem in the writer process (or in the HDF5
+ * library) therefore does not bring down the DAQ application, and several writer
+ * processes (one per writer lane of the DataWriter) don't share the HDF5 global lock.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_PLUGINS_SUBPROCESSDATASTORE_HPP_
+#define DFMODULES_PLUGINS_SUBPROCESSDATASTORE_HPP_
+
+#include "dfmodules/DataStore.hpp"
+#include "dfmodules/SharedMemoryRing.hpp"
+#include "dfmodules/SubprocessWriterProtocol.hpp"
+#include "dfmodules/subprocessdatastore/Nljs.hpp"
+#include "dfmodules/subprocessdatastore/Structs.hpp"
+#include "dfmodules/subprocessdatastoreinfo/InfoNljs.hpp"
+
+#include "appfwk/DAQModule.hpp"
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <spawn.h>
+#include <string>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+extern char** environ; // NOLINT
+
+namespace dunedaq {
+
+// Disable coverage checking LCOV_EXCL_START
+ERS_DECLARE_ISSUE_BASE(dfmodules,
+                       WriterProcessProblem,
+                       appfwk::GeneralDAQModuleIssue,
+                       "A problem was encountered with the writer process " << pid << ": " << details,
+                       ((std::string)name),
+                       ((int)pid)((std::string)details))
+
+ERS_DECLARE_ISSUE_BASE(dfmodules,
+                       WriterProcessWriteFailed,
+                       appfwk::GeneralDAQModuleIssue,
+                       "The writer process failed to write " << record_type << " number " << record_number
+                                                             << ", sequence number " << sequence_number << ": "
+                                                             << details,
+                       ((std::string)name),
+                       ((std::string)record_type)((size_t)record_number)((size_t)sequence_number)((std::string)details))
+// Re-enable coverage checking LCOV_EXCL_STOP
+
+namespace dfmodules {
+
+/**
+ * @brief SubprocessDataStore hands the data blocks to a writer process
+ */
+class SubprocessDataStore : public DataStore
+{
+
+public:
+  enum
+  {
+    TLVL_BASIC = 2,
+    TLVL_REPLIES = 10
+  };
+
+  /**
+   * @brief SubprocessDataStore Constructor.  Starts the writer process, and waits
+   * for it to create its DataStore.
+   * @param conf Configuration of the SubprocessDataStore (see subprocessdatastore.jsonnet)
+   */
+  explicit SubprocessDataStore(const nlohmann::json& conf)
+    : DataStore(conf.value("name", "data_store"))
+    , m_writer_pid(-1)
+    , m_writer_has_exited(false)
+    , m_writer_exit_status(0)
+    , m_reading_replies(false)
+    , m_stopping_writer(false)
+    , m_records_awaiting_completion(0)
+    , m_records_sent(0)
+    , m_bytes_sent(0)
+    , m_write_failures(0)
+  {
+    TLOG_DEBUG(TLVL_BASIC) << get_name() << ": Configuration: " << conf;
+
+    m_config_params = conf.get<subprocessdatastore::ConfParams>();
+    m_write_timeout = std::chrono::milliseconds(std::max(m_config_params.write_timeout_ms, 0));
+    m_command_timeout = std::chrono::milliseconds(std::max(m_config_params.command_timeout_ms, 1));
+
+    m_request_ring.reset(new SharedMemoryRing(get_name() + "_requests", m_config_params.request_ring_size_bytes));
+    m_reply_ring.reset(new SharedMemoryRing(get_name() + "_replies", m_config_params.reply_ring_size_bytes));
+    start_writer_process();
+
+    // the DataStore of the writer process has the name of this one, unless it is configured otherwise
+    nlohmann::json data_store_params = conf.value("data_store_parameters", nlohmann::json::object());
+    if (!data_store_params.contains("name")) {
+      data_store_params["name"] = get_name();
+    }
+    try {
+      send_command(subprocesswriter::MessageType::kConfigure, data_store_params.dump(), "configuring");
+    } catch (...) { // NOLINT(runtime/exceptions)
+      stop_writer_process();
+      // NOLINT here because we *ARE* re-throwing the exception!
+      throw;
+    }
+  }
+
+  ~SubprocessDataStore() { stop_writer_process(); }
+
+  /**
+   * @brief SubprocessDataStore write()
+   * Copies the TriggerRecord into the request ring.  A RetryableDataStoreProblem is
+   * thrown if there is no space in the ring within the configured write timeout.
+   */
+  virtual void write(const daqdataformats::TriggerRecord& tr)
+  {
+    check_record_size(subprocesswriter::get_message_size(tr), "trigger record");
+    record_id_t record_id(tr.get_header_ref().get_trigger_number(), tr.get_header_ref().get_sequence_number());
+    std::lock_guard<std::mutex> lk(m_request_mutex);
+    // the TriggerRecord is in flight before it is sent, since its completion may arrive right away
+    {
+      std::lock_guard<std::mutex> reply_lk(m_reply_mutex);
+      m_records_in_flight.insert(record_id);
+    }
+    if (!subprocesswriter::send_record(*m_request_ring, tr, m_write_timeout)) {
+      {
+        std::lock_guard<std::mutex> reply_lk(m_reply_mutex);
+        m_records_in_flight.erase(record_id);
+      }
+      throw_send_problem("handing a trigger record to the writer process");
+    }
+    ++m_records_awaiting_completion;
+    ++m_records_sent;
+    m_bytes_sent += tr.get_total_size_bytes();
+  }
+
+  /**
+   * @brief SubprocessDataStore write()
+   * Copies the TimeSlice into the request ring.  A RetryableDataStoreProblem is
+   * thrown if there is no space in the ring within the configured write timeout.
+   */
+  virtual void write(const daqdataformats::TimeSlice& ts)
+  {
+    check_record_size(subprocesswriter::get_message_size(ts), "time slice");
+    std::lock_guard<std::mutex> lk(m_request_mutex);
+    if (!subprocesswriter::send_record(*m_request_ring, ts, m_write_timeout)) {
+      throw_send_problem("handing a time slice to the writer process");
+    }
+    ++m_records_sent;
+    m_bytes_sent += ts.get_total_size_bytes();
+  }
+
+  /**
+   * @brief The TriggerRecords are reported once the writer process has written them
+   */
+  bool reports_write_completions() const { return true; }
+
+  /**
+   * @brief Returns the TriggerRecords that the writer process has written since the
+   * previous call.
+   */
+  std::vector<record_id_t> take_completed_records()
+  {
+    std::vector<record_id_t> completed_records;
+    std::lock_guard<std::mutex> lk(m_reply_mutex);
+    completed_records.swap(m_completed_records);
+    return completed_records;
+  }
+
+  /**
+   * @brief Returns the TriggerRecords that the writer process has failed to write since
+   * the previous call (the failures have been reported).
+   */
+  std::vector<record_id_t> take_failed_records()
+  {
+    std::vector<record_id_t> failed_records;
+    std::lock_guard<std::mutex> lk(m_reply_mutex);
+    failed_records.swap(m_failed_records);
+    return failed_records;
+  }
+
+  /**
+   * @brief Fills the operational monitoring information of the SubprocessDataStore.
+   * The DataStore in the writer process does not report its own information.
+   */
+  void get_info(opmonlib::InfoCollector& ci, int /*level*/)
+  {
+    subprocessdatastoreinfo::Info info;
+    info.records_sent = m_records_sent.exchange(0);
+    info.bytes_sent = m_bytes_sent.exchange(0);
+    info.write_failures = m_write_failures.exchange(0);
+    info.records_awaiting_completion = m_records_awaiting_completion.load();
+    info.ring_used_bytes = m_request_ring->get_used_bytes();
+    info.ring_capacity = m_request_ring->get_capacity();
+    ci.add(info);
+  }
+
+  /**
+   * @brief Informs the DataStore of the writer process that writes of data blocks
+   * associated with the specified run number will soon be requested, and waits for
+   * it to be ready.  A problem that the writer process reports is rethrown here.
+   */
+  void prepare_for_run(daqdataformats::run_number_t run_number)
+  {
+    {
+      std::lock_guard<std::mutex> lk(m_reply_mutex);
+      m_completed_records.clear();
+      m_failed_records.clear();
+      m_records_in_flight.clear();
+      m_records_awaiting_completion = 0;
+    }
+    subprocesswriter::RunCommand command{ run_number };
+    send_command(subprocesswriter::MessageType::kPrepareRun,
+                 std::string(reinterpret_cast<const char*>(&command), sizeof(command)),
+                 "preparing for run " + std::to_string(run_number));
+  }
+
+  /**
+   * @brief Informs the DataStore of the writer process that writes of data blocks
+   * associated with the specified run number have finished, and waits for it to
+   * finish with the run.  All the writes have completed when this method returns.
+   */
+  void finish_with_run(daqdataformats::run_number_t run_number)
+  {
+    subprocesswriter::RunCommand command{ run_number };
+    send_command(subprocesswriter::MessageType::kFinishRun,
+                 std::string(reinterpret_cast<const char*>(&command), sizeof(command)),
+                 "finishing with run " + std::to_string(run_number));
+  }
+
+private:
+  SubprocessDataStore(const SubprocessDataStore&) = delete;
+  SubprocessDataStore& operator=(const SubprocessDataStore&) = delete;
+  SubprocessDataStore(SubprocessDataStore&&) = delete;
+  SubprocessDataStore& operator=(SubprocessDataStore&&) = delete;
+
+  // how often the reader of the replies checks whether the writer process is still running
+  static constexpr std::chrono::milliseconds s_reply_poll_time{ 100 };
+
+  // Configuration
+  subprocessdatastore::ConfParams m_config_params;
+  std::chrono::milliseconds m_write_timeout;
+  std::chrono::milliseconds m_command_timeout;
+
+  // the requests are written by the callers of this DataStore, the replies are read by m_reply_thread
+  std::unique_ptr<SharedMemoryRing> m_request_ring;
+  std::unique_ptr<SharedMemoryRing> m_reply_ring;
+  std::mutex m_request_mutex;
+
+  // Writer process
+  pid_t m_writer_pid;
+  bool m_writer_has_exited;
+  int m_writer_exit_status;
+  std::mutex m_process_mutex;
+
+  // Replies
+  std::thread m_reply_thread;
+  std::atomic<bool> m_reading_replies;
+  std::atomic<bool> m_stopping_writer; // the writer process has been asked to exit
+  std::mutex m_reply_mutex;
+  std::condition_variable m_ack_cv;
+  std::deque<std::pair<subprocesswriter::Ack, std::string>> m_acks;
+  std::vector<record_id_t> m_completed_records;
+  std::vector<record_id_t> m_failed_records;
+  std::set<record_id_t> m_records_in_flight; // TriggerRecords that have been sent and not completed yet
+
+  // Monitoring
+  std::atomic<size_t> m_records_awaiting_completion;
+  std::atomic<size_t> m_records_sent;
+  std::atomic<size_t> m_bytes_sent;
+  std::atomic<size_t> m_write_failures;
+
+  /**
+   * @brief Starts the writer process, which attaches to the rings through the file
+   * descriptors that it inherits, and the thread that reads its replies.
+   */
+  void start_writer_process()
+  {
+    std::string executable = m_config_params.writer_executable;
+    std::string request_fd = std::to_string(m_request_ring->get_fd());
+    std::string reply_fd = std::to_string(m_reply_ring->get_fd());
+    std::string name = get_name();
+    std::vector<char*> argv{ executable.data(), request_fd.data(), reply_fd.data(), name.data(), nullptr };
+    int result = posix_spawnp(&m_writer_pid, executable.c_str(), nullptr, nullptr, argv.data(), environ);
+    if (result != 0) {
+      throw GeneralDataStoreProblem(
+        ERS_HERE, get_name(), "starting the writer process \"" + executable + "\": " + std::strerror(result));
+    }
+    TLOG_DEBUG(TLVL_BASIC) << get_name() << ": Started the writer process " << m_writer_pid;
+
+    m_reading_replies = true;
+    m_reply_thread = std::thread(&SubprocessDataStore::read_replies, this);
+  }
+
+  /**
+   * @brief Asks the writer process to exit, and kills it if it doesn't do so in time
+   */
+  void stop_writer_process()
+  {
+    if (!writer_process_has_exited()) {
+      m_stopping_writer = true;
+      {
+        std::lock_guard<std::mutex> lk(m_request_mutex);
+        m_request_ring->write_message(
+          static_cast<uint32_t>(subprocesswriter::MessageType::kShutdown), {}, m_command_timeout); // NOLINT
+      }
+      auto deadline = std::chrono::steady_clock::now() + m_command_timeout;
+      while (!writer_process_has_exited() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      if (!writer_process_has_exited()) {
+        ers::error(WriterProcessProblem(ERS_HERE, get_name(), m_writer_pid, "it did not exit in time and is killed"));
+        kill(m_writer_pid, SIGKILL);
+        std::lock_guard<std::mutex> lk(m_process_mutex);
+        waitpid(m_writer_pid, &m_writer_exit_status, 0);
+        m_writer_has_exited = true;
+      }
+    }
+    m_request_ring->close();
+
+    m_reading_replies = false;
+    if (m_reply_thread.joinable()) {
+      m_reply_thread.join();
+    }
+  }
+
+  /**
+   * @brief Whether the writer process has exited; the process is reaped when it has
+   */
+  bool writer_process_has_exited()
+  {
+    std::lock_guard<std::mutex> lk(m_process_mutex);
+    if (!m_writer_has_exited && waitpid(m_writer_pid, &m_writer_exit_status, WNOHANG) == m_writer_pid) {
+      m_writer_has_exited = true;
+    }
+    return m_writer_has_exited;
+  }
+
+  /**
+   * @brief Reads the acknowledgements and the completions that the writer process sends
+   */
+  void read_replies()
+  {
+    bool exit_was_reported = false;
+    bool records_in_flight_were_failed = false;
+    while (m_reading_replies.load()) {
+      uint32_t type = 0; // NOLINT(build/unsigned)
+      size_t size = 0;
+      const char* payload = m_reply_ring->peek_message(type, size, s_reply_poll_time);
+      if (payload == nullptr) {
+        // the writer process may have sent more replies between the previous check and its exit,
+        // so the TriggerRecords that it has not completed are only known once those have been read
+        if (exit_was_reported && !records_in_flight_were_failed) {
+          records_in_flight_were_failed = true;
+          fail_records_in_flight();
+        }
+        if (!exit_was_reported && writer_process_has_exited()) {
+          exit_was_reported = true;
+          if (!m_stopping_writer.load()) {
+            ers::error(WriterProcessProblem(
+              ERS_HERE, get_name(), m_writer_pid, "it exited with status " + std::to_string(m_writer_exit_status)));
+          }
+          // the writes and commands that are waiting for the writer process fail
+          m_request_ring->close();
+          m_ack_cv.notify_all();
+        }
+        continue;
+      }
+
+      if (type == static_cast<uint32_t>(subprocesswriter::MessageType::kCompletion)) { // NOLINT(build/unsigned)
+        subprocesswriter::Completion completion;
+        std::memcpy(&completion, payload, sizeof(completion));
+        std::string details(payload + sizeof(completion), size - sizeof(completion));
+        handle_completion(completion, details);
+      } else if (type == static_cast<uint32_t>(subprocesswriter::MessageType::kAck)) { // NOLINT(build/unsigned)
+        subprocesswriter::Ack ack;
+        std::memcpy(&ack, payload, sizeof(ack));
+        std::string details(payload + sizeof(ack), size - sizeof(ack));
+        TLOG_DEBUG(TLVL_REPLIES) << get_name() << ": Received the acknowledgement of command "
+                                 << static_cast<uint32_t>(ack.command) << ", success = " // NOLINT(build/unsigned)
+                                 << ack.success;
+        {
+          std::lock_guard<std::mutex> lk(m_reply_mutex);
+          m_acks.emplace_back(ack, details);
+        }
+        m_ack_cv.notify_all();
+      }
+      m_reply_ring->consume_message();
+    }
+  }
+
+  void handle_completion(const subprocesswriter::Completion& completion, const std::string& details)
+  {
+    bool is_trigger_record = (completion.record_type == subprocesswriter::MessageType::kTriggerRecord);
+    if (!completion.success) {
+      ++m_write_failures;
+      ers::error(WriterProcessWriteFailed(ERS_HERE,
+                                          get_name(),
+                                          is_trigger_record ? "trigger record" : "time slice",
+                                          completion.record_number,
+                                          completion.sequence_number,
+                                          details));
+    }
+    if (is_trigger_record) {
+      std::lock_guard<std::mutex> lk(m_reply_mutex);
+      m_records_in_flight.erase(record_id_t(completion.record_number, completion.sequence_number));
+      if (completion.success) {
+        m_completed_records.emplace_back(completion.record_number, completion.sequence_number);
+      } else {
+        m_failed_records.emplace_back(completion.record_number, completion.sequence_number);
+      }
+      if (m_records_awaiting_completion > 0) {
+        --m_records_awaiting_completion;
+      }
+    }
+  }
+
+  /**
+   * @brief Reports the TriggerRecords that the writer process has not completed before it
+   * exited as failed, so that their tokens are not held back.
+   */
+  void fail_records_in_flight()
+  {
+    std::lock_guard<std::mutex> lk(m_reply_mutex);
+    for (auto const& record_id : m_records_in_flight) {
+      ++m_write_failures;
+      ers::error(WriterProcessWriteFailed(
+        ERS_HERE, get_name(), "trigger record", record_id.first, record_id.second, "the writer process has exited"));
+      m_failed_records.push_back(record_id);
+    }
+    m_records_in_flight.clear();
+    m_records_awaiting_completion = 0;
+  }
+
+  /**
+   * @brief Sends a command to the writer process, and waits for its acknowledgement.
+   * A GeneralDataStoreProblem is thrown if the command fails or is not acknowledged in time.
+   */
+  void send_command(subprocesswriter::MessageType type, const std::string& payload, const std::string& description)
+  {
+    {
+      std::lock_guard<std::mutex> lk(m_reply_mutex);
+      m_acks.clear();
+    }
+    bool was_sent = false;
+    {
+      std::lock_guard<std::mutex> lk(m_request_mutex);
+      was_sent = m_request_ring->write_message(
+        static_cast<uint32_t>(type), { { payload.data(), payload.size() } }, m_command_timeout); // NOLINT
+    }
+    if (!was_sent) {
+      throw GeneralDataStoreProblem(ERS_HERE, get_name(), description + ": the writer process does not read requests");
+    }
+
+    std::unique_lock<std::mutex> lk(m_reply_mutex);
+    bool was_acknowledged = m_ack_cv.wait_for(lk, m_command_timeout, [&]() {
+      return !m_acks.empty() || m_request_ring->is_closed();
+    });
+    if (!was_acknowledged || m_acks.empty()) {
+      throw GeneralDataStoreProblem(
+        ERS_HERE, get_name(), description + ": the writer process did not acknowledge the command");
+    }
+    auto ack = std::move(m_acks.front());
+    m_acks.pop_front();
+    if (ack.first.command != type || !ack.first.success) {
+      throw GeneralDataStoreProblem(ERS_HERE, get_name(), description + " in the writer process: " + ack.second);
+    }
+  }
+
+  void check_record_size(size_t message_size, const std::string& record_type)
+  {
+    if (message_size > m_request_ring->get_capacity()) {
+      MessageTooLargeForSharedMemoryRing issue(
+        ERS_HERE, message_size, m_request_ring->get_name(), m_request_ring->get_capacity());
+      throw GeneralDataStoreProblem(ERS_HERE, get_name(), "handing a " + record_type + " to the writer process", issue);
+    }
+  }
+
+  void throw_send_problem(const std::string& description)
+  {
+    if (m_request_ring->is_closed()) {
+      throw GeneralDataStoreProblem(ERS_HERE, get_name(), description + ", which is not running");
+    }
+    throw RetryableDataStoreProblem(ERS_HERE, get_name(), description + ", whose request ring is full");
+  }
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_PLUGINS_SUBPROCESSDATASTORE_HPP_
@@ -21,6 +21,7 @@
 
 #include "boost/date_time/posix_time/posix_time.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <memory>
 #include <sstream>
@@ -41,6 +42,7 @@ TPStreamWriter::TPStreamWriter(const std::string& name)
   : dunedaq::appfwk::DAQModule(name)
   , m_thread(std::bind(&TPStreamWriter::do_work, this, std::placeholders::_1))
   , m_queue_timeout(100)
+  , m_max_tpsets_per_wakeup(1)
 {
   register_command("conf", &TPStreamWriter::do_conf);
   register_command("start", &TPStreamWriter::do_start);
@@ -57,7 +59,7 @@ TPStreamWriter::init(const nlohmann::json& payload)
 }
 
 void
-TPStreamWriter::get_info(opmonlib::InfoCollector& ci, int /*level*/)
+TPStreamWriter::get_info(opmonlib::InfoCollector& ci, int level)
 {
   tpstreamwriterinfo::Info info;
 
@@ -66,6 +68,13 @@ TPStreamWriter::get_info(opmonlib::InfoCollector& ci, int /*level*/)
   info.bytes_output = m_bytes_output.exchange(0);
 
   ci.add(info);
+
+  std::lock_guard<std::mutex> lk(m_data_writer_mutex);
+  if (m_data_writer.get() != nullptr) {
+    opmonlib::InfoCollector data_store_ci;
+    m_data_writer->get_info(data_store_ci, level);
+    ci.add(m_data_writer->get_name(), data_store_ci);
+  }
 }
 
 void
@@ -75,10 +84,13 @@ TPStreamWriter::do_conf(const data_t& payload)
   tpstreamwriter::ConfParams conf_params = payload.get<tpstreamwriter::ConfParams>();
   m_accumulation_interval_ticks = conf_params.tp_accumulation_interval_ticks;
   m_source_id = conf_params.source_id;
+  m_max_tpsets_per_wakeup = static_cast<size_t>(std::max(conf_params.max_tpsets_per_wakeup, 1));
 
   // create the DataStore instance here
   try {
-    m_data_writer = make_data_store(payload["data_store_parameters"]);
+    std::unique_ptr<DataStore> data_store = make_data_store(payload["data_store_parameters"]);
+    std::lock_guard<std::mutex> lk(m_data_writer_mutex);
+    m_data_writer = std::move(data_store);
   } catch (const ers::Issue& excpt) {
     throw UnableToConfigure(ERS_HERE, get_name(), excpt);
   }
@@ -139,7 +151,10 @@ TPStreamWriter::do_scrap(const data_t& /*payload*/)
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_scrap() method";
 
   // clear/reset the DataStore instance here
-  m_data_writer.reset();
+  {
+    std::lock_guard<std::mutex> lk(m_data_writer_mutex);
+    m_data_writer.reset();
+  }
 
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_scrap() method";
 }
@@ -158,71 +173,56 @@ TPStreamWriter::do_work(std::atomic<bool>& running_flag)
   TPBundleHandler tp_bundle_handler(m_accumulation_interval_ticks, m_run_number, std::chrono::seconds(1));
 
   while (running_flag.load()) {
-    trigger::TPSet tpset;
+    std::vector<trigger::TPSet> tpsets;
+
+    // wait for the first TPSet, and then pick up the ones that are already waiting,
+    // so that the TimeSlices that they complete are written together
     try {
-      tpset = m_tpset_source->receive(m_queue_timeout);
-      ++n_tpset_received;
-      ++m_tpset_received;
-    } catch (iomanager::TimeoutExpired&) {
-      continue;
+      auto tpset = m_tpset_source->try_receive(m_queue_timeout);
+      while (tpset.has_value()) {
+        tpsets.push_back(std::move(*tpset));
+        if (tpsets.size() >= m_max_tpsets_per_wakeup) {
+          break;
+        }
+        tpset = m_tpset_source->try_receive(iomanager::Receiver::s_no_block);
+      }
+    } catch (const ers::Issue& excpt) {
+      ers::warning(excpt);
     }
-
-    TLOG_DEBUG(21) << "Number of TPs in TPSet is " << tpset.objects.size() << ", Source ID is " << tpset.origin
-                   << ", seqno is " << tpset.seqno << ", start timestamp is " << tpset.start_time << ", run number is "
-                   << tpset.run_number << ", slice id is " << (tpset.start_time / m_accumulation_interval_ticks);
-
-    // 30-Mar-2022, KAB: added test for matching run number.  This is to avoid getting
-    // confused by TPSets that happen to be leftover in transit from one run to the
-    // next (which we have observed in v2.10.x systems).
-    if (tpset.run_number != m_run_number) {
-      TLOG_DEBUG(22) << "Discarding TPSet with invalid run number " << tpset.run_number << " (current is "
-                     << m_run_number << "),  Source ID is " << tpset.origin << ", seqno is " << tpset.seqno;
+    if (tpsets.empty()) {
       continue;
     }
-
-    tp_bundle_handler.add_tpset(std::move(tpset));
+    n_tpset_received += tpsets.size();
+    m_tpset_received += tpsets.size();
+
+    for (auto& tpset : tpsets) {
+      TLOG_DEBUG(21) << "Number of TPs in TPSet is " << tpset.objects.size() << ", Source ID is " << tpset.origin
+                     << ", seqno is " << tpset.seqno << ", start timestamp is " << tpset.start_time
+                     << ", run number is " << tpset.run_number << ", slice id is "
+                     << (tpset.start_time / m_accumulation_interval_ticks);
+
+      // 30-Mar-2022, KAB: added test for matching run number.  This is to avoid getting
+      // confused by TPSets that happen to be leftover in transit from one run to the
+      // next (which we have observed in v2.10.x systems).
+      if (tpset.run_number != m_run_number) {
+        TLOG_DEBUG(22) << "Discarding TPSet with invalid run number " << tpset.run_number << " (current is "
+                       << m_run_number << "),  Source ID is " << tpset.origin << ", seqno is " << tpset.seqno;
+        continue;
+      }
+
+      if (first_timestamp == 0) {
+        first_timestamp = tpset.start_time;
+      }
+      last_timestamp = tpset.start_time;
+
+      tp_bundle_handler.add_tpset(std::move(tpset));
+    }
 
     std::vector<std::unique_ptr<daqdataformats::TimeSlice>> list_of_timeslices =
       tp_bundle_handler.get_properly_aged_timeslices();
-    for (auto& timeslice_ptr : list_of_timeslices) {
-      daqdataformats::SourceID sid(daqdataformats::SourceID::Subsystem::kTRBuilder, m_source_id);
-      timeslice_ptr->set_element_id(sid);
-
-      // write the TSH and the fragments as a set of data blocks
-      bool should_retry = true;
-      size_t retry_wait_usec = 1000;
-      do {
-        should_retry = false;
-        try {
-          m_data_writer->write(*timeslice_ptr);
-	  ++m_tpset_written;
-	  m_bytes_output += timeslice_ptr->get_total_size_bytes();
-        } catch (const RetryableDataStoreProblem& excpt) {
-          should_retry = true;
-          ers::error(DataWritingProblem(ERS_HERE,
-                                        get_name(),
-                                        timeslice_ptr->get_header().timeslice_number,
-                                        timeslice_ptr->get_header().run_number,
-                                        excpt));
-          if (retry_wait_usec > 1000000) {
-            retry_wait_usec = 1000000;
-          }
-          usleep(retry_wait_usec);
-          retry_wait_usec *= 2;
-        } catch (const std::exception& excpt) {
-          ers::error(DataWritingProblem(ERS_HERE,
-                                        get_name(),
-                                        timeslice_ptr->get_header().timeslice_number,
-                                        timeslice_ptr->get_header().run_number,
-                                        excpt));
-        }
-      } while (should_retry && running_flag.load());
-    }
-
-    if (first_timestamp == 0) {
-      first_timestamp = tpset.start_time;
+    if (!list_of_timeslices.empty()) {
+      write_time_slices(list_of_timeslices, running_flag);
     }
-    last_timestamp = tpset.start_time;
   } // while(running)
 
   auto end_time = steady_clock::now();
@@ -235,6 +235,70 @@ TPStreamWriter::do_work(std::atomic<bool>& running_flag)
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_work() method";
 } // NOLINT Function length
 
+void
+TPStreamWriter::write_time_slices(std::vector<std::unique_ptr<daqdataformats::TimeSlice>>& list_of_timeslices,
+                                  std::atomic<bool>& running_flag)
+{
+  // write the TSHs and the fragments as a batch of data blocks.
+  // The DataStore takes the TimeSlices out of the list as they are written,
+  // so the values that are needed after the write are saved here.
+  std::vector<daqdataformats::timeslice_number_t> timeslice_numbers;
+  std::vector<daqdataformats::run_number_t> run_numbers;
+  std::vector<size_t> timeslice_sizes_bytes;
+  for (auto& timeslice_ptr : list_of_timeslices) {
+    daqdataformats::SourceID sid(daqdataformats::SourceID::Subsystem::kTRBuilder, m_source_id);
+    timeslice_ptr->set_element_id(sid);
+
+    timeslice_numbers.push_back(timeslice_ptr->get_header().timeslice_number);
+    run_numbers.push_back(timeslice_ptr->get_header().run_number);
+    timeslice_sizes_bytes.push_back(timeslice_ptr->get_total_size_bytes());
+  }
+
+  // the first entry that is still in the list is the one that the DataStore had a problem with
+  std::vector<bool> is_accounted_for(list_of_timeslices.size(), false);
+  auto failed_index = [&]() {
+    size_t idx = 0;
+    while (idx + 1 < list_of_timeslices.size() && list_of_timeslices[idx].get() == nullptr) {
+      ++idx;
+    }
+    return idx;
+  };
+
+  bool should_retry = true;
+  size_t retry_wait_usec = 1000;
+  do {
+    should_retry = false;
+    try {
+      m_data_writer->write(list_of_timeslices);
+    } catch (const RetryableDataStoreProblem& excpt) {
+      size_t idx = failed_index();
+      should_retry = (list_of_timeslices[idx].get() != nullptr);
+      ers::error(DataWritingProblem(ERS_HERE, get_name(), timeslice_numbers[idx], run_numbers[idx], excpt));
+      if (retry_wait_usec > 1000000) {
+        retry_wait_usec = 1000000;
+      }
+      usleep(retry_wait_usec);
+      retry_wait_usec *= 2;
+    } catch (const std::exception& excpt) {
+      size_t idx = failed_index();
+      ers::error(DataWritingProblem(ERS_HERE, get_name(), timeslice_numbers[idx], run_numbers[idx], excpt));
+      if (list_of_timeslices[idx].get() != nullptr) {
+        list_of_timeslices[idx].reset();
+        is_accounted_for[idx] = true;
+      }
+      should_retry = (list_of_timeslices[failed_index()].get() != nullptr);
+    }
+
+    for (size_t idx = 0; idx < list_of_timeslices.size(); ++idx) {
+      if (list_of_timeslices[idx].get() == nullptr && !is_accounted_for[idx]) {
+        is_accounted_for[idx] = true;
+        ++m_tpset_written;
+        m_bytes_output += timeslice_sizes_bytes[idx];
+      }
+    }
+  } while (should_retry && running_flag.load());
+}
+
 } // namespace dfmodules
 } // namespace dunedaq
 
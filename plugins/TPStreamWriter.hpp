@@ -20,7 +20,9 @@
 #include "utilities/WorkerThread.hpp"
 
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace dunedaq {
 namespace dfmodules {
@@ -55,12 +57,14 @@ private:
   // Threading
   dunedaq::utilities::WorkerThread m_thread;
   void do_work(std::atomic<bool>&);
+  void write_time_slices(std::vector<std::unique_ptr<daqdataformats::TimeSlice>>&, std::atomic<bool>&);
 
   // Configuration
   std::chrono::milliseconds m_queue_timeout;
   size_t m_accumulation_interval_ticks;
   daqdataformats::run_number_t m_run_number;
   uint32_t m_source_id; // NOLINT(build/unsigned)
+  size_t m_max_tpsets_per_wakeup;
 
   // Queue sources and sinks
   using incoming_t = trigger::TPSet;
@@ -69,6 +73,7 @@ private:
 
   // Worker(s)
   std::unique_ptr<DataStore> m_data_writer;
+  std::mutex m_data_writer_mutex; // protects the creation and deletion of the DataStore against get_info() calls
 
   // Metrics
   std::atomic<uint64_t> m_tpset_received = { 0 };         // NOLINT(build/unsigned)
@@ -0,0 +1,426 @@
+/**
+ * @file TRReplayer.cpp TRReplayer class implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "TRReplayer.hpp"
+#include "dfmodules/CommonIssues.hpp"
+#include "dfmodules/trreplayer/Nljs.hpp"
+#include "dfmodules/trreplayerinfo/InfoNljs.hpp"
+
+#include "appfwk/DAQModuleHelper.hpp"
+#include "daqdataformats/Fragment.hpp"
+#include "daqdataformats/TriggerRecordHeader.hpp"
+#include "iomanager/IOManager.hpp"
+#include "logging/Logging.hpp"
+#include "rcif/cmd/Nljs.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "TRReplayer" // NOLINT
+enum
+{
+  TLVL_ENTER_EXIT_METHODS = 5,
+  TLVL_CONFIG = 7,
+  TLVL_WORK_STEPS = 10,
+  TLVL_SEND_TR = 15,
+  TLVL_READ_TR = 16
+};
+
+namespace dunedaq {
+namespace dfmodules {
+
+TRReplayer::TRReplayer(const std::string& name)
+  : dunedaq::appfwk::DAQModule(name)
+  , m_send_thread(std::bind(&TRReplayer::do_send, this, std::placeholders::_1))
+  , m_token_thread(std::bind(&TRReplayer::do_receive_tokens, this, std::placeholders::_1))
+  , m_queue_timeout(100)
+  , m_rate_mode(RateMode::kFixed)
+  , m_run_number(0)
+  , m_next_position_to_read(0)
+  , m_next_position_to_send(0)
+  , m_read_threads_should_stop(false)
+  , m_last_original_trigger_number(0)
+  , m_replay_trigger_number(0)
+{
+  register_command("conf", &TRReplayer::do_conf);
+  register_command("start", &TRReplayer::do_start);
+  register_command("stop", &TRReplayer::do_stop);
+  register_command("scrap", &TRReplayer::do_scrap);
+}
+
+void
+TRReplayer::init(const data_t& init_data)
+{
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering init() method";
+  auto iom = iomanager::IOManager::get();
+  auto ci = appfwk::connection_index(init_data, { "trigger_record_output", "token_input" });
+  m_tr_sender = iom->get_sender<std::unique_ptr<daqdataformats::TriggerRecord>>(ci["trigger_record_output"]);
+  m_token_receiver = iom->get_receiver<dfmessages::TriggerDecisionToken>(ci["token_input"]);
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting init() method";
+}
+
+void
+TRReplayer::get_info(opmonlib::InfoCollector& ci, int /*level*/)
+{
+  trreplayerinfo::Info info;
+  info.records_read = m_records_read.exchange(0);
+  info.records_sent = m_records_sent.exchange(0);
+  info.bytes_sent = m_bytes_sent.exchange(0);
+  info.tokens_received = m_tokens_received.exchange(0);
+  info.read_errors = m_read_errors.exchange(0);
+  info.send_timeouts = m_send_timeouts.exchange(0);
+  info.waits_for_read_ahead = m_waits_for_read_ahead.exchange(0);
+  {
+    std::lock_guard<std::mutex> lk(m_read_ahead_mutex);
+    info.records_read_ahead = m_read_ahead_records.size();
+  }
+  ci.add(info);
+}
+
+void
+TRReplayer::do_conf(const data_t& payload)
+{
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_conf() method";
+
+  m_conf_params = payload.get<trreplayer::ConfParams>();
+  if (m_conf_params.rate_mode == "fixed") {
+    m_rate_mode = RateMode::kFixed;
+  } else if (m_conf_params.rate_mode == "maximum") {
+    m_rate_mode = RateMode::kMaximum;
+  } else if (m_conf_params.rate_mode == "recorded") {
+    m_rate_mode = RateMode::kRecorded;
+  } else {
+    throw UnableToConfigure(
+      ERS_HERE, get_name(), InvalidReplayRateMode(ERS_HERE, get_name(), m_conf_params.rate_mode));
+  }
+  TLOG_DEBUG(TLVL_CONFIG) << get_name() << ": rate_mode is " << m_conf_params.rate_mode << ", rate_hz is "
+                          << m_conf_params.rate_hz << ", time_scale is " << m_conf_params.time_scale;
+
+  // the list of records is made once, so that the reading doesn't need to look for them
+  m_file_cache.reset(new HDF5FileCache(static_cast<size_t>(std::max(m_conf_params.max_open_files, 1))));
+  m_record_locations.clear();
+  for (auto const& file_name : m_conf_params.file_names) {
+    try {
+      for (auto const& record_id : m_file_cache->get_record_ids(file_name)) {
+        m_record_locations.push_back({ file_name, record_id });
+      }
+    } catch (const std::exception& excpt) {
+      ers::error(FileOperationProblem(ERS_HERE, get_name(), file_name, excpt));
+    }
+  }
+  if (m_record_locations.empty()) {
+    throw UnableToConfigure(
+      ERS_HERE, get_name(), NoRecordsToReplay(ERS_HERE, get_name(), m_conf_params.file_names.size()));
+  }
+  TLOG_DEBUG(TLVL_CONFIG) << get_name() << ": found " << m_record_locations.size() << " TriggerRecords in "
+                          << m_conf_params.file_names.size() << " files";
+
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_conf() method";
+}
+
+void
+TRReplayer::do_start(const data_t& payload)
+{
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_start() method";
+
+  rcif::cmd::StartParams start_params = payload.get<rcif::cmd::StartParams>();
+  m_run_number = start_params.run;
+  if (m_record_locations.empty()) {
+    // e.g. a start without a preceding conf
+    throw UnableToStart(ERS_HERE, get_name(), m_run_number, NoRecordsToReplay(ERS_HERE, get_name(), 0));
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(m_read_ahead_mutex);
+    m_read_ahead_records.clear();
+    m_next_position_to_read = 0;
+    m_next_position_to_send = 0;
+    m_read_threads_should_stop = false;
+  }
+  m_last_original_trigger_number = 0;
+  m_replay_trigger_number = 0;
+  m_triggers_sent = 0;
+  m_tokens_received_in_run = 0;
+
+  m_token_thread.start_working_thread(get_name() + "_tokens");
+  for (int idx = 0; idx < std::max(m_conf_params.number_of_read_threads, 1); ++idx) {
+    m_read_threads.emplace_back(&TRReplayer::do_read, this);
+  }
+  m_send_thread.start_working_thread(get_name());
+
+  TLOG() << get_name() << " successfully started for run number " << m_run_number;
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_start() method";
+}
+
+void
+TRReplayer::do_stop(const data_t& /*args*/)
+{
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_stop() method";
+
+  m_send_thread.stop_working_thread();
+  stop_read_threads();
+  m_token_thread.stop_working_thread();
+  {
+    std::lock_guard<std::mutex> lk(m_read_ahead_mutex);
+    m_read_ahead_records.clear();
+  }
+
+  TLOG() << get_name() << " successfully stopped for run number " << m_run_number << ", " << m_replay_trigger_number
+         << " triggers were sent";
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_stop() method";
+}
+
+void
+TRReplayer::do_scrap(const data_t& /*payload*/)
+{
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_scrap() method";
+  m_record_locations.clear();
+  m_file_cache.reset();
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_scrap() method";
+}
+
+void
+TRReplayer::do_read()
+{
+  const size_t read_ahead_records = static_cast<size_t>(std::max(m_conf_params.read_ahead_records, 1));
+  const size_t record_count = m_record_locations.size();
+  while (true) {
+    size_t position = 0;
+    {
+      std::unique_lock<std::mutex> lk(m_read_ahead_mutex);
+      m_read_ahead_cv.wait(lk, [&]() {
+        return m_read_threads_should_stop ||
+               (m_next_position_to_read < m_next_position_to_send + read_ahead_records &&
+                (m_conf_params.loop || m_next_position_to_read < record_count));
+      });
+      if (m_read_threads_should_stop) {
+        break;
+      }
+      position = m_next_position_to_read++;
+    }
+
+    auto const& location = m_record_locations[position % record_count];
+    std::unique_ptr<daqdataformats::TriggerRecord> tr_ptr;
+    try {
+      tr_ptr = m_file_cache->read_trigger_record(location.file_name, location.record_id);
+      ++m_records_read;
+      TLOG_DEBUG(TLVL_READ_TR) << get_name() << ": read TriggerRecord " << location.record_id.first << "."
+                               << location.record_id.second << " from " << location.file_name;
+    } catch (const std::exception& excpt) {
+      ++m_read_errors;
+      ers::error(ReplayReadProblem(
+        ERS_HERE, get_name(), location.file_name, location.record_id.first, location.record_id.second, excpt));
+    }
+
+    {
+      std::lock_guard<std::mutex> lk(m_read_ahead_mutex);
+      m_read_ahead_records[position] = std::move(tr_ptr);
+    }
+    m_read_ahead_cv.notify_all();
+  }
+}
+
+void
+TRReplayer::stop_read_threads()
+{
+  {
+    std::lock_guard<std::mutex> lk(m_read_ahead_mutex);
+    m_read_threads_should_stop = true;
+  }
+  m_read_ahead_cv.notify_all();
+  for (auto& read_thread : m_read_threads) {
+    read_thread.join();
+  }
+  m_read_threads.clear();
+}
+
+std::unique_ptr<daqdataformats::TriggerRecord>
+TRReplayer::take_read_ahead_record(size_t replay_position, std::atomic<bool>& running_flag)
+{
+  std::unique_lock<std::mutex> lk(m_read_ahead_mutex);
+  auto iter = m_read_ahead_records.find(replay_position);
+  if (iter == m_read_ahead_records.end()) {
+    ++m_waits_for_read_ahead;
+    while (running_flag.load() && (iter = m_read_ahead_records.find(replay_position)) == m_read_ahead_records.end()) {
+      m_read_ahead_cv.wait_for(lk, m_queue_timeout);
+    }
+    if (iter == m_read_ahead_records.end()) {
+      return nullptr;
+    }
+  }
+  std::unique_ptr<daqdataformats::TriggerRecord> tr_ptr = std::move(iter->second);
+  m_read_ahead_records.erase(iter);
+  m_next_position_to_send = replay_position + 1;
+  lk.unlock();
+  m_read_ahead_cv.notify_all();
+  return tr_ptr;
+}
+
+void
+TRReplayer::renumber(daqdataformats::TriggerRecord& tr)
+{
+  auto const& original_header = tr.get_header_ref();
+  if (m_replay_trigger_number == 0 || original_header.get_sequence_number() == 0 ||
+      original_header.get_trigger_number() != m_last_original_trigger_number) {
+    ++m_replay_trigger_number;
+  }
+  m_last_original_trigger_number = original_header.get_trigger_number();
+
+  // the header is rebuilt from a copy of its storage, which includes the component requests
+  std::vector<char> header_buffer(original_header.get_total_size_bytes());
+  std::memcpy(header_buffer.data(), original_header.get_storage_location(), header_buffer.size());
+  auto header_data = reinterpret_cast<daqdataformats::TriggerRecordHeaderData*>(header_buffer.data()); // NOLINT
+  header_data->trigger_number = m_replay_trigger_number;
+  header_data->run_number = m_run_number;
+  tr.get_header_ref() = daqdataformats::TriggerRecordHeader(header_buffer.data(), true);
+
+  for (auto const& frag_ptr : tr.get_fragments_ref()) {
+    frag_ptr->set_trigger_number(m_replay_trigger_number);
+    frag_ptr->set_run_number(m_run_number);
+  }
+}
+
+void
+TRReplayer::do_send(std::atomic<bool>& running_flag)
+{
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_send() method";
+
+  const size_t record_count = m_record_locations.size();
+  const size_t max_outstanding_triggers = static_cast<size_t>(std::max(m_conf_params.max_outstanding_triggers, 0));
+  const auto fixed_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(m_conf_params.rate_hz > 0.0 ? 1.0 / m_conf_params.rate_hz : 1.0));
+
+  // long waits are split up, so that a stop is noticed promptly
+  auto wait_until = [&](std::chrono::steady_clock::time_point wake_time) {
+    while (running_flag.load() && std::chrono::steady_clock::now() < wake_time) {
+      std::this_thread::sleep_until(std::min(wake_time, std::chrono::steady_clock::now() + m_queue_timeout));
+    }
+    return running_flag.load();
+  };
+
+  size_t position = 0;
+  auto next_send_time = std::chrono::steady_clock::now();
+  bool have_timestamp_reference = false;
+  daqdataformats::timestamp_t reference_timestamp = 0;
+  daqdataformats::timestamp_t previous_timestamp = 0;
+  std::chrono::steady_clock::time_point reference_time;
+
+  while (running_flag.load()) {
+    if (!m_conf_params.loop && position >= record_count) {
+      // everything has been sent; wait for the stop
+      std::this_thread::sleep_for(m_queue_timeout);
+      continue;
+    }
+
+    // a new trigger is only started when the DataWriter has caught up with the earlier ones;
+    // the later sequences of a trigger are not held back, since its token depends on them
+    bool starts_new_trigger = (m_record_locations[position % record_count].record_id.second == 0);
+    if (starts_new_trigger && max_outstanding_triggers > 0 &&
+        m_triggers_sent.load() >= m_tokens_received_in_run.load() + max_outstanding_triggers) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+
+    std::unique_ptr<daqdataformats::TriggerRecord> tr_ptr = take_read_ahead_record(position, running_flag);
+    if (!running_flag.load()) {
+      break;
+    }
+    ++position;
+    if (tr_ptr.get() == nullptr) {
+      // the read problem has already been reported
+      continue;
+    }
+
+    if (m_rate_mode == RateMode::kFixed) {
+      // after a long wait (e.g. for tokens), the schedule starts over instead of catching up with a burst
+      auto now = std::chrono::steady_clock::now();
+      if (next_send_time + fixed_interval < now) {
+        next_send_time = now;
+      }
+      if (!wait_until(next_send_time)) {
+        break;
+      }
+      next_send_time += fixed_interval;
+    } else if (m_rate_mode == RateMode::kRecorded) {
+      daqdataformats::timestamp_t timestamp = tr_ptr->get_header_ref().get_trigger_timestamp();
+      // the timestamps start over when the replay loops back to the first file
+      if (!have_timestamp_reference || timestamp < previous_timestamp) {
+        have_timestamp_reference = true;
+        reference_timestamp = timestamp;
+        reference_time = std::chrono::steady_clock::now();
+      }
+      previous_timestamp = timestamp;
+      double seconds_since_reference = static_cast<double>(timestamp - reference_timestamp) /
+                                       m_conf_params.clock_frequency_hz * m_conf_params.time_scale;
+      if (!wait_until(reference_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                         std::chrono::duration<double>(seconds_since_reference)))) {
+        break;
+      }
+    }
+
+    renumber(*tr_ptr);
+    size_t size_bytes = tr_ptr->get_total_size_bytes();
+    daqdataformats::trigger_number_t trigger_number = tr_ptr->get_header_ref().get_trigger_number();
+    daqdataformats::sequence_number_t sequence_number = tr_ptr->get_header_ref().get_sequence_number();
+    bool was_sent = false;
+    while (!was_sent && tr_ptr.get() != nullptr && running_flag.load()) {
+      try {
+        m_tr_sender->send(std::move(tr_ptr), m_queue_timeout);
+        was_sent = true;
+      } catch (const iomanager::TimeoutExpired& excpt) {
+        ++m_send_timeouts;
+        if (tr_ptr.get() == nullptr) {
+          ers::warning(excpt);
+        }
+      }
+    }
+    if (was_sent) {
+      ++m_records_sent;
+      m_bytes_sent += size_bytes;
+      if (starts_new_trigger) {
+        ++m_triggers_sent;
+      }
+      TLOG_DEBUG(TLVL_SEND_TR) << get_name() << ": sent TriggerRecord " << trigger_number << "." << sequence_number;
+    }
+  }
+
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_send() method";
+}
+
+void
+TRReplayer::do_receive_tokens(std::atomic<bool>& running_flag)
+{
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_receive_tokens() method";
+  while (running_flag.load()) {
+    try {
+      dfmessages::TriggerDecisionToken token = m_token_receiver->receive(m_queue_timeout);
+      ++m_tokens_received;
+      // the DataWriter announces itself with a token for run 0, which doesn't stand for a trigger
+      if (token.run_number == m_run_number) {
+        ++m_tokens_received_in_run;
+      }
+      TLOG_DEBUG(TLVL_WORK_STEPS) << get_name() << ": received the token for trigger " << token.trigger_number;
+    } catch (const iomanager::TimeoutExpired&) {
+      continue;
+    }
+  }
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_receive_tokens() method";
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+DEFINE_DUNE_DAQ_MODULE(dunedaq::dfmodules::TRReplayer)
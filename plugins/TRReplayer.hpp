@@ -0,0 +1,178 @@
+/**
+ * @file TRReplayer.hpp
+ *
+ * TRReplayer reads the TriggerRecords from files that were written by the
+ * HDF5DataStore and sends them to a DataWriter (or any other module that takes
+ * the output of a TriggerRecordBuilder), so that the write load of real data
+ * can be reproduced in a test setup.  The TriggerRecords are read ahead of the
+ * sending by a pool of threads, and they are sent at a fixed rate, as fast as
+ * the tokens from the DataWriter allow, or with the intervals between their
+ * recorded trigger timestamps.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_PLUGINS_TRREPLAYER_HPP_
+#define DFMODULES_PLUGINS_TRREPLAYER_HPP_
+
+#include "HDF5FileCache.hpp"
+#include "dfmodules/trreplayer/Structs.hpp"
+
+#include "appfwk/DAQModule.hpp"
+#include "daqdataformats/TriggerRecord.hpp"
+#include "dfmessages/TriggerDecisionToken.hpp"
+#include "iomanager/Receiver.hpp"
+#include "iomanager/Sender.hpp"
+#include "utilities/WorkerThread.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dunedaq {
+namespace dfmodules {
+
+/**
+ * @brief TRReplayer sends the TriggerRecords from HDF5 files at a controlled rate
+ */
+class TRReplayer : public dunedaq::appfwk::DAQModule
+{
+public:
+  /**
+   * @brief TRReplayer Constructor
+   * @param name Instance name for this TRReplayer instance
+   */
+  explicit TRReplayer(const std::string& name);
+
+  TRReplayer(const TRReplayer&) = delete;            ///< TRReplayer is not copy-constructible
+  TRReplayer& operator=(const TRReplayer&) = delete; ///< TRReplayer is not copy-assignable
+  TRReplayer(TRReplayer&&) = delete;                 ///< TRReplayer is not move-constructible
+  TRReplayer& operator=(TRReplayer&&) = delete;      ///< TRReplayer is not move-assignable
+
+  void init(const data_t&) override;
+  void get_info(opmonlib::InfoCollector& ci, int level) override;
+
+private:
+  // Commands
+  void do_conf(const data_t&);
+  void do_start(const data_t&);
+  void do_stop(const data_t&);
+  void do_scrap(const data_t&);
+
+  enum class RateMode
+  {
+    kFixed,
+    kMaximum,
+    kRecorded
+  };
+
+  /**
+   * @brief A TriggerRecord in the input files
+   */
+  struct RecordLocation
+  {
+    std::string file_name;
+    HDF5FileCache::record_id_t record_id;
+  };
+
+  // Threading
+  dunedaq::utilities::WorkerThread m_send_thread;
+  void do_send(std::atomic<bool>&);
+  dunedaq::utilities::WorkerThread m_token_thread;
+  void do_receive_tokens(std::atomic<bool>&);
+  std::vector<std::thread> m_read_threads;
+  void do_read();
+  void stop_read_threads();
+
+  /**
+   * @brief Waits until the TriggerRecord with the specified position in the replay
+   * has been read, and takes it out of the read-ahead buffer.
+   * @return the TriggerRecord, or a null pointer if it could not be read, or if the
+   * sending has been stopped
+   */
+  std::unique_ptr<daqdataformats::TriggerRecord> take_read_ahead_record(size_t replay_position,
+                                                                        std::atomic<bool>& running_flag);
+
+  /**
+   * @brief Gives the TriggerRecord the run number of the current run and the next trigger
+   * number in the replay, since the DataWriter checks the former and the HDF5 files can't
+   * hold two records with the same trigger number.
+   */
+  void renumber(daqdataformats::TriggerRecord& tr);
+
+  // Configuration
+  std::chrono::milliseconds m_queue_timeout;
+  trreplayer::ConfParams m_conf_params;
+  RateMode m_rate_mode;
+  std::vector<RecordLocation> m_record_locations;
+  std::unique_ptr<HDF5FileCache> m_file_cache;
+  daqdataformats::run_number_t m_run_number;
+
+  // Connections
+  using tr_sender_ct = iomanager::SenderConcept<std::unique_ptr<daqdataformats::TriggerRecord>>;
+  std::shared_ptr<tr_sender_ct> m_tr_sender;
+  using token_receiver_ct = iomanager::ReceiverConcept<dfmessages::TriggerDecisionToken>;
+  std::shared_ptr<token_receiver_ct> m_token_receiver;
+
+  // Read-ahead buffer, keyed by the position in the replay; a null entry marks a
+  // TriggerRecord that could not be read
+  std::map<size_t, std::unique_ptr<daqdataformats::TriggerRecord>> m_read_ahead_records;
+  size_t m_next_position_to_read;
+  size_t m_next_position_to_send;
+  bool m_read_threads_should_stop;
+  std::mutex m_read_ahead_mutex;
+  std::condition_variable m_read_ahead_cv;
+
+  // Renumbering
+  daqdataformats::trigger_number_t m_last_original_trigger_number;
+  daqdataformats::trigger_number_t m_replay_trigger_number;
+
+  // Flow control
+  std::atomic<uint64_t> m_triggers_sent = { 0 };           // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_tokens_received_in_run = { 0 };  // NOLINT(build/unsigned)
+
+  // Metrics
+  std::atomic<uint64_t> m_records_read = { 0 };          // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_records_sent = { 0 };          // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_bytes_sent = { 0 };            // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_tokens_received = { 0 };      // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_read_errors = { 0 };          // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_send_timeouts = { 0 };        // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_waits_for_read_ahead = { 0 }; // NOLINT(build/unsigned)
+};
+} // namespace dfmodules
+
+ERS_DECLARE_ISSUE_BASE(dfmodules,
+                       InvalidReplayRateMode,
+                       appfwk::GeneralDAQModuleIssue,
+                       "The replay rate mode \"" << rate_mode
+                                                 << "\" is not supported (\"fixed\", \"maximum\", or \"recorded\")",
+                       ((std::string)name),
+                       ((std::string)rate_mode))
+
+ERS_DECLARE_ISSUE_BASE(dfmodules,
+                       ReplayReadProblem,
+                       appfwk::GeneralDAQModuleIssue,
+                       "A problem was encountered when reading TriggerRecord number "
+                         << trnum << "." << seqnum << " from file \"" << file_name << "\"",
+                       ((std::string)name),
+                       ((std::string)file_name)((size_t)trnum)((size_t)seqnum))
+
+ERS_DECLARE_ISSUE_BASE(dfmodules,
+                       NoRecordsToReplay,
+                       appfwk::GeneralDAQModuleIssue,
+                       "None of the " << file_count << " configured input files contain TriggerRecords to replay",
+                       ((std::string)name),
+                       ((size_t)file_count))
+
+} // namespace dunedaq
+
+#endif // DFMODULES_PLUGINS_TRREPLAYER_HPP_
@@ -3,11 +3,60 @@ import h5py
 import os.path
 import re
 
+# Top-level objects that the HDF5DataStore may write next to the records
+non_record_objects = ["FileSummary", "RecordIndex", "TimeSliceStream"]
+
+# Bit of the TriggerRecordErrorBits that flags incomplete TriggerRecords
+incomplete_error_bit = 0
+
 class DataFile:
     def __init__(self, filename):
         self.h5file=h5py.File(filename, 'r')
-        self.events=self.h5file.keys()
+        self.events=[key for key in self.h5file.keys() if key not in non_record_objects]
         self.n_events=len(self.events)
+        self.summary=read_file_summary(self.h5file)
+
+def read_file_summary(h5file):
+    "Read the FileSummary columns of a file into a dict of arrays, or return None if the file has no summary"
+    if "FileSummary" not in h5file:
+        return None
+    return {name: column[()] for name, column in h5file["FileSummary"].items()}
+
+def summarize_file(datafile):
+    "Summarize the records in a file from its FileSummary, without visiting the records themselves"
+    summary = datafile.summary
+    if summary is None:
+        print(f"File {os.path.basename(datafile.h5file.filename)} does not have a FileSummary")
+        return None
+    n_records = len(summary["record_number"])
+    n_incomplete = sum(1 for bits in summary["error_bits"] if (int(bits) >> incomplete_error_bit) & 1)
+    result = {"record_count": n_records,
+              "incomplete_record_count": n_incomplete,
+              "fragment_count": int(sum(summary["fragment_count"])),
+              "total_bytes": int(sum(summary["total_bytes"]))}
+    if n_records > 0:
+        result["first_record_number"] = int(min(summary["record_number"]))
+        result["last_record_number"] = int(max(summary["record_number"]))
+        timestamps = [int(ts) for ts in summary["timestamp"] if ts != 0]
+        if len(timestamps) > 0:
+            result["first_timestamp"] = min(timestamps)
+            result["last_timestamp"] = max(timestamps)
+    return result
+
+def check_file_summary(datafile):
+    "Check that the FileSummary of a file, if it has one, has one row per record"
+    passed=True
+    base_filename = os.path.basename(datafile.h5file.filename)
+    if datafile.summary is None:
+        print(f"No FileSummary in file {base_filename}, nothing to check")
+        return passed
+    row_count = len(datafile.summary["record_number"])
+    if row_count != datafile.n_events:
+        passed=False
+        print(f"The FileSummary of file {base_filename} has {row_count} rows, but the file has {datafile.n_events} records")
+    if passed:
+        print(f"FileSummary of file {base_filename} matches its {datafile.n_events} records")
+    return passed
 
 def find_fragments_of_specified_type(grp, subsystem='', fragment_type=''):
     frag_list = [] # Local variable here
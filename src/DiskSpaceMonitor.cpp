@@ -0,0 +1,146 @@
+/**
+ * @file DiskSpaceMonitor.cpp DiskSpaceMonitor Class Implementation
+ *
+ * The DiskSpaceMonitor class keeps track of the free space on the disk that holds
+ * a given path.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/DiskSpaceMonitor.hpp"
+#include "dfmodules/diskspacemonitorinfo/InfoNljs.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <sys/statvfs.h>
+#include <thread>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "DiskSpaceMonitor" // NOLINT
+enum
+{
+  TLVL_ENTER_EXIT_METHODS = 5,
+  TLVL_SAMPLES = 12
+};
+
+namespace dunedaq {
+namespace dfmodules {
+
+DiskSpaceMonitor::DiskSpaceMonitor(const std::string& parent_name,
+                                   const std::string& path,
+                                   std::chrono::milliseconds sampling_interval)
+  : NamedObject(parent_name + "::DiskSpaceMonitor")
+  , m_thread(std::bind(&DiskSpaceMonitor::do_work, this, std::placeholders::_1))
+  , m_path(path)
+  , m_sampling_interval(std::max(sampling_interval, std::chrono::milliseconds(1)))
+  , m_last_sample_time(std::chrono::steady_clock::now())
+{
+  sample();
+}
+
+DiskSpaceMonitor::~DiskSpaceMonitor()
+{
+  stop_monitoring();
+}
+
+void
+DiskSpaceMonitor::start_monitoring()
+{
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering start_monitoring() method";
+  if (!m_thread.thread_running()) {
+    m_thread.start_working_thread("diskspace");
+  }
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting start_monitoring() method";
+}
+
+void
+DiskSpaceMonitor::stop_monitoring()
+{
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering stop_monitoring() method";
+  if (m_thread.thread_running()) {
+    m_thread.stop_working_thread();
+  }
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting stop_monitoring() method";
+}
+
+bool
+DiskSpaceMonitor::sample()
+{
+  auto lk = std::lock_guard<std::mutex>(m_sample_mutex);
+
+  // the counter is reset *before* the statvfs call, so that bytes which are written while
+  // the call is in progress are, at worst, subtracted twice (a conservative prediction)
+  size_t bytes_written = m_bytes_written_since_sample.exchange(0);
+
+  struct statvfs vfs_results;
+  int retval = statvfs(m_path.c_str(), &vfs_results);
+  auto now = std::chrono::steady_clock::now();
+  ++m_samples_taken;
+  if (retval != 0) {
+    ++m_failed_samples;
+    m_path_is_valid.store(false);
+    m_measured_free_space.store(0);
+    m_last_sample_time = now;
+    return false;
+  }
+
+  size_t free_space = vfs_results.f_bsize * vfs_results.f_bavail;
+  size_t previous_free_space = m_measured_free_space.exchange(free_space);
+  m_total_space.store(vfs_results.f_frsize * vfs_results.f_blocks);
+
+  auto elapsed_usec = std::chrono::duration_cast<std::chrono::microseconds>(now - m_last_sample_time).count();
+  if (m_path_is_valid.load() && elapsed_usec > 0) {
+    int64_t change = static_cast<int64_t>(previous_free_space) - static_cast<int64_t>(free_space);
+    m_fill_rate.store(static_cast<int64_t>(static_cast<double>(change) * 1.0e6 / elapsed_usec));
+  }
+  m_path_is_valid.store(true);
+  m_last_sample_time = now;
+
+  TLOG_DEBUG(TLVL_SAMPLES) << get_name() << ": free space on the disk with path \"" << m_path << "\" is " << free_space
+                           << " bytes, " << bytes_written << " bytes were written since the previous sample";
+  return true;
+}
+
+void
+DiskSpaceMonitor::do_work(std::atomic<bool>& running_flag)
+{
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_work() method";
+  const std::chrono::milliseconds max_sleep_time(10);
+  auto next_sample_time = std::chrono::steady_clock::now() + m_sampling_interval;
+  while (running_flag.load()) {
+    auto now = std::chrono::steady_clock::now();
+    if (now >= next_sample_time) {
+      sample();
+      next_sample_time = now + m_sampling_interval;
+    } else {
+      // sleep in small steps so that stop requests are handled promptly
+      std::this_thread::sleep_for(
+        std::min(std::chrono::duration_cast<std::chrono::milliseconds>(next_sample_time - now), max_sleep_time));
+    }
+  }
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_work() method";
+}
+
+void
+DiskSpaceMonitor::get_info(opmonlib::InfoCollector& ci, int /*level*/)
+{
+  diskspacemonitorinfo::Info info;
+  info.path = m_path;
+  info.free_space = get_measured_free_space();
+  info.predicted_free_space = get_predicted_free_space();
+  info.total_space = get_total_space();
+  info.fill_rate = get_fill_rate();
+  info.samples_taken = m_samples_taken.exchange(0);
+  info.failed_samples = m_failed_samples.exchange(0);
+  ci.add(info);
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
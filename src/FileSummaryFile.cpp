@@ -0,0 +1,233 @@
+/**
+ * @file FileSummaryFile.cpp FileSummaryWriter and FileSummaryReader Class Implementations
+ *
+ * The FileSummaryWriter class writes the summary columns of the records in an HDF5
+ * file into the file, and the FileSummaryReader class reads them.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/FileSummaryFile.hpp"
+#include "dfmodules/RecordIndexFormat.hpp"
+
+#include "logging/Logging.hpp"
+
+#include "hdf5.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "FileSummaryFile" // NOLINT
+enum
+{
+  TLVL_BASIC = 2
+};
+
+namespace dunedaq {
+namespace dfmodules {
+
+namespace {
+
+/**
+ * @brief Closes an HDF5 object when it goes out of scope
+ */
+class HDF5Object
+{
+public:
+  HDF5Object(hid_t id, herr_t (*close_function)(hid_t))
+    : m_id(id)
+    , m_close_function(close_function)
+  {}
+  ~HDF5Object()
+  {
+    if (m_id >= 0) {
+      m_close_function(m_id);
+    }
+  }
+  HDF5Object(const HDF5Object&) = delete;
+  HDF5Object& operator=(const HDF5Object&) = delete;
+
+  hid_t get() const { return m_id; }
+
+private:
+  hid_t m_id;
+  herr_t (*m_close_function)(hid_t);
+};
+
+hid_t
+get_native_type(const std::vector<uint32_t>& /*column*/) // NOLINT(build/unsigned)
+{
+  return H5T_NATIVE_UINT32;
+}
+
+hid_t
+get_native_type(const std::vector<uint64_t>& /*column*/) // NOLINT(build/unsigned)
+{
+  return H5T_NATIVE_UINT64;
+}
+
+hid_t
+get_file_type(const std::vector<uint32_t>& /*column*/) // NOLINT(build/unsigned)
+{
+  return H5T_STD_U32LE;
+}
+
+hid_t
+get_file_type(const std::vector<uint64_t>& /*column*/) // NOLINT(build/unsigned)
+{
+  return H5T_STD_U64LE;
+}
+
+/**
+ * @brief Writes one column as a one-dimensional dataset in the specified group
+ * @return whether the column was written
+ */
+template<typename T>
+bool
+write_column(hid_t group_id, const char* column_name, const std::vector<T>& column)
+{
+  hsize_t dims[1] = { column.size() };
+  HDF5Object space(H5Screate_simple(1, dims, nullptr), H5Sclose);
+  HDF5Object dcpl(H5Pcreate(H5P_DATASET_CREATE), H5Pclose);
+  if (space.get() < 0 || dcpl.get() < 0) {
+    return false;
+  }
+  // the columns of a typical file are small enough to be stored in the object header
+  if (column.size() * sizeof(T) <= filesummary::s_max_compact_column_size &&
+      H5Pset_layout(dcpl.get(), H5D_COMPACT) < 0) {
+    return false;
+  }
+  HDF5Object dataset(
+    H5Dcreate2(group_id, column_name, get_file_type(column), space.get(), H5P_DEFAULT, dcpl.get(), H5P_DEFAULT),
+    H5Dclose);
+  if (dataset.get() < 0) {
+    return false;
+  }
+  return column.empty() ||
+         H5Dwrite(dataset.get(), get_native_type(column), H5S_ALL, H5S_ALL, H5P_DEFAULT, column.data()) >= 0;
+}
+
+/**
+ * @brief Reads one column from the specified group
+ * @return whether the column was read
+ */
+template<typename T>
+bool
+read_column(hid_t group_id, const char* column_name, std::vector<T>& column)
+{
+  HDF5Object dataset(H5Dopen2(group_id, column_name, H5P_DEFAULT), H5Dclose);
+  if (dataset.get() < 0) {
+    return false;
+  }
+  HDF5Object space(H5Dget_space(dataset.get()), H5Sclose);
+  hssize_t size = (space.get() >= 0) ? H5Sget_simple_extent_npoints(space.get()) : -1;
+  if (size < 0) {
+    return false;
+  }
+  column.resize(static_cast<size_t>(size));
+  return column.empty() ||
+         H5Dread(dataset.get(), get_native_type(column), H5S_ALL, H5S_ALL, H5P_DEFAULT, column.data()) >= 0;
+}
+
+} // namespace
+
+void
+FileSummaryWriter::add(const daqdataformats::TriggerRecord& tr)
+{
+  auto const& trh = tr.get_header_ref();
+  m_columns.record_number.push_back(trh.get_trigger_number());
+  m_columns.sequence_number.push_back(trh.get_sequence_number());
+  m_columns.record_type.push_back(static_cast<uint32_t>(recordindex::RecordType::kTriggerRecord)); // NOLINT
+  m_columns.timestamp.push_back(trh.get_trigger_timestamp());
+  m_columns.trigger_type.push_back(trh.get_trigger_type());
+  m_columns.fragment_count.push_back(tr.get_fragments_ref().size());
+  m_columns.total_bytes.push_back(tr.get_total_size_bytes());
+  m_columns.error_bits.push_back(static_cast<uint32_t>(trh.get_error_bits().to_ulong())); // NOLINT(build/unsigned)
+}
+
+void
+FileSummaryWriter::add(const daqdataformats::TimeSlice& ts)
+{
+  m_columns.record_number.push_back(ts.get_header().timeslice_number);
+  m_columns.sequence_number.push_back(0);
+  m_columns.record_type.push_back(static_cast<uint32_t>(recordindex::RecordType::kTimeSlice)); // NOLINT
+  m_columns.timestamp.push_back(0);
+  m_columns.trigger_type.push_back(0);
+  m_columns.fragment_count.push_back(ts.get_fragments_ref().size());
+  m_columns.total_bytes.push_back(ts.get_total_size_bytes());
+  m_columns.error_bits.push_back(0);
+}
+
+void
+FileSummaryWriter::write_to_hdf5_file(const std::string& hdf5_file_name) const
+{
+  auto check = [&](bool ok, const std::string& operation) {
+    if (!ok) {
+      throw FileSummaryProblem(ERS_HERE, "writing", hdf5_file_name, operation + " failed");
+    }
+  };
+
+  // an HDF5 file that is already open elsewhere in this process is shared with that open
+  HDF5Object file(H5Fopen(hdf5_file_name.c_str(), H5F_ACC_RDWR, H5P_DEFAULT), H5Fclose);
+  check(file.get() >= 0, "H5Fopen");
+  HDF5Object group(H5Gcreate2(file.get(), filesummary::s_group_name, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT),
+                   H5Gclose);
+  check(group.get() >= 0, "H5Gcreate2");
+
+  check(write_column(group.get(), "record_number", m_columns.record_number), "writing record_number");
+  check(write_column(group.get(), "sequence_number", m_columns.sequence_number), "writing sequence_number");
+  check(write_column(group.get(), "record_type", m_columns.record_type), "writing record_type");
+  check(write_column(group.get(), "timestamp", m_columns.timestamp), "writing timestamp");
+  check(write_column(group.get(), "trigger_type", m_columns.trigger_type), "writing trigger_type");
+  check(write_column(group.get(), "fragment_count", m_columns.fragment_count), "writing fragment_count");
+  check(write_column(group.get(), "total_bytes", m_columns.total_bytes), "writing total_bytes");
+  check(write_column(group.get(), "error_bits", m_columns.error_bits), "writing error_bits");
+  TLOG_DEBUG(TLVL_BASIC) << "Wrote the summary of " << m_columns.size() << " records to " << hdf5_file_name;
+}
+
+FileSummaryReader::FileSummaryReader(const std::string& hdf5_file_name)
+  : m_file_name(hdf5_file_name)
+{
+  auto check = [&](bool ok, const std::string& operation) {
+    if (!ok) {
+      throw FileSummaryProblem(ERS_HERE, "reading", m_file_name, operation + " failed");
+    }
+  };
+
+  HDF5Object file(H5Fopen(m_file_name.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose);
+  check(file.get() >= 0, "H5Fopen");
+  check(H5Lexists(file.get(), filesummary::s_group_name, H5P_DEFAULT) > 0, "finding the summary group");
+  HDF5Object group(H5Gopen2(file.get(), filesummary::s_group_name, H5P_DEFAULT), H5Gclose);
+  check(group.get() >= 0, "H5Gopen2");
+
+  check(read_column(group.get(), "record_number", m_columns.record_number), "reading record_number");
+  check(read_column(group.get(), "sequence_number", m_columns.sequence_number), "reading sequence_number");
+  check(read_column(group.get(), "record_type", m_columns.record_type), "reading record_type");
+  check(read_column(group.get(), "timestamp", m_columns.timestamp), "reading timestamp");
+  check(read_column(group.get(), "trigger_type", m_columns.trigger_type), "reading trigger_type");
+  check(read_column(group.get(), "fragment_count", m_columns.fragment_count), "reading fragment_count");
+  check(read_column(group.get(), "total_bytes", m_columns.total_bytes), "reading total_bytes");
+  check(read_column(group.get(), "error_bits", m_columns.error_bits), "reading error_bits");
+
+  size_t size = m_columns.size();
+  check(m_columns.sequence_number.size() == size && m_columns.record_type.size() == size &&
+          m_columns.timestamp.size() == size && m_columns.trigger_type.size() == size &&
+          m_columns.fragment_count.size() == size && m_columns.total_bytes.size() == size &&
+          m_columns.error_bits.size() == size,
+        "checking the column lengths");
+}
+
+bool
+FileSummaryReader::has_file_summary(const std::string& hdf5_file_name)
+{
+  HDF5Object file(H5Fopen(hdf5_file_name.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose);
+  return file.get() >= 0 && H5Lexists(file.get(), filesummary::s_group_name, H5P_DEFAULT) > 0;
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
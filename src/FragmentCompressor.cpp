@@ -0,0 +1,384 @@
+/**
+ * @file FragmentCompressor.cpp FragmentCompressor Class Implementation
+ *
+ * The FragmentCompressor class compresses the payloads of Fragments on a pool
+ * of worker threads.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/FragmentCompressor.hpp"
+#include "dfmodules/fragmentcompressorinfo/InfoNljs.hpp"
+
+#include "detdataformats/DetID.hpp"
+#include "logging/Logging.hpp"
+
+#include "boost/iostreams/device/array.hpp"
+#include "boost/iostreams/device/back_inserter.hpp"
+#include "boost/iostreams/filter/bzip2.hpp"
+#include "boost/iostreams/filter/zlib.hpp"
+#include "boost/iostreams/filtering_stream.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "FragmentCompressor" // NOLINT
+enum
+{
+  TLVL_BASIC = 2
+};
+
+namespace dunedaq {
+namespace dfmodules {
+
+namespace {
+
+std::vector<char>
+run_compressor(const char* data, size_t size, FragmentCompressor::Codec codec, int level)
+{
+  std::vector<char> output;
+  output.reserve(size);
+  boost::iostreams::filtering_ostream out_stream;
+  if (codec == FragmentCompressor::Codec::kZlib) {
+    out_stream.push(boost::iostreams::zlib_compressor(
+      boost::iostreams::zlib_params(level < 0 ? boost::iostreams::zlib::default_compression : level)));
+  } else {
+    out_stream.push(boost::iostreams::bzip2_compressor(
+      boost::iostreams::bzip2_params(level < 1 ? boost::iostreams::bzip2::default_block_size : std::min(level, 9))));
+  }
+  out_stream.push(boost::iostreams::back_inserter(output));
+  out_stream.write(data, static_cast<std::streamsize>(size));
+  // resetting the stream flushes the compressor
+  out_stream.reset();
+  return output;
+}
+
+void
+run_decompressor(const char* data, size_t size, FragmentCompressor::Codec codec, char* output, size_t output_size)
+{
+  boost::iostreams::filtering_istream in_stream;
+  if (codec == FragmentCompressor::Codec::kZlib) {
+    in_stream.push(boost::iostreams::zlib_decompressor());
+  } else {
+    in_stream.push(boost::iostreams::bzip2_decompressor());
+  }
+  in_stream.push(boost::iostreams::array_source(data, size));
+  in_stream.read(output, static_cast<std::streamsize>(output_size));
+  if (static_cast<size_t>(in_stream.gcount()) != output_size) {
+    std::ostringstream oss;
+    oss << "the decompressed payload has " << in_stream.gcount() << " bytes instead of " << output_size;
+    throw FragmentCompressionProblem(
+      ERS_HERE, "decompressing", FragmentCompressor::codec_to_string(codec), oss.str());
+  }
+}
+
+} // namespace
+
+FragmentCompressor::FragmentCompressor(const std::string& parent_name,
+                                       const std::vector<Rule>& rules,
+                                       size_t number_of_threads,
+                                       size_t min_fragment_size_bytes)
+  : NamedObject(parent_name + "::FragmentCompressor")
+  , m_rules(rules)
+  , m_min_fragment_size(min_fragment_size_bytes)
+  , m_fragments_per_task(16)
+  , m_workers_should_stop(false)
+{
+  number_of_threads = std::max(number_of_threads, static_cast<size_t>(1));
+  for (size_t idx = 0; idx < number_of_threads; ++idx) {
+    m_workers.emplace_back(&FragmentCompressor::worker_work, this);
+  }
+  TLOG_DEBUG(TLVL_BASIC) << get_name() << ": started " << number_of_threads
+                         << " compression threads, rules: " << get_description();
+}
+
+FragmentCompressor::~FragmentCompressor()
+{
+  {
+    std::lock_guard<std::mutex> lk(m_tasks_mutex);
+    m_workers_should_stop = true;
+  }
+  m_tasks_cv.notify_all();
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+}
+
+std::unique_ptr<daqdataformats::TriggerRecord>
+FragmentCompressor::compress(const daqdataformats::TriggerRecord& tr)
+{
+  auto tr_copy = std::make_unique<daqdataformats::TriggerRecord>(tr.get_header_ref());
+  for (auto& frag_ptr : compress_fragments(tr.get_fragments_ref())) {
+    tr_copy->add_fragment(std::move(frag_ptr));
+  }
+  return tr_copy;
+}
+
+std::unique_ptr<daqdataformats::TimeSlice>
+FragmentCompressor::compress(const daqdataformats::TimeSlice& ts)
+{
+  auto ts_copy = std::make_unique<daqdataformats::TimeSlice>(ts.get_header());
+  for (auto& frag_ptr : compress_fragments(ts.get_fragments_ref())) {
+    ts_copy->add_fragment(std::move(frag_ptr));
+  }
+  return ts_copy;
+}
+
+std::vector<std::unique_ptr<daqdataformats::Fragment>>
+FragmentCompressor::compress_fragments(const std::vector<std::unique_ptr<daqdataformats::Fragment>>& fragments)
+{
+  std::vector<std::unique_ptr<daqdataformats::Fragment>> results(fragments.size());
+
+  // the Fragments are handed to the worker threads in groups, to limit the overhead per task
+  std::vector<std::future<void>> task_results;
+  {
+    std::lock_guard<std::mutex> lk(m_tasks_mutex);
+    for (size_t first = 0; first < fragments.size(); first += m_fragments_per_task) {
+      size_t last = std::min(first + m_fragments_per_task, fragments.size());
+      std::packaged_task<void()> task([this, &fragments, &results, first, last]() {
+        for (size_t idx = first; idx < last; ++idx) {
+          results[idx] = compress_or_copy(*fragments[idx]);
+        }
+      });
+      task_results.push_back(task.get_future());
+      m_tasks.push_back(std::move(task));
+    }
+  }
+  m_tasks_cv.notify_all();
+
+  // all tasks need to finish before the results go out of scope, so the first
+  // problem is only re-thrown once that is the case
+  std::exception_ptr first_problem;
+  for (auto& task_result : task_results) {
+    try {
+      task_result.get();
+    } catch (...) { // NOLINT(runtime/exceptions)
+      if (!first_problem) {
+        first_problem = std::current_exception();
+      }
+    }
+  }
+  if (first_problem) {
+    std::rethrow_exception(first_problem);
+  }
+  return results;
+}
+
+std::unique_ptr<daqdataformats::Fragment>
+FragmentCompressor::compress_or_copy(const daqdataformats::Fragment& frag)
+{
+  const Rule* rule = select_rule(frag);
+  if (rule != nullptr && rule->codec != Codec::kNone && frag.get_size() >= m_min_fragment_size &&
+      !is_compressed(frag)) {
+    auto start_time = std::chrono::steady_clock::now();
+    std::unique_ptr<daqdataformats::Fragment> compressed_frag = compress_fragment(frag, rule->codec, rule->level);
+    auto& metrics = m_codec_metrics[static_cast<size_t>(rule->codec)];
+    metrics.compression_time_us +=
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+    ++metrics.fragments;
+    metrics.uncompressed_bytes += frag.get_size();
+    if (compressed_frag.get() != nullptr) {
+      metrics.compressed_bytes += compressed_frag->get_size();
+      return compressed_frag;
+    }
+    // the Fragment is stored as it is, when compression doesn't make it smaller
+    metrics.compressed_bytes += frag.get_size();
+  }
+  return std::make_unique<daqdataformats::Fragment>(frag.get_storage_location(),
+                                                    daqdataformats::Fragment::BufferAdoptionMode::kCopyFromBuffer);
+}
+
+const FragmentCompressor::Rule*
+FragmentCompressor::select_rule(const daqdataformats::Fragment& frag) const
+{
+  for (auto const& rule : m_rules) {
+    if (!rule.fragment_type.empty() &&
+        rule.fragment_type != daqdataformats::fragment_type_to_string(frag.get_fragment_type())) {
+      continue;
+    }
+    if (!rule.detector_group_type.empty() &&
+        rule.detector_group_type != detdataformats::DetID::subsystem_to_string(
+                                      static_cast<detdataformats::DetID::Subsystem>(frag.get_detector_id()))) {
+      continue;
+    }
+    return &rule;
+  }
+  return nullptr;
+}
+
+void
+FragmentCompressor::worker_work()
+{
+  std::unique_lock<std::mutex> lk(m_tasks_mutex);
+  while (true) {
+    m_tasks_cv.wait(lk, [&]() { return !m_tasks.empty() || m_workers_should_stop; });
+    if (m_tasks.empty()) {
+      break;
+    }
+    std::packaged_task<void()> task = std::move(m_tasks.front());
+    m_tasks.pop_front();
+    lk.unlock();
+    // exceptions are stored in the future of the task
+    task();
+    lk.lock();
+  }
+}
+
+std::string
+FragmentCompressor::get_description() const
+{
+  std::ostringstream oss;
+  for (size_t idx = 0; idx < m_rules.size(); ++idx) {
+    auto const& rule = m_rules[idx];
+    if (idx > 0) {
+      oss << "; ";
+    }
+    oss << "fragment_type=" << (rule.fragment_type.empty() ? "*" : rule.fragment_type)
+        << " detector_group_type=" << (rule.detector_group_type.empty() ? "*" : rule.detector_group_type)
+        << " codec=" << codec_to_string(rule.codec) << " level=" << rule.level;
+  }
+  return oss.str();
+}
+
+void
+FragmentCompressor::get_info(opmonlib::InfoCollector& ci, int /*level*/)
+{
+  for (size_t idx = 1; idx < s_number_of_codecs; ++idx) {
+    auto& metrics = m_codec_metrics[idx];
+    fragmentcompressorinfo::Info info;
+    info.codec = codec_to_string(static_cast<Codec>(idx));
+    info.fragments_compressed = metrics.fragments.exchange(0);
+    info.uncompressed_bytes = metrics.uncompressed_bytes.exchange(0);
+    info.compressed_bytes = metrics.compressed_bytes.exchange(0);
+    info.compression_time_us = metrics.compression_time_us.exchange(0);
+    if (info.fragments_compressed == 0) {
+      continue;
+    }
+    info.compression_ratio =
+      (info.compressed_bytes > 0) ? static_cast<double>(info.uncompressed_bytes) / info.compressed_bytes : 0.0;
+
+    opmonlib::InfoCollector codec_ci;
+    codec_ci.add(info);
+    ci.add("codec_" + info.codec, codec_ci);
+  }
+}
+
+FragmentCompressor::Codec
+FragmentCompressor::string_to_codec(const std::string& codec_name)
+{
+  if (codec_name == "none" || codec_name.empty()) {
+    return Codec::kNone;
+  }
+  if (codec_name == "zlib" || codec_name == "deflate") {
+    return Codec::kZlib;
+  }
+  if (codec_name == "bzip2") {
+    return Codec::kBzip2;
+  }
+  throw InvalidCompressionCodec(ERS_HERE, codec_name);
+}
+
+std::string
+FragmentCompressor::codec_to_string(Codec codec)
+{
+  switch (codec) {
+    case Codec::kNone:
+      return "none";
+    case Codec::kZlib:
+      return "zlib";
+    case Codec::kBzip2:
+      return "bzip2";
+  }
+  return "unknown";
+}
+
+std::unique_ptr<daqdataformats::Fragment>
+FragmentCompressor::compress_fragment(const daqdataformats::Fragment& frag, Codec codec, int level)
+{
+  size_t payload_size = frag.get_size() - sizeof(daqdataformats::FragmentHeader);
+  std::vector<char> compressed_payload;
+  try {
+    compressed_payload = run_compressor(static_cast<const char*>(frag.get_data()), payload_size, codec, level);
+  } catch (std::exception const& excpt) {
+    throw FragmentCompressionProblem(ERS_HERE, "compressing", codec_to_string(codec), excpt.what());
+  }
+
+  size_t compressed_size =
+    sizeof(daqdataformats::FragmentHeader) + sizeof(CompressedPayloadHeader) + compressed_payload.size();
+  if (compressed_size >= frag.get_size()) {
+    return nullptr;
+  }
+
+  daqdataformats::FragmentHeader frag_header = frag.get_header();
+  frag_header.size = compressed_size;
+  CompressedPayloadHeader payload_header;
+  payload_header.codec = static_cast<uint16_t>(codec); // NOLINT(build/unsigned)
+  payload_header.uncompressed_payload_size_bytes = payload_size;
+
+  std::vector<char> buffer(compressed_size);
+  std::memcpy(buffer.data(), &frag_header, sizeof(frag_header));
+  std::memcpy(buffer.data() + sizeof(frag_header), &payload_header, sizeof(payload_header));
+  std::memcpy(buffer.data() + sizeof(frag_header) + sizeof(payload_header),
+              compressed_payload.data(),
+              compressed_payload.size());
+  return std::make_unique<daqdataformats::Fragment>(buffer.data(),
+                                                    daqdataformats::Fragment::BufferAdoptionMode::kCopyFromBuffer);
+}
+
+bool
+FragmentCompressor::is_compressed(const daqdataformats::Fragment& frag)
+{
+  if (frag.get_size() < sizeof(daqdataformats::FragmentHeader) + sizeof(CompressedPayloadHeader)) {
+    return false;
+  }
+  CompressedPayloadHeader payload_header;
+  std::memcpy(&payload_header, frag.get_data(), sizeof(payload_header));
+  return payload_header.marker == CompressedPayloadHeader::s_marker &&
+         payload_header.codec != static_cast<uint16_t>(Codec::kNone) && // NOLINT(build/unsigned)
+         payload_header.codec < static_cast<uint16_t>(s_number_of_codecs); // NOLINT(build/unsigned)
+}
+
+std::unique_ptr<daqdataformats::Fragment>
+FragmentCompressor::decompress_fragment(const daqdataformats::Fragment& frag)
+{
+  if (!is_compressed(frag)) {
+    return std::make_unique<daqdataformats::Fragment>(frag.get_storage_location(),
+                                                      daqdataformats::Fragment::BufferAdoptionMode::kCopyFromBuffer);
+  }
+  CompressedPayloadHeader payload_header;
+  std::memcpy(&payload_header, frag.get_data(), sizeof(payload_header));
+  Codec codec = static_cast<Codec>(payload_header.codec);
+  const char* compressed_payload = static_cast<const char*>(frag.get_data()) + sizeof(payload_header);
+  size_t compressed_payload_size = frag.get_size() - sizeof(daqdataformats::FragmentHeader) - sizeof(payload_header);
+
+  daqdataformats::FragmentHeader frag_header = frag.get_header();
+  frag_header.size = sizeof(frag_header) + payload_header.uncompressed_payload_size_bytes;
+  std::vector<char> buffer(frag_header.size);
+  std::memcpy(buffer.data(), &frag_header, sizeof(frag_header));
+  try {
+    run_decompressor(compressed_payload,
+                     compressed_payload_size,
+                     codec,
+                     buffer.data() + sizeof(frag_header),
+                     payload_header.uncompressed_payload_size_bytes);
+  } catch (FragmentCompressionProblem const&) {
+    throw;
+  } catch (std::exception const& excpt) {
+    throw FragmentCompressionProblem(ERS_HERE, "decompressing", codec_to_string(codec), excpt.what());
+  }
+  return std::make_unique<daqdataformats::Fragment>(buffer.data(),
+                                                    daqdataformats::Fragment::BufferAdoptionMode::kCopyFromBuffer);
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
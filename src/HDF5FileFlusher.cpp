@@ -0,0 +1,260 @@
+/**
+ * @file HDF5FileFlusher.cpp HDF5FileFlusher Class Implementation
+ *
+ * The HDF5FileFlusher class flushes the file that the HDF5DataStore is
+ * writing to disk according to a configurable policy.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/HDF5FileFlusher.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "HDF5FileFlusher" // NOLINT
+enum
+{
+  TLVL_BASIC = 2,
+  TLVL_FILE = 10,
+  TLVL_FLUSH = 15
+};
+
+namespace dunedaq {
+namespace dfmodules {
+
+namespace {
+
+/**
+ * @brief Writes the contents of the file (or directory) with the specified name to disk
+ * @return an empty string, or a description of the problem
+ */
+std::string
+sync_path(const std::string& path, bool is_directory)
+{
+  int fd = ::open(path.c_str(), is_directory ? (O_RDONLY | O_DIRECTORY) : O_RDONLY);
+  if (fd < 0) {
+    return std::string("open failed for ") + path + ": " + std::strerror(errno);
+  }
+  int status = is_directory ? ::fsync(fd) : ::fdatasync(fd);
+  int error_number = errno;
+  ::close(fd);
+  if (status != 0) {
+    return std::string(is_directory ? "fsync" : "fdatasync") + " failed for " + path + ": " +
+           std::strerror(error_number);
+  }
+  return "";
+}
+
+} // namespace
+
+HDF5FileFlusher::HDF5FileFlusher(const std::string& parent_name, const Policy& policy, std::mutex& hdf5_mutex)
+  : NamedObject(parent_name + "::HDF5FileFlusher")
+  , m_policy(policy)
+  , m_hdf5_mutex(hdf5_mutex)
+  , m_file_id(-1)
+  , m_fd(-1)
+  , m_records_since_flush(0)
+  , m_bytes_since_flush(0)
+  , m_last_flush_time(std::chrono::steady_clock::now())
+  , m_flush_requested(false)
+  , m_flush_in_progress(false)
+  , m_stop_requested(false)
+{
+  if (m_policy.flush_in_background) {
+    m_flush_thread = std::thread(&HDF5FileFlusher::do_background_flushes, this);
+  }
+}
+
+HDF5FileFlusher::~HDF5FileFlusher()
+{
+  if (m_flush_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lk(m_flush_mutex);
+      m_stop_requested = true;
+      m_flush_requested = false;
+    }
+    m_flush_cv.notify_all();
+    m_flush_thread.join();
+  }
+  finish_file();
+}
+
+bool
+HDF5FileFlusher::is_flushing_requested(const Policy& policy)
+{
+  return policy.records_between_flushes > 0 || policy.bytes_between_flushes > 0 ||
+         policy.time_between_flushes.count() > 0 || policy.sync_at_close;
+}
+
+void
+HDF5FileFlusher::start_file(const std::string& file_name)
+{
+  finish_file();
+
+  std::unique_lock<std::mutex> lk(m_flush_mutex);
+  wait_for_background_flush(lk);
+  m_file_name = file_name;
+  m_records_since_flush = 0;
+  m_bytes_since_flush = 0;
+  m_last_flush_time = std::chrono::steady_clock::now();
+  if (m_policy.records_between_flushes == 0 && m_policy.bytes_between_flushes == 0 &&
+      m_policy.time_between_flushes.count() == 0) {
+    // only the sync at close was requested
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> hdf5_lock(m_hdf5_mutex);
+    m_file_id = H5Fopen(file_name.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+  }
+  if (m_file_id < 0) {
+    ers::error(HDF5FileFlushProblem(ERS_HERE, file_name, "the file could not be opened for flushing"));
+    return;
+  }
+  m_fd = ::open(file_name.c_str(), O_RDONLY);
+  if (m_fd < 0) {
+    ers::error(HDF5FileFlushProblem(
+      ERS_HERE, file_name, std::string("the file could not be opened for syncing: ") + std::strerror(errno)));
+  }
+  TLOG_DEBUG(TLVL_FILE) << get_name() << ": started flushing file " << file_name;
+}
+
+void
+HDF5FileFlusher::finish_file()
+{
+  std::unique_lock<std::mutex> lk(m_flush_mutex);
+  m_flush_requested = false;
+  wait_for_background_flush(lk);
+  if (m_file_id >= 0) {
+    std::lock_guard<std::mutex> hdf5_lock(m_hdf5_mutex);
+    H5Fclose(m_file_id);
+    m_file_id = -1;
+  }
+  if (m_fd >= 0) {
+    ::close(m_fd);
+    m_fd = -1;
+    TLOG_DEBUG(TLVL_FILE) << get_name() << ": finished flushing file " << m_file_name;
+  }
+  m_file_name.clear();
+}
+
+void
+HDF5FileFlusher::record_write(size_t record_count, size_t byte_count)
+{
+  if (m_file_id < 0) {
+    return;
+  }
+  m_records_since_flush += record_count;
+  m_bytes_since_flush += byte_count;
+
+  auto now = std::chrono::steady_clock::now();
+  bool flush_is_due =
+    (m_policy.records_between_flushes > 0 && m_records_since_flush >= m_policy.records_between_flushes) ||
+    (m_policy.bytes_between_flushes > 0 && m_bytes_since_flush >= m_policy.bytes_between_flushes) ||
+    (m_policy.time_between_flushes.count() > 0 && now - m_last_flush_time >= m_policy.time_between_flushes);
+  if (!flush_is_due) {
+    return;
+  }
+  m_records_since_flush = 0;
+  m_bytes_since_flush = 0;
+  m_last_flush_time = now;
+
+  if (m_flush_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lk(m_flush_mutex);
+      m_flush_requested = true;
+    }
+    m_flush_cv.notify_all();
+    return;
+  }
+  flush_current_file();
+}
+
+void
+HDF5FileFlusher::sync_closed_file(const std::string& file_name)
+{
+  if (!m_policy.sync_at_close) {
+    return;
+  }
+  auto sync_start_time = std::chrono::steady_clock::now();
+  std::string problem = sync_path(file_name, false);
+  if (problem.empty()) {
+    // the directory entry of the file, which was renamed when it was closed, is made durable too
+    std::string directory_name = std::filesystem::path(file_name).parent_path().string();
+    problem = sync_path(directory_name.empty() ? "." : directory_name, true);
+  }
+  m_sync_latency.record(std::chrono::steady_clock::now() - sync_start_time);
+  if (!problem.empty()) {
+    ers::error(HDF5FileFlushProblem(ERS_HERE, file_name, problem));
+  }
+}
+
+void
+HDF5FileFlusher::do_background_flushes()
+{
+  std::unique_lock<std::mutex> lk(m_flush_mutex);
+  while (true) {
+    m_flush_cv.wait(lk, [&]() { return m_flush_requested || m_stop_requested; });
+    if (m_stop_requested) {
+      break;
+    }
+    m_flush_requested = false;
+    m_flush_in_progress = true;
+    lk.unlock();
+    flush_current_file();
+    lk.lock();
+    m_flush_in_progress = false;
+    m_flush_cv.notify_all();
+  }
+}
+
+void
+HDF5FileFlusher::wait_for_background_flush(std::unique_lock<std::mutex>& lk)
+{
+  m_flush_cv.wait(lk, [&]() { return !m_flush_in_progress; });
+}
+
+void
+HDF5FileFlusher::flush_current_file()
+{
+  if (m_file_id < 0) {
+    return;
+  }
+
+  auto flush_start_time = std::chrono::steady_clock::now();
+  herr_t status = 0;
+  {
+    std::lock_guard<std::mutex> hdf5_lock(m_hdf5_mutex);
+    status = H5Fflush(m_file_id, H5F_SCOPE_LOCAL);
+  }
+  auto sync_start_time = std::chrono::steady_clock::now();
+  m_flush_latency.record(sync_start_time - flush_start_time);
+  if (status < 0) {
+    ers::error(HDF5FileFlushProblem(ERS_HERE, m_file_name, "H5Fflush failed"));
+    return;
+  }
+
+  if (m_fd >= 0) {
+    if (::fdatasync(m_fd) != 0) {
+      ers::error(HDF5FileFlushProblem(ERS_HERE, m_file_name, std::string("fdatasync failed: ") + std::strerror(errno)));
+    }
+    m_sync_latency.record(std::chrono::steady_clock::now() - sync_start_time);
+  }
+  TLOG_DEBUG(TLVL_FLUSH) << get_name() << ": flushed file " << m_file_name;
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
@@ -0,0 +1,228 @@
+/**
+ * @file HDF5FileTuning.cpp HDF5FileTuning Class Implementation
+ *
+ * The HDF5FileTuning class applies HDF5 file-creation and file-access tuning
+ * to the files that the HDF5DataStore writes.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/HDF5FileTuning.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "HDF5FileTuning" // NOLINT
+enum
+{
+  TLVL_BASIC = 2,
+  TLVL_FILE = 10
+};
+
+namespace dunedaq {
+namespace dfmodules {
+
+namespace {
+
+/**
+ * @brief Closes an HDF5 property list when it goes out of scope
+ */
+struct PropertyList
+{
+  explicit PropertyList(hid_t class_id)
+    : id(H5Pcreate(class_id))
+  {}
+  ~PropertyList()
+  {
+    if (id >= 0) {
+      H5Pclose(id);
+    }
+  }
+  hid_t id;
+};
+
+H5F_libver_t
+string_to_libver(const std::string& parameter_name, const std::string& value, H5F_libver_t default_value)
+{
+  if (value.empty()) {
+    return default_value;
+  }
+  if (value == "earliest") {
+    return H5F_LIBVER_EARLIEST;
+  }
+  if (value == "v18") {
+    return H5F_LIBVER_V18;
+  }
+  if (value == "v110") {
+    return H5F_LIBVER_V110;
+  }
+#if H5_VERSION_GE(1, 12, 0)
+  if (value == "v112") {
+    return H5F_LIBVER_V112;
+  }
+#endif
+  if (value == "latest") {
+    return H5F_LIBVER_LATEST;
+  }
+  throw InvalidHDF5TuningParameter(ERS_HERE, parameter_name, value);
+}
+
+} // namespace
+
+HDF5FileTuning::HDF5FileTuning(const std::string& parent_name, const Settings& settings)
+  : NamedObject(parent_name + "::HDF5FileTuning")
+  , m_settings(settings)
+  , m_file_space_strategy_is_set(!settings.file_space_strategy.empty())
+  , m_file_space_strategy(H5F_FSPACE_STRATEGY_FSM_AGGR)
+{
+  if (settings.file_space_strategy == "page") {
+    m_file_space_strategy = H5F_FSPACE_STRATEGY_PAGE;
+  } else if (settings.file_space_strategy == "aggr") {
+    m_file_space_strategy = H5F_FSPACE_STRATEGY_AGGR;
+  } else if (settings.file_space_strategy == "none") {
+    m_file_space_strategy = H5F_FSPACE_STRATEGY_NONE;
+  } else if (!settings.file_space_strategy.empty() && settings.file_space_strategy != "fsm_aggr") {
+    throw InvalidHDF5TuningParameter(ERS_HERE, "file_space_strategy", settings.file_space_strategy);
+  }
+
+  // page buffering is only possible with the paged file-space strategy
+  if (settings.page_buffer_size_bytes > 0 && m_file_space_strategy != H5F_FSPACE_STRATEGY_PAGE) {
+    throw InvalidHDF5TuningParameter(ERS_HERE,
+                                     "page_buffer_size_bytes",
+                                     std::to_string(settings.page_buffer_size_bytes) +
+                                       "\" (page buffering needs the \"page\" file_space_strategy)");
+  }
+
+  m_libver_low = string_to_libver("libver_low", settings.libver_low, H5F_LIBVER_EARLIEST);
+  m_libver_high = string_to_libver("libver_high", settings.libver_high, H5F_LIBVER_LATEST);
+
+  TLOG_DEBUG(TLVL_BASIC) << get_name() << ": alignment " << settings.alignment_bytes << " (threshold "
+                         << settings.alignment_threshold_bytes << "), metadata block size "
+                         << settings.metadata_block_size_bytes << ", file-space strategy \""
+                         << settings.file_space_strategy << "\", page buffer size " << settings.page_buffer_size_bytes
+                         << ", preallocation " << settings.preallocate;
+}
+
+bool
+HDF5FileTuning::is_tuning_requested(const Settings& settings)
+{
+  return settings.alignment_bytes > 0 || settings.metadata_block_size_bytes > 0 ||
+         settings.metadata_cache_initial_size_bytes > 0 || settings.metadata_cache_max_size_bytes > 0 ||
+         settings.page_buffer_size_bytes > 0 || !settings.file_space_strategy.empty() ||
+         settings.file_space_page_size_bytes > 0 || settings.sieve_buffer_size_bytes > 0 ||
+         !settings.libver_low.empty() || !settings.libver_high.empty() || settings.preallocate;
+}
+
+std::unique_ptr<HDF5FileTuning::PreparedFile>
+HDF5FileTuning::prepare_file(const std::string& file_name, size_t preallocation_size_bytes) const
+{
+  // an existing file is opened with its own settings
+  if (std::filesystem::exists(file_name)) {
+    TLOG_DEBUG(TLVL_FILE) << get_name() << ": file " << file_name << " already exists, not applying the tuning";
+    return nullptr;
+  }
+
+  auto check = [&](herr_t status, const char* operation) {
+    if (status < 0) {
+      throw HDF5FileTuningProblem(ERS_HERE, file_name, std::string(operation) + " failed");
+    }
+  };
+
+  PropertyList fcpl(H5P_FILE_CREATE);
+  PropertyList fapl(H5P_FILE_ACCESS);
+  check(fcpl.id, "H5Pcreate(H5P_FILE_CREATE)");
+  check(fapl.id, "H5Pcreate(H5P_FILE_ACCESS)");
+
+  if (m_file_space_strategy_is_set) {
+    check(H5Pset_file_space_strategy(fcpl.id, m_file_space_strategy, false, 1), "H5Pset_file_space_strategy");
+  }
+  if (m_settings.file_space_page_size_bytes > 0) {
+    check(H5Pset_file_space_page_size(fcpl.id, m_settings.file_space_page_size_bytes), "H5Pset_file_space_page_size");
+  }
+
+  if (m_settings.alignment_bytes > 0) {
+    check(H5Pset_alignment(fapl.id, m_settings.alignment_threshold_bytes, m_settings.alignment_bytes),
+          "H5Pset_alignment");
+  }
+  if (m_settings.metadata_block_size_bytes > 0) {
+    check(H5Pset_meta_block_size(fapl.id, m_settings.metadata_block_size_bytes), "H5Pset_meta_block_size");
+  }
+  if (m_settings.metadata_cache_initial_size_bytes > 0 || m_settings.metadata_cache_max_size_bytes > 0) {
+    H5AC_cache_config_t mdc_config;
+    mdc_config.version = H5AC__CURR_CACHE_CONFIG_VERSION;
+    check(H5Pget_mdc_config(fapl.id, &mdc_config), "H5Pget_mdc_config");
+    if (m_settings.metadata_cache_initial_size_bytes > 0) {
+      mdc_config.set_initial_size = true;
+      mdc_config.initial_size = m_settings.metadata_cache_initial_size_bytes;
+    }
+    if (m_settings.metadata_cache_max_size_bytes > 0) {
+      mdc_config.max_size = m_settings.metadata_cache_max_size_bytes;
+    }
+    mdc_config.max_size = std::max(mdc_config.max_size, mdc_config.initial_size);
+    mdc_config.min_size = std::min(mdc_config.min_size, mdc_config.initial_size);
+    check(H5Pset_mdc_config(fapl.id, &mdc_config), "H5Pset_mdc_config");
+  }
+  if (m_settings.page_buffer_size_bytes > 0) {
+    check(H5Pset_page_buffer_size(fapl.id, m_settings.page_buffer_size_bytes, 0, 0), "H5Pset_page_buffer_size");
+  }
+  if (m_settings.sieve_buffer_size_bytes > 0) {
+    check(H5Pset_sieve_buf_size(fapl.id, m_settings.sieve_buffer_size_bytes), "H5Pset_sieve_buf_size");
+  }
+  if (!m_settings.libver_low.empty() || !m_settings.libver_high.empty()) {
+    check(H5Pset_libver_bounds(fapl.id, m_libver_low, m_libver_high), "H5Pset_libver_bounds");
+  }
+
+  hid_t file_id = H5Fcreate(file_name.c_str(), H5F_ACC_EXCL, fcpl.id, fapl.id);
+  check(file_id, "H5Fcreate");
+  auto prepared_file = std::make_unique<PreparedFile>(file_id);
+
+  // the blocks are reserved without changing the file size, so the HDF5 library
+  // does not see them
+  if (m_settings.preallocate && preallocation_size_bytes > 0) {
+    int fd = open(file_name.c_str(), O_WRONLY);
+    if (fd < 0 || fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, preallocation_size_bytes) != 0) {
+      ers::warning(HDF5FileTuningProblem(ERS_HERE, file_name, std::string("fallocate failed: ") + strerror(errno)));
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+
+  TLOG_DEBUG(TLVL_FILE) << get_name() << ": created file " << file_name << " with the tuned property lists";
+  return prepared_file;
+}
+
+void
+HDF5FileTuning::release_unused_space(const std::string& file_name) const
+{
+  if (!m_settings.preallocate) {
+    return;
+  }
+  // truncating the file to its own size frees the reserved blocks beyond the end of the file
+  std::error_code error_code;
+  auto file_size = std::filesystem::file_size(file_name, error_code);
+  if (!error_code) {
+    std::filesystem::resize_file(file_name, file_size, error_code);
+  }
+  if (error_code) {
+    ers::warning(HDF5FileTuningProblem(
+      ERS_HERE, file_name, "the reserved disk space could not be released: " + error_code.message()));
+  }
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
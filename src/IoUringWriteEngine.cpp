@@ -0,0 +1,321 @@
+/**
+ * @file IoUringWriteEngine.cpp IoUringWriteEngine Class Implementation
+ *
+ * The IoUringWriteEngine class submits file writes and syncs through an
+ * io_uring submission queue and collects their completions.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/IoUringWriteEngine.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "IoUringWriteEngine" // NOLINT
+enum
+{
+  TLVL_BASIC = 2,
+  TLVL_REQUESTS = 15
+};
+
+namespace dunedaq {
+namespace dfmodules {
+
+namespace {
+
+constexpr size_t s_buffer_alignment = 4096;
+
+int
+io_uring_setup(unsigned entries, struct io_uring_params* params)
+{
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int
+io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+  return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int
+io_uring_register(int ring_fd, unsigned opcode, const void* arg, unsigned nr_args)
+{
+  return static_cast<int>(::syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+} // namespace
+
+/**
+ * @brief The memory that is shared with the kernel: the submission and completion rings
+ * and the array of submission queue entries
+ */
+struct IoUringWriteEngine::Ring
+{
+  int fd = -1;
+  void* sq_ring = MAP_FAILED;
+  size_t sq_ring_size = 0;
+  void* cq_ring = MAP_FAILED;
+  size_t cq_ring_size = 0;
+  struct io_uring_sqe* sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+  size_t sqes_size = 0;
+
+  unsigned* sq_head = nullptr;
+  unsigned* sq_tail = nullptr;
+  unsigned* sq_mask = nullptr;
+  unsigned* sq_array = nullptr;
+  unsigned* cq_head = nullptr;
+  unsigned* cq_tail = nullptr;
+  unsigned* cq_mask = nullptr;
+  struct io_uring_cqe* cqes = nullptr;
+
+  ~Ring()
+  {
+    if (sqes != MAP_FAILED) {
+      ::munmap(sqes, sqes_size);
+    }
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring) {
+      ::munmap(cq_ring, cq_ring_size);
+    }
+    if (sq_ring != MAP_FAILED) {
+      ::munmap(sq_ring, sq_ring_size);
+    }
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+};
+
+IoUringWriteEngine::IoUringWriteEngine(const std::string& parent_name,
+                                       size_t queue_depth,
+                                       size_t number_of_buffers,
+                                       size_t buffer_size)
+  : NamedObject(parent_name + "::IoUringWriteEngine")
+  , m_queue_depth(std::max(queue_depth, static_cast<size_t>(1)))
+  , m_buffer_size(((std::max(buffer_size, s_buffer_alignment) + s_buffer_alignment - 1) / s_buffer_alignment) *
+                  s_buffer_alignment)
+  , m_buffers_registered(false)
+  , m_number_in_flight(0)
+  , m_ring(new Ring())
+{
+  struct io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  m_ring->fd = io_uring_setup(static_cast<unsigned>(m_queue_depth), &params);
+  if (m_ring->fd < 0) {
+    throw IoUringProblem(ERS_HERE, "setting up", std::string("io_uring_setup failed: ") + std::strerror(errno));
+  }
+
+  m_ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  m_ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    m_ring->sq_ring_size = std::max(m_ring->sq_ring_size, m_ring->cq_ring_size);
+  }
+  const int prot = PROT_READ | PROT_WRITE;
+  const int flags = MAP_SHARED | MAP_POPULATE;
+  m_ring->sq_ring = ::mmap(nullptr, m_ring->sq_ring_size, prot, flags, m_ring->fd, IORING_OFF_SQ_RING);
+  if (m_ring->sq_ring == MAP_FAILED) {
+    throw IoUringProblem(
+      ERS_HERE, "setting up", std::string("mapping the submission ring failed: ") + std::strerror(errno));
+  }
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    m_ring->cq_ring = m_ring->sq_ring;
+  } else {
+    m_ring->cq_ring = ::mmap(nullptr, m_ring->cq_ring_size, prot, flags, m_ring->fd, IORING_OFF_CQ_RING);
+    if (m_ring->cq_ring == MAP_FAILED) {
+      throw IoUringProblem(
+        ERS_HERE, "setting up", std::string("mapping the completion ring failed: ") + std::strerror(errno));
+    }
+  }
+  m_ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  m_ring->sqes = static_cast<struct io_uring_sqe*>(
+    ::mmap(nullptr, m_ring->sqes_size, prot, flags, m_ring->fd, IORING_OFF_SQES));
+  if (m_ring->sqes == MAP_FAILED) {
+    throw IoUringProblem(
+      ERS_HERE, "setting up", std::string("mapping the submission queue entries failed: ") + std::strerror(errno));
+  }
+
+  char* sq_ring = static_cast<char*>(m_ring->sq_ring);
+  m_ring->sq_head = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.head);
+  m_ring->sq_tail = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+  m_ring->sq_mask = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.ring_mask);
+  m_ring->sq_array = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+  char* cq_ring = static_cast<char*>(m_ring->cq_ring);
+  m_ring->cq_head = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+  m_ring->cq_tail = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+  m_ring->cq_mask = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.ring_mask);
+  m_ring->cqes = reinterpret_cast<struct io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+
+  std::vector<struct iovec> iovecs;
+  for (size_t idx = 0; idx < std::max(number_of_buffers, static_cast<size_t>(1)); ++idx) {
+    void* buffer_ptr = nullptr;
+    if (posix_memalign(&buffer_ptr, s_buffer_alignment, m_buffer_size) != 0) {
+      throw IoUringProblem(ERS_HERE, "setting up", "the write buffers could not be allocated");
+    }
+    m_buffers.emplace_back(static_cast<char*>(buffer_ptr), &std::free);
+    iovecs.push_back({ buffer_ptr, m_buffer_size });
+  }
+
+  // the registration of the buffers counts against the memory lock limit on older kernels,
+  // so the buffers are used without registration if it fails
+  m_buffers_registered = (io_uring_register(m_ring->fd,
+                                            IORING_REGISTER_BUFFERS,
+                                            iovecs.data(),
+                                            static_cast<unsigned>(iovecs.size())) == 0);
+  TLOG_DEBUG(TLVL_BASIC) << get_name() << ": set up an io_uring queue of depth " << m_queue_depth << " with "
+                         << m_buffers.size() << " buffers of " << m_buffer_size
+                         << " bytes, buffers registered = " << m_buffers_registered;
+}
+
+IoUringWriteEngine::~IoUringWriteEngine()
+{
+  // the kernel may still be reading from the buffers, so they are only freed
+  // once all of the requests have completed
+  std::vector<Completion> completions;
+  while (m_number_in_flight > 0) {
+    if (io_uring_enter(m_ring->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+      break;
+    }
+    collect_completions(completions);
+  }
+}
+
+bool
+IoUringWriteEngine::is_supported()
+{
+  struct io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  int fd = io_uring_setup(1, &params);
+  if (fd < 0) {
+    return false;
+  }
+  ::close(fd);
+  return true;
+}
+
+void
+IoUringWriteEngine::submit_write(int fd,
+                                 size_t buffer_index,
+                                 size_t length,
+                                 uint64_t offset, // NOLINT(build/unsigned)
+                                 uint64_t tag)    // NOLINT(build/unsigned)
+{
+  if (buffer_index >= m_buffers.size() || length > m_buffer_size) {
+    throw IoUringProblem(ERS_HERE,
+                         "submitting a write to",
+                         "buffer " + std::to_string(buffer_index) + " and length " + std::to_string(length) +
+                           " are out of range");
+  }
+  submit(fd,
+         m_buffers_registered ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE,
+         0,
+         buffer_index,
+         length,
+         offset,
+         tag);
+}
+
+void
+IoUringWriteEngine::submit_sync(int fd, uint64_t tag) // NOLINT(build/unsigned)
+{
+  submit(fd, IORING_OP_FSYNC, IOSQE_IO_DRAIN, 0, 0, 0, tag);
+}
+
+std::vector<IoUringWriteEngine::Completion>
+IoUringWriteEngine::reap(size_t min_completions)
+{
+  std::vector<Completion> completions;
+  completions.swap(m_completions_collected_early);
+  collect_completions(completions);
+  while (completions.size() < min_completions && m_number_in_flight > 0) {
+    if (io_uring_enter(m_ring->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+      throw IoUringProblem(ERS_HERE, "waiting for completions from", std::strerror(errno));
+    }
+    collect_completions(completions);
+  }
+  return completions;
+}
+
+void
+IoUringWriteEngine::submit(int fd,
+                           uint8_t opcode,      // NOLINT(build/unsigned)
+                           uint8_t flags,       // NOLINT(build/unsigned)
+                           size_t buffer_index,
+                           size_t length,
+                           uint64_t offset, // NOLINT(build/unsigned)
+                           uint64_t tag)    // NOLINT(build/unsigned)
+{
+  while (m_number_in_flight >= m_queue_depth) {
+    if (io_uring_enter(m_ring->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+      throw IoUringProblem(ERS_HERE, "waiting for room in", std::strerror(errno));
+    }
+    collect_completions(m_completions_collected_early);
+  }
+
+  unsigned tail = *m_ring->sq_tail;
+  unsigned index = tail & *m_ring->sq_mask;
+  struct io_uring_sqe* sqe = &m_ring->sqes[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->flags = flags;
+  sqe->fd = fd;
+  sqe->user_data = tag;
+  if (opcode == IORING_OP_FSYNC) {
+    sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+  } else {
+    sqe->addr = reinterpret_cast<uint64_t>(m_buffers[buffer_index].get()); // NOLINT(build/unsigned)
+    sqe->len = static_cast<uint32_t>(length);                               // NOLINT(build/unsigned)
+    sqe->off = offset;
+    if (opcode == IORING_OP_WRITE_FIXED) {
+      sqe->buf_index = static_cast<uint16_t>(buffer_index); // NOLINT(build/unsigned)
+    }
+  }
+  m_ring->sq_array[index] = index;
+  __atomic_store_n(m_ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+  int submitted = 0;
+  do {
+    submitted = io_uring_enter(m_ring->fd, 1, 0, 0);
+  } while (submitted < 0 && errno == EINTR);
+  if (submitted != 1) {
+    // the entry is taken back, so that it is not submitted with the next request
+    __atomic_store_n(m_ring->sq_tail, tail, __ATOMIC_RELEASE);
+    throw IoUringProblem(
+      ERS_HERE, "submitting a request to", submitted < 0 ? std::strerror(errno) : "the request was not accepted");
+  }
+  ++m_number_in_flight;
+  TLOG_DEBUG(TLVL_REQUESTS) << get_name() << ": submitted request " << tag << " (opcode " << static_cast<int>(opcode)
+                            << ", " << length << " bytes at offset " << offset << ")";
+}
+
+void
+IoUringWriteEngine::collect_completions(std::vector<Completion>& completions)
+{
+  unsigned head = *m_ring->cq_head;
+  unsigned tail = __atomic_load_n(m_ring->cq_tail, __ATOMIC_ACQUIRE);
+  while (head != tail) {
+    struct io_uring_cqe* cqe = &m_ring->cqes[head & *m_ring->cq_mask];
+    completions.push_back({ cqe->user_data, cqe->res });
+    --m_number_in_flight;
+    ++head;
+  }
+  __atomic_store_n(m_ring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
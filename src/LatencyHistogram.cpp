@@ -0,0 +1,184 @@
+/**
+ * @file LatencyHistogram.cpp LatencyHistogram Class Implementation
+ *
+ * The LatencyHistogram class accumulates the durations of an operation for
+ * operational monitoring.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/LatencyHistogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace dunedaq {
+namespace dfmodules {
+
+namespace {
+
+constexpr size_t s_fine_buckets_per_decade = 8;
+
+/**
+ * @brief The upper edges of the fine buckets, except the last one, which has none
+ */
+const std::array<uint64_t, LatencyHistogram::s_number_of_fine_buckets - 1>& // NOLINT(build/unsigned)
+get_fine_bucket_edges()
+{
+  static const auto s_edges = []() {
+    std::array<uint64_t, LatencyHistogram::s_number_of_fine_buckets - 1> edges{}; // NOLINT(build/unsigned)
+    for (size_t idx = 0; idx < edges.size(); ++idx) {
+      edges[idx] = static_cast<uint64_t>( // NOLINT(build/unsigned)
+        std::llround(10.0 * std::pow(10.0, static_cast<double>(idx) / s_fine_buckets_per_decade)));
+    }
+    return edges;
+  }();
+  return s_edges;
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram()
+  : m_count(0)
+  , m_sum_us(0)
+  , m_min_us(std::numeric_limits<uint64_t>::max()) // NOLINT(build/unsigned)
+  , m_max_us(0)
+{
+  for (auto& bucket_count : m_bucket_counts) {
+    bucket_count.store(0);
+  }
+  for (auto& bucket_count : m_fine_bucket_counts) {
+    bucket_count.store(0);
+  }
+}
+
+void
+LatencyHistogram::record(std::chrono::steady_clock::duration duration)
+{
+  auto duration_count = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+  uint64_t duration_us = duration_count > 0 ? static_cast<uint64_t>(duration_count) : 0; // NOLINT(build/unsigned)
+
+  uint64_t previous_min = m_min_us.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+  while (duration_us < previous_min &&
+         !m_min_us.compare_exchange_weak(previous_min, duration_us, std::memory_order_relaxed)) {
+  }
+  uint64_t previous_max = m_max_us.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+  while (duration_us > previous_max &&
+         !m_max_us.compare_exchange_weak(previous_max, duration_us, std::memory_order_relaxed)) {
+  }
+
+  // the sample is counted last, and get_and_reset() takes the count first, so that each sample
+  // in a snapshot's count is also in its buckets
+  m_sum_us.fetch_add(duration_us, std::memory_order_relaxed);
+  m_bucket_counts[get_bucket_index(duration_us)].fetch_add(1, std::memory_order_relaxed);
+  m_fine_bucket_counts[get_fine_bucket_index(duration_us)].fetch_add(1, std::memory_order_relaxed);
+  m_count.fetch_add(1, std::memory_order_release);
+}
+
+LatencyHistogram::Snapshot
+LatencyHistogram::get_and_reset()
+{
+  Snapshot snapshot;
+  snapshot.count = m_count.exchange(0, std::memory_order_acquire);
+  snapshot.sum_us = m_sum_us.exchange(0);
+  for (size_t idx = 0; idx < s_number_of_buckets; ++idx) {
+    snapshot.bucket_counts[idx] = m_bucket_counts[idx].exchange(0);
+  }
+  FineBucketCounts fine_bucket_counts;
+  for (size_t idx = 0; idx < s_number_of_fine_buckets; ++idx) {
+    fine_bucket_counts[idx] = m_fine_bucket_counts[idx].exchange(0);
+  }
+  snapshot.min_us = m_min_us.exchange(std::numeric_limits<uint64_t>::max()); // NOLINT(build/unsigned)
+  snapshot.max_us = m_max_us.exchange(0);
+  if (snapshot.count == 0) {
+    snapshot.min_us = 0;
+    return snapshot;
+  }
+  if (snapshot.min_us > snapshot.max_us) {
+    // a sample that is recorded while the counters are reset may not update the minimum and
+    // maximum of the new interval, in which case the range is estimated from the fine buckets
+    estimate_range(fine_bucket_counts, snapshot);
+  }
+  snapshot.p50_us = estimate_percentile(fine_bucket_counts, 0.50, snapshot);
+  snapshot.p90_us = estimate_percentile(fine_bucket_counts, 0.90, snapshot);
+  snapshot.p99_us = estimate_percentile(fine_bucket_counts, 0.99, snapshot);
+  return snapshot;
+}
+
+uint64_t // NOLINT(build/unsigned)
+LatencyHistogram::estimate_percentile(const FineBucketCounts& fine_bucket_counts,
+                                      double fraction,
+                                      const Snapshot& snapshot)
+{
+  // samples that are recorded while the counters are reset may be in the buckets but not
+  // in the count, or vice versa, so the total is taken from the buckets
+  uint64_t total_count = 0; // NOLINT(build/unsigned)
+  for (auto bucket_count : fine_bucket_counts) {
+    total_count += bucket_count;
+  }
+  uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * total_count)); // NOLINT(build/unsigned)
+  rank = std::max<uint64_t>(rank, 1);                                      // NOLINT(build/unsigned)
+
+  uint64_t cumulative_count = 0; // NOLINT(build/unsigned)
+  size_t index = 0;
+  for (; index < s_number_of_fine_buckets - 1; ++index) {
+    cumulative_count += fine_bucket_counts[index];
+    if (cumulative_count >= rank) {
+      break;
+    }
+  }
+  // get_and_reset() makes sure that the range of the samples is valid, but std::clamp() must
+  // never be given an empty one
+  bool range_is_valid = (snapshot.min_us <= snapshot.max_us);
+  if (index == s_number_of_fine_buckets - 1) {
+    return range_is_valid ? snapshot.max_us : get_fine_bucket_edges().back();
+  }
+  if (!range_is_valid) {
+    return get_fine_bucket_edges()[index];
+  }
+  return std::clamp(get_fine_bucket_edges()[index], snapshot.min_us, snapshot.max_us);
+}
+
+void
+LatencyHistogram::estimate_range(const FineBucketCounts& fine_bucket_counts, Snapshot& snapshot)
+{
+  auto const& edges = get_fine_bucket_edges();
+  auto is_not_empty = [](uint64_t bucket_count) { return bucket_count > 0; }; // NOLINT(build/unsigned)
+  auto first_iter = std::find_if(fine_bucket_counts.begin(), fine_bucket_counts.end(), is_not_empty);
+  if (first_iter == fine_bucket_counts.end()) {
+    snapshot.min_us = 0;
+    snapshot.max_us = 0;
+    return;
+  }
+  auto last_iter = std::find_if(fine_bucket_counts.rbegin(), fine_bucket_counts.rend(), is_not_empty);
+  size_t first_index = static_cast<size_t>(std::distance(fine_bucket_counts.begin(), first_iter));
+  size_t last_index =
+    s_number_of_fine_buckets - 1 - static_cast<size_t>(std::distance(fine_bucket_counts.rbegin(), last_iter));
+  snapshot.min_us = (first_index == 0) ? 0 : edges[first_index - 1];
+  snapshot.max_us = (last_index == s_number_of_fine_buckets - 1) ? edges.back() : edges[last_index];
+}
+
+size_t
+LatencyHistogram::get_bucket_index(uint64_t duration_us) // NOLINT(build/unsigned)
+{
+  size_t index = 0;
+  uint64_t upper_edge = 10; // NOLINT(build/unsigned)
+  while (index < (s_number_of_buckets - 1) && duration_us >= upper_edge) {
+    ++index;
+    upper_edge *= 10;
+  }
+  return index;
+}
+
+size_t
+LatencyHistogram::get_fine_bucket_index(uint64_t duration_us) // NOLINT(build/unsigned)
+{
+  auto const& edges = get_fine_bucket_edges();
+  return static_cast<size_t>(std::distance(edges.begin(), std::upper_bound(edges.begin(), edges.end(), duration_us)));
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
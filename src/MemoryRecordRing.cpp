@@ -0,0 +1,347 @@
+/**
+ * @file MemoryRecordRing.cpp MemoryRecordRing Class Implementation
+ *
+ * The MemoryRecordRing class keeps the most recent TriggerRecords and TimeSlices
+ * in a preallocated ring buffer in memory.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/MemoryRecordRing.hpp"
+#include "dfmodules/memoryrecordringinfo/InfoNljs.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "MemoryRecordRing" // NOLINT
+enum
+{
+  TLVL_BASIC = 2,
+  TLVL_RECORDS = 15
+};
+
+namespace dunedaq {
+namespace dfmodules {
+
+namespace {
+std::mutex s_registry_mutex;
+std::map<std::string, std::weak_ptr<MemoryRecordRing>> s_registry;
+} // namespace
+
+std::shared_ptr<MemoryRecordRing>
+MemoryRecordRing::create(const std::string& name, size_t capacity_bytes, size_t max_records)
+{
+  auto ring = std::make_shared<MemoryRecordRing>(name, capacity_bytes, max_records);
+  std::lock_guard<std::mutex> lk(s_registry_mutex);
+  for (auto iter = s_registry.begin(); iter != s_registry.end();) {
+    if (iter->second.expired()) {
+      iter = s_registry.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  s_registry[name] = ring;
+  return ring;
+}
+
+std::shared_ptr<MemoryRecordRing>
+MemoryRecordRing::find(const std::string& name)
+{
+  std::lock_guard<std::mutex> lk(s_registry_mutex);
+  auto iter = s_registry.find(name);
+  if (iter == s_registry.end()) {
+    return nullptr;
+  }
+  return iter->second.lock();
+}
+
+MemoryRecordRing::MemoryRecordRing(const std::string& name, size_t capacity_bytes, size_t max_records)
+  : NamedObject(name)
+  , m_buffer(capacity_bytes)
+  , m_max_records(max_records)
+  , m_write_offset(0)
+  , m_bytes_in_ring(0)
+  , m_next_index(0)
+{
+  TLOG_DEBUG(TLVL_BASIC) << get_name() << ": created a memory ring of " << capacity_bytes << " bytes and "
+                         << max_records << " records";
+}
+
+void
+MemoryRecordRing::add(const daqdataformats::TriggerRecord& tr)
+{
+  auto const& trh = tr.get_header_ref();
+  add_record(tr,
+             RecordType::kTriggerRecord,
+             trh.get_trigger_number(),
+             trh.get_sequence_number(),
+             trh.get_run_number(),
+             trh.get_storage_location(),
+             trh.get_total_size_bytes());
+}
+
+void
+MemoryRecordRing::add(const daqdataformats::TimeSlice& ts)
+{
+  daqdataformats::TimeSliceHeader tsh = ts.get_header();
+  add_record(ts, RecordType::kTimeSlice, tsh.timeslice_number, 0, tsh.run_number, &tsh, sizeof(tsh));
+}
+
+template<typename T>
+void
+MemoryRecordRing::add_record(const T& record,
+                             RecordType record_type,
+                             uint64_t record_number, // NOLINT(build/unsigned)
+                             daqdataformats::sequence_number_t sequence_number,
+                             daqdataformats::run_number_t run_number,
+                             const void* header,
+                             size_t header_size)
+{
+  size_t record_size = header_size;
+  for (auto const& frag_ptr : record.get_fragments_ref()) {
+    record_size += frag_ptr->get_size();
+  }
+  if (record_size > m_buffer.size()) {
+    throw RecordTooLargeForRing(ERS_HERE,
+                                (record_type == RecordType::kTriggerRecord ? "TriggerRecord" : "TimeSlice"),
+                                record_size,
+                                get_name(),
+                                m_buffer.size());
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    Entry entry;
+    entry.offset = make_room(record_size);
+    entry.header_size = header_size;
+    entry.number_of_fragments = record.get_fragments_ref().size();
+    entry.info.index = m_next_index++;
+    entry.info.record_type = record_type;
+    entry.info.record_number = record_number;
+    entry.info.sequence_number = sequence_number;
+    entry.info.run_number = run_number;
+    entry.info.size_bytes = record_size;
+
+    char* dest = m_buffer.data() + entry.offset;
+    std::memcpy(dest, header, header_size);
+    dest += header_size;
+    for (auto const& frag_ptr : record.get_fragments_ref()) {
+      std::memcpy(dest, frag_ptr->get_storage_location(), frag_ptr->get_size());
+      dest += frag_ptr->get_size();
+    }
+
+    m_entries.push_back(entry);
+    m_write_offset = entry.offset + record_size;
+    m_bytes_in_ring += record_size;
+  }
+  m_record_added_cv.notify_all();
+
+  ++m_records_added;
+  m_bytes_added += record_size;
+  TLOG_DEBUG(TLVL_RECORDS) << get_name() << ": added record number " << record_number << " of " << record_size
+                           << " bytes";
+}
+
+/**
+ * Records are laid out back-to-back in the order in which they were added.  A record
+ * never wraps around the end of the buffer; if it does not fit in the space that is
+ * left at the end, it is written at the start, and the (oldest) records at the end
+ * are dropped.  The m_mutex needs to be held by the caller.
+ */
+size_t
+MemoryRecordRing::make_room(size_t size)
+{
+  auto drop_oldest = [&]() {
+    m_bytes_in_ring -= m_entries.front().info.size_bytes;
+    m_entries.pop_front();
+    ++m_records_dropped;
+  };
+
+  if (m_max_records > 0) {
+    while (m_entries.size() >= m_max_records) {
+      drop_oldest();
+    }
+  }
+
+  size_t offset = m_write_offset;
+  if (offset + size > m_buffer.size()) {
+    while (!m_entries.empty() && m_entries.front().offset >= m_write_offset) {
+      drop_oldest();
+    }
+    offset = 0;
+  }
+  while (!m_entries.empty() && m_entries.front().offset >= offset && m_entries.front().offset < offset + size) {
+    drop_oldest();
+  }
+  return offset;
+}
+
+void
+MemoryRecordRing::clear()
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_entries.clear();
+  m_write_offset = 0;
+  m_bytes_in_ring = 0;
+}
+
+std::vector<MemoryRecordRing::EntryInfo>
+MemoryRecordRing::list_entries() const
+{
+  std::vector<EntryInfo> entry_list;
+  std::lock_guard<std::mutex> lk(m_mutex);
+  for (auto const& entry : m_entries) {
+    entry_list.push_back(entry.info);
+  }
+  return entry_list;
+}
+
+std::unique_ptr<daqdataformats::TriggerRecord>
+MemoryRecordRing::get_trigger_record(daqdataformats::trigger_number_t trigger_number,
+                                     daqdataformats::sequence_number_t sequence_number)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  for (auto iter = m_entries.rbegin(); iter != m_entries.rend(); ++iter) {
+    if (iter->info.record_type == RecordType::kTriggerRecord && iter->info.record_number == trigger_number &&
+        iter->info.sequence_number == sequence_number) {
+      ++m_records_read;
+      return make_trigger_record(*iter);
+    }
+  }
+  return nullptr;
+}
+
+std::unique_ptr<daqdataformats::TimeSlice>
+MemoryRecordRing::get_time_slice(daqdataformats::timeslice_number_t timeslice_number)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  for (auto iter = m_entries.rbegin(); iter != m_entries.rend(); ++iter) {
+    if (iter->info.record_type == RecordType::kTimeSlice && iter->info.record_number == timeslice_number) {
+      ++m_records_read;
+      return make_time_slice(*iter);
+    }
+  }
+  return nullptr;
+}
+
+std::unique_ptr<daqdataformats::TriggerRecord>
+MemoryRecordRing::get_latest_trigger_record()
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  for (auto iter = m_entries.rbegin(); iter != m_entries.rend(); ++iter) {
+    if (iter->info.record_type == RecordType::kTriggerRecord) {
+      ++m_records_read;
+      return make_trigger_record(*iter);
+    }
+  }
+  return nullptr;
+}
+
+std::unique_ptr<daqdataformats::TriggerRecord>
+MemoryRecordRing::read_next_trigger_record(uint64_t& next_index, // NOLINT(build/unsigned)
+                                           std::chrono::milliseconds timeout)
+{
+  const Entry* entry = nullptr;
+  std::unique_lock<std::mutex> lk(m_mutex);
+  m_record_added_cv.wait_for(lk, timeout, [&]() {
+    entry = find_entry_after(next_index, RecordType::kTriggerRecord);
+    return entry != nullptr;
+  });
+  if (entry == nullptr) {
+    return nullptr;
+  }
+  next_index = entry->info.index + 1;
+  ++m_records_read;
+  return make_trigger_record(*entry);
+}
+
+std::unique_ptr<daqdataformats::TimeSlice>
+MemoryRecordRing::read_next_time_slice(uint64_t& next_index, // NOLINT(build/unsigned)
+                                       std::chrono::milliseconds timeout)
+{
+  const Entry* entry = nullptr;
+  std::unique_lock<std::mutex> lk(m_mutex);
+  m_record_added_cv.wait_for(lk, timeout, [&]() {
+    entry = find_entry_after(next_index, RecordType::kTimeSlice);
+    return entry != nullptr;
+  });
+  if (entry == nullptr) {
+    return nullptr;
+  }
+  next_index = entry->info.index + 1;
+  ++m_records_read;
+  return make_time_slice(*entry);
+}
+
+const MemoryRecordRing::Entry*
+MemoryRecordRing::find_entry_after(uint64_t next_index, RecordType record_type) const // NOLINT(build/unsigned)
+{
+  for (auto const& entry : m_entries) {
+    if (entry.info.index >= next_index && entry.info.record_type == record_type) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+std::unique_ptr<daqdataformats::TriggerRecord>
+MemoryRecordRing::make_trigger_record(const Entry& entry) const
+{
+  daqdataformats::TriggerRecordHeader trh(const_cast<char*>(m_buffer.data() + entry.offset), true);
+  auto tr_ptr = std::make_unique<daqdataformats::TriggerRecord>(trh);
+  add_fragments(*tr_ptr, entry);
+  return tr_ptr;
+}
+
+std::unique_ptr<daqdataformats::TimeSlice>
+MemoryRecordRing::make_time_slice(const Entry& entry) const
+{
+  daqdataformats::TimeSliceHeader tsh;
+  std::memcpy(&tsh, m_buffer.data() + entry.offset, sizeof(tsh));
+  auto ts_ptr = std::make_unique<daqdataformats::TimeSlice>(tsh);
+  add_fragments(*ts_ptr, entry);
+  return ts_ptr;
+}
+
+template<typename T>
+void
+MemoryRecordRing::add_fragments(T& record, const Entry& entry) const
+{
+  const char* frag_location = m_buffer.data() + entry.offset + entry.header_size;
+  for (size_t idx = 0; idx < entry.number_of_fragments; ++idx) {
+    auto frag_ptr = std::make_unique<daqdataformats::Fragment>(
+      const_cast<char*>(frag_location), daqdataformats::Fragment::BufferAdoptionMode::kCopyFromBuffer);
+    frag_location += frag_ptr->get_size();
+    record.add_fragment(std::move(frag_ptr));
+  }
+}
+
+void
+MemoryRecordRing::get_info(opmonlib::InfoCollector& ci, int /*level*/)
+{
+  memoryrecordringinfo::Info info;
+  info.records_added = m_records_added.exchange(0);
+  info.bytes_added = m_bytes_added.exchange(0);
+  info.records_dropped = m_records_dropped.exchange(0);
+  info.records_read = m_records_read.exchange(0);
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    info.records_in_ring = m_entries.size();
+    info.bytes_in_ring = m_bytes_in_ring;
+  }
+  info.capacity = m_buffer.size();
+  ci.add(info);
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
@@ -0,0 +1,237 @@
+/**
+ * @file OutputDirectorySelector.cpp OutputDirectorySelector Class Implementation
+ *
+ * The OutputDirectorySelector class distributes output files over a list of
+ * directories, taking full and slow disks out of the rotation.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/OutputDirectorySelector.hpp"
+#include "dfmodules/outputdirectoryinfo/InfoNljs.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "OutputDirectorySelector" // NOLINT
+enum
+{
+  TLVL_BASIC = 2,
+  TLVL_SELECTION = 12
+};
+
+namespace dunedaq {
+namespace dfmodules {
+
+OutputDirectorySelector::OutputDirectorySelector(const std::string& parent_name,
+                                                 const std::vector<DirectoryConfig>& directories,
+                                                 std::chrono::milliseconds free_space_sampling_interval,
+                                                 size_t min_write_rate_bytes_per_second,
+                                                 std::chrono::milliseconds excluded_directory_retry_interval)
+  : NamedObject(parent_name + "::OutputDirectorySelector")
+  , m_min_write_rate(min_write_rate_bytes_per_second)
+  , m_excluded_directory_retry_interval(excluded_directory_retry_interval)
+{
+  for (auto const& dir_config : directories) {
+    auto dir = std::make_unique<Directory>();
+    dir->path = dir_config.path;
+    dir->weight = std::max(dir_config.weight, 1);
+    dir->disk_space_monitor.reset(new DiskSpaceMonitor(parent_name, dir_config.path, free_space_sampling_interval));
+    TLOG_DEBUG(TLVL_BASIC) << get_name() << ": added output directory \"" << dir->path << "\" with weight "
+                           << dir->weight;
+    m_directories.push_back(std::move(dir));
+  }
+}
+
+void
+OutputDirectorySelector::start_monitoring()
+{
+  for (auto& dir : m_directories) {
+    dir->disk_space_monitor->start_monitoring();
+  }
+}
+
+void
+OutputDirectorySelector::stop_monitoring()
+{
+  for (auto& dir : m_directories) {
+    dir->disk_space_monitor->stop_monitoring();
+  }
+}
+
+bool
+OutputDirectorySelector::is_usable(const Directory& dir,
+                                   size_t min_free_space,
+                                   std::chrono::steady_clock::time_point now) const
+{
+  return dir.disk_space_monitor->is_path_valid() && dir.excluded_until <= now &&
+         dir.disk_space_monitor->get_predicted_free_space() >= min_free_space;
+}
+
+bool
+OutputDirectorySelector::is_usable(size_t index, size_t min_free_space)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return is_usable(*m_directories[index], min_free_space, std::chrono::steady_clock::now());
+}
+
+std::optional<size_t>
+OutputDirectorySelector::select(size_t min_free_space)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  auto now = std::chrono::steady_clock::now();
+
+  // smooth weighted round-robin: each usable directory gains its weight, the one with the
+  // highest accumulated weight is chosen, and it gives back the total weight of the round
+  int64_t total_weight = 0;
+  std::optional<size_t> chosen_index;
+  for (size_t idx = 0; idx < m_directories.size(); ++idx) {
+    auto& dir = *m_directories[idx];
+    if (!is_usable(dir, min_free_space, now)) {
+      continue;
+    }
+    dir.current_weight += dir.weight;
+    total_weight += dir.weight;
+    if (!chosen_index.has_value() || dir.current_weight > m_directories[*chosen_index]->current_weight) {
+      chosen_index = idx;
+    }
+  }
+  if (chosen_index.has_value()) {
+    m_directories[*chosen_index]->current_weight -= total_weight;
+    TLOG_DEBUG(TLVL_SELECTION) << get_name() << ": selected output directory \""
+                               << m_directories[*chosen_index]->path << "\"";
+  }
+  return chosen_index;
+}
+
+std::optional<size_t>
+OutputDirectorySelector::peek(size_t min_free_space)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  auto now = std::chrono::steady_clock::now();
+
+  // the same choice as in select(), on the weights that the directories would have
+  std::optional<size_t> chosen_index;
+  int64_t chosen_weight = 0;
+  for (size_t idx = 0; idx < m_directories.size(); ++idx) {
+    auto& dir = *m_directories[idx];
+    if (!is_usable(dir, min_free_space, now)) {
+      continue;
+    }
+    int64_t next_weight = dir.current_weight + dir.weight;
+    if (!chosen_index.has_value() || next_weight > chosen_weight) {
+      chosen_index = idx;
+      chosen_weight = next_weight;
+    }
+  }
+  return chosen_index;
+}
+
+void
+OutputDirectorySelector::commit(size_t index, size_t min_free_space)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  auto now = std::chrono::steady_clock::now();
+
+  int64_t total_weight = 0;
+  for (size_t idx = 0; idx < m_directories.size(); ++idx) {
+    auto& dir = *m_directories[idx];
+    if (idx != index && !is_usable(dir, min_free_space, now)) {
+      continue;
+    }
+    dir.current_weight += dir.weight;
+    total_weight += dir.weight;
+  }
+  m_directories[index]->current_weight -= total_weight;
+  TLOG_DEBUG(TLVL_SELECTION) << get_name() << ": selected output directory \"" << m_directories[index]->path
+                             << "\"";
+}
+
+void
+OutputDirectorySelector::record_file_started(size_t index)
+{
+  ++m_directories[index]->files_started;
+}
+
+void
+OutputDirectorySelector::record_write(size_t index, size_t bytes, std::chrono::steady_clock::duration write_time)
+{
+  auto& dir = *m_directories[index];
+  dir.disk_space_monitor->record_bytes_written(bytes);
+  dir.bytes_written += bytes;
+
+  std::lock_guard<std::mutex> lk(m_mutex);
+  dir.bytes_in_measurement += bytes;
+  dir.time_in_measurement += write_time;
+  if (dir.time_in_measurement < s_write_rate_measurement_time) {
+    return;
+  }
+
+  double seconds = std::chrono::duration<double>(dir.time_in_measurement).count();
+  size_t write_rate = static_cast<size_t>(static_cast<double>(dir.bytes_in_measurement) / seconds);
+  dir.last_write_rate.store(write_rate);
+  dir.bytes_in_measurement = 0;
+  dir.time_in_measurement = std::chrono::steady_clock::duration::zero();
+
+  if (m_min_write_rate > 0 && write_rate < m_min_write_rate && m_directories.size() > 1) {
+    dir.excluded_until = std::chrono::steady_clock::now() + m_excluded_directory_retry_interval;
+    ers::warning(OutputDirectoryTakenOutOfRotation(
+      ERS_HERE, dir.path, write_rate, m_min_write_rate, m_excluded_directory_retry_interval.count()));
+  }
+}
+
+std::vector<size_t>
+OutputDirectorySelector::reset()
+{
+  std::vector<size_t> invalid_directories;
+  std::lock_guard<std::mutex> lk(m_mutex);
+  for (size_t idx = 0; idx < m_directories.size(); ++idx) {
+    auto& dir = *m_directories[idx];
+    if (!dir.disk_space_monitor->sample()) {
+      invalid_directories.push_back(idx);
+    }
+    dir.current_weight = 0;
+    dir.excluded_until = std::chrono::steady_clock::time_point();
+    dir.bytes_in_measurement = 0;
+    dir.time_in_measurement = std::chrono::steady_clock::duration::zero();
+  }
+  return invalid_directories;
+}
+
+void
+OutputDirectorySelector::get_info(opmonlib::InfoCollector& ci, int level)
+{
+  auto now = std::chrono::steady_clock::now();
+  for (size_t idx = 0; idx < m_directories.size(); ++idx) {
+    auto& dir = *m_directories[idx];
+
+    outputdirectoryinfo::Info info;
+    info.path = dir.path;
+    info.weight = dir.weight;
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      info.in_rotation = dir.excluded_until <= now;
+    }
+    info.write_rate = dir.last_write_rate.load();
+    info.files_started = dir.files_started.exchange(0);
+    info.bytes_written = dir.bytes_written.exchange(0);
+
+    opmonlib::InfoCollector dir_ci;
+    dir_ci.add(info);
+    opmonlib::InfoCollector disk_space_ci;
+    dir.disk_space_monitor->get_info(disk_space_ci, level);
+    dir_ci.add("disk_space", disk_space_ci);
+    ci.add("directory_" + std::to_string(idx), dir_ci);
+  }
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
@@ -0,0 +1,545 @@
+/**
+ * @file PackedRecordFile.cpp PackedRecordWriter and PackedRecordReader Class Implementations
+ *
+ * The PackedRecordWriter class writes records into an HDF5 file in the packed
+ * record layout, and the PackedRecordReader class reads them back.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/PackedRecordFile.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "PackedRecordFile" // NOLINT
+enum
+{
+  TLVL_BASIC = 2,
+  TLVL_RECORDS = 15
+};
+
+namespace dunedaq {
+namespace dfmodules {
+
+namespace {
+
+/**
+ * @brief Index tables up to this size are stored in the object header of their
+ * dataset (compact layout), which saves a separate allocation in the file
+ */
+constexpr size_t s_max_compact_index_bytes = 32768;
+
+/**
+ * @brief Closes an HDF5 object when it goes out of scope
+ */
+class HDF5Object
+{
+public:
+  HDF5Object(hid_t id, herr_t (*close_function)(hid_t))
+    : m_id(id)
+    , m_close_function(close_function)
+  {}
+  ~HDF5Object()
+  {
+    if (m_id >= 0) {
+      m_close_function(m_id);
+    }
+  }
+  HDF5Object(const HDF5Object&) = delete;
+  HDF5Object& operator=(const HDF5Object&) = delete;
+
+  hid_t get() const { return m_id; }
+
+private:
+  hid_t m_id;
+  herr_t (*m_close_function)(hid_t);
+};
+
+/**
+ * @brief Creates the in-memory compound type of the packedrecord::IndexEntry
+ */
+hid_t
+create_index_type()
+{
+  using packedrecord::IndexEntry;
+  hid_t index_type = H5Tcreate(H5T_COMPOUND, sizeof(IndexEntry));
+  if (index_type < 0) {
+    return index_type;
+  }
+  if (H5Tinsert(index_type, "entry_type", HOFFSET(IndexEntry, entry_type), H5T_NATIVE_UINT32) < 0 ||
+      H5Tinsert(index_type, "subsystem", HOFFSET(IndexEntry, subsystem), H5T_NATIVE_UINT32) < 0 ||
+      H5Tinsert(index_type, "element_id", HOFFSET(IndexEntry, element_id), H5T_NATIVE_UINT32) < 0 ||
+      H5Tinsert(index_type, "fragment_type", HOFFSET(IndexEntry, fragment_type), H5T_NATIVE_UINT32) < 0 ||
+      H5Tinsert(index_type, "offset", HOFFSET(IndexEntry, offset), H5T_NATIVE_UINT64) < 0 ||
+      H5Tinsert(index_type, "size", HOFFSET(IndexEntry, size), H5T_NATIVE_UINT64) < 0) {
+    H5Tclose(index_type);
+    return -1;
+  }
+  return index_type;
+}
+
+bool
+write_scalar_attribute(hid_t object_id, const char* name, hid_t file_type, hid_t memory_type, const void* value)
+{
+  HDF5Object space(H5Screate(H5S_SCALAR), H5Sclose);
+  HDF5Object attribute(H5Acreate2(object_id, name, file_type, space.get(), H5P_DEFAULT, H5P_DEFAULT), H5Aclose);
+  return attribute.get() >= 0 && H5Awrite(attribute.get(), memory_type, value) >= 0;
+}
+
+template<typename T>
+bool
+read_scalar_attribute(hid_t object_id, const char* name, hid_t memory_type, T& value)
+{
+  HDF5Object attribute(H5Aopen(object_id, name, H5P_DEFAULT), H5Aclose);
+  return attribute.get() >= 0 && H5Aread(attribute.get(), memory_type, &value) >= 0;
+}
+
+/**
+ * @brief Reads a string attribute, which may have a fixed or a variable length
+ * @return an empty string, if the attribute can't be read
+ */
+std::string
+read_string_attribute(hid_t object_id, const char* name)
+{
+  if (H5Aexists(object_id, name) <= 0) {
+    return "";
+  }
+  HDF5Object attribute(H5Aopen(object_id, name, H5P_DEFAULT), H5Aclose);
+  HDF5Object type(H5Aget_type(attribute.get()), H5Tclose);
+  if (type.get() < 0 || H5Tget_class(type.get()) != H5T_STRING) {
+    return "";
+  }
+  if (H5Tis_variable_str(type.get()) > 0) {
+    char* value = nullptr;
+    if (H5Aread(attribute.get(), type.get(), &value) < 0 || value == nullptr) {
+      return "";
+    }
+    std::string result(value);
+    H5free_memory(value);
+    return result;
+  }
+  std::vector<char> value(H5Tget_size(type.get()) + 1, '\0');
+  if (H5Aread(attribute.get(), type.get(), value.data()) < 0) {
+    return "";
+  }
+  return std::string(value.data());
+}
+
+herr_t
+collect_link_name(hid_t /*group_id*/, const char* name, const H5L_info_t* /*info*/, void* names)
+{
+  static_cast<std::vector<std::string>*>(names)->emplace_back(name);
+  return 0;
+}
+
+} // namespace
+
+PackedRecordWriter::PackedRecordWriter(const std::string& hdf5_file_name)
+  : m_file_name(hdf5_file_name)
+  , m_file_id(-1)
+  , m_index_type(-1)
+  , m_recorded_size(0)
+{
+  // an HDF5 file that is already open elsewhere in this process is shared with that open
+  m_file_id = H5Fopen(m_file_name.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+  if (m_file_id < 0) {
+    throw PackedRecordProblem(ERS_HERE, "opening", m_file_name, "H5Fopen failed");
+  }
+  m_index_type = create_index_type();
+  bool ok = m_index_type >= 0;
+  if (ok && H5Aexists(m_file_id, packedrecord::s_layout_attribute_name) == 0) {
+    HDF5Object string_type(H5Tcopy(H5T_C_S1), H5Tclose);
+    ok = string_type.get() >= 0 && H5Tset_size(string_type.get(), std::strlen(packedrecord::s_layout_name)) >= 0 &&
+         write_scalar_attribute(m_file_id,
+                                packedrecord::s_layout_attribute_name,
+                                string_type.get(),
+                                string_type.get(),
+                                packedrecord::s_layout_name);
+  }
+  if (!ok) {
+    if (m_index_type >= 0) {
+      H5Tclose(m_index_type);
+    }
+    H5Fclose(m_file_id);
+    throw PackedRecordProblem(ERS_HERE, "opening", m_file_name, "the file could not be prepared for packed records");
+  }
+  TLOG_DEBUG(TLVL_BASIC) << "Opened file " << m_file_name << " for writing packed records";
+}
+
+PackedRecordWriter::~PackedRecordWriter()
+{
+  H5Tclose(m_index_type);
+  H5Fclose(m_file_id);
+}
+
+void
+PackedRecordWriter::write(const daqdataformats::TriggerRecord& tr, const std::string& group_name)
+{
+  auto const& trh = tr.get_header_ref();
+  write_record(group_name,
+               packedrecord::RecordType::kTriggerRecord,
+               trh.get_trigger_number(),
+               trh.get_sequence_number(),
+               trh.get_storage_location(),
+               trh.get_total_size_bytes(),
+               tr.get_fragments_ref());
+}
+
+void
+PackedRecordWriter::write(const daqdataformats::TimeSlice& ts, const std::string& group_name)
+{
+  auto const& tsh = ts.get_header();
+  write_record(group_name,
+               packedrecord::RecordType::kTimeSlice,
+               tsh.timeslice_number,
+               0,
+               &tsh,
+               sizeof(tsh),
+               ts.get_fragments_ref());
+}
+
+void
+PackedRecordWriter::write_record(const std::string& group_name,
+                                 packedrecord::RecordType record_type,
+                                 uint64_t record_number,   // NOLINT(build/unsigned)
+                                 uint32_t sequence_number, // NOLINT(build/unsigned)
+                                 const void* header_data,
+                                 size_t header_size,
+                                 const std::vector<std::unique_ptr<daqdataformats::Fragment>>& fragments)
+{
+  auto check = [&](bool ok, const char* operation) {
+    if (!ok) {
+      throw PackedRecordProblem(
+        ERS_HERE, "writing", m_file_name, std::string(operation) + " failed for record group " + group_name);
+    }
+  };
+
+  std::vector<packedrecord::IndexEntry> index;
+  index.reserve(fragments.size() + 1);
+  packedrecord::IndexEntry header_entry;
+  header_entry.entry_type = packedrecord::EntryType::kRecordHeader;
+  header_entry.size = header_size;
+  index.push_back(header_entry);
+  uint64_t data_size = header_size; // NOLINT(build/unsigned)
+  for (auto const& frag_ptr : fragments) {
+    daqdataformats::FragmentHeader frag_header = frag_ptr->get_header();
+    packedrecord::IndexEntry entry;
+    entry.subsystem = static_cast<uint32_t>(frag_header.element_id.subsystem); // NOLINT(build/unsigned)
+    entry.element_id = frag_header.element_id.id;
+    entry.fragment_type = frag_header.fragment_type;
+    entry.offset = data_size;
+    entry.size = frag_ptr->get_size();
+    index.push_back(entry);
+    data_size += entry.size;
+  }
+
+  HDF5Object group(H5Gcreate2(m_file_id, group_name.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT), H5Gclose);
+  check(group.get() >= 0, "H5Gcreate2");
+
+  // the space of the data dataset is allocated when it is created, and it is not
+  // filled, since all of it is written right away
+  HDF5Object data_dcpl(H5Pcreate(H5P_DATASET_CREATE), H5Pclose);
+  check(data_dcpl.get() >= 0 && H5Pset_layout(data_dcpl.get(), H5D_CONTIGUOUS) >= 0 &&
+          H5Pset_alloc_time(data_dcpl.get(), H5D_ALLOC_TIME_EARLY) >= 0 &&
+          H5Pset_fill_time(data_dcpl.get(), H5D_FILL_TIME_NEVER) >= 0,
+        "H5Pset_layout");
+  hsize_t data_dims[1] = { data_size };
+  HDF5Object data_space(H5Screate_simple(1, data_dims, nullptr), H5Sclose);
+  check(data_space.get() >= 0, "H5Screate_simple");
+  HDF5Object data(H5Dcreate2(group.get(),
+                             packedrecord::s_data_dataset_name,
+                             H5T_STD_U8LE,
+                             data_space.get(),
+                             H5P_DEFAULT,
+                             data_dcpl.get(),
+                             H5P_DEFAULT),
+                  H5Dclose);
+  check(data.get() >= 0, "H5Dcreate2");
+
+  // the header and the Fragments are written from where they are, without copying
+  // them into a single buffer first
+  auto write_piece = [&](const void* piece_data, const packedrecord::IndexEntry& entry) {
+    if (entry.size == 0) {
+      return;
+    }
+    hsize_t start[1] = { entry.offset };
+    hsize_t count[1] = { entry.size };
+    HDF5Object memory_space(H5Screate_simple(1, count, nullptr), H5Sclose);
+    check(memory_space.get() >= 0 &&
+            H5Sselect_hyperslab(data_space.get(), H5S_SELECT_SET, start, nullptr, count, nullptr) >= 0,
+          "H5Sselect_hyperslab");
+    check(H5Dwrite(data.get(), H5T_NATIVE_UINT8, memory_space.get(), data_space.get(), H5P_DEFAULT, piece_data) >= 0,
+          "H5Dwrite");
+  };
+  write_piece(header_data, index[0]);
+  for (size_t idx = 0; idx < fragments.size(); ++idx) {
+    write_piece(fragments[idx]->get_storage_location(), index[idx + 1]);
+  }
+
+  uint32_t record_type_value = static_cast<uint32_t>(record_type); // NOLINT(build/unsigned)
+  check(write_scalar_attribute(data.get(),
+                               packedrecord::s_record_number_attribute_name,
+                               H5T_STD_U64LE,
+                               H5T_NATIVE_UINT64,
+                               &record_number) &&
+          write_scalar_attribute(data.get(),
+                                 packedrecord::s_sequence_number_attribute_name,
+                                 H5T_STD_U32LE,
+                                 H5T_NATIVE_UINT32,
+                                 &sequence_number) &&
+          write_scalar_attribute(data.get(),
+                                 packedrecord::s_record_type_attribute_name,
+                                 H5T_STD_U32LE,
+                                 H5T_NATIVE_UINT32,
+                                 &record_type_value),
+        "H5Awrite");
+
+  HDF5Object index_dcpl(H5Pcreate(H5P_DATASET_CREATE), H5Pclose);
+  check(index_dcpl.get() >= 0, "H5Pcreate");
+  if (index.size() * sizeof(packedrecord::IndexEntry) <= s_max_compact_index_bytes) {
+    check(H5Pset_layout(index_dcpl.get(), H5D_COMPACT) >= 0, "H5Pset_layout");
+  }
+  hsize_t index_dims[1] = { index.size() };
+  HDF5Object index_space(H5Screate_simple(1, index_dims, nullptr), H5Sclose);
+  check(index_space.get() >= 0, "H5Screate_simple");
+  HDF5Object index_dataset(H5Dcreate2(group.get(),
+                                      packedrecord::s_index_dataset_name,
+                                      m_index_type,
+                                      index_space.get(),
+                                      H5P_DEFAULT,
+                                      index_dcpl.get(),
+                                      H5P_DEFAULT),
+                           H5Dclose);
+  check(index_dataset.get() >= 0, "H5Dcreate2");
+  check(H5Dwrite(index_dataset.get(), m_index_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, index.data()) >= 0, "H5Dwrite");
+
+  m_recorded_size += data_size;
+  TLOG_DEBUG(TLVL_RECORDS) << "Wrote record " << record_number << "." << sequence_number << " with "
+                           << fragments.size() << " fragments and " << data_size << " bytes to file " << m_file_name;
+}
+
+PackedRecordReader::PackedRecordReader(const std::string& hdf5_file_name)
+  : m_file_name(hdf5_file_name)
+  , m_file_id(-1)
+  , m_index_type(-1)
+{
+  m_file_id = H5Fopen(m_file_name.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  if (m_file_id < 0) {
+    throw PackedRecordProblem(ERS_HERE, "opening", m_file_name, "H5Fopen failed");
+  }
+  std::string problem;
+  if (read_string_attribute(m_file_id, packedrecord::s_layout_attribute_name) != packedrecord::s_layout_name) {
+    problem = "the file does not use the packed record layout";
+  } else {
+    m_index_type = create_index_type();
+    if (m_index_type < 0) {
+      problem = "H5Tcreate failed";
+    }
+  }
+
+  // the record groups are the top-level groups that have a data dataset
+  std::vector<std::string> link_names;
+  if (problem.empty() &&
+      H5Literate(m_file_id, H5_INDEX_NAME, H5_ITER_NATIVE, nullptr, collect_link_name, &link_names) < 0) {
+    problem = "H5Literate failed";
+  }
+  for (auto const& link_name : link_names) {
+    if (!problem.empty()) {
+      break;
+    }
+    HDF5Object object(H5Oopen(m_file_id, link_name.c_str(), H5P_DEFAULT), H5Oclose);
+    if (object.get() < 0 || H5Iget_type(object.get()) != H5I_GROUP ||
+        H5Lexists(object.get(), packedrecord::s_data_dataset_name, H5P_DEFAULT) <= 0) {
+      continue;
+    }
+    HDF5Object data(H5Dopen2(object.get(), packedrecord::s_data_dataset_name, H5P_DEFAULT), H5Dclose);
+    uint64_t record_number = 0;   // NOLINT(build/unsigned)
+    uint32_t sequence_number = 0; // NOLINT(build/unsigned)
+    uint32_t record_type = 0;     // NOLINT(build/unsigned)
+    if (data.get() < 0 ||
+        !read_scalar_attribute(
+          data.get(), packedrecord::s_record_number_attribute_name, H5T_NATIVE_UINT64, record_number) ||
+        !read_scalar_attribute(
+          data.get(), packedrecord::s_sequence_number_attribute_name, H5T_NATIVE_UINT32, sequence_number) ||
+        !read_scalar_attribute(data.get(), packedrecord::s_record_type_attribute_name, H5T_NATIVE_UINT32, record_type)) {
+      problem = "the attributes of record group " + link_name + " could not be read";
+      break;
+    }
+    m_records[std::make_pair(record_number, sequence_number)] =
+      RecordGroup{ link_name, static_cast<packedrecord::RecordType>(record_type) };
+  }
+
+  if (!problem.empty()) {
+    if (m_index_type >= 0) {
+      H5Tclose(m_index_type);
+    }
+    H5Fclose(m_file_id);
+    throw PackedRecordProblem(ERS_HERE, "opening", m_file_name, problem);
+  }
+  TLOG_DEBUG(TLVL_BASIC) << "Opened file " << m_file_name << " with " << m_records.size() << " packed records";
+}
+
+PackedRecordReader::~PackedRecordReader()
+{
+  H5Tclose(m_index_type);
+  H5Fclose(m_file_id);
+}
+
+bool
+PackedRecordReader::is_packed_file(const std::string& hdf5_file_name)
+{
+  HDF5Object file(H5Fopen(hdf5_file_name.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose);
+  return file.get() >= 0 &&
+         read_string_attribute(file.get(), packedrecord::s_layout_attribute_name) == packedrecord::s_layout_name;
+}
+
+std::vector<PackedRecordReader::record_id_t>
+PackedRecordReader::get_record_ids() const
+{
+  std::vector<record_id_t> record_ids;
+  for (auto const& [record_id, record_group] : m_records) {
+    record_ids.push_back(record_id);
+  }
+  return record_ids;
+}
+
+std::vector<packedrecord::IndexEntry>
+PackedRecordReader::get_index(const record_id_t& record_id) const
+{
+  const RecordGroup& record_group = find_record(record_id);
+  std::string dataset_name = record_group.group_name + "/" + packedrecord::s_index_dataset_name;
+  HDF5Object index_dataset(H5Dopen2(m_file_id, dataset_name.c_str(), H5P_DEFAULT), H5Dclose);
+  HDF5Object index_space(H5Dget_space(index_dataset.get()), H5Sclose);
+  hssize_t number_of_entries = index_space.get() >= 0 ? H5Sget_simple_extent_npoints(index_space.get()) : -1;
+  if (index_dataset.get() < 0 || number_of_entries < 1) {
+    throw PackedRecordProblem(ERS_HERE, "reading", m_file_name, "the index table " + dataset_name + " is invalid");
+  }
+
+  std::vector<packedrecord::IndexEntry> index(static_cast<size_t>(number_of_entries));
+  if (H5Dread(index_dataset.get(), m_index_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, index.data()) < 0) {
+    throw PackedRecordProblem(ERS_HERE, "reading", m_file_name, "H5Dread failed for " + dataset_name);
+  }
+  if (index[0].entry_type != packedrecord::EntryType::kRecordHeader) {
+    throw PackedRecordProblem(
+      ERS_HERE, "reading", m_file_name, "the index table " + dataset_name + " does not start with the record header");
+  }
+  return index;
+}
+
+std::unique_ptr<daqdataformats::TriggerRecord>
+PackedRecordReader::read_trigger_record(const record_id_t& record_id) const
+{
+  const RecordGroup& record_group = find_record(record_id);
+  if (record_group.record_type != packedrecord::RecordType::kTriggerRecord) {
+    throw PackedRecordProblem(
+      ERS_HERE, "reading", m_file_name, "record group " + record_group.group_name + " is not a TriggerRecord");
+  }
+  std::vector<packedrecord::IndexEntry> index = get_index(record_id);
+  std::vector<char> data = read_data(record_group.group_name, 0, index.back().offset + index.back().size);
+
+  daqdataformats::TriggerRecordHeader trh(data.data() + index[0].offset, true);
+  auto tr_ptr = std::make_unique<daqdataformats::TriggerRecord>(trh);
+  for (size_t idx = 1; idx < index.size(); ++idx) {
+    tr_ptr->add_fragment(std::make_unique<daqdataformats::Fragment>(
+      data.data() + index[idx].offset, daqdataformats::Fragment::BufferAdoptionMode::kCopyFromBuffer));
+  }
+  return tr_ptr;
+}
+
+std::unique_ptr<daqdataformats::TimeSlice>
+PackedRecordReader::read_time_slice(uint64_t timeslice_number) const // NOLINT(build/unsigned)
+{
+  record_id_t record_id = std::make_pair(timeslice_number, 0);
+  const RecordGroup& record_group = find_record(record_id);
+  std::vector<packedrecord::IndexEntry> index = get_index(record_id);
+  if (record_group.record_type != packedrecord::RecordType::kTimeSlice ||
+      index[0].size != sizeof(daqdataformats::TimeSliceHeader)) {
+    throw PackedRecordProblem(
+      ERS_HERE, "reading", m_file_name, "record group " + record_group.group_name + " is not a TimeSlice");
+  }
+  std::vector<char> data = read_data(record_group.group_name, 0, index.back().offset + index.back().size);
+
+  daqdataformats::TimeSliceHeader tsh;
+  std::memcpy(&tsh, data.data() + index[0].offset, sizeof(tsh));
+  auto ts_ptr = std::make_unique<daqdataformats::TimeSlice>(tsh);
+  for (size_t idx = 1; idx < index.size(); ++idx) {
+    ts_ptr->add_fragment(std::make_unique<daqdataformats::Fragment>(
+      data.data() + index[idx].offset, daqdataformats::Fragment::BufferAdoptionMode::kCopyFromBuffer));
+  }
+  return ts_ptr;
+}
+
+std::unique_ptr<daqdataformats::Fragment>
+PackedRecordReader::read_fragment(const record_id_t& record_id, const daqdataformats::SourceID& source_id) const
+{
+  for (auto const& entry : get_index(record_id)) {
+    if (entry.entry_type == packedrecord::EntryType::kFragment &&
+        entry.subsystem == static_cast<uint32_t>(source_id.subsystem) && // NOLINT(build/unsigned)
+        entry.element_id == source_id.id) {
+      std::vector<char> data = read_data(find_record(record_id).group_name, entry.offset, entry.size);
+      return std::make_unique<daqdataformats::Fragment>(data.data(),
+                                                        daqdataformats::Fragment::BufferAdoptionMode::kCopyFromBuffer);
+    }
+  }
+  return nullptr;
+}
+
+const PackedRecordReader::RecordGroup&
+PackedRecordReader::find_record(const record_id_t& record_id) const
+{
+  auto iter = m_records.find(record_id);
+  if (iter == m_records.end()) {
+    throw PackedRecordProblem(ERS_HERE,
+                              "reading",
+                              m_file_name,
+                              "there is no record " + std::to_string(record_id.first) + "." +
+                                std::to_string(record_id.second));
+  }
+  return iter->second;
+}
+
+std::vector<char>
+PackedRecordReader::read_data(const std::string& group_name,
+                              uint64_t offset, // NOLINT(build/unsigned)
+                              uint64_t size    // NOLINT(build/unsigned)
+) const
+{
+  std::string dataset_name = group_name + "/" + packedrecord::s_data_dataset_name;
+  HDF5Object data(H5Dopen2(m_file_id, dataset_name.c_str(), H5P_DEFAULT), H5Dclose);
+  HDF5Object data_space(H5Dget_space(data.get()), H5Sclose);
+  hssize_t data_size = data_space.get() >= 0 ? H5Sget_simple_extent_npoints(data_space.get()) : -1;
+  if (data.get() < 0 || data_size < 0 || offset + size > static_cast<uint64_t>(data_size)) { // NOLINT(build/unsigned)
+    throw PackedRecordProblem(ERS_HERE,
+                              "reading",
+                              m_file_name,
+                              "the range of " + std::to_string(size) + " bytes at offset " + std::to_string(offset) +
+                                " is outside of " + dataset_name);
+  }
+
+  std::vector<char> buffer(size);
+  if (size == 0) {
+    return buffer;
+  }
+  hsize_t start[1] = { offset };
+  hsize_t count[1] = { size };
+  HDF5Object memory_space(H5Screate_simple(1, count, nullptr), H5Sclose);
+  if (memory_space.get() < 0 ||
+      H5Sselect_hyperslab(data_space.get(), H5S_SELECT_SET, start, nullptr, count, nullptr) < 0 ||
+      H5Dread(data.get(), H5T_NATIVE_UINT8, memory_space.get(), data_space.get(), H5P_DEFAULT, buffer.data()) < 0) {
+    throw PackedRecordProblem(ERS_HERE, "reading", m_file_name, "H5Dread failed for " + dataset_name);
+  }
+  return buffer;
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
@@ -0,0 +1,128 @@
+/**
+ * @file RawDataFileReader.cpp RawDataFileReader Class Implementation
+ *
+ * The RawDataFileReader class reads the TriggerRecords and TimeSlices from a
+ * flat binary file that was written by the RawDataFileWriter.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/RawDataFileReader.hpp"
+
+#include "daqdataformats/FragmentHeader.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <utility>
+
+namespace dunedaq {
+namespace dfmodules {
+
+RawDataFileReader::RawDataFileReader(const std::string& file_name)
+  : m_file_name(file_name)
+  , m_stream(file_name, std::ios::in | std::ios::binary)
+  , m_block_offset(0)
+{
+  if (!m_stream.is_open()) {
+    throw RawDataFileProblem(ERS_HERE, "opening", m_file_name, std::strerror(errno));
+  }
+  if (!m_stream.read(reinterpret_cast<char*>(&m_file_header), sizeof(m_file_header))) { // NOLINT
+    throw RawDataFileProblem(ERS_HERE, "reading the file header of", m_file_name, "the file is too short");
+  }
+  if (m_file_header.marker != rawdatafile::s_file_header_marker) {
+    throw RawDataFileProblem(ERS_HERE, "reading the file header of", m_file_name, "the file marker is invalid");
+  }
+  if (m_file_header.version != rawdatafile::s_current_version ||
+      m_file_header.header_size != sizeof(rawdatafile::FileHeader)) {
+    throw RawDataFileProblem(ERS_HERE,
+                             "reading the file header of",
+                             m_file_name,
+                             "unsupported format version " + std::to_string(m_file_header.version));
+  }
+  m_block_offset = sizeof(m_file_header);
+}
+
+bool
+RawDataFileReader::read_next_block()
+{
+  m_block_payload.clear();
+  if (!m_stream.read(reinterpret_cast<char*>(&m_block_header), sizeof(m_block_header))) { // NOLINT
+    if (m_stream.gcount() == 0) {
+      return false;
+    }
+    throw RawDataFileProblem(ERS_HERE,
+                             "reading",
+                             m_file_name,
+                             "the block header at offset " + std::to_string(m_block_offset) + " is truncated");
+  }
+  if (m_block_header.marker != rawdatafile::s_block_header_marker ||
+      m_block_header.block_size_bytes < sizeof(m_block_header) + m_block_header.record_header_size) {
+    throw RawDataFileProblem(
+      ERS_HERE, "reading", m_file_name, "the block header at offset " + std::to_string(m_block_offset) + " is invalid");
+  }
+
+  m_block_payload.resize(m_block_header.block_size_bytes - sizeof(m_block_header));
+  if (!m_stream.read(m_block_payload.data(), m_block_payload.size())) {
+    throw RawDataFileProblem(
+      ERS_HERE, "reading", m_file_name, "the data block at offset " + std::to_string(m_block_offset) + " is truncated");
+  }
+  m_block_offset += m_block_header.block_size_bytes;
+  return true;
+}
+
+std::unique_ptr<daqdataformats::TriggerRecord>
+RawDataFileReader::get_trigger_record()
+{
+  if (m_block_payload.empty() || m_block_header.block_type != rawdatafile::BlockType::kTriggerRecord) {
+    throw RawDataFileProblem(ERS_HERE, "reading", m_file_name, "the current data block is not a TriggerRecord");
+  }
+  daqdataformats::TriggerRecordHeader trh(m_block_payload.data(), true);
+  auto tr_ptr = std::make_unique<daqdataformats::TriggerRecord>(trh);
+  for (auto& frag_ptr : get_fragments()) {
+    tr_ptr->add_fragment(std::move(frag_ptr));
+  }
+  return tr_ptr;
+}
+
+std::unique_ptr<daqdataformats::TimeSlice>
+RawDataFileReader::get_time_slice()
+{
+  if (m_block_payload.empty() || m_block_header.block_type != rawdatafile::BlockType::kTimeSlice ||
+      m_block_header.record_header_size != sizeof(daqdataformats::TimeSliceHeader)) {
+    throw RawDataFileProblem(ERS_HERE, "reading", m_file_name, "the current data block is not a TimeSlice");
+  }
+  daqdataformats::TimeSliceHeader tsh;
+  std::memcpy(&tsh, m_block_payload.data(), sizeof(tsh));
+  auto ts_ptr = std::make_unique<daqdataformats::TimeSlice>(tsh);
+  for (auto& frag_ptr : get_fragments()) {
+    ts_ptr->add_fragment(std::move(frag_ptr));
+  }
+  return ts_ptr;
+}
+
+std::vector<std::unique_ptr<daqdataformats::Fragment>>
+RawDataFileReader::get_fragments()
+{
+  std::vector<std::unique_ptr<daqdataformats::Fragment>> fragments;
+  size_t offset = m_block_header.record_header_size;
+  for (uint32_t idx = 0; idx < m_block_header.num_fragments; ++idx) { // NOLINT(build/unsigned)
+    daqdataformats::FragmentHeader frag_header;
+    if (offset + sizeof(frag_header) > m_block_payload.size()) {
+      throw RawDataFileProblem(ERS_HERE, "reading", m_file_name, "a fragment header extends beyond its data block");
+    }
+    std::memcpy(&frag_header, m_block_payload.data() + offset, sizeof(frag_header));
+    if (frag_header.size < sizeof(frag_header) || offset + frag_header.size > m_block_payload.size()) {
+      throw RawDataFileProblem(ERS_HERE, "reading", m_file_name, "a fragment extends beyond its data block");
+    }
+    fragments.push_back(std::make_unique<daqdataformats::Fragment>(
+      m_block_payload.data() + offset, daqdataformats::Fragment::BufferAdoptionMode::kCopyFromBuffer));
+    offset += frag_header.size;
+  }
+  return fragments;
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
@@ -0,0 +1,403 @@
+/**
+ * @file RawDataFileWriter.cpp RawDataFileWriter Class Implementation
+ *
+ * The RawDataFileWriter class writes TriggerRecords and TimeSlices into a
+ * flat binary file, using page-aligned buffers and direct I/O, and optionally
+ * an io_uring write engine.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/RawDataFileWriter.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "RawDataFileWriter" // NOLINT
+enum
+{
+  TLVL_BASIC = 2,
+  TLVL_FILE_WRITES = 15
+};
+
+namespace dunedaq {
+namespace dfmodules {
+
+namespace {
+size_t
+round_up_to_alignment(size_t size)
+{
+  return ((size + rawdatafile::s_direct_io_alignment - 1) / rawdatafile::s_direct_io_alignment) *
+         rawdatafile::s_direct_io_alignment;
+}
+
+size_t
+round_down_to_alignment(size_t size)
+{
+  return (size / rawdatafile::s_direct_io_alignment) * rawdatafile::s_direct_io_alignment;
+}
+
+/**
+ * @brief Tag of the sync requests that are submitted to the write engine; the writes
+ * are tagged with the index of their buffer
+ */
+constexpr uint64_t s_sync_tag = ~static_cast<uint64_t>(0); // NOLINT(build/unsigned)
+} // namespace
+
+RawDataFileWriter::RawDataFileWriter(const std::string& file_name,
+                                     const rawdatafile::FileHeader& file_header,
+                                     size_t buffer_size,
+                                     bool use_direct_io,
+                                     const std::string& in_progress_suffix,
+                                     IoUringWriteEngine* write_engine)
+  : m_file_name(file_name)
+  , m_in_progress_file_name(file_name + in_progress_suffix)
+  , m_fd(-1)
+  , m_using_direct_io(false)
+  , m_buffer(nullptr, &std::free)
+  , m_current_buffer(nullptr)
+  , m_buffer_size(round_up_to_alignment(std::max(buffer_size, rawdatafile::s_direct_io_alignment)))
+  , m_buffer_fill(0)
+  , m_file_offset(0)
+  , m_recorded_size(0)
+  , m_durable_size(0)
+  , m_write_engine(write_engine)
+  , m_current_buffer_index(0)
+{
+  if (m_write_engine != nullptr) {
+    // the engine's buffers are page-aligned, and their size is a multiple of the page size
+    m_buffer_size = m_write_engine->get_buffer_size();
+    m_write_lengths.resize(m_write_engine->get_number_of_buffers(), 0);
+    for (size_t idx = 0; idx < m_write_engine->get_number_of_buffers(); ++idx) {
+      m_free_buffers.push_back(idx);
+    }
+    take_free_buffer();
+  } else {
+    void* buffer_ptr = nullptr;
+    if (posix_memalign(&buffer_ptr, rawdatafile::s_direct_io_alignment, m_buffer_size) != 0) {
+      throw RawDataFileProblem(ERS_HERE, "allocating the write buffer for", m_file_name, std::strerror(ENOMEM));
+    }
+    m_buffer.reset(static_cast<char*>(buffer_ptr));
+    m_current_buffer = m_buffer.get();
+  }
+
+  const int open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+  if (use_direct_io) {
+    m_fd = ::open(m_in_progress_file_name.c_str(), open_flags | O_DIRECT, 0644);
+    if (m_fd >= 0) {
+      m_using_direct_io = true;
+    } else if (errno == EINVAL) {
+      // some file systems (e.g. tmpfs) don't support direct I/O
+      TLOG_DEBUG(TLVL_BASIC) << "Direct I/O is not supported for file " << m_in_progress_file_name
+                             << ", falling back to buffered I/O";
+    }
+  }
+  if (m_fd < 0) {
+    m_fd = ::open(m_in_progress_file_name.c_str(), open_flags, 0644);
+  }
+  if (m_fd < 0) {
+    throw RawDataFileProblem(ERS_HERE, "creating", m_in_progress_file_name, std::strerror(errno));
+  }
+  TLOG_DEBUG(TLVL_BASIC) << "Created raw data file " << m_in_progress_file_name << " with a " << m_buffer_size
+                         << " byte write buffer, direct I/O = " << m_using_direct_io
+                         << ", io_uring = " << (m_write_engine != nullptr);
+
+  append(&file_header, sizeof(file_header));
+}
+
+RawDataFileWriter::~RawDataFileWriter()
+{
+  try {
+    close();
+  } catch (ers::Issue const& excpt) {
+    ers::error(excpt);
+  }
+}
+
+size_t
+RawDataFileWriter::write(const daqdataformats::TriggerRecord& tr)
+{
+  auto const& trh = tr.get_header_ref();
+
+  rawdatafile::BlockHeader block_header;
+  block_header.block_type = rawdatafile::BlockType::kTriggerRecord;
+  block_header.record_number = trh.get_trigger_number();
+  block_header.sequence_number = trh.get_sequence_number();
+  block_header.run_number = trh.get_run_number();
+  block_header.record_header_size = trh.get_total_size_bytes();
+  block_header.num_fragments = tr.get_fragments_ref().size();
+  block_header.block_size_bytes = sizeof(block_header) + block_header.record_header_size;
+  for (auto const& frag_ptr : tr.get_fragments_ref()) {
+    block_header.block_size_bytes += frag_ptr->get_size();
+  }
+
+  append(&block_header, sizeof(block_header));
+  append(trh.get_storage_location(), trh.get_total_size_bytes());
+  for (auto const& frag_ptr : tr.get_fragments_ref()) {
+    append(frag_ptr->get_storage_location(), frag_ptr->get_size());
+  }
+  return block_header.block_size_bytes;
+}
+
+size_t
+RawDataFileWriter::write(const daqdataformats::TimeSlice& ts)
+{
+  auto const& tsh = ts.get_header();
+
+  rawdatafile::BlockHeader block_header;
+  block_header.block_type = rawdatafile::BlockType::kTimeSlice;
+  block_header.record_number = tsh.timeslice_number;
+  block_header.sequence_number = 0;
+  block_header.run_number = tsh.run_number;
+  block_header.record_header_size = sizeof(tsh);
+  block_header.num_fragments = ts.get_fragments_ref().size();
+  block_header.block_size_bytes = sizeof(block_header) + block_header.record_header_size;
+  for (auto const& frag_ptr : ts.get_fragments_ref()) {
+    block_header.block_size_bytes += frag_ptr->get_size();
+  }
+
+  append(&block_header, sizeof(block_header));
+  append(&tsh, sizeof(tsh));
+  for (auto const& frag_ptr : ts.get_fragments_ref()) {
+    append(frag_ptr->get_storage_location(), frag_ptr->get_size());
+  }
+  return block_header.block_size_bytes;
+}
+
+void
+RawDataFileWriter::close()
+{
+  if (m_fd < 0) {
+    return;
+  }
+
+  try {
+    throw_if_write_failed();
+    // direct I/O needs aligned sizes, so the last block is padded with zeroes,
+    // and the padding is removed again with ftruncate()
+    if (m_buffer_fill > 0) {
+      size_t padded_size = round_up_to_alignment(m_buffer_fill);
+      std::memset(m_current_buffer + m_buffer_fill, 0, padded_size - m_buffer_fill);
+      write_current_buffer(padded_size);
+      m_buffer_fill = 0;
+    }
+    wait_for_engine_requests();
+    throw_if_write_failed();
+    if (::ftruncate(m_fd, m_recorded_size) != 0) {
+      throw RawDataFileProblem(ERS_HERE, "truncating", m_in_progress_file_name, std::strerror(errno));
+    }
+    if (::fdatasync(m_fd) != 0) {
+      throw RawDataFileProblem(ERS_HERE, "syncing", m_in_progress_file_name, std::strerror(errno));
+    }
+    m_durable_size = m_recorded_size;
+  } catch (...) { // NOLINT(runtime/exceptions)
+    // the engine is left without requests of this file, so that it can be used for the next one
+    try {
+      wait_for_engine_requests();
+    } catch (ers::Issue const& excpt) {
+      ers::error(excpt);
+    }
+    ::close(m_fd);
+    m_fd = -1;
+    // NOLINT here because we *ARE* re-throwing the exception!
+    throw;
+  }
+
+  int fd = m_fd;
+  m_fd = -1;
+  if (::close(fd) != 0) {
+    throw RawDataFileProblem(ERS_HERE, "closing", m_in_progress_file_name, std::strerror(errno));
+  }
+  if (m_in_progress_file_name != m_file_name && std::rename(m_in_progress_file_name.c_str(), m_file_name.c_str()) != 0) {
+    throw RawDataFileProblem(ERS_HERE, "renaming", m_in_progress_file_name, std::strerror(errno));
+  }
+  TLOG_DEBUG(TLVL_BASIC) << "Closed raw data file " << m_file_name << ", size = " << m_recorded_size << " bytes";
+}
+
+void
+RawDataFileWriter::sync()
+{
+  if (m_fd < 0) {
+    throw RawDataFileProblem(ERS_HERE, "syncing", m_in_progress_file_name, "the file is not open");
+  }
+  throw_if_write_failed();
+
+  if (m_buffer_fill > 0) {
+    // the complete blocks are written for good, and the partial block at the end is written
+    // padded, and kept at the start of the buffer so that it is written again once it has
+    // been filled further.  The later write of that block can't overtake this one, since
+    // the sync below holds back the requests that are submitted after it.
+    size_t complete_size = round_down_to_alignment(m_buffer_fill);
+    size_t padded_size = round_up_to_alignment(m_buffer_fill);
+    size_t partial_size = m_buffer_fill - complete_size;
+    std::memset(m_current_buffer + m_buffer_fill, 0, padded_size - m_buffer_fill);
+    const char* written_buffer = m_current_buffer;
+    write_current_buffer(padded_size);
+    std::memmove(m_current_buffer, written_buffer + complete_size, partial_size);
+    m_file_offset += complete_size;
+    m_buffer_fill = partial_size;
+  }
+
+  if (m_write_engine != nullptr) {
+    m_sync_sizes.push_back(m_recorded_size);
+    try {
+      m_write_engine->submit_sync(m_fd, s_sync_tag);
+    } catch (ers::Issue const& excpt) {
+      m_sync_sizes.pop_back();
+      throw RawDataFileProblem(ERS_HERE, "syncing", m_in_progress_file_name, excpt.what());
+    }
+    return;
+  }
+  if (::fdatasync(m_fd) != 0) {
+    throw RawDataFileProblem(ERS_HERE, "syncing", m_in_progress_file_name, std::strerror(errno));
+  }
+  m_durable_size = m_recorded_size;
+}
+
+void
+RawDataFileWriter::poll_completions()
+{
+  if (m_write_engine != nullptr && m_fd >= 0) {
+    process_completions(m_write_engine->reap(0));
+  }
+}
+
+void
+RawDataFileWriter::append(const void* data, size_t size)
+{
+  if (m_fd < 0) {
+    throw RawDataFileProblem(ERS_HERE, "writing to", m_in_progress_file_name, "the file is not open");
+  }
+  throw_if_write_failed();
+
+  const char* data_ptr = static_cast<const char*>(data);
+  while (size > 0) {
+    size_t chunk_size = std::min(size, m_buffer_size - m_buffer_fill);
+    std::memcpy(m_current_buffer + m_buffer_fill, data_ptr, chunk_size);
+    m_buffer_fill += chunk_size;
+    m_recorded_size += chunk_size;
+    data_ptr += chunk_size;
+    size -= chunk_size;
+    if (m_buffer_fill == m_buffer_size) {
+      write_current_buffer(m_buffer_size);
+      m_file_offset += m_buffer_size;
+      m_buffer_fill = 0;
+    }
+  }
+}
+
+void
+RawDataFileWriter::write_current_buffer(size_t size)
+{
+  TLOG_DEBUG(TLVL_FILE_WRITES) << "Writing " << size << " bytes at offset " << m_file_offset << " of file "
+                               << m_in_progress_file_name;
+  if (m_write_engine != nullptr) {
+    m_write_lengths[m_current_buffer_index] = size;
+    try {
+      m_write_engine->submit_write(m_fd, m_current_buffer_index, size, m_file_offset, m_current_buffer_index);
+    } catch (ers::Issue const& excpt) {
+      throw RawDataFileProblem(ERS_HERE, "writing to", m_in_progress_file_name, excpt.what());
+    }
+    take_free_buffer();
+    return;
+  }
+
+  size_t bytes_written = 0;
+  while (bytes_written < size) {
+    ssize_t retval =
+      ::pwrite(m_fd, m_current_buffer + bytes_written, size - bytes_written, m_file_offset + bytes_written);
+    if (retval < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw RawDataFileProblem(ERS_HERE, "writing to", m_in_progress_file_name, std::strerror(errno));
+    }
+    bytes_written += static_cast<size_t>(retval);
+  }
+}
+
+void
+RawDataFileWriter::take_free_buffer()
+{
+  while (m_free_buffers.empty()) {
+    std::vector<IoUringWriteEngine::Completion> completions;
+    try {
+      completions = m_write_engine->reap(1);
+    } catch (ers::Issue const& excpt) {
+      throw RawDataFileProblem(ERS_HERE, "writing to", m_in_progress_file_name, excpt.what());
+    }
+    if (completions.empty()) {
+      throw RawDataFileProblem(
+        ERS_HERE, "writing to", m_in_progress_file_name, "no write buffer of the io_uring engine became free");
+    }
+    process_completions(completions);
+  }
+  m_current_buffer_index = m_free_buffers.back();
+  m_free_buffers.pop_back();
+  m_current_buffer = m_write_engine->get_buffer(m_current_buffer_index);
+}
+
+void
+RawDataFileWriter::process_completions(const std::vector<IoUringWriteEngine::Completion>& completions)
+{
+  for (auto const& completion : completions) {
+    if (completion.tag == s_sync_tag) {
+      size_t synced_size = m_sync_sizes.front();
+      m_sync_sizes.pop_front();
+      if (completion.result < 0) {
+        m_write_error = std::string("fdatasync failed: ") + std::strerror(-completion.result);
+      } else if (m_write_error.empty()) {
+        m_durable_size = std::max(m_durable_size, synced_size);
+      }
+      continue;
+    }
+
+    size_t buffer_index = static_cast<size_t>(completion.tag);
+    if (completion.result < 0) {
+      m_write_error = std::strerror(-completion.result);
+    } else if (static_cast<size_t>(completion.result) != m_write_lengths[buffer_index]) {
+      m_write_error = "only " + std::to_string(completion.result) + " of " +
+                      std::to_string(m_write_lengths[buffer_index]) + " bytes were written";
+    }
+    m_free_buffers.push_back(buffer_index);
+  }
+}
+
+void
+RawDataFileWriter::wait_for_engine_requests()
+{
+  if (m_write_engine == nullptr) {
+    return;
+  }
+  try {
+    process_completions(m_write_engine->reap(0));
+    while (m_write_engine->get_number_in_flight() > 0) {
+      process_completions(m_write_engine->reap(1));
+    }
+  } catch (IoUringProblem const& excpt) {
+    throw RawDataFileProblem(ERS_HERE, "writing to", m_in_progress_file_name, excpt.what());
+  }
+}
+
+void
+RawDataFileWriter::throw_if_write_failed()
+{
+  if (!m_write_error.empty()) {
+    throw RawDataFileProblem(ERS_HERE, "writing to", m_in_progress_file_name, m_write_error);
+  }
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
@@ -0,0 +1,204 @@
+/**
+ * @file RecordIndexFile.cpp RecordIndexWriter and RecordIndexReader Class Implementations
+ *
+ * The RecordIndexWriter class writes the side-car index file of an HDF5 file,
+ * and the RecordIndexReader class reads it.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/RecordIndexFile.hpp"
+
+#include "logging/Logging.hpp"
+
+#include "hdf5.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "RecordIndexFile" // NOLINT
+enum
+{
+  TLVL_BASIC = 2,
+  TLVL_ENTRIES = 15
+};
+
+namespace dunedaq {
+namespace dfmodules {
+
+namespace {
+
+/**
+ * @brief Closes an HDF5 object when it goes out of scope
+ */
+class HDF5Object
+{
+public:
+  HDF5Object(hid_t id, herr_t (*close_function)(hid_t))
+    : m_id(id)
+    , m_close_function(close_function)
+  {}
+  ~HDF5Object()
+  {
+    if (m_id >= 0) {
+      m_close_function(m_id);
+    }
+  }
+  HDF5Object(const HDF5Object&) = delete;
+  HDF5Object& operator=(const HDF5Object&) = delete;
+
+  hid_t get() const { return m_id; }
+
+private:
+  hid_t m_id;
+  herr_t (*m_close_function)(hid_t);
+};
+
+} // namespace
+
+RecordIndexWriter::RecordIndexWriter(const std::string& file_name, const recordindex::FileHeader& file_header)
+  : m_file_name(file_name)
+  , m_fd(-1)
+{
+  m_fd = ::open(m_file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (m_fd < 0) {
+    throw RecordIndexProblem(ERS_HERE, "creating", m_file_name, std::strerror(errno));
+  }
+
+  recordindex::FileHeader header = file_header;
+  header.entry_size = sizeof(recordindex::Entry);
+  if (::write(m_fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header))) {
+    int error_number = errno;
+    close();
+    throw RecordIndexProblem(ERS_HERE, "writing the header of", m_file_name, std::strerror(error_number));
+  }
+  TLOG_DEBUG(TLVL_BASIC) << "Created record index file " << m_file_name;
+}
+
+RecordIndexWriter::~RecordIndexWriter()
+{
+  close();
+}
+
+void
+RecordIndexWriter::append(const recordindex::Entry& entry)
+{
+  if (m_fd < 0) {
+    throw RecordIndexProblem(ERS_HERE, "appending an entry to", m_file_name, "the file has already been closed");
+  }
+  if (::write(m_fd, &entry, sizeof(entry)) != static_cast<ssize_t>(sizeof(entry))) {
+    throw RecordIndexProblem(ERS_HERE, "appending an entry to", m_file_name, std::strerror(errno));
+  }
+  m_entries.push_back(entry);
+  TLOG_DEBUG(TLVL_ENTRIES) << "Added record " << entry.record_number << "." << entry.sequence_number
+                           << " to record index file " << m_file_name;
+}
+
+void
+RecordIndexWriter::write_to_hdf5_file(const std::string& hdf5_file_name) const
+{
+  auto check = [&](bool ok, const char* operation) {
+    if (!ok) {
+      throw RecordIndexProblem(
+        ERS_HERE, "writing the dataset of", m_file_name, std::string(operation) + " failed for " + hdf5_file_name);
+    }
+  };
+
+  // an HDF5 file that is already open elsewhere in this process is shared with that open
+  HDF5Object file(H5Fopen(hdf5_file_name.c_str(), H5F_ACC_RDWR, H5P_DEFAULT), H5Fclose);
+  check(file.get() >= 0, "H5Fopen");
+
+  HDF5Object path_type(H5Tcopy(H5T_C_S1), H5Tclose);
+  check(path_type.get() >= 0, "H5Tcopy");
+  check(H5Tset_size(path_type.get(), recordindex::s_max_group_path_length) >= 0, "H5Tset_size");
+  check(H5Tset_strpad(path_type.get(), H5T_STR_NULLTERM) >= 0, "H5Tset_strpad");
+
+  HDF5Object entry_type(H5Tcreate(H5T_COMPOUND, sizeof(recordindex::Entry)), H5Tclose);
+  check(entry_type.get() >= 0, "H5Tcreate");
+  using recordindex::Entry;
+  check(H5Tinsert(entry_type.get(), "record_number", HOFFSET(Entry, record_number), H5T_NATIVE_UINT64) >= 0 &&
+          H5Tinsert(entry_type.get(), "sequence_number", HOFFSET(Entry, sequence_number), H5T_NATIVE_UINT32) >= 0 &&
+          H5Tinsert(entry_type.get(), "record_type", HOFFSET(Entry, record_type), H5T_NATIVE_UINT32) >= 0 &&
+          H5Tinsert(entry_type.get(), "timestamp", HOFFSET(Entry, timestamp), H5T_NATIVE_UINT64) >= 0 &&
+          H5Tinsert(entry_type.get(), "trigger_type", HOFFSET(Entry, trigger_type), H5T_NATIVE_UINT64) >= 0 &&
+          H5Tinsert(entry_type.get(), "size_bytes", HOFFSET(Entry, size_bytes), H5T_NATIVE_UINT64) >= 0 &&
+          H5Tinsert(entry_type.get(), "group_path", HOFFSET(Entry, group_path), path_type.get()) >= 0,
+        "H5Tinsert");
+
+  hsize_t dims[1] = { m_entries.size() };
+  HDF5Object space(H5Screate_simple(1, dims, nullptr), H5Sclose);
+  check(space.get() >= 0, "H5Screate_simple");
+
+  HDF5Object dataset(
+    H5Dcreate2(
+      file.get(), recordindex::s_dataset_name, entry_type.get(), space.get(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT),
+    H5Dclose);
+  check(dataset.get() >= 0, "H5Dcreate2");
+  if (!m_entries.empty()) {
+    check(H5Dwrite(dataset.get(), entry_type.get(), H5S_ALL, H5S_ALL, H5P_DEFAULT, m_entries.data()) >= 0,
+          "H5Dwrite");
+  }
+  TLOG_DEBUG(TLVL_BASIC) << "Wrote " << m_entries.size() << " record index entries to " << hdf5_file_name;
+}
+
+void
+RecordIndexWriter::close()
+{
+  if (m_fd >= 0) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+}
+
+RecordIndexReader::RecordIndexReader(const std::string& file_name)
+  : m_file_name(file_name)
+{
+  std::ifstream stream(m_file_name, std::ios::binary);
+  if (!stream.is_open()) {
+    throw RecordIndexProblem(ERS_HERE, "opening", m_file_name, std::strerror(errno));
+  }
+  if (!stream.read(reinterpret_cast<char*>(&m_file_header), sizeof(m_file_header))) {
+    throw RecordIndexProblem(ERS_HERE, "reading the header of", m_file_name, "the file is too short");
+  }
+  if (m_file_header.marker != recordindex::s_file_header_marker) {
+    throw RecordIndexProblem(ERS_HERE, "reading the header of", m_file_name, "the file marker is invalid");
+  }
+  if (m_file_header.version != recordindex::s_current_version ||
+      m_file_header.entry_size != sizeof(recordindex::Entry)) {
+    throw RecordIndexProblem(ERS_HERE,
+                             "reading the header of",
+                             m_file_name,
+                             "unsupported version " + std::to_string(m_file_header.version) + " or entry size " +
+                               std::to_string(m_file_header.entry_size));
+  }
+  stream.seekg(m_file_header.header_size);
+
+  recordindex::Entry entry;
+  while (stream.read(reinterpret_cast<char*>(&entry), sizeof(entry))) {
+    m_entry_lookup[std::make_pair(entry.record_number, entry.sequence_number)] = m_entries.size();
+    m_entries.push_back(entry);
+  }
+}
+
+const recordindex::Entry*
+RecordIndexReader::find_entry(uint64_t record_number, uint32_t sequence_number) const // NOLINT(build/unsigned)
+{
+  auto iter = m_entry_lookup.find(std::make_pair(record_number, sequence_number));
+  if (iter == m_entry_lookup.end()) {
+    return nullptr;
+  }
+  return &m_entries[iter->second];
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
@@ -0,0 +1,327 @@
+/**
+ * @file SharedMemoryRing.cpp SharedMemoryRing Class Implementation
+ *
+ * The SharedMemoryRing class is a single-producer, single-consumer queue of messages
+ * in a shared memory region that is shared with a child process.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/SharedMemoryRing.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <linux/futex.h>
+#include <memory>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "SharedMemoryRing" // NOLINT
+enum
+{
+  TLVL_BASIC = 2
+};
+
+namespace dunedaq {
+namespace dfmodules {
+
+namespace {
+
+constexpr uint64_t s_magic = 0x44464d5348524e47; // NOLINT(build/unsigned) "DFMSHRNG"
+constexpr size_t s_message_alignment = 16;
+constexpr size_t s_page_size = 4096;
+constexpr uint32_t s_padding_type = 0xffffffff; // NOLINT(build/unsigned) fills the end of the data area
+
+// the waits are bounded, so that a closed ring or a vanished peer is noticed
+constexpr std::chrono::milliseconds s_max_wait_time(10);
+
+size_t
+round_up(size_t value, size_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+/**
+ * @brief The control block at the start of the region.  The positions count the bytes
+ * that have been written and read since the ring was created; the sequence numbers are
+ * futex words that are incremented whenever the positions move.
+ */
+struct SharedMemoryRing::Header
+{
+  uint64_t magic;    // NOLINT(build/unsigned)
+  uint64_t capacity; // NOLINT(build/unsigned)
+  alignas(64) std::atomic<uint64_t> write_position;  // NOLINT(build/unsigned)
+  std::atomic<uint32_t> data_sequence;               // NOLINT(build/unsigned)
+  alignas(64) std::atomic<uint64_t> read_position;   // NOLINT(build/unsigned)
+  std::atomic<uint32_t> space_sequence;              // NOLINT(build/unsigned)
+  alignas(64) std::atomic<uint32_t> closed;          // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief Precedes each message in the data area
+ */
+struct SharedMemoryRing::MessageHeader
+{
+  uint32_t type;     // NOLINT(build/unsigned)
+  uint32_t reserved; // NOLINT(build/unsigned)
+  uint64_t size;     // NOLINT(build/unsigned) of the payload
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, // NOLINT(build/unsigned)
+              "The shared memory ring needs lock-free 64-bit atomics");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, // NOLINT(build/unsigned)
+              "The shared memory ring needs lock-free 32-bit atomics");
+
+SharedMemoryRing::SharedMemoryRing(const std::string& name, size_t capacity_bytes)
+  : NamedObject(name)
+  , m_fd(-1)
+  , m_capacity(round_up(std::max(capacity_bytes, s_page_size), s_page_size))
+  , m_region_size(0)
+  , m_header(nullptr)
+  , m_data(nullptr)
+  , m_peeked_size(0)
+{
+  // the file descriptor is deliberately inheritable, since the child process attaches to it
+  m_fd = static_cast<int>(syscall(SYS_memfd_create, name.c_str(), 0));
+  if (m_fd < 0) {
+    throw SharedMemoryRingProblem(
+      ERS_HERE, "creating", get_name(), std::string("memfd_create failed: ") + std::strerror(errno));
+  }
+  size_t region_size = round_up(sizeof(Header), s_page_size) + m_capacity;
+  if (ftruncate(m_fd, static_cast<off_t>(region_size)) != 0) {
+    int error_number = errno;
+    ::close(m_fd);
+    throw SharedMemoryRingProblem(
+      ERS_HERE, "creating", get_name(), std::string("ftruncate failed: ") + std::strerror(error_number));
+  }
+  map_region(region_size);
+
+  // the region of a new memory file is zero-filled, which initializes the atomics
+  m_header->magic = s_magic;
+  m_header->capacity = m_capacity;
+  TLOG_DEBUG(TLVL_BASIC) << get_name() << ": Created a shared memory ring of " << m_capacity << " bytes";
+}
+
+std::unique_ptr<SharedMemoryRing>
+SharedMemoryRing::attach(const std::string& name, int fd)
+{
+  return std::unique_ptr<SharedMemoryRing>(new SharedMemoryRing(name, fd, AttachTag()));
+}
+
+SharedMemoryRing::SharedMemoryRing(const std::string& name, int fd, AttachTag)
+  : NamedObject(name)
+  , m_fd(fd)
+  , m_capacity(0)
+  , m_region_size(0)
+  , m_header(nullptr)
+  , m_data(nullptr)
+  , m_peeked_size(0)
+{
+  struct stat file_status;
+  if (fstat(m_fd, &file_status) != 0) {
+    throw SharedMemoryRingProblem(
+      ERS_HERE, "attaching to", get_name(), std::string("fstat failed: ") + std::strerror(errno));
+  }
+  size_t region_size = static_cast<size_t>(file_status.st_size);
+  if (region_size <= round_up(sizeof(Header), s_page_size)) {
+    throw SharedMemoryRingProblem(ERS_HERE, "attaching to", get_name(), "the memory file is too small");
+  }
+  map_region(region_size);
+  if (m_header->magic != s_magic || m_header->capacity != region_size - round_up(sizeof(Header), s_page_size)) {
+    munmap(m_header, m_region_size);
+    throw SharedMemoryRingProblem(ERS_HERE, "attaching to", get_name(), "the memory file does not contain a ring");
+  }
+  m_capacity = m_header->capacity;
+}
+
+SharedMemoryRing::~SharedMemoryRing()
+{
+  munmap(m_header, m_region_size);
+  ::close(m_fd);
+}
+
+void
+SharedMemoryRing::map_region(size_t region_size)
+{
+  void* region = mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  if (region == MAP_FAILED) {
+    throw SharedMemoryRingProblem(
+      ERS_HERE, "mapping", get_name(), std::string("mmap failed: ") + std::strerror(errno));
+  }
+  m_region_size = region_size;
+  m_header = static_cast<Header*>(region);
+  m_data = static_cast<char*>(region) + round_up(sizeof(Header), s_page_size);
+}
+
+size_t
+SharedMemoryRing::get_message_size(size_t payload_size)
+{
+  return round_up(sizeof(MessageHeader) + payload_size, s_message_alignment);
+}
+
+bool
+SharedMemoryRing::write_message(uint32_t type, // NOLINT(build/unsigned)
+                                const std::vector<Part>& parts,
+                                std::chrono::milliseconds timeout)
+{
+  size_t payload_size = 0;
+  for (auto const& part : parts) {
+    payload_size += part.size;
+  }
+  size_t message_size = get_message_size(payload_size);
+  if (message_size > m_capacity) {
+    throw MessageTooLargeForSharedMemoryRing(ERS_HERE, message_size, get_name(), m_capacity);
+  }
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  // only this thread moves the write position
+  uint64_t write_position = m_header->write_position.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+  size_t offset = write_position % m_capacity;
+  if (offset + message_size > m_capacity) {
+    // the message does not fit before the end of the data area, so the rest of it is
+    // filled with a padding message (offsets are aligned, so there is room for its header),
+    // which is published on its own, since the reader needs to release it before the
+    // message fits at the start
+    size_t padding_size = m_capacity - offset;
+    if (!wait_for_space(padding_size, deadline)) {
+      return false;
+    }
+    MessageHeader padding_header{ s_padding_type, 0, padding_size - sizeof(MessageHeader) };
+    std::memcpy(m_data + offset, &padding_header, sizeof(padding_header));
+    write_position += padding_size;
+    m_header->write_position.store(write_position, std::memory_order_release);
+    notify(m_header->data_sequence);
+    offset = 0;
+  }
+  if (!wait_for_space(message_size, deadline)) {
+    return false;
+  }
+
+  MessageHeader message_header{ type, 0, payload_size };
+  std::memcpy(m_data + offset, &message_header, sizeof(message_header));
+  char* payload = m_data + offset + sizeof(message_header);
+  for (auto const& part : parts) {
+    std::memcpy(payload, part.data, part.size);
+    payload += part.size;
+  }
+  m_header->write_position.store(write_position + message_size, std::memory_order_release);
+  notify(m_header->data_sequence);
+  return true;
+}
+
+const char*
+SharedMemoryRing::peek_message(uint32_t& type, size_t& size, std::chrono::milliseconds timeout) // NOLINT
+{
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (true) {
+    uint32_t observed_sequence = m_header->data_sequence.load(std::memory_order_acquire); // NOLINT(build/unsigned)
+    // only this thread moves the read position
+    uint64_t read_position = m_header->read_position.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+    if (m_header->write_position.load(std::memory_order_acquire) != read_position) {
+      size_t offset = read_position % m_capacity;
+      MessageHeader message_header;
+      std::memcpy(&message_header, m_data + offset, sizeof(message_header));
+      m_peeked_size = get_message_size(message_header.size);
+      if (message_header.type == s_padding_type) {
+        consume_message();
+        continue;
+      }
+      type = message_header.type;
+      size = message_header.size;
+      return m_data + offset + sizeof(message_header);
+    }
+    if (is_closed() || std::chrono::steady_clock::now() >= deadline) {
+      return nullptr;
+    }
+    wait_for_change(m_header->data_sequence, observed_sequence, deadline);
+  }
+}
+
+void
+SharedMemoryRing::consume_message()
+{
+  uint64_t read_position = m_header->read_position.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+  m_header->read_position.store(read_position + m_peeked_size, std::memory_order_release);
+  m_peeked_size = 0;
+  notify(m_header->space_sequence);
+}
+
+void
+SharedMemoryRing::close()
+{
+  m_header->closed.store(1, std::memory_order_release);
+  notify(m_header->data_sequence);
+  notify(m_header->space_sequence);
+}
+
+bool
+SharedMemoryRing::is_closed() const
+{
+  return m_header->closed.load(std::memory_order_acquire) != 0;
+}
+
+size_t
+SharedMemoryRing::get_used_bytes() const
+{
+  return m_header->write_position.load(std::memory_order_acquire) -
+         m_header->read_position.load(std::memory_order_acquire);
+}
+
+bool
+SharedMemoryRing::wait_for_space(size_t size, std::chrono::steady_clock::time_point deadline)
+{
+  while (true) {
+    uint32_t observed_sequence = m_header->space_sequence.load(std::memory_order_acquire); // NOLINT(build/unsigned)
+    if (m_capacity - get_used_bytes() >= size) {
+      return true;
+    }
+    if (is_closed() || std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+    wait_for_change(m_header->space_sequence, observed_sequence, deadline);
+  }
+}
+
+void
+SharedMemoryRing::wait_for_change(std::atomic<uint32_t>& sequence, // NOLINT(build/unsigned)
+                                  uint32_t observed_value,          // NOLINT(build/unsigned)
+                                  std::chrono::steady_clock::time_point deadline)
+{
+  auto wait_time =
+    std::min(std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now()),
+             std::chrono::duration_cast<std::chrono::nanoseconds>(s_max_wait_time));
+  if (wait_time.count() <= 0) {
+    return;
+  }
+  struct timespec relative_timeout;
+  relative_timeout.tv_sec = static_cast<time_t>(wait_time.count() / 1000000000);
+  relative_timeout.tv_nsec = static_cast<long>(wait_time.count() % 1000000000); // NOLINT(runtime/int)
+  // the futex is shared with the other process, so the private variants can't be used;
+  // a spurious or interrupted wake-up just results in another check
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&sequence), FUTEX_WAIT, observed_value, &relative_timeout, nullptr, 0);
+}
+
+void
+SharedMemoryRing::notify(std::atomic<uint32_t>& sequence) // NOLINT(build/unsigned)
+{
+  sequence.fetch_add(1, std::memory_order_release);
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&sequence), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
@@ -0,0 +1,474 @@
+/**
+ * @file SliceStreamFile.cpp SliceStreamWriter and SliceStreamReader Class Implementations
+ *
+ * The SliceStreamWriter class appends TimeSlices to an HDF5 file in the appended
+ * TimeSlice layout, and the SliceStreamReader class reads them back.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/SliceStreamFile.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "SliceStreamFile" // NOLINT
+enum
+{
+  TLVL_BASIC = 2,
+  TLVL_SLICES = 15
+};
+
+namespace dunedaq {
+namespace dfmodules {
+
+namespace {
+
+/**
+ * @brief Number of entries in each chunk of the SliceIndex dataset
+ */
+constexpr size_t s_slice_index_chunk_entries = 1024;
+
+/**
+ * @brief Tag of the opaque type of the rows
+ */
+constexpr const char* s_row_type_tag = "TimeSlice Fragment row";
+
+/**
+ * @brief Closes an HDF5 object when it goes out of scope
+ */
+class HDF5Object
+{
+public:
+  HDF5Object(hid_t id, herr_t (*close_function)(hid_t))
+    : m_id(id)
+    , m_close_function(close_function)
+  {}
+  ~HDF5Object()
+  {
+    if (m_id >= 0) {
+      m_close_function(m_id);
+    }
+  }
+  HDF5Object(const HDF5Object&) = delete;
+  HDF5Object& operator=(const HDF5Object&) = delete;
+
+  hid_t get() const { return m_id; }
+
+private:
+  hid_t m_id;
+  herr_t (*m_close_function)(hid_t);
+};
+
+/**
+ * @brief Creates the in-memory compound type of the slicestream::SliceEntry
+ */
+hid_t
+create_entry_type()
+{
+  using slicestream::SliceEntry;
+  hid_t entry_type = H5Tcreate(H5T_COMPOUND, sizeof(SliceEntry));
+  if (entry_type < 0) {
+    return entry_type;
+  }
+  if (H5Tinsert(entry_type, "timeslice_number", HOFFSET(SliceEntry, timeslice_number), H5T_NATIVE_UINT64) < 0 ||
+      H5Tinsert(entry_type, "run_number", HOFFSET(SliceEntry, run_number), H5T_NATIVE_UINT32) < 0 ||
+      H5Tinsert(entry_type, "subsystem", HOFFSET(SliceEntry, subsystem), H5T_NATIVE_UINT32) < 0 ||
+      H5Tinsert(entry_type, "element_id", HOFFSET(SliceEntry, element_id), H5T_NATIVE_UINT32) < 0 ||
+      H5Tinsert(entry_type, "fragment_type", HOFFSET(SliceEntry, fragment_type), H5T_NATIVE_UINT32) < 0 ||
+      H5Tinsert(entry_type, "window_begin", HOFFSET(SliceEntry, window_begin), H5T_NATIVE_UINT64) < 0 ||
+      H5Tinsert(entry_type, "window_end", HOFFSET(SliceEntry, window_end), H5T_NATIVE_UINT64) < 0 ||
+      H5Tinsert(entry_type, "first_row", HOFFSET(SliceEntry, first_row), H5T_NATIVE_UINT64) < 0 ||
+      H5Tinsert(entry_type, "row_count", HOFFSET(SliceEntry, row_count), H5T_NATIVE_UINT64) < 0) {
+    H5Tclose(entry_type);
+    return -1;
+  }
+  return entry_type;
+}
+
+/**
+ * @brief Returns the number of rows of the specified one-dimensional dataset, or -1
+ */
+hssize_t
+get_number_of_rows(hid_t dataset_id)
+{
+  HDF5Object space(H5Dget_space(dataset_id), H5Sclose);
+  return space.get() >= 0 ? H5Sget_simple_extent_npoints(space.get()) : -1;
+}
+
+} // namespace
+
+SliceStreamWriter::SliceStreamWriter(const std::string& hdf5_file_name, size_t row_size, size_t chunk_size_bytes)
+  : m_file_name(hdf5_file_name)
+  , m_row_size(row_size)
+  , m_chunk_rows(std::max(chunk_size_bytes / std::max(row_size, static_cast<size_t>(1)), static_cast<size_t>(1)))
+  , m_file_id(-1)
+  , m_group_id(-1)
+  , m_row_type(-1)
+  , m_entry_type(-1)
+  , m_slice_index_id(-1)
+  , m_slice_index_rows(0)
+  , m_recorded_size(0)
+{
+  if (m_row_size == 0) {
+    throw SliceStreamProblem(ERS_HERE, "opening", m_file_name, "the row size is zero");
+  }
+
+  // an HDF5 file that is already open elsewhere in this process is shared with that open
+  m_file_id = H5Fopen(m_file_name.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+  if (m_file_id < 0) {
+    throw SliceStreamProblem(ERS_HERE, "opening", m_file_name, "H5Fopen failed");
+  }
+
+  std::string problem;
+  if (H5Lexists(m_file_id, slicestream::s_group_name, H5P_DEFAULT) > 0) {
+    // TimeSlices are appended to the ones that are already in the file
+    m_group_id = H5Gopen2(m_file_id, slicestream::s_group_name, H5P_DEFAULT);
+    uint64_t existing_row_size = 0; // NOLINT(build/unsigned)
+    HDF5Object attribute(H5Aopen(m_group_id, slicestream::s_row_size_attribute_name, H5P_DEFAULT), H5Aclose);
+    if (attribute.get() < 0 || H5Aread(attribute.get(), H5T_NATIVE_UINT64, &existing_row_size) < 0 ||
+        existing_row_size != m_row_size) {
+      problem = "the rows that are already in the file have a different size";
+    }
+  } else {
+    m_group_id = H5Gcreate2(m_file_id, slicestream::s_group_name, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    uint64_t row_size_value = m_row_size; // NOLINT(build/unsigned)
+    HDF5Object space(H5Screate(H5S_SCALAR), H5Sclose);
+    HDF5Object attribute(
+      H5Acreate2(
+        m_group_id, slicestream::s_row_size_attribute_name, H5T_STD_U64LE, space.get(), H5P_DEFAULT, H5P_DEFAULT),
+      H5Aclose);
+    if (m_group_id < 0 || attribute.get() < 0 || H5Awrite(attribute.get(), H5T_NATIVE_UINT64, &row_size_value) < 0) {
+      problem = "the " + std::string(slicestream::s_group_name) + " group could not be created";
+    }
+  }
+  if (problem.empty()) {
+    m_row_type = H5Tcreate(H5T_OPAQUE, m_row_size);
+    m_entry_type = create_entry_type();
+    if (m_row_type < 0 || H5Tset_tag(m_row_type, s_row_type_tag) < 0 || m_entry_type < 0) {
+      problem = "the HDF5 types could not be created";
+    }
+  }
+  if (!problem.empty()) {
+    if (m_entry_type >= 0) {
+      H5Tclose(m_entry_type);
+    }
+    if (m_row_type >= 0) {
+      H5Tclose(m_row_type);
+    }
+    if (m_group_id >= 0) {
+      H5Gclose(m_group_id);
+    }
+    H5Fclose(m_file_id);
+    throw SliceStreamProblem(ERS_HERE, "opening", m_file_name, problem);
+  }
+
+  try {
+    std::tie(m_slice_index_id, m_slice_index_rows) =
+      open_or_create_dataset(slicestream::s_slice_index_dataset_name, m_entry_type, s_slice_index_chunk_entries);
+  } catch (...) { // NOLINT(runtime/exceptions)
+    H5Tclose(m_entry_type);
+    H5Tclose(m_row_type);
+    H5Gclose(m_group_id);
+    H5Fclose(m_file_id);
+    // NOLINT here because we *ARE* re-throwing the exception!
+    throw;
+  }
+  TLOG_DEBUG(TLVL_BASIC) << "Opened file " << m_file_name << " for appending TimeSlices with " << m_row_size
+                         << "-byte rows";
+}
+
+SliceStreamWriter::~SliceStreamWriter()
+{
+  for (auto const& [source, row_dataset] : m_row_datasets) {
+    H5Dclose(row_dataset.id);
+  }
+  H5Dclose(m_slice_index_id);
+  H5Tclose(m_entry_type);
+  H5Tclose(m_row_type);
+  H5Gclose(m_group_id);
+  H5Fclose(m_file_id);
+}
+
+void
+SliceStreamWriter::write(const daqdataformats::TimeSlice& ts)
+{
+  auto const& tsh = ts.get_header();
+  auto const& fragments = ts.get_fragments_ref();
+
+  // all of the Fragments are checked before anything is written
+  for (auto const& frag_ptr : fragments) {
+    size_t payload_size = frag_ptr->get_size() - sizeof(daqdataformats::FragmentHeader);
+    if (payload_size % m_row_size != 0) {
+      daqdataformats::FragmentHeader frag_header = frag_ptr->get_header();
+      throw SliceStreamProblem(ERS_HERE,
+                               "writing",
+                               m_file_name,
+                               "the payload of the Fragment from SourceID " +
+                                 std::to_string(static_cast<uint32_t>(frag_header.element_id.subsystem)) + // NOLINT
+                                 "_" + std::to_string(frag_header.element_id.id) + " of TimeSlice " +
+                                 std::to_string(tsh.timeslice_number) + " is not a whole number of " +
+                                 std::to_string(m_row_size) + "-byte rows");
+    }
+  }
+
+  std::vector<slicestream::SliceEntry> entries;
+  entries.reserve(fragments.size());
+  for (auto const& frag_ptr : fragments) {
+    daqdataformats::FragmentHeader frag_header = frag_ptr->get_header();
+    slicestream::SliceEntry entry;
+    entry.timeslice_number = tsh.timeslice_number;
+    entry.run_number = tsh.run_number;
+    entry.subsystem = static_cast<uint32_t>(frag_header.element_id.subsystem); // NOLINT(build/unsigned)
+    entry.element_id = frag_header.element_id.id;
+    entry.fragment_type = frag_header.fragment_type;
+    entry.window_begin = frag_header.window_begin;
+    entry.window_end = frag_header.window_end;
+
+    auto source = std::make_pair(entry.subsystem, entry.element_id);
+    auto iter = m_row_datasets.find(source);
+    if (iter == m_row_datasets.end()) {
+      auto [dataset_id, rows] = open_or_create_dataset(
+        slicestream::get_row_dataset_name(entry.subsystem, entry.element_id), m_row_type, m_chunk_rows);
+      iter = m_row_datasets.emplace(source, RowDataset{ dataset_id, rows }).first;
+    }
+
+    size_t payload_size = frag_ptr->get_size() - sizeof(daqdataformats::FragmentHeader);
+    entry.first_row = iter->second.rows;
+    entry.row_count = payload_size / m_row_size;
+    if (entry.row_count > 0) {
+      append(iter->second.id,
+             m_row_type,
+             entry.first_row,
+             entry.row_count,
+             static_cast<const char*>(frag_ptr->get_storage_location()) + sizeof(daqdataformats::FragmentHeader));
+      iter->second.rows += entry.row_count;
+      m_recorded_size += payload_size;
+    }
+    entries.push_back(entry);
+  }
+
+  if (!entries.empty()) {
+    append(m_slice_index_id, m_entry_type, m_slice_index_rows, entries.size(), entries.data());
+    m_slice_index_rows += entries.size();
+    m_recorded_size += entries.size() * sizeof(slicestream::SliceEntry);
+  }
+  TLOG_DEBUG(TLVL_SLICES) << "Appended TimeSlice " << tsh.timeslice_number << " with " << fragments.size()
+                          << " fragments to file " << m_file_name;
+}
+
+std::pair<hid_t, uint64_t> // NOLINT(build/unsigned)
+SliceStreamWriter::open_or_create_dataset(const std::string& dataset_name, hid_t type_id, size_t chunk_rows)
+{
+  // a chunk stays in the chunk cache until it is full, so that it is written to disk with a single write
+  HDF5Object dapl(H5Pcreate(H5P_DATASET_ACCESS), H5Pclose);
+  bool ok = dapl.get() >= 0 &&
+            H5Pset_chunk_cache(dapl.get(), H5D_CHUNK_CACHE_NSLOTS_DEFAULT, chunk_rows * H5Tget_size(type_id), 1.0) >= 0;
+
+  hid_t dataset_id = -1;
+  if (ok && H5Lexists(m_group_id, dataset_name.c_str(), H5P_DEFAULT) > 0) {
+    dataset_id = H5Dopen2(m_group_id, dataset_name.c_str(), dapl.get());
+  } else if (ok) {
+    hsize_t dims[1] = { 0 };
+    hsize_t max_dims[1] = { H5S_UNLIMITED };
+    hsize_t chunk_dims[1] = { chunk_rows };
+    HDF5Object space(H5Screate_simple(1, dims, max_dims), H5Sclose);
+    HDF5Object dcpl(H5Pcreate(H5P_DATASET_CREATE), H5Pclose);
+    if (space.get() >= 0 && dcpl.get() >= 0 && H5Pset_chunk(dcpl.get(), 1, chunk_dims) >= 0) {
+      dataset_id = H5Dcreate2(
+        m_group_id, dataset_name.c_str(), type_id, space.get(), H5P_DEFAULT, dcpl.get(), dapl.get());
+    }
+  }
+  hssize_t rows = dataset_id >= 0 ? get_number_of_rows(dataset_id) : -1;
+  if (rows < 0) {
+    if (dataset_id >= 0) {
+      H5Dclose(dataset_id);
+    }
+    throw SliceStreamProblem(ERS_HERE, "opening", m_file_name, "dataset " + dataset_name + " could not be opened");
+  }
+  return std::make_pair(dataset_id, static_cast<uint64_t>(rows)); // NOLINT(build/unsigned)
+}
+
+void
+SliceStreamWriter::append(hid_t dataset_id,
+                          hid_t type_id,
+                          uint64_t first_row, // NOLINT(build/unsigned)
+                          uint64_t row_count, // NOLINT(build/unsigned)
+                          const void* data)
+{
+  hsize_t new_size[1] = { first_row + row_count };
+  hsize_t start[1] = { first_row };
+  hsize_t count[1] = { row_count };
+  bool ok = H5Dset_extent(dataset_id, new_size) >= 0;
+  HDF5Object file_space(ok ? H5Dget_space(dataset_id) : -1, H5Sclose);
+  HDF5Object memory_space(H5Screate_simple(1, count, nullptr), H5Sclose);
+  ok = ok && file_space.get() >= 0 && memory_space.get() >= 0 &&
+       H5Sselect_hyperslab(file_space.get(), H5S_SELECT_SET, start, nullptr, count, nullptr) >= 0 &&
+       H5Dwrite(dataset_id, type_id, memory_space.get(), file_space.get(), H5P_DEFAULT, data) >= 0;
+  if (!ok) {
+    throw SliceStreamProblem(ERS_HERE,
+                             "writing",
+                             m_file_name,
+                             "appending " + std::to_string(row_count) + " rows at row " + std::to_string(first_row) +
+                               " failed");
+  }
+}
+
+SliceStreamReader::SliceStreamReader(const std::string& hdf5_file_name)
+  : m_file_name(hdf5_file_name)
+  , m_file_id(-1)
+  , m_group_id(-1)
+  , m_row_size(0)
+{
+  m_file_id = H5Fopen(m_file_name.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  if (m_file_id < 0) {
+    throw SliceStreamProblem(ERS_HERE, "opening", m_file_name, "H5Fopen failed");
+  }
+
+  std::string problem;
+  uint64_t row_size = 0; // NOLINT(build/unsigned)
+  if (H5Lexists(m_file_id, slicestream::s_group_name, H5P_DEFAULT) <= 0 ||
+      (m_group_id = H5Gopen2(m_file_id, slicestream::s_group_name, H5P_DEFAULT)) < 0) {
+    problem = "the file has no appended TimeSlices";
+  } else {
+    HDF5Object attribute(H5Aopen(m_group_id, slicestream::s_row_size_attribute_name, H5P_DEFAULT), H5Aclose);
+    if (attribute.get() < 0 || H5Aread(attribute.get(), H5T_NATIVE_UINT64, &row_size) < 0 || row_size == 0) {
+      problem = "the row size attribute could not be read";
+    }
+  }
+  m_row_size = row_size;
+
+  if (problem.empty()) {
+    HDF5Object entry_type(create_entry_type(), H5Tclose);
+    HDF5Object slice_index(H5Dopen2(m_group_id, slicestream::s_slice_index_dataset_name, H5P_DEFAULT), H5Dclose);
+    hssize_t number_of_entries = slice_index.get() >= 0 ? get_number_of_rows(slice_index.get()) : -1;
+    if (entry_type.get() < 0 || number_of_entries < 0) {
+      problem = "the SliceIndex dataset could not be opened";
+    } else if (number_of_entries > 0) {
+      m_slice_index.resize(static_cast<size_t>(number_of_entries));
+      if (H5Dread(slice_index.get(), entry_type.get(), H5S_ALL, H5S_ALL, H5P_DEFAULT, m_slice_index.data()) < 0) {
+        problem = "the SliceIndex dataset could not be read";
+      }
+    }
+  }
+
+  if (!problem.empty()) {
+    if (m_group_id >= 0) {
+      H5Gclose(m_group_id);
+    }
+    H5Fclose(m_file_id);
+    throw SliceStreamProblem(ERS_HERE, "opening", m_file_name, problem);
+  }
+  TLOG_DEBUG(TLVL_BASIC) << "Opened file " << m_file_name << " with " << m_slice_index.size()
+                         << " appended TimeSlice entries";
+}
+
+SliceStreamReader::~SliceStreamReader()
+{
+  H5Gclose(m_group_id);
+  H5Fclose(m_file_id);
+}
+
+std::vector<daqdataformats::SourceID>
+SliceStreamReader::get_source_ids() const
+{
+  std::vector<daqdataformats::SourceID> source_ids;
+  std::set<std::pair<uint32_t, uint32_t>> sources_seen; // NOLINT(build/unsigned)
+  for (auto const& entry : m_slice_index) {
+    if (sources_seen.insert(std::make_pair(entry.subsystem, entry.element_id)).second) {
+      source_ids.emplace_back(static_cast<daqdataformats::SourceID::Subsystem>(entry.subsystem), entry.element_id);
+    }
+  }
+  return source_ids;
+}
+
+std::vector<char>
+SliceStreamReader::read_rows(const daqdataformats::SourceID& source_id,
+                             uint64_t first_row, // NOLINT(build/unsigned)
+                             uint64_t row_count  // NOLINT(build/unsigned)
+) const
+{
+  std::vector<char> rows(row_count * m_row_size);
+  if (row_count == 0) {
+    return rows;
+  }
+
+  std::string dataset_name =
+    slicestream::get_row_dataset_name(static_cast<uint32_t>(source_id.subsystem), source_id.id); // NOLINT
+  HDF5Object dataset(H5Lexists(m_group_id, dataset_name.c_str(), H5P_DEFAULT) > 0
+                       ? H5Dopen2(m_group_id, dataset_name.c_str(), H5P_DEFAULT)
+                       : -1,
+                     H5Dclose);
+  hssize_t number_of_rows = dataset.get() >= 0 ? get_number_of_rows(dataset.get()) : -1;
+  if (number_of_rows < 0 || first_row + row_count > static_cast<uint64_t>(number_of_rows)) { // NOLINT(build/unsigned)
+    throw SliceStreamProblem(ERS_HERE,
+                             "reading",
+                             m_file_name,
+                             "rows " + std::to_string(first_row) + " to " + std::to_string(first_row + row_count) +
+                               " are not in dataset " + dataset_name);
+  }
+
+  hsize_t start[1] = { first_row };
+  hsize_t count[1] = { row_count };
+  HDF5Object row_type(H5Dget_type(dataset.get()), H5Tclose);
+  HDF5Object file_space(H5Dget_space(dataset.get()), H5Sclose);
+  HDF5Object memory_space(H5Screate_simple(1, count, nullptr), H5Sclose);
+  if (row_type.get() < 0 || file_space.get() < 0 || memory_space.get() < 0 ||
+      H5Sselect_hyperslab(file_space.get(), H5S_SELECT_SET, start, nullptr, count, nullptr) < 0 ||
+      H5Dread(dataset.get(), row_type.get(), memory_space.get(), file_space.get(), H5P_DEFAULT, rows.data()) < 0) {
+    throw SliceStreamProblem(ERS_HERE, "reading", m_file_name, "H5Dread failed for dataset " + dataset_name);
+  }
+  return rows;
+}
+
+std::vector<char>
+SliceStreamReader::read_time_slice_rows(uint64_t timeslice_number, // NOLINT(build/unsigned)
+                                        const daqdataformats::SourceID& source_id) const
+{
+  for (auto const& entry : m_slice_index) {
+    if (entry.timeslice_number == timeslice_number &&
+        entry.subsystem == static_cast<uint32_t>(source_id.subsystem) && // NOLINT(build/unsigned)
+        entry.element_id == source_id.id) {
+      return read_rows(source_id, entry.first_row, entry.row_count);
+    }
+  }
+  return std::vector<char>();
+}
+
+std::vector<char>
+SliceStreamReader::read_time_range_rows(const daqdataformats::SourceID& source_id,
+                                        uint64_t begin, // NOLINT(build/unsigned)
+                                        uint64_t end    // NOLINT(build/unsigned)
+) const
+{
+  // the rows of a SourceID are appended in the order of its TimeSlices, so the rows of
+  // the overlapping TimeSlices are one range
+  uint64_t first_row = std::numeric_limits<uint64_t>::max(); // NOLINT(build/unsigned)
+  uint64_t end_row = 0;                                      // NOLINT(build/unsigned)
+  for (auto const& entry : m_slice_index) {
+    if (entry.subsystem == static_cast<uint32_t>(source_id.subsystem) && // NOLINT(build/unsigned)
+        entry.element_id == source_id.id && entry.window_begin < end && entry.window_end > begin &&
+        entry.row_count > 0) {
+      first_row = std::min(first_row, entry.first_row);
+      end_row = std::max(end_row, entry.first_row + entry.row_count);
+    }
+  }
+  if (end_row == 0) {
+    return std::vector<char>();
+  }
+  return read_rows(source_id, first_row, end_row - first_row);
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
@@ -0,0 +1,301 @@
+/**
+ * @file StagedFileMover.cpp StagedFileMover Class Implementation
+ *
+ * The StagedFileMover class moves closed files from a staging directory to a
+ * bulk destination directory on a background thread.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/StagedFileMover.hpp"
+#include "dfmodules/stagedfilemoverinfo/InfoNljs.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "StagedFileMover" // NOLINT
+enum
+{
+  TLVL_BASIC = 2,
+  TLVL_FILE = 10
+};
+
+namespace dunedaq {
+namespace dfmodules {
+
+StagedFileMover::StagedFileMover(const std::string& parent_name, const Policy& policy)
+  : NamedObject(parent_name + "::StagedFileMover")
+  , m_policy(policy)
+  , m_move_in_progress(false)
+  , m_stop_requested(false)
+{
+  m_policy.copy_chunk_size = std::max(m_policy.copy_chunk_size, static_cast<size_t>(4096));
+  m_move_thread = std::thread(&StagedFileMover::do_moves, this);
+}
+
+StagedFileMover::~StagedFileMover()
+{
+  {
+    std::lock_guard<std::mutex> lk(m_queue_mutex);
+    m_stop_requested = true;
+    if (!m_queue.empty()) {
+      TLOG_DEBUG(TLVL_BASIC) << get_name() << ": moving the " << m_queue.size()
+                             << " files that are still queued before stopping";
+    }
+  }
+  m_queue_cv.notify_all();
+  m_move_thread.join();
+}
+
+void
+StagedFileMover::add_file(const std::string& file_name)
+{
+  {
+    std::lock_guard<std::mutex> lk(m_queue_mutex);
+    m_queue.push_back(file_name);
+  }
+  m_queue_cv.notify_all();
+}
+
+void
+StagedFileMover::wait_until_idle()
+{
+  std::unique_lock<std::mutex> lk(m_queue_mutex);
+  m_idle_cv.wait(lk, [&] { return m_queue.empty() && !m_move_in_progress; });
+}
+
+std::string
+StagedFileMover::get_destination_name(const std::string& file_name) const
+{
+  return (std::filesystem::path(m_policy.destination_directory) / std::filesystem::path(file_name).filename()).string();
+}
+
+size_t
+StagedFileMover::get_number_of_queued_files() const
+{
+  std::lock_guard<std::mutex> lk(m_queue_mutex);
+  return m_queue.size() + (m_move_in_progress ? 1 : 0);
+}
+
+void
+StagedFileMover::get_info(opmonlib::InfoCollector& ci, int /*level*/)
+{
+  stagedfilemoverinfo::Info info;
+  info.queued_files = get_number_of_queued_files();
+  info.files_moved = m_files_moved.exchange(0);
+  info.bytes_moved = m_bytes_moved.exchange(0);
+  info.failed_moves = m_failed_moves.exchange(0);
+  info.staging_disk_usage = m_staging_disk_usage.load();
+  info.above_high_water_mark = m_above_high_water_mark.load();
+  ci.add(info);
+}
+
+void
+StagedFileMover::do_moves()
+{
+  std::unique_lock<std::mutex> lk(m_queue_mutex);
+  while (true) {
+    m_queue_cv.wait(lk, [&] { return m_stop_requested || !m_queue.empty(); });
+    if (m_queue.empty()) {
+      // stop was requested, and everything has been moved
+      break;
+    }
+    std::string file_name = m_queue.front();
+    m_queue.pop_front();
+    m_move_in_progress = true;
+    lk.unlock();
+
+    auto move_start_time = std::chrono::steady_clock::now();
+    if (move_file(file_name)) {
+      m_move_latency.record(std::chrono::steady_clock::now() - move_start_time);
+      ++m_files_moved;
+    } else {
+      ++m_failed_moves;
+    }
+
+    lk.lock();
+    m_move_in_progress = false;
+    if (m_queue.empty()) {
+      m_idle_cv.notify_all();
+    }
+  }
+}
+
+bool
+StagedFileMover::move_file(const std::string& file_name)
+{
+  std::string destination_name = get_destination_name(file_name);
+  std::string in_progress_name = destination_name + s_in_progress_suffix;
+  std::string staging_directory = std::filesystem::path(file_name).parent_path().string();
+  if (staging_directory.empty()) {
+    staging_directory = ".";
+  }
+
+  int in_fd = ::open(file_name.c_str(), O_RDONLY);
+  if (in_fd < 0) {
+    ers::error(StagedFileMoveProblem(ERS_HERE,
+                                     file_name,
+                                     m_policy.destination_directory,
+                                     std::string("the file could not be opened: ") + std::strerror(errno)));
+    return false;
+  }
+  struct stat in_stat;
+  if (::fstat(in_fd, &in_stat) != 0) {
+    int error_number = errno;
+    ::close(in_fd);
+    ers::error(StagedFileMoveProblem(ERS_HERE,
+                                     file_name,
+                                     m_policy.destination_directory,
+                                     std::string("fstat failed: ") + std::strerror(error_number)));
+    return false;
+  }
+  int out_fd = ::open(in_progress_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (out_fd < 0) {
+    int error_number = errno;
+    ::close(in_fd);
+    ers::error(StagedFileMoveProblem(ERS_HERE,
+                                     file_name,
+                                     m_policy.destination_directory,
+                                     "the copy " + in_progress_name +
+                                       " could not be created: " + std::strerror(error_number)));
+    return false;
+  }
+  is_above_high_water_mark(staging_directory);
+  TLOG_DEBUG(TLVL_FILE) << get_name() << ": moving " << file_name << " (" << in_stat.st_size << " bytes) to "
+                        << destination_name;
+
+  size_t size = static_cast<size_t>(in_stat.st_size);
+  std::string problem = copy_contents(in_fd, out_fd, size, staging_directory);
+  if (problem.empty() && ::fdatasync(out_fd) != 0) {
+    problem = std::string("fdatasync of the copy failed: ") + std::strerror(errno);
+  }
+  struct stat out_stat;
+  if (problem.empty() && ::fstat(out_fd, &out_stat) != 0) {
+    problem = std::string("fstat of the copy failed: ") + std::strerror(errno);
+  }
+  if (problem.empty() && static_cast<size_t>(out_stat.st_size) != size) {
+    problem = "the copy has " + std::to_string(out_stat.st_size) + " bytes instead of " + std::to_string(size);
+  }
+  ::close(out_fd);
+  ::close(in_fd);
+
+  if (problem.empty() && std::rename(in_progress_name.c_str(), destination_name.c_str()) != 0) {
+    problem = "the copy could not be renamed to " + destination_name + ": " + std::strerror(errno);
+  }
+  if (!problem.empty()) {
+    std::remove(in_progress_name.c_str());
+    ers::error(StagedFileMoveProblem(ERS_HERE, file_name, m_policy.destination_directory, problem));
+    return false;
+  }
+
+  // the rename is made durable before the staged file is deleted
+  int dir_fd = ::open(m_policy.destination_directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (dir_fd >= 0) {
+    ::fsync(dir_fd);
+    ::close(dir_fd);
+  }
+  if (std::remove(file_name.c_str()) != 0) {
+    ers::warning(StagedFileMoveProblem(ERS_HERE,
+                                       file_name,
+                                       m_policy.destination_directory,
+                                       std::string("the file was copied, but it could not be deleted: ") +
+                                         std::strerror(errno)));
+  }
+  m_bytes_moved += size;
+  return true;
+}
+
+std::string
+StagedFileMover::copy_contents(int in_fd, int out_fd, size_t size, const std::string& staging_directory)
+{
+  auto copy_start_time = std::chrono::steady_clock::now();
+  bool use_copy_file_range = true;
+  loff_t in_offset = 0;
+  loff_t out_offset = 0;
+  size_t bytes_copied = 0;
+  while (bytes_copied < size) {
+    size_t chunk_size = std::min(m_policy.copy_chunk_size, size - bytes_copied);
+    ssize_t result = 0;
+    if (use_copy_file_range) {
+      result = ::copy_file_range(in_fd, &in_offset, out_fd, &out_offset, chunk_size, 0);
+      if (result < 0 && bytes_copied == 0 &&
+          (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+        // copy_file_range can't copy between these file systems
+        TLOG_DEBUG(TLVL_FILE) << get_name() << ": copy_file_range is not available (" << std::strerror(errno)
+                              << "), using sendfile";
+        use_copy_file_range = false;
+        continue;
+      }
+    } else {
+      off_t sendfile_offset = static_cast<off_t>(bytes_copied);
+      result = ::sendfile(out_fd, in_fd, &sendfile_offset, chunk_size);
+    }
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return std::string(use_copy_file_range ? "copy_file_range" : "sendfile") + " failed after " +
+             std::to_string(bytes_copied) + " bytes: " + std::strerror(errno);
+    }
+    if (result == 0) {
+      return "the file ended after " + std::to_string(bytes_copied) + " bytes";
+    }
+    bytes_copied += static_cast<size_t>(result);
+    limit_rate(bytes_copied, copy_start_time, staging_directory);
+  }
+  return "";
+}
+
+void
+StagedFileMover::limit_rate(size_t bytes_copied,
+                            std::chrono::steady_clock::time_point copy_start_time,
+                            const std::string& staging_directory)
+{
+  if (m_policy.max_bytes_per_second == 0 || is_above_high_water_mark(staging_directory)) {
+    return;
+  }
+  auto earliest_time =
+    copy_start_time + std::chrono::microseconds(static_cast<int64_t>(
+                        1.0e6 * static_cast<double>(bytes_copied) / static_cast<double>(m_policy.max_bytes_per_second)));
+  std::unique_lock<std::mutex> lk(m_queue_mutex);
+  m_queue_cv.wait_until(lk, earliest_time, [&] { return m_stop_requested; });
+}
+
+bool
+StagedFileMover::is_above_high_water_mark(const std::string& staging_directory)
+{
+  struct statvfs stat_buffer;
+  if (::statvfs(staging_directory.c_str(), &stat_buffer) != 0 || stat_buffer.f_blocks == 0) {
+    return m_above_high_water_mark.load();
+  }
+  double usage = 1.0 - static_cast<double>(stat_buffer.f_bavail) / static_cast<double>(stat_buffer.f_blocks);
+  bool above_high_water_mark = usage > m_policy.staging_high_water_mark;
+  m_staging_disk_usage.store(usage);
+  if (above_high_water_mark != m_above_high_water_mark.exchange(above_high_water_mark)) {
+    TLOG_DEBUG(TLVL_BASIC) << get_name() << ": the staging disk usage is " << usage << ", which is "
+                           << (above_high_water_mark ? "above" : "below")
+                           << " the high-water mark; the rate limit is "
+                           << (above_high_water_mark ? "suspended" : "applied again");
+  }
+  return above_high_water_mark;
+}
+
+} // namespace dfmodules
+} // namespace dunedaq
@@ -0,0 +1,130 @@
+/**
+ * @file SubprocessWriterProtocol.cpp Serialization of the records that the
+ * SubprocessDataStore sends to its writer process
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/SubprocessWriterProtocol.hpp"
+
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace dfmodules {
+namespace subprocesswriter {
+
+namespace {
+
+template<typename T>
+bool
+send_serialized_record(SharedMemoryRing& ring,
+                       MessageType type,
+                       RecordHeader record_header,
+                       const void* header,
+                       const T& record,
+                       std::chrono::milliseconds timeout)
+{
+  std::vector<SharedMemoryRing::Part> parts;
+  parts.reserve(record.get_fragments_ref().size() + 2);
+  record_header.number_of_fragments = record.get_fragments_ref().size();
+  parts.push_back({ &record_header, sizeof(record_header) });
+  parts.push_back({ header, record_header.header_size });
+  for (auto const& frag_ptr : record.get_fragments_ref()) {
+    parts.push_back({ frag_ptr->get_storage_location(), frag_ptr->get_size() });
+  }
+  return ring.write_message(static_cast<uint32_t>(type), parts, timeout); // NOLINT(build/unsigned)
+}
+
+template<typename T>
+size_t
+get_serialized_size(const T& record, size_t header_size)
+{
+  size_t payload_size = sizeof(RecordHeader) + header_size;
+  for (auto const& frag_ptr : record.get_fragments_ref()) {
+    payload_size += frag_ptr->get_size();
+  }
+  return SharedMemoryRing::get_message_size(payload_size);
+}
+
+template<typename T>
+void
+add_fragments(T& record, const RecordHeader& record_header, const char* payload)
+{
+  const char* frag_location = payload + sizeof(record_header) + record_header.header_size;
+  for (size_t idx = 0; idx < record_header.number_of_fragments; ++idx) {
+    auto frag_ptr = std::make_unique<daqdataformats::Fragment>(
+      const_cast<char*>(frag_location), daqdataformats::Fragment::BufferAdoptionMode::kCopyFromBuffer);
+    frag_location += frag_ptr->get_size();
+    record.add_fragment(std::move(frag_ptr));
+  }
+}
+
+} // namespace
+
+bool
+send_record(SharedMemoryRing& ring, const daqdataformats::TriggerRecord& tr, std::chrono::milliseconds timeout)
+{
+  auto const& trh = tr.get_header_ref();
+  RecordHeader record_header{};
+  record_header.record_number = trh.get_trigger_number();
+  record_header.run_number = trh.get_run_number();
+  record_header.sequence_number = trh.get_sequence_number();
+  record_header.header_size = trh.get_total_size_bytes();
+  return send_serialized_record(
+    ring, MessageType::kTriggerRecord, record_header, trh.get_storage_location(), tr, timeout);
+}
+
+bool
+send_record(SharedMemoryRing& ring, const daqdataformats::TimeSlice& ts, std::chrono::milliseconds timeout)
+{
+  daqdataformats::TimeSliceHeader tsh = ts.get_header();
+  RecordHeader record_header{};
+  record_header.record_number = tsh.timeslice_number;
+  record_header.run_number = tsh.run_number;
+  record_header.header_size = sizeof(tsh);
+  return send_serialized_record(ring, MessageType::kTimeSlice, record_header, &tsh, ts, timeout);
+}
+
+size_t
+get_message_size(const daqdataformats::TriggerRecord& tr)
+{
+  return get_serialized_size(tr, tr.get_header_ref().get_total_size_bytes());
+}
+
+size_t
+get_message_size(const daqdataformats::TimeSlice& ts)
+{
+  return get_serialized_size(ts, sizeof(daqdataformats::TimeSliceHeader));
+}
+
+std::unique_ptr<daqdataformats::TriggerRecord>
+make_trigger_record(const char* payload, size_t /*size*/)
+{
+  RecordHeader record_header;
+  std::memcpy(&record_header, payload, sizeof(record_header));
+  daqdataformats::TriggerRecordHeader trh(const_cast<char*>(payload + sizeof(record_header)), true);
+  auto tr_ptr = std::make_unique<daqdataformats::TriggerRecord>(trh);
+  add_fragments(*tr_ptr, record_header, payload);
+  return tr_ptr;
+}
+
+std::unique_ptr<daqdataformats::TimeSlice>
+make_time_slice(const char* payload, size_t /*size*/)
+{
+  RecordHeader record_header;
+  std::memcpy(&record_header, payload, sizeof(record_header));
+  daqdataformats::TimeSliceHeader tsh;
+  std::memcpy(&tsh, payload + sizeof(record_header), sizeof(tsh));
+  auto ts_ptr = std::make_unique<daqdataformats::TimeSlice>(tsh);
+  add_fragments(*ts_ptr, record_header, payload);
+  return ts_ptr;
+}
+
+} // namespace subprocesswriter
+} // namespace dfmodules
+} // namespace dunedaq
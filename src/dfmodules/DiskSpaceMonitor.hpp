@@ -0,0 +1,114 @@
+/**
+ * @file DiskSpaceMonitor.hpp DiskSpaceMonitor Class
+ *
+ * The DiskSpaceMonitor class keeps track of the free space on the disk that holds
+ * a given path.  It samples the file system with statvfs on its own thread and
+ * subtracts the bytes that have been written since the latest sample, so that
+ * writers can check the (predicted) free space without a system call.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_DISKSPACEMONITOR_HPP_
+#define DFMODULES_SRC_DFMODULES_DISKSPACEMONITOR_HPP_
+
+#include "opmonlib/InfoCollector.hpp"
+#include "utilities/NamedObject.hpp"
+#include "utilities/WorkerThread.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace dunedaq {
+namespace dfmodules {
+
+class DiskSpaceMonitor : public utilities::NamedObject
+{
+public:
+  /**
+   * @brief DiskSpaceMonitor Constructor.  An initial sample of the free space is
+   * taken here, so that the predicted free space is valid right away.
+   * @param parent_name Name of the object that owns this monitor
+   * @param path Path on the disk that is to be monitored
+   * @param sampling_interval Time between subsequent statvfs samples
+   */
+  DiskSpaceMonitor(const std::string& parent_name,
+                   const std::string& path,
+                   std::chrono::milliseconds sampling_interval);
+  ~DiskSpaceMonitor();
+
+  DiskSpaceMonitor(const DiskSpaceMonitor&) = delete;            ///< DiskSpaceMonitor is not copy-constructible
+  DiskSpaceMonitor& operator=(const DiskSpaceMonitor&) = delete; ///< DiskSpaceMonitor is not copy-assignable
+  DiskSpaceMonitor(DiskSpaceMonitor&&) = delete;                 ///< DiskSpaceMonitor is not move-constructible
+  DiskSpaceMonitor& operator=(DiskSpaceMonitor&&) = delete;      ///< DiskSpaceMonitor is not move-assignable
+
+  void start_monitoring();
+  void stop_monitoring();
+
+  /**
+   * @brief Samples the free space with statvfs right away.
+   * @return whether the statvfs call succeeded
+   */
+  bool sample();
+
+  /**
+   * @brief Informs the monitor that the specified number of bytes have been written
+   * to the disk since the latest sample.
+   */
+  void record_bytes_written(size_t bytes) { m_bytes_written_since_sample.fetch_add(bytes, std::memory_order_relaxed); }
+
+  /**
+   * @brief Returns the free space that was measured in the latest sample, minus
+   * the bytes that have been written since then.  No system call is made.
+   */
+  size_t get_predicted_free_space() const
+  {
+    size_t measured = m_measured_free_space.load(std::memory_order_relaxed);
+    size_t written = m_bytes_written_since_sample.load(std::memory_order_relaxed);
+    return (written < measured) ? (measured - written) : 0;
+  }
+
+  size_t get_measured_free_space() const { return m_measured_free_space.load(std::memory_order_relaxed); }
+  size_t get_total_space() const { return m_total_space.load(std::memory_order_relaxed); }
+  bool is_path_valid() const { return m_path_is_valid.load(std::memory_order_relaxed); }
+  const std::string& get_path() const { return m_path; }
+
+  /**
+   * @brief Returns the rate at which the free space has changed between the two
+   * latest samples, in bytes per second.  Positive values mean that the disk is filling up.
+   */
+  int64_t get_fill_rate() const { return m_fill_rate.load(std::memory_order_relaxed); }
+
+  void get_info(opmonlib::InfoCollector& ci, int level);
+
+private:
+  // Threading
+  dunedaq::utilities::WorkerThread m_thread;
+  void do_work(std::atomic<bool>&);
+
+  // Configuration
+  std::string m_path;
+  std::chrono::milliseconds m_sampling_interval;
+
+  // Internal data
+  std::atomic<size_t> m_measured_free_space{ 0 };
+  std::atomic<size_t> m_total_space{ 0 };
+  std::atomic<size_t> m_bytes_written_since_sample{ 0 };
+  std::atomic<int64_t> m_fill_rate{ 0 };
+  std::atomic<bool> m_path_is_valid{ false };
+  std::chrono::steady_clock::time_point m_last_sample_time;
+  std::mutex m_sample_mutex;
+
+  // Metrics
+  std::atomic<uint64_t> m_samples_taken{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_failed_samples{ 0 }; // NOLINT(build/unsigned)
+};
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_DISKSPACEMONITOR_HPP_
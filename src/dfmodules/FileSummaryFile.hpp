@@ -0,0 +1,91 @@
+/**
+ * @file FileSummaryFile.hpp FileSummaryWriter and FileSummaryReader Classes
+ *
+ * The FileSummaryWriter class collects one row of summary information per record
+ * that is written to an HDF5 file, and writes the columns into the file when it is
+ * closed (see FileSummaryFormat.hpp).  The FileSummaryReader class reads the
+ * columns back.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_FILESUMMARYFILE_HPP_
+#define DFMODULES_SRC_DFMODULES_FILESUMMARYFILE_HPP_
+
+#include "dfmodules/FileSummaryFormat.hpp"
+
+#include "daqdataformats/TimeSlice.hpp"
+#include "daqdataformats/TriggerRecord.hpp"
+
+#include <string>
+
+namespace dunedaq {
+namespace dfmodules {
+
+class FileSummaryWriter
+{
+public:
+  FileSummaryWriter() = default;
+
+  FileSummaryWriter(const FileSummaryWriter&) = delete;            ///< FileSummaryWriter is not copy-constructible
+  FileSummaryWriter& operator=(const FileSummaryWriter&) = delete; ///< FileSummaryWriter is not copy-assignable
+  FileSummaryWriter(FileSummaryWriter&&) = delete;                 ///< FileSummaryWriter is not move-constructible
+  FileSummaryWriter& operator=(FileSummaryWriter&&) = delete;      ///< FileSummaryWriter is not move-assignable
+
+  /**
+   * @brief Adds the row of a record that has been written
+   */
+  void add(const daqdataformats::TriggerRecord& tr);
+  void add(const daqdataformats::TimeSlice& ts);
+
+  /**
+   * @brief Writes the columns into the filesummary::s_group_name group at the top
+   * level of the specified HDF5 file, which may be open elsewhere in this process.
+   * The HDF5 mutex needs to be held by the caller.
+   */
+  void write_to_hdf5_file(const std::string& hdf5_file_name) const;
+
+  /**
+   * @brief Forgets the rows, for the next file
+   */
+  void clear() { m_columns = filesummary::Columns(); }
+
+  const filesummary::Columns& get_columns() const { return m_columns; }
+
+private:
+  filesummary::Columns m_columns;
+};
+
+class FileSummaryReader
+{
+public:
+  /**
+   * @brief FileSummaryReader Constructor.  All of the columns are read from the
+   * specified HDF5 file.  The HDF5 mutex needs to be held by the caller, if there is one.
+   */
+  explicit FileSummaryReader(const std::string& hdf5_file_name);
+
+  FileSummaryReader(const FileSummaryReader&) = delete;            ///< FileSummaryReader is not copy-constructible
+  FileSummaryReader& operator=(const FileSummaryReader&) = delete; ///< FileSummaryReader is not copy-assignable
+  FileSummaryReader(FileSummaryReader&&) = delete;                 ///< FileSummaryReader is not move-constructible
+  FileSummaryReader& operator=(FileSummaryReader&&) = delete;      ///< FileSummaryReader is not move-assignable
+
+  /**
+   * @brief Whether the specified HDF5 file has a file summary
+   */
+  static bool has_file_summary(const std::string& hdf5_file_name);
+
+  const filesummary::Columns& get_columns() const { return m_columns; }
+  const std::string& get_file_name() const { return m_file_name; }
+
+private:
+  std::string m_file_name;
+  filesummary::Columns m_columns;
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_FILESUMMARYFILE_HPP_
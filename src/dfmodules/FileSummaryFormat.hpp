@@ -0,0 +1,74 @@
+/**
+ * @file FileSummaryFormat.hpp
+ *
+ * This file contains the description of the file summary that the HDF5DataStore
+ * writes into each of its output files when the file is closed.  The summary is a
+ * group at the top level of the file with one one-dimensional dataset per column,
+ * and one row per record in the order in which the records were written, so that
+ * bookkeeping tools can summarize a file by reading a few small datasets instead of
+ * visiting all of the groups and datasets of the records.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_FILESUMMARYFORMAT_HPP_
+#define DFMODULES_SRC_DFMODULES_FILESUMMARYFORMAT_HPP_
+
+#include "ers/Issue.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+
+// Disable coverage checking LCOV_EXCL_START
+/**
+ * @brief An ERS Issue for problems with reading or writing file summaries
+ */
+ERS_DECLARE_ISSUE(dfmodules,
+                  FileSummaryProblem,
+                  "A problem was encountered when " << operation << " the summary of file \"" << file_name
+                                                    << "\": " << details,
+                  ((std::string)operation)((std::string)file_name)((std::string)details))
+// Re-enable coverage checking LCOV_EXCL_STOP
+
+namespace dfmodules {
+namespace filesummary {
+
+/**
+ * @brief Name of the group, at the top level of the HDF5 file, that holds the columns
+ */
+constexpr const char* s_group_name = "FileSummary";
+
+/**
+ * @brief Columns that are not larger than this are stored in the compact layout, in the object header
+ */
+constexpr size_t s_max_compact_column_size = 32768;
+
+/**
+ * @brief The columns of the summary, one element per record.  The dataset of each
+ * column has the name of the member.
+ */
+struct Columns
+{
+  std::vector<uint64_t> record_number;   // NOLINT(build/unsigned) trigger or timeslice number
+  std::vector<uint32_t> sequence_number; // NOLINT(build/unsigned)
+  std::vector<uint32_t> record_type;     // NOLINT(build/unsigned) a recordindex::RecordType value
+  std::vector<uint64_t> timestamp;       // NOLINT(build/unsigned) trigger timestamp, zero for TimeSlices
+  std::vector<uint64_t> trigger_type;    // NOLINT(build/unsigned) zero for TimeSlices
+  std::vector<uint32_t> fragment_count;  // NOLINT(build/unsigned)
+  std::vector<uint64_t> total_bytes;     // NOLINT(build/unsigned) header and Fragments, as they were written
+  std::vector<uint32_t> error_bits;      // NOLINT(build/unsigned) TriggerRecordErrorBits, zero for TimeSlices
+
+  size_t size() const { return record_number.size(); }
+};
+
+} // namespace filesummary
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_FILESUMMARYFORMAT_HPP_
@@ -0,0 +1,188 @@
+/**
+ * @file FragmentCompressor.hpp FragmentCompressor Class
+ *
+ * The FragmentCompressor class compresses the payloads of the Fragments in
+ * TriggerRecords and TimeSlices before they are written to disk.  The codec is
+ * chosen per Fragment, based on its FragmentType and the detector group type
+ * of its detector ID, and the Fragments of a data block are compressed in
+ * parallel on a pool of worker threads.
+ *
+ * A compressed Fragment keeps its FragmentHeader (with the size updated), and
+ * its payload starts with a CompressedPayloadHeader that identifies the codec
+ * and holds the size of the original payload.  decompress_fragment() restores
+ * the original Fragment.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_FRAGMENTCOMPRESSOR_HPP_
+#define DFMODULES_SRC_DFMODULES_FRAGMENTCOMPRESSOR_HPP_
+
+#include "daqdataformats/Fragment.hpp"
+#include "daqdataformats/TimeSlice.hpp"
+#include "daqdataformats/TriggerRecord.hpp"
+#include "opmonlib/InfoCollector.hpp"
+#include "utilities/NamedObject.hpp"
+
+#include "ers/Issue.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dunedaq {
+
+// Disable coverage checking LCOV_EXCL_START
+ERS_DECLARE_ISSUE(dfmodules,
+                  InvalidCompressionCodec,
+                  "The compression codec \"" << codec_name << "\" is not supported",
+                  ((std::string)codec_name))
+
+ERS_DECLARE_ISSUE(dfmodules,
+                  FragmentCompressionProblem,
+                  "A problem was encountered when " << operation << " a Fragment with the " << codec_name
+                                                    << " codec: " << details,
+                  ((std::string)operation)((std::string)codec_name)((std::string)details))
+// Re-enable coverage checking LCOV_EXCL_STOP
+
+namespace dfmodules {
+
+class FragmentCompressor : public utilities::NamedObject
+{
+public:
+  enum class Codec : uint16_t // NOLINT(build/unsigned)
+  {
+    kNone = 0,
+    kZlib = 1,
+    kBzip2 = 2
+  };
+
+  /**
+   * @brief The header at the start of the payload of a compressed Fragment
+   */
+  struct CompressedPayloadHeader
+  {
+    static constexpr uint32_t s_marker = 0x46504D43; // NOLINT(build/unsigned) "CMPF"
+
+    uint32_t marker = s_marker;                    // NOLINT(build/unsigned)
+    uint16_t codec = 0;                            // NOLINT(build/unsigned)
+    uint16_t unused = 0;                           // NOLINT(build/unsigned)
+    uint64_t uncompressed_payload_size_bytes = 0; // NOLINT(build/unsigned)
+  };
+
+  /**
+   * @brief A rule that selects the codec for Fragments.  Empty fragment_type and
+   * detector_group_type strings match any Fragment.
+   */
+  struct Rule
+  {
+    std::string fragment_type;
+    std::string detector_group_type;
+    Codec codec;
+    int level;
+  };
+
+  /**
+   * @brief FragmentCompressor Constructor
+   * @param parent_name Name of the object that owns this compressor
+   * @param rules Codec selection rules, the first rule that matches a Fragment is used
+   * @param number_of_threads Number of worker threads that do the compression
+   * @param min_fragment_size_bytes Fragments that are smaller than this are not compressed
+   */
+  FragmentCompressor(const std::string& parent_name,
+                     const std::vector<Rule>& rules,
+                     size_t number_of_threads,
+                     size_t min_fragment_size_bytes);
+  ~FragmentCompressor();
+
+  FragmentCompressor(const FragmentCompressor&) = delete;            ///< FragmentCompressor is not copy-constructible
+  FragmentCompressor& operator=(const FragmentCompressor&) = delete; ///< FragmentCompressor is not copy-assignable
+  FragmentCompressor(FragmentCompressor&&) = delete;                 ///< FragmentCompressor is not move-constructible
+  FragmentCompressor& operator=(FragmentCompressor&&) = delete;      ///< FragmentCompressor is not move-assignable
+
+  /**
+   * @brief Returns a copy of the TriggerRecord in which the Fragments have been
+   * compressed according to the rules.
+   */
+  std::unique_ptr<daqdataformats::TriggerRecord> compress(const daqdataformats::TriggerRecord& tr);
+
+  /**
+   * @brief Returns a copy of the TimeSlice in which the Fragments have been
+   * compressed according to the rules.
+   */
+  std::unique_ptr<daqdataformats::TimeSlice> compress(const daqdataformats::TimeSlice& ts);
+
+  /**
+   * @brief Returns a description of the rules, e.g. for storing it in the output files
+   */
+  std::string get_description() const;
+
+  void get_info(opmonlib::InfoCollector& ci, int level);
+
+  static Codec string_to_codec(const std::string& codec_name);
+  static std::string codec_to_string(Codec codec);
+
+  /**
+   * @brief Compresses the payload of the Fragment with the specified codec.
+   * @return the compressed Fragment, or a null pointer if compression does not
+   * make the Fragment smaller
+   */
+  static std::unique_ptr<daqdataformats::Fragment> compress_fragment(const daqdataformats::Fragment& frag,
+                                                                     Codec codec,
+                                                                     int level);
+
+  /**
+   * @brief Whether the payload of the Fragment was compressed by a FragmentCompressor
+   */
+  static bool is_compressed(const daqdataformats::Fragment& frag);
+
+  /**
+   * @brief Returns a copy of the compressed Fragment with its original payload
+   */
+  static std::unique_ptr<daqdataformats::Fragment> decompress_fragment(const daqdataformats::Fragment& frag);
+
+private:
+  struct CodecMetrics
+  {
+    std::atomic<uint64_t> fragments{ 0 };          // NOLINT(build/unsigned)
+    std::atomic<uint64_t> uncompressed_bytes{ 0 }; // NOLINT(build/unsigned)
+    std::atomic<uint64_t> compressed_bytes{ 0 };   // NOLINT(build/unsigned)
+    std::atomic<uint64_t> compression_time_us{ 0 }; // NOLINT(build/unsigned)
+  };
+
+  const Rule* select_rule(const daqdataformats::Fragment& frag) const;
+  std::vector<std::unique_ptr<daqdataformats::Fragment>> compress_fragments(
+    const std::vector<std::unique_ptr<daqdataformats::Fragment>>& fragments);
+  std::unique_ptr<daqdataformats::Fragment> compress_or_copy(const daqdataformats::Fragment& frag);
+  void worker_work();
+
+  std::vector<Rule> m_rules;
+  size_t m_min_fragment_size;
+  size_t m_fragments_per_task;
+
+  // Worker threads
+  std::vector<std::thread> m_workers;
+  std::deque<std::packaged_task<void()>> m_tasks;
+  std::mutex m_tasks_mutex;
+  std::condition_variable m_tasks_cv;
+  bool m_workers_should_stop;
+
+  // Metrics, indexed by codec
+  static constexpr size_t s_number_of_codecs = 3;
+  CodecMetrics m_codec_metrics[s_number_of_codecs];
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_FRAGMENTCOMPRESSOR_HPP_
@@ -0,0 +1,164 @@
+/**
+ * @file HDF5FileFlusher.hpp HDF5FileFlusher Class
+ *
+ * The HDF5FileFlusher class makes the data that the HDF5DataStore has written
+ * durable while a file is still open, according to a configurable policy:
+ * after a number of records, after a number of bytes, or after an amount of time.
+ * A flush writes the HDF5 library buffers and metadata to the file (H5Fflush)
+ * and then asks the kernel to write the file contents to disk (fdatasync).
+ * Optionally, the file is also synced to disk, together with its directory,
+ * when it is closed.
+ *
+ * The HDF5RawDataFile class does not expose its HDF5 file identifier, so the
+ * flusher opens the file a second time; an HDF5 file that is opened a second
+ * time in the same process shares the state of the first open, so flushing
+ * through the second identifier flushes the data written through the first.
+ *
+ * The flushes can be done on a background thread, so that the writing thread
+ * does not wait for the disk.  The HDF5 part of a flush still needs the HDF5
+ * mutex, but the fdatasync is done without it.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_HDF5FILEFLUSHER_HPP_
+#define DFMODULES_SRC_DFMODULES_HDF5FILEFLUSHER_HPP_
+
+#include "dfmodules/LatencyHistogram.hpp"
+
+#include "utilities/NamedObject.hpp"
+
+#include "ers/Issue.hpp"
+
+#include "hdf5.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace dunedaq {
+
+// Disable coverage checking LCOV_EXCL_START
+ERS_DECLARE_ISSUE(dfmodules,
+                  HDF5FileFlushProblem,
+                  "A problem was encountered when flushing file " << file_name << " to disk: " << details,
+                  ((std::string)file_name)((std::string)details))
+// Re-enable coverage checking LCOV_EXCL_STOP
+
+namespace dfmodules {
+
+class HDF5FileFlusher : public utilities::NamedObject
+{
+public:
+  /**
+   * @brief When the open file is flushed.  Zero values disable the corresponding rule.
+   */
+  struct Policy
+  {
+    size_t records_between_flushes = 0;
+    size_t bytes_between_flushes = 0;
+    std::chrono::milliseconds time_between_flushes{ 0 };
+    bool sync_at_close = false;
+    bool flush_in_background = false;
+  };
+
+  /**
+   * @brief HDF5FileFlusher Constructor
+   * @param parent_name Name of the object that owns this instance
+   * @param policy The flush policy
+   * @param hdf5_mutex The mutex that serializes the calls to the HDF5 library
+   */
+  HDF5FileFlusher(const std::string& parent_name, const Policy& policy, std::mutex& hdf5_mutex);
+
+  /**
+   * @brief Stops the background thread, if there is one, and closes the file
+   * that is being flushed
+   */
+  ~HDF5FileFlusher();
+
+  HDF5FileFlusher(const HDF5FileFlusher&) = delete;            ///< HDF5FileFlusher is not copy-constructible
+  HDF5FileFlusher& operator=(const HDF5FileFlusher&) = delete; ///< HDF5FileFlusher is not copy-assignable
+  HDF5FileFlusher(HDF5FileFlusher&&) = delete;                 ///< HDF5FileFlusher is not move-constructible
+  HDF5FileFlusher& operator=(HDF5FileFlusher&&) = delete;      ///< HDF5FileFlusher is not move-assignable
+
+  /**
+   * @brief Whether the policy asks for any flushes beyond the ones that the HDF5 library does itself
+   */
+  static bool is_flushing_requested(const Policy& policy);
+
+  /**
+   * @brief Starts flushing the specified file, which has just been opened for writing.
+   * The HDF5 mutex must not be held by the caller.
+   */
+  void start_file(const std::string& file_name);
+
+  /**
+   * @brief Stops flushing the current file.  This needs to be called before the
+   * HDF5RawDataFile of the file is closed, since the file is only closed once all of
+   * its identifiers are closed.  A background flush that is in progress is waited for.
+   * The HDF5 mutex must not be held by the caller.
+   */
+  void finish_file();
+
+  /**
+   * @brief Counts data that was written to the current file, and flushes the file (or
+   * asks the background thread to flush it) when the policy says that a flush is due.
+   * The time rule is only checked here, so a file that is not written to is not flushed.
+   * The HDF5 mutex must not be held by the caller.
+   */
+  void record_write(size_t record_count, size_t byte_count);
+
+  /**
+   * @brief Writes the contents of a file that has been closed to disk, together with
+   * the directory that it is in, if the policy asks for that.
+   */
+  void sync_closed_file(const std::string& file_name);
+
+  const Policy& get_policy() const { return m_policy; }
+  LatencyHistogram& get_flush_latency() { return m_flush_latency; }
+  LatencyHistogram& get_sync_latency() { return m_sync_latency; }
+
+private:
+  void do_background_flushes();
+  void wait_for_background_flush(std::unique_lock<std::mutex>& lk);
+
+  /**
+   * @brief Flushes the current file.  Problems are reported, rather than thrown, since
+   * the data has been written and the flush may be done on the background thread.
+   */
+  void flush_current_file();
+
+  Policy m_policy;
+  std::mutex& m_hdf5_mutex;
+
+  // The file that is being flushed; these are only changed by start_file() and
+  // finish_file(), while no background flush is in progress
+  std::string m_file_name;
+  hid_t m_file_id;
+  int m_fd;
+
+  // Data written since the previous flush
+  size_t m_records_since_flush;
+  size_t m_bytes_since_flush;
+  std::chrono::steady_clock::time_point m_last_flush_time;
+
+  // Background flushes
+  std::thread m_flush_thread;
+  std::mutex m_flush_mutex;
+  std::condition_variable m_flush_cv;
+  bool m_flush_requested;
+  bool m_flush_in_progress;
+  bool m_stop_requested;
+
+  LatencyHistogram m_flush_latency;
+  LatencyHistogram m_sync_latency;
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_HDF5FILEFLUSHER_HPP_
@@ -0,0 +1,142 @@
+/**
+ * @file HDF5FileTuning.hpp HDF5FileTuning Class
+ *
+ * The HDF5FileTuning class applies HDF5 file-creation and file-access tuning
+ * (data alignment, metadata block size, metadata cache, page buffering,
+ * file-space strategy, sieve buffer, library version bounds) to the files that
+ * the HDF5DataStore writes.  The HDF5RawDataFile class opens its files with
+ * the default property lists, so prepare_file() creates the file with the tuned
+ * property lists first and keeps it open while the HDF5RawDataFile opens it.
+ * A file that is opened a second time in the same process shares the state of
+ * the first open, including the access properties, so the tuning stays in
+ * effect until the HDF5RawDataFile closes the file.
+ *
+ * Optionally, disk blocks are reserved for the file up front with fallocate,
+ * and the blocks that were not used are released when the file is closed.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_HDF5FILETUNING_HPP_
+#define DFMODULES_SRC_DFMODULES_HDF5FILETUNING_HPP_
+
+#include "utilities/NamedObject.hpp"
+
+#include "ers/Issue.hpp"
+
+#include "hdf5.h"
+
+#include <memory>
+#include <string>
+
+namespace dunedaq {
+
+// Disable coverage checking LCOV_EXCL_START
+ERS_DECLARE_ISSUE(dfmodules,
+                  InvalidHDF5TuningParameter,
+                  "The value \"" << value << "\" is not valid for the HDF5 tuning parameter " << parameter_name,
+                  ((std::string)parameter_name)((std::string)value))
+
+ERS_DECLARE_ISSUE(dfmodules,
+                  HDF5FileTuningProblem,
+                  "A problem was encountered when applying the HDF5 tuning settings to file " << file_name << ": "
+                                                                                              << details,
+                  ((std::string)file_name)((std::string)details))
+// Re-enable coverage checking LCOV_EXCL_STOP
+
+namespace dfmodules {
+
+class HDF5FileTuning : public utilities::NamedObject
+{
+public:
+  /**
+   * @brief The tuning settings.  Zero sizes and empty strings select the HDF5 defaults.
+   */
+  struct Settings
+  {
+    size_t alignment_bytes = 0;
+    size_t alignment_threshold_bytes = 0;
+    size_t metadata_block_size_bytes = 0;
+    size_t metadata_cache_initial_size_bytes = 0;
+    size_t metadata_cache_max_size_bytes = 0;
+    size_t page_buffer_size_bytes = 0;
+    std::string file_space_strategy;
+    size_t file_space_page_size_bytes = 0;
+    size_t sieve_buffer_size_bytes = 0;
+    std::string libver_low;
+    std::string libver_high;
+    bool preallocate = false;
+  };
+
+  /**
+   * @brief A file that was created with the tuned property lists, which is kept
+   * open (and so keeps the tuning in effect) until this object is destroyed.
+   */
+  class PreparedFile
+  {
+  public:
+    explicit PreparedFile(hid_t file_id)
+      : m_file_id(file_id)
+    {}
+    ~PreparedFile() { H5Fclose(m_file_id); }
+
+    PreparedFile(const PreparedFile&) = delete;            ///< PreparedFile is not copy-constructible
+    PreparedFile& operator=(const PreparedFile&) = delete; ///< PreparedFile is not copy-assignable
+    PreparedFile(PreparedFile&&) = delete;                 ///< PreparedFile is not move-constructible
+    PreparedFile& operator=(PreparedFile&&) = delete;      ///< PreparedFile is not move-assignable
+
+    hid_t get_file_id() const { return m_file_id; }
+
+  private:
+    hid_t m_file_id;
+  };
+
+  /**
+   * @brief HDF5FileTuning Constructor.  The settings are validated here.
+   * @param parent_name Name of the object that owns this instance
+   * @param settings The tuning settings
+   */
+  HDF5FileTuning(const std::string& parent_name, const Settings& settings);
+
+  HDF5FileTuning(const HDF5FileTuning&) = delete;            ///< HDF5FileTuning is not copy-constructible
+  HDF5FileTuning& operator=(const HDF5FileTuning&) = delete; ///< HDF5FileTuning is not copy-assignable
+  HDF5FileTuning(HDF5FileTuning&&) = delete;                 ///< HDF5FileTuning is not move-constructible
+  HDF5FileTuning& operator=(HDF5FileTuning&&) = delete;      ///< HDF5FileTuning is not move-assignable
+
+  /**
+   * @brief Whether any of the settings differs from the HDF5 defaults
+   */
+  static bool is_tuning_requested(const Settings& settings);
+
+  /**
+   * @brief Creates the HDF5 file with the tuned property lists and reserves the
+   * disk space for it, if configured.  The HDF5 mutex needs to be held by the caller.
+   * @param file_name Full name of the file, as it will be opened by the HDF5RawDataFile
+   * @param preallocation_size_bytes Number of bytes to reserve on disk, if preallocation is enabled
+   * @return the open file, or a null pointer if the file already exists (in which case
+   * it is left untouched)
+   */
+  std::unique_ptr<PreparedFile> prepare_file(const std::string& file_name, size_t preallocation_size_bytes) const;
+
+  /**
+   * @brief Releases the disk blocks that were reserved for the file but not used.
+   * This method does nothing when preallocation is disabled.
+   */
+  void release_unused_space(const std::string& file_name) const;
+
+  const Settings& get_settings() const { return m_settings; }
+
+private:
+  Settings m_settings;
+  bool m_file_space_strategy_is_set;
+  H5F_fspace_strategy_t m_file_space_strategy;
+  H5F_libver_t m_libver_low;
+  H5F_libver_t m_libver_high;
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_HDF5FILETUNING_HPP_
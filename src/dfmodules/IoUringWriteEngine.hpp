@@ -0,0 +1,137 @@
+/**
+ * @file IoUringWriteEngine.hpp IoUringWriteEngine Class
+ *
+ * The IoUringWriteEngine class submits file writes and syncs to the kernel
+ * through an io_uring submission queue, so that several large writes can be
+ * in flight at the same time from a single thread, and it collects their
+ * completions.  The data is written from a pool of page-aligned buffers that
+ * belong to the engine, which are registered with the kernel (when the memory
+ * lock limit allows it) so that they do not need to be mapped for each write.
+ *
+ * The io_uring system calls are used directly, so no additional library is needed.
+ * A sync request is only started once all of the requests that were submitted
+ * before it have completed, and the requests that are submitted after it are
+ * only started once it has completed, so its completion means that the data of
+ * all earlier writes is on disk.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_IOURINGWRITEENGINE_HPP_
+#define DFMODULES_SRC_DFMODULES_IOURINGWRITEENGINE_HPP_
+
+#include "utilities/NamedObject.hpp"
+
+#include "ers/Issue.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+
+// Disable coverage checking LCOV_EXCL_START
+ERS_DECLARE_ISSUE(dfmodules,
+                  IoUringProblem,
+                  "A problem was encountered when " << operation << " the io_uring write engine: " << details,
+                  ((std::string)operation)((std::string)details))
+// Re-enable coverage checking LCOV_EXCL_STOP
+
+namespace dfmodules {
+
+class IoUringWriteEngine : public utilities::NamedObject
+{
+public:
+  /**
+   * @brief The result of a request: the tag that it was submitted with, and the
+   * number of bytes that were written (zero for a sync) or a negative errno value
+   */
+  struct Completion
+  {
+    uint64_t tag; // NOLINT(build/unsigned)
+    int result;
+  };
+
+  /**
+   * @brief IoUringWriteEngine Constructor
+   * @param parent_name Name of the object that owns this instance
+   * @param queue_depth Maximum number of requests that are in flight at the same time
+   * @param number_of_buffers Number of write buffers
+   * @param buffer_size Size of each write buffer, rounded up to a multiple of the page size
+   */
+  IoUringWriteEngine(const std::string& parent_name, size_t queue_depth, size_t number_of_buffers, size_t buffer_size);
+
+  /**
+   * @brief Waits for the requests that are still in flight, and releases the queue
+   */
+  ~IoUringWriteEngine();
+
+  IoUringWriteEngine(const IoUringWriteEngine&) = delete;            ///< IoUringWriteEngine is not copy-constructible
+  IoUringWriteEngine& operator=(const IoUringWriteEngine&) = delete; ///< IoUringWriteEngine is not copy-assignable
+  IoUringWriteEngine(IoUringWriteEngine&&) = delete;                 ///< IoUringWriteEngine is not move-constructible
+  IoUringWriteEngine& operator=(IoUringWriteEngine&&) = delete;      ///< IoUringWriteEngine is not move-assignable
+
+  /**
+   * @brief Whether the kernel supports io_uring (and allows this process to use it)
+   */
+  static bool is_supported();
+
+  size_t get_number_of_buffers() const { return m_buffers.size(); }
+  size_t get_buffer_size() const { return m_buffer_size; }
+  char* get_buffer(size_t buffer_index) const { return m_buffers[buffer_index].get(); }
+  bool are_buffers_registered() const { return m_buffers_registered; }
+  size_t get_number_in_flight() const { return m_number_in_flight; }
+
+  /**
+   * @brief Submits a write of the first length bytes of the specified buffer to the
+   * file at the specified offset.  The buffer must not be changed until the write has
+   * completed.  If the queue is full, this waits for a request to complete first.
+   */
+  void submit_write(int fd,
+                    size_t buffer_index,
+                    size_t length,
+                    uint64_t offset, // NOLINT(build/unsigned)
+                    uint64_t tag);   // NOLINT(build/unsigned)
+
+  /**
+   * @brief Submits an fdatasync of the file, which is ordered after all of the requests
+   * that were submitted before it, and before all of the requests that are submitted after it.
+   */
+  void submit_sync(int fd, uint64_t tag); // NOLINT(build/unsigned)
+
+  /**
+   * @brief Returns the requests that have completed, waiting until there are at
+   * least min_completions of them (or until nothing is in flight anymore)
+   */
+  std::vector<Completion> reap(size_t min_completions);
+
+private:
+  struct Ring;
+
+  void submit(int fd,
+              uint8_t opcode, // NOLINT(build/unsigned)
+              uint8_t flags,  // NOLINT(build/unsigned)
+              size_t buffer_index,
+              size_t length,
+              uint64_t offset, // NOLINT(build/unsigned)
+              uint64_t tag);   // NOLINT(build/unsigned)
+  void collect_completions(std::vector<Completion>& completions);
+
+  size_t m_queue_depth;
+  size_t m_buffer_size;
+  std::vector<std::unique_ptr<char, decltype(&std::free)>> m_buffers;
+  bool m_buffers_registered;
+  size_t m_number_in_flight;
+  std::vector<Completion> m_completions_collected_early; ///< while waiting for room in the queue
+  std::unique_ptr<Ring> m_ring; ///< declared last, so that the buffers are unregistered before they are freed
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_IOURINGWRITEENGINE_HPP_
@@ -0,0 +1,110 @@
+/**
+ * @file LatencyHistogram.hpp LatencyHistogram Class
+ *
+ * The LatencyHistogram class accumulates the durations of an operation for
+ * operational monitoring: the number of samples, their sum, minimum, and
+ * maximum, and a histogram with logarithmic (decade) buckets, from below
+ * 10 microseconds to one second and above.  The median and the 90th and 99th
+ * percentiles are estimated from finer buckets, eight per decade, so they are
+ * accurate to within about a third.  Samples can be recorded from several
+ * threads without locking.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_LATENCYHISTOGRAM_HPP_
+#define DFMODULES_SRC_DFMODULES_LATENCYHISTOGRAM_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace dunedaq {
+namespace dfmodules {
+
+class LatencyHistogram
+{
+public:
+  /**
+   * @brief Number of buckets: below 10 us, below 100 us, below 1 ms, below 10 ms,
+   * below 100 ms, below 1 s, and 1 s or more
+   */
+  static constexpr size_t s_number_of_buckets = 7;
+
+  /**
+   * @brief Number of the finer buckets from which the percentiles are estimated: below
+   * 10 us, eight per decade from 10 us to 10 s, and 10 s or more
+   */
+  static constexpr size_t s_number_of_fine_buckets = 50;
+
+  /**
+   * @brief The contents of the histogram at one moment
+   */
+  struct Snapshot
+  {
+    uint64_t count = 0;  // NOLINT(build/unsigned)
+    uint64_t sum_us = 0; // NOLINT(build/unsigned)
+    uint64_t min_us = 0; // NOLINT(build/unsigned)
+    uint64_t max_us = 0; // NOLINT(build/unsigned)
+    std::array<uint64_t, s_number_of_buckets> bucket_counts{}; // NOLINT(build/unsigned)
+    uint64_t p50_us = 0; // NOLINT(build/unsigned)
+    uint64_t p90_us = 0; // NOLINT(build/unsigned)
+    uint64_t p99_us = 0; // NOLINT(build/unsigned)
+  };
+
+  LatencyHistogram();
+
+  LatencyHistogram(const LatencyHistogram&) = delete;            ///< LatencyHistogram is not copy-constructible
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete; ///< LatencyHistogram is not copy-assignable
+  LatencyHistogram(LatencyHistogram&&) = delete;                 ///< LatencyHistogram is not move-constructible
+  LatencyHistogram& operator=(LatencyHistogram&&) = delete;      ///< LatencyHistogram is not move-assignable
+
+  void record(std::chrono::steady_clock::duration duration);
+
+  /**
+   * @brief Returns the samples that were recorded since the previous call, and starts over
+   */
+  Snapshot get_and_reset();
+
+  /**
+   * @brief Returns the index of the bucket for a duration of the specified number of microseconds
+   */
+  static size_t get_bucket_index(uint64_t duration_us); // NOLINT(build/unsigned)
+
+  /**
+   * @brief Returns the index of the fine bucket for a duration of the specified number of microseconds
+   */
+  static size_t get_fine_bucket_index(uint64_t duration_us); // NOLINT(build/unsigned)
+
+private:
+  using FineBucketCounts = std::array<uint64_t, s_number_of_fine_buckets>; // NOLINT(build/unsigned)
+
+  /**
+   * @brief Estimates the duration below which the specified fraction of the samples fall: the
+   * upper edge of the fine bucket that contains it, limited to the range of the samples
+   */
+  static uint64_t estimate_percentile(const FineBucketCounts& fine_bucket_counts, // NOLINT(build/unsigned)
+                                      double fraction,
+                                      const Snapshot& snapshot);
+
+  /**
+   * @brief Sets the minimum and maximum of the snapshot to the edges of the first and last
+   * fine buckets that have samples
+   */
+  static void estimate_range(const FineBucketCounts& fine_bucket_counts, Snapshot& snapshot);
+
+  std::atomic<uint64_t> m_count;  // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_sum_us; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_min_us; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_max_us; // NOLINT(build/unsigned)
+  std::array<std::atomic<uint64_t>, s_number_of_buckets> m_bucket_counts;           // NOLINT(build/unsigned)
+  std::array<std::atomic<uint64_t>, s_number_of_fine_buckets> m_fine_bucket_counts; // NOLINT(build/unsigned)
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_LATENCYHISTOGRAM_HPP_
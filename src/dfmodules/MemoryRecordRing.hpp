@@ -0,0 +1,192 @@
+/**
+ * @file MemoryRecordRing.hpp MemoryRecordRing Class
+ *
+ * The MemoryRecordRing class keeps the most recent TriggerRecords and TimeSlices
+ * in a preallocated ring buffer in memory.  The records are stored in serialized
+ * form; when the ring is full (in bytes or in number of records), the oldest
+ * records are dropped.  Rings are registered by name, so that consumers in the
+ * same process can find the ring that a MemoryDataStore writes into and read
+ * the records back with little latency.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_MEMORYRECORDRING_HPP_
+#define DFMODULES_SRC_DFMODULES_MEMORYRECORDRING_HPP_
+
+#include "daqdataformats/TimeSlice.hpp"
+#include "daqdataformats/TriggerRecord.hpp"
+#include "daqdataformats/Types.hpp"
+#include "opmonlib/InfoCollector.hpp"
+#include "utilities/NamedObject.hpp"
+
+#include "ers/Issue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+
+// Disable coverage checking LCOV_EXCL_START
+ERS_DECLARE_ISSUE(dfmodules,
+                  RecordTooLargeForRing,
+                  "A " << record_type << " of " << record_size << " bytes does not fit into the memory ring \""
+                       << ring_name << "\", which has a capacity of " << capacity << " bytes",
+                  ((std::string)record_type)((size_t)record_size)((std::string)ring_name)((size_t)capacity))
+// Re-enable coverage checking LCOV_EXCL_STOP
+
+namespace dfmodules {
+
+class MemoryRecordRing : public utilities::NamedObject
+{
+public:
+  enum class RecordType
+  {
+    kTriggerRecord = 1,
+    kTimeSlice = 2
+  };
+
+  /**
+   * @brief Description of a record in the ring
+   */
+  struct EntryInfo
+  {
+    uint64_t index;          // NOLINT(build/unsigned) position in the sequence of records that were added
+    RecordType record_type;
+    uint64_t record_number;  // NOLINT(build/unsigned) trigger number or time slice number
+    daqdataformats::sequence_number_t sequence_number;
+    daqdataformats::run_number_t run_number;
+    size_t size_bytes;
+  };
+
+  /**
+   * @brief Creates a ring and registers it under the specified name.  A ring that was
+   * registered earlier under the same name is replaced in the registry (consumers that
+   * still hold it keep a valid, but no longer updated, ring).
+   * @param name Name under which consumers can find the ring
+   * @param capacity_bytes Size of the preallocated buffer
+   * @param max_records Maximum number of records in the ring, zero means no limit
+   */
+  static std::shared_ptr<MemoryRecordRing> create(const std::string& name, size_t capacity_bytes, size_t max_records);
+
+  /**
+   * @brief Returns the ring with the specified name, or a null pointer if there is none
+   */
+  static std::shared_ptr<MemoryRecordRing> find(const std::string& name);
+
+  MemoryRecordRing(const std::string& name, size_t capacity_bytes, size_t max_records);
+
+  MemoryRecordRing(const MemoryRecordRing&) = delete;            ///< MemoryRecordRing is not copy-constructible
+  MemoryRecordRing& operator=(const MemoryRecordRing&) = delete; ///< MemoryRecordRing is not copy-assignable
+  MemoryRecordRing(MemoryRecordRing&&) = delete;                 ///< MemoryRecordRing is not move-constructible
+  MemoryRecordRing& operator=(MemoryRecordRing&&) = delete;      ///< MemoryRecordRing is not move-assignable
+
+  /**
+   * @brief Adds a copy of the TriggerRecord to the ring, dropping the oldest records if needed
+   */
+  void add(const daqdataformats::TriggerRecord& tr);
+
+  /**
+   * @brief Adds a copy of the TimeSlice to the ring, dropping the oldest records if needed
+   */
+  void add(const daqdataformats::TimeSlice& ts);
+
+  /**
+   * @brief Drops all records from the ring
+   */
+  void clear();
+
+  /**
+   * @brief Returns the descriptions of the records that are in the ring, oldest first
+   */
+  std::vector<EntryInfo> list_entries() const;
+
+  /**
+   * @brief Returns a copy of the specified TriggerRecord, or a null pointer if it is not in the ring
+   */
+  std::unique_ptr<daqdataformats::TriggerRecord> get_trigger_record(daqdataformats::trigger_number_t trigger_number,
+                                                                    daqdataformats::sequence_number_t sequence_number);
+
+  /**
+   * @brief Returns a copy of the specified TimeSlice, or a null pointer if it is not in the ring
+   */
+  std::unique_ptr<daqdataformats::TimeSlice> get_time_slice(daqdataformats::timeslice_number_t timeslice_number);
+
+  /**
+   * @brief Returns a copy of the most recent TriggerRecord, or a null pointer if there is none
+   */
+  std::unique_ptr<daqdataformats::TriggerRecord> get_latest_trigger_record();
+
+  /**
+   * @brief Returns a copy of the oldest TriggerRecord in the ring whose index is at least
+   * next_index, waiting up to the specified time for one to be added.  On success,
+   * next_index is moved past the returned record, so that repeated calls walk through
+   * the records in order (records that were dropped before they could be read are skipped).
+   * @return the TriggerRecord, or a null pointer if none arrived in time
+   */
+  std::unique_ptr<daqdataformats::TriggerRecord> read_next_trigger_record(uint64_t& next_index, // NOLINT
+                                                                          std::chrono::milliseconds timeout);
+
+  /**
+   * @brief Same as read_next_trigger_record(), for TimeSlices
+   */
+  std::unique_ptr<daqdataformats::TimeSlice> read_next_time_slice(uint64_t& next_index, // NOLINT(build/unsigned)
+                                                                  std::chrono::milliseconds timeout);
+
+  size_t get_capacity() const { return m_buffer.size(); }
+
+  void get_info(opmonlib::InfoCollector& ci, int level);
+
+private:
+  struct Entry
+  {
+    EntryInfo info;
+    size_t offset;
+    size_t header_size;
+    size_t number_of_fragments;
+  };
+
+  template<typename T>
+  void add_record(const T& record,
+                  RecordType record_type,
+                  uint64_t record_number, // NOLINT(build/unsigned)
+                  daqdataformats::sequence_number_t sequence_number,
+                  daqdataformats::run_number_t run_number,
+                  const void* header,
+                  size_t header_size);
+  size_t make_room(size_t size);
+  const Entry* find_entry_after(uint64_t next_index, RecordType record_type) const; // NOLINT(build/unsigned)
+  std::unique_ptr<daqdataformats::TriggerRecord> make_trigger_record(const Entry& entry) const;
+  std::unique_ptr<daqdataformats::TimeSlice> make_time_slice(const Entry& entry) const;
+  template<typename T>
+  void add_fragments(T& record, const Entry& entry) const;
+
+  std::vector<char> m_buffer;
+  size_t m_max_records;
+  std::deque<Entry> m_entries;
+  size_t m_write_offset;
+  size_t m_bytes_in_ring;
+  uint64_t m_next_index; // NOLINT(build/unsigned)
+  mutable std::mutex m_mutex;
+  std::condition_variable m_record_added_cv;
+
+  // Metrics
+  std::atomic<uint64_t> m_records_added{ 0 };   // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_bytes_added{ 0 };     // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_records_dropped{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_records_read{ 0 };    // NOLINT(build/unsigned)
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_MEMORYRECORDRING_HPP_
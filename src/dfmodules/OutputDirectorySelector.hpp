@@ -0,0 +1,168 @@
+/**
+ * @file OutputDirectorySelector.hpp OutputDirectorySelector Class
+ *
+ * The OutputDirectorySelector class distributes output files over a list of
+ * directories (typically on independent disks).  Directories are chosen with a
+ * smooth weighted round-robin.  A directory is skipped while the disk that holds
+ * it does not have enough free space, and it is taken out of the rotation for a
+ * while when its measured write rate drops below a configured minimum.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_OUTPUTDIRECTORYSELECTOR_HPP_
+#define DFMODULES_SRC_DFMODULES_OUTPUTDIRECTORYSELECTOR_HPP_
+
+#include "dfmodules/DiskSpaceMonitor.hpp"
+
+#include "opmonlib/InfoCollector.hpp"
+#include "utilities/NamedObject.hpp"
+
+#include "ers/Issue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+
+// Disable coverage checking LCOV_EXCL_START
+ERS_DECLARE_ISSUE(dfmodules,
+                  OutputDirectoryTakenOutOfRotation,
+                  "The output directory \"" << path << "\" has been taken out of the rotation for " << holdoff_ms
+                                            << " ms, because its write rate (" << measured_rate
+                                            << " bytes/s) is below the configured minimum (" << minimum_rate
+                                            << " bytes/s)",
+                  ((std::string)path)((size_t)measured_rate)((size_t)minimum_rate)((int64_t)holdoff_ms))
+// Re-enable coverage checking LCOV_EXCL_STOP
+
+namespace dfmodules {
+
+class OutputDirectorySelector : public utilities::NamedObject
+{
+public:
+  struct DirectoryConfig
+  {
+    std::string path;
+    int weight;
+  };
+
+  /**
+   * @brief OutputDirectorySelector Constructor
+   * @param parent_name Name of the object that owns this selector
+   * @param directories Output directories and their (relative) weights
+   * @param free_space_sampling_interval Time between samples of the free space on each disk
+   * @param min_write_rate_bytes_per_second Minimum write rate of a directory, zero disables the check
+   * @param excluded_directory_retry_interval Time after which a slow directory is put back into the rotation
+   */
+  OutputDirectorySelector(const std::string& parent_name,
+                          const std::vector<DirectoryConfig>& directories,
+                          std::chrono::milliseconds free_space_sampling_interval,
+                          size_t min_write_rate_bytes_per_second,
+                          std::chrono::milliseconds excluded_directory_retry_interval);
+
+  OutputDirectorySelector(const OutputDirectorySelector&) = delete; ///< OutputDirectorySelector is not copy-constructible
+  OutputDirectorySelector& operator=(const OutputDirectorySelector&) =
+    delete;                                                    ///< OutputDirectorySelector is not copy-assignable
+  OutputDirectorySelector(OutputDirectorySelector&&) = delete; ///< OutputDirectorySelector is not move-constructible
+  OutputDirectorySelector& operator=(OutputDirectorySelector&&) =
+    delete; ///< OutputDirectorySelector is not move-assignable
+
+  void start_monitoring();
+  void stop_monitoring();
+
+  size_t get_number_of_directories() const { return m_directories.size(); }
+  const std::string& get_path(size_t index) const { return m_directories[index]->path; }
+  DiskSpaceMonitor& get_disk_space_monitor(size_t index) { return *m_directories[index]->disk_space_monitor; }
+
+  /**
+   * @brief Chooses the directory for the next output file.  Directories with less
+   * than min_free_space bytes of (predicted) free space and directories that have been
+   * taken out of the rotation are skipped.
+   * @return the index of the chosen directory, or nothing if no directory is usable
+   */
+  std::optional<size_t> select(size_t min_free_space);
+
+  /**
+   * @brief Returns the directory that select() would choose, without changing the state of
+   * the rotation, e.g. for a file that is created ahead of time and may not be used.
+   */
+  std::optional<size_t> peek(size_t min_free_space);
+
+  /**
+   * @brief Updates the state of the rotation as select() does when it chooses the specified
+   * directory, once the directory that was found with peek() is actually used.
+   */
+  void commit(size_t index, size_t min_free_space);
+
+  /**
+   * @brief Whether the specified directory can currently be used for new files
+   */
+  bool is_usable(size_t index, size_t min_free_space);
+
+  /**
+   * @brief Informs the selector that a file has been started in the specified directory
+   */
+  void record_file_started(size_t index);
+
+  /**
+   * @brief Informs the selector that the specified number of bytes has been written to
+   * the specified directory, and how long that took.  This is used both for the bookkeeping
+   * of the free space and for the measurement of the write rate.
+   */
+  void record_write(size_t index, size_t bytes, std::chrono::steady_clock::duration write_time);
+
+  /**
+   * @brief Samples the free space of all directories right away and puts all directories
+   * back into the rotation.
+   * @return the indices of the directories whose paths are not valid
+   */
+  std::vector<size_t> reset();
+
+  void get_info(opmonlib::InfoCollector& ci, int level);
+
+  /**
+   * @brief Amount of write time over which the write rate of a directory is measured
+   */
+  static constexpr std::chrono::seconds s_write_rate_measurement_time{ 1 };
+
+private:
+  struct Directory
+  {
+    std::string path;
+    int weight;
+    std::unique_ptr<DiskSpaceMonitor> disk_space_monitor;
+
+    // Selection state
+    int64_t current_weight = 0;
+    std::chrono::steady_clock::time_point excluded_until;
+
+    // Write rate measurement
+    size_t bytes_in_measurement = 0;
+    std::chrono::steady_clock::duration time_in_measurement{ 0 };
+    std::atomic<size_t> last_write_rate{ 0 };
+
+    // Metrics
+    std::atomic<uint64_t> files_started{ 0 }; // NOLINT(build/unsigned)
+    std::atomic<uint64_t> bytes_written{ 0 }; // NOLINT(build/unsigned)
+  };
+
+  bool is_usable(const Directory& dir, size_t min_free_space, std::chrono::steady_clock::time_point now) const;
+
+  std::vector<std::unique_ptr<Directory>> m_directories;
+  size_t m_min_write_rate;
+  std::chrono::milliseconds m_excluded_directory_retry_interval;
+  std::mutex m_mutex;
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_OUTPUTDIRECTORYSELECTOR_HPP_
@@ -0,0 +1,150 @@
+/**
+ * @file PackedRecordFile.hpp PackedRecordWriter and PackedRecordReader Classes
+ *
+ * The PackedRecordWriter class writes TriggerRecords and TimeSlices into an HDF5
+ * file in the packed record layout (see PackedRecordFormat.hpp), and the
+ * PackedRecordReader class reads them back, either complete or one Fragment at a time.
+ *
+ * Both classes use the HDF5 library directly, so the HDF5 mutex needs to be held
+ * by the caller for all of their methods, including the constructors and destructors.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_PACKEDRECORDFILE_HPP_
+#define DFMODULES_SRC_DFMODULES_PACKEDRECORDFILE_HPP_
+
+#include "dfmodules/PackedRecordFormat.hpp"
+
+#include "daqdataformats/Fragment.hpp"
+#include "daqdataformats/SourceID.hpp"
+#include "daqdataformats/TimeSlice.hpp"
+#include "daqdataformats/TriggerRecord.hpp"
+
+#include "hdf5.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace dfmodules {
+
+class PackedRecordWriter
+{
+public:
+  /**
+   * @brief PackedRecordWriter Constructor.  The HDF5 file needs to exist already; when
+   * it is open elsewhere in this process (by the HDF5RawDataFile that was used to create
+   * it), this writer shares that open file, so it needs to be destroyed before the other
+   * handle is closed.
+   */
+  explicit PackedRecordWriter(const std::string& hdf5_file_name);
+
+  ~PackedRecordWriter();
+
+  PackedRecordWriter(const PackedRecordWriter&) = delete;            ///< PackedRecordWriter is not copy-constructible
+  PackedRecordWriter& operator=(const PackedRecordWriter&) = delete; ///< PackedRecordWriter is not copy-assignable
+  PackedRecordWriter(PackedRecordWriter&&) = delete;                 ///< PackedRecordWriter is not move-constructible
+  PackedRecordWriter& operator=(PackedRecordWriter&&) = delete;      ///< PackedRecordWriter is not move-assignable
+
+  /**
+   * @brief Writes the record into a new group with the specified name
+   */
+  void write(const daqdataformats::TriggerRecord& tr, const std::string& group_name);
+  void write(const daqdataformats::TimeSlice& ts, const std::string& group_name);
+
+  /**
+   * @brief Returns the number of bytes of record data that have been written
+   */
+  size_t get_recorded_size() const { return m_recorded_size; }
+
+  const std::string& get_file_name() const { return m_file_name; }
+
+private:
+  void write_record(const std::string& group_name,
+                    packedrecord::RecordType record_type,
+                    uint64_t record_number,   // NOLINT(build/unsigned)
+                    uint32_t sequence_number, // NOLINT(build/unsigned)
+                    const void* header_data,
+                    size_t header_size,
+                    const std::vector<std::unique_ptr<daqdataformats::Fragment>>& fragments);
+
+  std::string m_file_name;
+  hid_t m_file_id;
+  hid_t m_index_type;
+  size_t m_recorded_size;
+};
+
+class PackedRecordReader
+{
+public:
+  using record_id_t = std::pair<uint64_t, daqdataformats::sequence_number_t>; // NOLINT(build/unsigned)
+
+  /**
+   * @brief PackedRecordReader Constructor.  The file is opened read-only, and the
+   * records that it contains are listed.  A PackedRecordProblem is thrown if the file
+   * can't be opened or if it does not use the packed layout.
+   */
+  explicit PackedRecordReader(const std::string& hdf5_file_name);
+
+  ~PackedRecordReader();
+
+  PackedRecordReader(const PackedRecordReader&) = delete;            ///< PackedRecordReader is not copy-constructible
+  PackedRecordReader& operator=(const PackedRecordReader&) = delete; ///< PackedRecordReader is not copy-assignable
+  PackedRecordReader(PackedRecordReader&&) = delete;                 ///< PackedRecordReader is not move-constructible
+  PackedRecordReader& operator=(PackedRecordReader&&) = delete;      ///< PackedRecordReader is not move-assignable
+
+  /**
+   * @brief Whether the specified HDF5 file uses the packed layout
+   */
+  static bool is_packed_file(const std::string& hdf5_file_name);
+
+  std::vector<record_id_t> get_record_ids() const;
+  bool has_record(const record_id_t& record_id) const { return m_records.count(record_id) > 0; }
+
+  /**
+   * @brief Returns the index table of the specified record
+   */
+  std::vector<packedrecord::IndexEntry> get_index(const record_id_t& record_id) const;
+
+  std::unique_ptr<daqdataformats::TriggerRecord> read_trigger_record(const record_id_t& record_id) const;
+  std::unique_ptr<daqdataformats::TimeSlice> read_time_slice(uint64_t timeslice_number) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief Reads one Fragment of the record, without reading the rest of the record,
+   * or returns a null pointer if the record has no Fragment from the specified source
+   */
+  std::unique_ptr<daqdataformats::Fragment> read_fragment(const record_id_t& record_id,
+                                                          const daqdataformats::SourceID& source_id) const;
+
+  const std::string& get_file_name() const { return m_file_name; }
+
+private:
+  struct RecordGroup
+  {
+    std::string group_name;
+    packedrecord::RecordType record_type;
+  };
+
+  const RecordGroup& find_record(const record_id_t& record_id) const;
+  std::vector<char> read_data(const std::string& group_name,
+                              uint64_t offset,      // NOLINT(build/unsigned)
+                              uint64_t size) const; // NOLINT(build/unsigned)
+
+  std::string m_file_name;
+  hid_t m_file_id;
+  hid_t m_index_type;
+  std::map<record_id_t, RecordGroup> m_records;
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_PACKEDRECORDFILE_HPP_
@@ -0,0 +1,95 @@
+/**
+ * @file PackedRecordFormat.hpp
+ *
+ * This file contains the description of the "packed" record layout of the HDF5
+ * files that the HDF5DataStore writes when it is configured to do so.  Instead
+ * of one dataset per Fragment, in groups that follow the path parameters of the
+ * file layout, each record is written as a single group with two datasets: a
+ * byte dataset that holds the record header and all of the Fragments back-to-back,
+ * and a small index table with the offset, size, and SourceID of each of them.
+ * This keeps the number of HDF5 objects per record constant, no matter how many
+ * Fragments the record has.
+ *
+ * The record group has the same name as in the standard layout.  The record
+ * number, sequence number, and record type are stored as attributes of the data
+ * dataset, and the file has a "record_layout" attribute with the value "packed".
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_PACKEDRECORDFORMAT_HPP_
+#define DFMODULES_SRC_DFMODULES_PACKEDRECORDFORMAT_HPP_
+
+#include "ers/Issue.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace dunedaq {
+
+// Disable coverage checking LCOV_EXCL_START
+/**
+ * @brief An ERS Issue for problems with reading or writing records in the packed layout
+ */
+ERS_DECLARE_ISSUE(dfmodules,
+                  PackedRecordProblem,
+                  "A problem was encountered when " << operation << " packed records in file \"" << file_name
+                                                    << "\": " << details,
+                  ((std::string)operation)((std::string)file_name)((std::string)details))
+// Re-enable coverage checking LCOV_EXCL_STOP
+
+namespace dfmodules {
+namespace packedrecord {
+
+/**
+ * @brief Name and value of the file attribute that identifies the layout
+ */
+constexpr const char* s_layout_attribute_name = "record_layout";
+constexpr const char* s_layout_name = "packed";
+
+/**
+ * @brief Names of the datasets in each record group
+ */
+constexpr const char* s_data_dataset_name = "PackedData";
+constexpr const char* s_index_dataset_name = "PackedIndex";
+
+/**
+ * @brief Names of the attributes of the data dataset
+ */
+constexpr const char* s_record_number_attribute_name = "record_number";
+constexpr const char* s_sequence_number_attribute_name = "sequence_number";
+constexpr const char* s_record_type_attribute_name = "record_type";
+
+enum class RecordType : uint32_t // NOLINT(build/unsigned)
+{
+  kTriggerRecord = 1,
+  kTimeSlice = 2
+};
+
+enum class EntryType : uint32_t // NOLINT(build/unsigned)
+{
+  kRecordHeader = 1, ///< the TriggerRecordHeader or TimeSliceHeader, always the first entry
+  kFragment = 2
+};
+
+/**
+ * @brief The index table entry of the record header or of one Fragment
+ */
+struct IndexEntry
+{
+  EntryType entry_type = EntryType::kFragment;
+  uint32_t subsystem = 0;     // NOLINT(build/unsigned) of the SourceID of the Fragment
+  uint32_t element_id = 0;    // NOLINT(build/unsigned) of the SourceID of the Fragment
+  uint32_t fragment_type = 0; // NOLINT(build/unsigned)
+  uint64_t offset = 0;        // NOLINT(build/unsigned) in bytes, from the start of the data dataset
+  uint64_t size = 0;          // NOLINT(build/unsigned) in bytes
+};
+static_assert(sizeof(IndexEntry) == 32, "The size of the packed record IndexEntry has changed");
+
+} // namespace packedrecord
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_PACKEDRECORDFORMAT_HPP_
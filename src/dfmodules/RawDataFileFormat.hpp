@@ -0,0 +1,107 @@
+/**
+ * @file RawDataFileFormat.hpp
+ *
+ * This file contains the description of the flat binary file format that is
+ * written by the RawDataStore.  A file consists of a FileHeader followed by
+ * data blocks.  Each data block starts with a BlockHeader, followed by the
+ * header of the TriggerRecord or TimeSlice and by its Fragments, laid out
+ * back-to-back.  The sizes of the record header and of the Fragments are
+ * self-describing, so that the file can be read sequentially without an index.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_RAWDATAFILEFORMAT_HPP_
+#define DFMODULES_SRC_DFMODULES_RAWDATAFILEFORMAT_HPP_
+
+#include "ers/Issue.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace dunedaq {
+
+// Disable coverage checking LCOV_EXCL_START
+/**
+ * @brief An ERS Issue for problems with reading or writing raw data files
+ */
+ERS_DECLARE_ISSUE(dfmodules,
+                  RawDataFileProblem,
+                  "A problem was encountered when " << operation << " raw data file \"" << file_name
+                                                    << "\": " << details,
+                  ((std::string)operation)((std::string)file_name)((std::string)details))
+// Re-enable coverage checking LCOV_EXCL_STOP
+
+namespace dfmodules {
+namespace rawdatafile {
+
+constexpr uint32_t s_file_header_marker = 0x46574152;  // NOLINT(build/unsigned) "RAWF" on little-endian hosts
+constexpr uint32_t s_block_header_marker = 0x42574152; // NOLINT(build/unsigned) "RAWB" on little-endian hosts
+constexpr uint32_t s_current_version = 1;              // NOLINT(build/unsigned)
+
+/**
+ * @brief Alignment (in bytes) of the buffers, offsets and sizes that are used for direct I/O
+ */
+constexpr size_t s_direct_io_alignment = 4096;
+
+constexpr size_t s_max_string_length = 64;
+
+enum class BlockType : uint32_t // NOLINT(build/unsigned)
+{
+  kTriggerRecord = 1,
+  kTimeSlice = 2
+};
+
+/**
+ * @brief The header at the start of each raw data file
+ */
+struct FileHeader
+{
+  uint32_t marker = s_file_header_marker;     // NOLINT(build/unsigned)
+  uint32_t version = s_current_version;       // NOLINT(build/unsigned)
+  uint32_t header_size = sizeof(FileHeader);  // NOLINT(build/unsigned)
+  uint32_t unused = 0;                        // NOLINT(build/unsigned)
+  uint64_t run_number = 0;                    // NOLINT(build/unsigned)
+  uint64_t file_index = 0;                    // NOLINT(build/unsigned)
+  uint64_t creation_time = 0;                 // NOLINT(build/unsigned) seconds since the epoch
+  char writer_identifier[s_max_string_length] = { 0 };
+  char operational_environment[s_max_string_length] = { 0 };
+};
+static_assert(sizeof(FileHeader) == 168, "The size of the raw data FileHeader has changed");
+
+/**
+ * @brief The header at the start of each data block in a raw data file
+ */
+struct BlockHeader
+{
+  uint32_t marker = s_block_header_marker;    // NOLINT(build/unsigned)
+  BlockType block_type = BlockType::kTriggerRecord;
+  uint64_t block_size_bytes = 0;              // NOLINT(build/unsigned) includes the size of this header
+  uint64_t record_number = 0;                 // NOLINT(build/unsigned) trigger or timeslice number
+  uint64_t sequence_number = 0;               // NOLINT(build/unsigned)
+  uint64_t run_number = 0;                    // NOLINT(build/unsigned)
+  uint32_t record_header_size = 0;            // NOLINT(build/unsigned)
+  uint32_t num_fragments = 0;                 // NOLINT(build/unsigned)
+};
+static_assert(sizeof(BlockHeader) == 48, "The size of the raw data BlockHeader has changed");
+
+/**
+ * @brief Copies the specified string into a fixed-size, null-terminated character array
+ */
+inline void
+copy_string(char (&destination)[s_max_string_length], const std::string& source)
+{
+  size_t length = std::min(source.size(), s_max_string_length - 1);
+  source.copy(destination, length);
+  destination[length] = '\0';
+}
+
+} // namespace rawdatafile
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_RAWDATAFILEFORMAT_HPP_
@@ -0,0 +1,83 @@
+/**
+ * @file RawDataFileReader.hpp RawDataFileReader Class
+ *
+ * The RawDataFileReader class reads the TriggerRecords and TimeSlices from a
+ * flat binary file that was written by the RawDataFileWriter (see RawDataFileFormat.hpp).
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_RAWDATAFILEREADER_HPP_
+#define DFMODULES_SRC_DFMODULES_RAWDATAFILEREADER_HPP_
+
+#include "dfmodules/RawDataFileFormat.hpp"
+
+#include "daqdataformats/Fragment.hpp"
+#include "daqdataformats/TimeSlice.hpp"
+#include "daqdataformats/TriggerRecord.hpp"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace dfmodules {
+
+class RawDataFileReader
+{
+public:
+  /**
+   * @brief RawDataFileReader Constructor.  The file is opened and its FileHeader is
+   * read and validated.
+   */
+  explicit RawDataFileReader(const std::string& file_name);
+
+  RawDataFileReader(const RawDataFileReader&) = delete;            ///< RawDataFileReader is not copy-constructible
+  RawDataFileReader& operator=(const RawDataFileReader&) = delete; ///< RawDataFileReader is not copy-assignable
+  RawDataFileReader(RawDataFileReader&&) = delete;                 ///< RawDataFileReader is not move-constructible
+  RawDataFileReader& operator=(RawDataFileReader&&) = delete;      ///< RawDataFileReader is not move-assignable
+
+  const rawdatafile::FileHeader& get_file_header() const { return m_file_header; }
+
+  /**
+   * @brief Reads the next data block from the file.
+   * @return false if the end of the file has been reached
+   * An exception is thrown if the data block is corrupt or truncated.
+   */
+  bool read_next_block();
+
+  /**
+   * @brief Returns the header of the data block that was read most recently
+   */
+  const rawdatafile::BlockHeader& get_block_header() const { return m_block_header; }
+
+  /**
+   * @brief Builds a TriggerRecord from the data block that was read most recently.
+   * An exception is thrown if that data block does not contain a TriggerRecord.
+   */
+  std::unique_ptr<daqdataformats::TriggerRecord> get_trigger_record();
+
+  /**
+   * @brief Builds a TimeSlice from the data block that was read most recently.
+   * An exception is thrown if that data block does not contain a TimeSlice.
+   */
+  std::unique_ptr<daqdataformats::TimeSlice> get_time_slice();
+
+private:
+  std::vector<std::unique_ptr<daqdataformats::Fragment>> get_fragments();
+
+  std::string m_file_name;
+  std::ifstream m_stream;
+  rawdatafile::FileHeader m_file_header;
+  rawdatafile::BlockHeader m_block_header;
+  std::vector<char> m_block_payload;
+  size_t m_block_offset;
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_RAWDATAFILEREADER_HPP_
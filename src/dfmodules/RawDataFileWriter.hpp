@@ -0,0 +1,157 @@
+/**
+ * @file RawDataFileWriter.hpp RawDataFileWriter Class
+ *
+ * The RawDataFileWriter class writes TriggerRecords and TimeSlices into a
+ * flat binary file (see RawDataFileFormat.hpp).  The data is collected in a
+ * page-aligned buffer and written to disk in large sequential writes, using
+ * direct I/O (O_DIRECT) when the file system supports it.
+ *
+ * Optionally, the writes are submitted through an IoUringWriteEngine, which
+ * keeps several of them in flight, instead of being done one at a time with
+ * pwrite().  The data is then collected in the buffers of the engine.  In both
+ * cases, sync() writes out the buffered data and syncs it to disk, and
+ * get_durable_size() tells how much of the file is known to be on disk.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_RAWDATAFILEWRITER_HPP_
+#define DFMODULES_SRC_DFMODULES_RAWDATAFILEWRITER_HPP_
+
+#include "dfmodules/IoUringWriteEngine.hpp"
+#include "dfmodules/RawDataFileFormat.hpp"
+
+#include "daqdataformats/TimeSlice.hpp"
+#include "daqdataformats/TriggerRecord.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace dfmodules {
+
+class RawDataFileWriter
+{
+public:
+  /**
+   * @brief RawDataFileWriter Constructor.  The file is created with the in-progress
+   * suffix appended to its name, and the FileHeader is written into it.
+   * @param file_name Name of the file, once it has been closed
+   * @param file_header Header that is written at the start of the file
+   * @param buffer_size Size of the write buffer, rounded up to a multiple of the direct I/O alignment
+   * @param use_direct_io Whether the file should be opened with O_DIRECT
+   * @param in_progress_suffix Suffix that is added to the filename while the file is being written
+   * @param write_engine Engine that the writes are submitted to, or a null pointer for pwrite().  The
+   * engine is used exclusively by this writer until the file is closed, and its buffers are used
+   * instead of a buffer of buffer_size bytes.
+   */
+  RawDataFileWriter(const std::string& file_name,
+                    const rawdatafile::FileHeader& file_header,
+                    size_t buffer_size,
+                    bool use_direct_io,
+                    const std::string& in_progress_suffix = ".writing",
+                    IoUringWriteEngine* write_engine = nullptr);
+
+  /**
+   * @brief Closes the file, if that has not already been done.  Problems that
+   * are found while closing the file are reported as errors.
+   */
+  ~RawDataFileWriter();
+
+  RawDataFileWriter(const RawDataFileWriter&) = delete;            ///< RawDataFileWriter is not copy-constructible
+  RawDataFileWriter& operator=(const RawDataFileWriter&) = delete; ///< RawDataFileWriter is not copy-assignable
+  RawDataFileWriter(RawDataFileWriter&&) = delete;                 ///< RawDataFileWriter is not move-constructible
+  RawDataFileWriter& operator=(RawDataFileWriter&&) = delete;      ///< RawDataFileWriter is not move-assignable
+
+  /**
+   * @brief Appends the TriggerRecord to the file.
+   * @return the number of bytes that were added to the file
+   */
+  size_t write(const daqdataformats::TriggerRecord& tr);
+
+  /**
+   * @brief Appends the TimeSlice to the file.
+   * @return the number of bytes that were added to the file
+   */
+  size_t write(const daqdataformats::TimeSlice& ts);
+
+  /**
+   * @brief Writes out the data that is buffered and syncs it to disk.  With a write
+   * engine, the write and the sync are only submitted here, and get_durable_size()
+   * reflects them once they have completed.  The last, partially filled block of the
+   * buffer is written padded with zeroes, and it is written again, with more data, later.
+   */
+  void sync();
+
+  /**
+   * @brief Processes the writes and syncs that have completed, without waiting
+   */
+  void poll_completions();
+
+  /**
+   * @brief Writes out the data that is still buffered, trims the file to its
+   * logical size, syncs it to disk, and removes the in-progress suffix from
+   * the filename.  Calling close() more than once has no effect.
+   */
+  void close();
+
+  const std::string& get_file_name() const { return m_file_name; }
+  const std::string& get_in_progress_file_name() const { return m_in_progress_file_name; }
+  size_t get_recorded_size() const { return m_recorded_size; }
+  size_t get_durable_size() const { return m_durable_size; }
+  bool is_sync_in_flight() const { return !m_sync_sizes.empty(); }
+  bool is_using_direct_io() const { return m_using_direct_io; }
+  bool is_open() const { return m_fd >= 0; }
+
+private:
+  void append(const void* data, size_t size);
+
+  /**
+   * @brief Writes the first size bytes of the current buffer to the file at the current
+   * offset.  With a write engine, the write is submitted, and a free buffer becomes the
+   * current buffer.
+   */
+  void write_current_buffer(size_t size);
+  void take_free_buffer();
+  void process_completions(const std::vector<IoUringWriteEngine::Completion>& completions);
+  void wait_for_engine_requests();
+  void throw_if_write_failed();
+
+  std::string m_file_name;
+  std::string m_in_progress_file_name;
+  int m_fd;
+  bool m_using_direct_io;
+
+  // Write buffer
+  std::unique_ptr<char, decltype(&std::free)> m_buffer;
+  char* m_current_buffer;
+  size_t m_buffer_size;
+  size_t m_buffer_fill;
+
+  // Bytes that have been handed to the operating system, the logical size of the file,
+  // and the part of the file that is known to be on disk
+  size_t m_file_offset;
+  size_t m_recorded_size;
+  size_t m_durable_size;
+
+  // Writes through the io_uring engine: the buffer that is being filled, the buffers that
+  // are not in flight, the length of the write of each buffer, and the file sizes that are
+  // covered by the syncs in flight (which complete in order)
+  IoUringWriteEngine* m_write_engine;
+  size_t m_current_buffer_index;
+  std::vector<size_t> m_free_buffers;
+  std::vector<size_t> m_write_lengths;
+  std::deque<size_t> m_sync_sizes;
+  std::string m_write_error;
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_RAWDATAFILEWRITER_HPP_
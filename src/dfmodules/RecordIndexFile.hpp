@@ -0,0 +1,105 @@
+/**
+ * @file RecordIndexFile.hpp RecordIndexWriter and RecordIndexReader Classes
+ *
+ * The RecordIndexWriter class appends the index entries of the records that are
+ * written to an HDF5 file to its side-car index file, and writes the complete
+ * index into a dataset of the HDF5 file before it is closed.  The RecordIndexReader
+ * class reads a side-car index file, so that readers and recovery tools can find
+ * a record without scanning the groups of the HDF5 file (see RecordIndexFormat.hpp).
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_RECORDINDEXFILE_HPP_
+#define DFMODULES_SRC_DFMODULES_RECORDINDEXFILE_HPP_
+
+#include "dfmodules/RecordIndexFormat.hpp"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace dfmodules {
+
+class RecordIndexWriter
+{
+public:
+  /**
+   * @brief RecordIndexWriter Constructor.  The side-car file is created (or truncated)
+   * and the FileHeader is written into it.
+   */
+  RecordIndexWriter(const std::string& file_name, const recordindex::FileHeader& file_header);
+
+  /**
+   * @brief Closes the side-car file, if that has not already been done.
+   */
+  ~RecordIndexWriter();
+
+  RecordIndexWriter(const RecordIndexWriter&) = delete;            ///< RecordIndexWriter is not copy-constructible
+  RecordIndexWriter& operator=(const RecordIndexWriter&) = delete; ///< RecordIndexWriter is not copy-assignable
+  RecordIndexWriter(RecordIndexWriter&&) = delete;                 ///< RecordIndexWriter is not move-constructible
+  RecordIndexWriter& operator=(RecordIndexWriter&&) = delete;      ///< RecordIndexWriter is not move-assignable
+
+  /**
+   * @brief Appends the entry to the side-car file with a single write, and keeps a
+   * copy for the in-file dataset.
+   */
+  void append(const recordindex::Entry& entry);
+
+  /**
+   * @brief Writes the entries into the recordindex::s_dataset_name dataset at the top
+   * level of the specified HDF5 file, which may be open elsewhere in this process.
+   * The HDF5 mutex needs to be held by the caller.
+   */
+  void write_to_hdf5_file(const std::string& hdf5_file_name) const;
+
+  void close();
+
+  const std::string& get_file_name() const { return m_file_name; }
+  const std::vector<recordindex::Entry>& get_entries() const { return m_entries; }
+
+private:
+  std::string m_file_name;
+  int m_fd;
+  std::vector<recordindex::Entry> m_entries;
+};
+
+class RecordIndexReader
+{
+public:
+  /**
+   * @brief RecordIndexReader Constructor.  The complete side-car file is read and
+   * validated; an incomplete entry at the end of the file is ignored.
+   */
+  explicit RecordIndexReader(const std::string& file_name);
+
+  RecordIndexReader(const RecordIndexReader&) = delete;            ///< RecordIndexReader is not copy-constructible
+  RecordIndexReader& operator=(const RecordIndexReader&) = delete; ///< RecordIndexReader is not copy-assignable
+  RecordIndexReader(RecordIndexReader&&) = delete;                 ///< RecordIndexReader is not move-constructible
+  RecordIndexReader& operator=(RecordIndexReader&&) = delete;      ///< RecordIndexReader is not move-assignable
+
+  const recordindex::FileHeader& get_file_header() const { return m_file_header; }
+  const std::vector<recordindex::Entry>& get_entries() const { return m_entries; }
+
+  /**
+   * @brief Returns the entry of the specified record, or a null pointer if it is not in the index
+   */
+  const recordindex::Entry* find_entry(uint64_t record_number,          // NOLINT(build/unsigned)
+                                       uint32_t sequence_number) const; // NOLINT(build/unsigned)
+
+private:
+  std::string m_file_name;
+  recordindex::FileHeader m_file_header;
+  std::vector<recordindex::Entry> m_entries;
+  std::map<std::pair<uint64_t, uint32_t>, size_t> m_entry_lookup; // NOLINT(build/unsigned)
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_RECORDINDEXFILE_HPP_
@@ -0,0 +1,110 @@
+/**
+ * @file RecordIndexFormat.hpp
+ *
+ * This file contains the description of the record index that the HDF5DataStore
+ * writes next to each of its output files (a "side-car" file), and into a
+ * dataset in the output file itself when the file is closed.  The side-car file
+ * consists of a FileHeader followed by fixed-size Entries, one per record that
+ * was written, in the order in which they were written.  Each Entry is appended
+ * with a single write as soon as its record has been handed to the HDF5 library,
+ * so the side-car of a file that was left behind by a crashed writer lists the
+ * records that it should contain.  An incomplete Entry at the end of the file is
+ * ignored by readers.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_RECORDINDEXFORMAT_HPP_
+#define DFMODULES_SRC_DFMODULES_RECORDINDEXFORMAT_HPP_
+
+#include "ers/Issue.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace dunedaq {
+
+// Disable coverage checking LCOV_EXCL_START
+/**
+ * @brief An ERS Issue for problems with reading or writing record index files
+ */
+ERS_DECLARE_ISSUE(dfmodules,
+                  RecordIndexProblem,
+                  "A problem was encountered when " << operation << " record index \"" << file_name
+                                                    << "\": " << details,
+                  ((std::string)operation)((std::string)file_name)((std::string)details))
+// Re-enable coverage checking LCOV_EXCL_STOP
+
+namespace dfmodules {
+namespace recordindex {
+
+constexpr uint32_t s_file_header_marker = 0x58444952; // NOLINT(build/unsigned) "RIDX" on little-endian hosts
+constexpr uint32_t s_current_version = 1;             // NOLINT(build/unsigned)
+
+constexpr size_t s_max_group_path_length = 64;
+
+/**
+ * @brief Name of the dataset, at the top level of the HDF5 file, that holds the index
+ */
+constexpr const char* s_dataset_name = "RecordIndex";
+
+/**
+ * @brief Suffix that is added to the name of the HDF5 file to form the name of the side-car file
+ */
+constexpr const char* s_side_car_suffix = ".index";
+
+enum class RecordType : uint32_t // NOLINT(build/unsigned)
+{
+  kTriggerRecord = 1,
+  kTimeSlice = 2
+};
+
+/**
+ * @brief The header at the start of each side-car index file
+ */
+struct FileHeader
+{
+  uint32_t marker = s_file_header_marker;    // NOLINT(build/unsigned)
+  uint32_t version = s_current_version;      // NOLINT(build/unsigned)
+  uint32_t header_size = sizeof(FileHeader); // NOLINT(build/unsigned)
+  uint32_t entry_size = 0;                   // NOLINT(build/unsigned) sizeof(Entry) when the file was written
+  uint64_t run_number = 0;                   // NOLINT(build/unsigned)
+  uint64_t file_index = 0;                   // NOLINT(build/unsigned)
+};
+static_assert(sizeof(FileHeader) == 32, "The size of the record index FileHeader has changed");
+
+/**
+ * @brief The index entry of one record
+ */
+struct Entry
+{
+  uint64_t record_number = 0;   // NOLINT(build/unsigned) trigger or timeslice number
+  uint32_t sequence_number = 0; // NOLINT(build/unsigned)
+  RecordType record_type = RecordType::kTriggerRecord;
+  uint64_t timestamp = 0;       // NOLINT(build/unsigned) trigger timestamp, zero for TimeSlices
+  uint64_t trigger_type = 0;    // NOLINT(build/unsigned) zero for TimeSlices
+  uint64_t size_bytes = 0;      // NOLINT(build/unsigned) size of the record as it was written
+  char group_path[s_max_group_path_length] = { 0 }; ///< path of the HDF5 group of the record
+};
+static_assert(sizeof(Entry) == 104, "The size of the record index Entry has changed");
+
+/**
+ * @brief Copies the specified string into a fixed-size, null-terminated character array
+ */
+inline void
+copy_group_path(char (&destination)[s_max_group_path_length], const std::string& source)
+{
+  size_t length = std::min(source.size(), s_max_group_path_length - 1);
+  source.copy(destination, length);
+  destination[length] = '\0';
+}
+
+} // namespace recordindex
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_RECORDINDEXFORMAT_HPP_
@@ -0,0 +1,148 @@
+/**
+ * @file SharedMemoryRing.hpp SharedMemoryRing Class
+ *
+ * The SharedMemoryRing class is a single-producer, single-consumer queue of messages
+ * in a shared memory region, which connects a process to a child process that it has
+ * started.  The region is backed by an anonymous memory file, whose file descriptor is
+ * inherited by the child process, and the messages are copied into and read from the
+ * region without any system call, except for the futex calls that wake a side that
+ * waits for data or for space.
+ *
+ * Each message has a type and a payload.  A message is written from a list of parts
+ * (e.g. a header and the Fragments of a record), so that it does not need to be
+ * assembled first, and it is read in place, so that it does not need to be copied out.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_SHAREDMEMORYRING_HPP_
+#define DFMODULES_SRC_DFMODULES_SHAREDMEMORYRING_HPP_
+
+#include "utilities/NamedObject.hpp"
+
+#include "ers/Issue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+
+// Disable coverage checking LCOV_EXCL_START
+ERS_DECLARE_ISSUE(dfmodules,
+                  SharedMemoryRingProblem,
+                  "A problem was encountered when " << operation << " the shared memory ring \"" << ring_name
+                                                    << "\": " << details,
+                  ((std::string)operation)((std::string)ring_name)((std::string)details))
+
+ERS_DECLARE_ISSUE(dfmodules,
+                  MessageTooLargeForSharedMemoryRing,
+                  "A message of " << message_size << " bytes does not fit into the shared memory ring \"" << ring_name
+                                  << "\", which has a capacity of " << capacity << " bytes",
+                  ((size_t)message_size)((std::string)ring_name)((size_t)capacity))
+// Re-enable coverage checking LCOV_EXCL_STOP
+
+namespace dfmodules {
+
+class SharedMemoryRing : public utilities::NamedObject
+{
+public:
+  /**
+   * @brief A contiguous piece of the payload of a message
+   */
+  struct Part
+  {
+    const void* data;
+    size_t size;
+  };
+
+  /**
+   * @brief SharedMemoryRing Constructor.  Creates a new ring, whose file descriptor
+   * (see get_fd()) is inherited by child processes.
+   * @param name Name of the ring, used in messages and as the name of the memory file
+   * @param capacity_bytes Size of the data area, rounded up to a multiple of 4096 bytes
+   */
+  SharedMemoryRing(const std::string& name, size_t capacity_bytes);
+
+  /**
+   * @brief Attaches to a ring that was created by the parent process, from the file
+   * descriptor that was inherited from it.  The ring takes ownership of the descriptor.
+   */
+  static std::unique_ptr<SharedMemoryRing> attach(const std::string& name, int fd);
+
+  ~SharedMemoryRing();
+
+  SharedMemoryRing(const SharedMemoryRing&) = delete;            ///< SharedMemoryRing is not copy-constructible
+  SharedMemoryRing& operator=(const SharedMemoryRing&) = delete; ///< SharedMemoryRing is not copy-assignable
+  SharedMemoryRing(SharedMemoryRing&&) = delete;                 ///< SharedMemoryRing is not move-constructible
+  SharedMemoryRing& operator=(SharedMemoryRing&&) = delete;      ///< SharedMemoryRing is not move-assignable
+
+  /**
+   * @brief Writes a message, waiting up to the specified time for space in the ring.
+   * Only one thread (in one process) may write to a ring.
+   * @return false if there was no space in time, or if the ring has been closed
+   */
+  bool write_message(uint32_t type, const std::vector<Part>& parts, std::chrono::milliseconds timeout); // NOLINT
+
+  /**
+   * @brief Returns the payload of the next message, waiting up to the specified time
+   * for one.  The payload stays valid, in the ring, until consume_message() is called.
+   * Only one thread (in one process) may read from a ring.
+   * @return the payload, or a null pointer if no message arrived in time
+   */
+  const char* peek_message(uint32_t& type, size_t& size, std::chrono::milliseconds timeout); // NOLINT
+
+  /**
+   * @brief Releases the space of the message that was returned by peek_message()
+   */
+  void consume_message();
+
+  /**
+   * @brief Marks the ring as closed, which makes the waits of both sides return.
+   * Messages that were written before are still read.
+   */
+  void close();
+  bool is_closed() const;
+
+  int get_fd() const { return m_fd; }
+  size_t get_capacity() const { return m_capacity; }
+  size_t get_used_bytes() const;
+
+  /**
+   * @brief The size that a message with the specified payload size takes in the ring
+   */
+  static size_t get_message_size(size_t payload_size);
+
+private:
+  struct AttachTag
+  {};
+  SharedMemoryRing(const std::string& name, int fd, AttachTag);
+
+  struct Header;
+  struct MessageHeader;
+
+  void map_region(size_t region_size);
+  void wait_for_change(std::atomic<uint32_t>& sequence, // NOLINT(build/unsigned)
+                       uint32_t observed_value,          // NOLINT(build/unsigned)
+                       std::chrono::steady_clock::time_point deadline);
+  void notify(std::atomic<uint32_t>& sequence); // NOLINT(build/unsigned)
+  bool wait_for_space(size_t size, std::chrono::steady_clock::time_point deadline);
+
+  int m_fd;
+  size_t m_capacity;
+  size_t m_region_size;
+  Header* m_header;
+  char* m_data;
+  size_t m_peeked_size;
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_SHAREDMEMORYRING_HPP_
@@ -0,0 +1,160 @@
+/**
+ * @file SliceStreamFile.hpp SliceStreamWriter and SliceStreamReader Classes
+ *
+ * The SliceStreamWriter class appends the Fragments of TimeSlices to the
+ * per-SourceID row datasets of an HDF5 file in the appended TimeSlice layout (see
+ * SliceStreamFormat.hpp), and the SliceStreamReader class reads the
+ * rows back, by TimeSlice or by time range.
+ *
+ * Both classes use the HDF5 library directly, so the HDF5 mutex needs to be held
+ * by the caller for all of their methods, including the constructors and destructors.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_SLICESTREAMFILE_HPP_
+#define DFMODULES_SRC_DFMODULES_SLICESTREAMFILE_HPP_
+
+#include "dfmodules/SliceStreamFormat.hpp"
+
+#include "daqdataformats/SourceID.hpp"
+#include "daqdataformats/TimeSlice.hpp"
+
+#include "hdf5.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace dfmodules {
+
+class SliceStreamWriter
+{
+public:
+  /**
+   * @brief SliceStreamWriter Constructor.  The HDF5 file needs to exist already; when
+   * it is open elsewhere in this process, this writer shares that open file, so it needs to
+   * be destroyed before the other handle is closed.
+   * @param hdf5_file_name Name of the HDF5 file
+   * @param row_size Size of the rows that the Fragment payloads consist of, in bytes
+   * @param chunk_size_bytes Approximate size of the chunks of the row datasets
+   */
+  SliceStreamWriter(const std::string& hdf5_file_name, size_t row_size, size_t chunk_size_bytes);
+
+  ~SliceStreamWriter();
+
+  SliceStreamWriter(const SliceStreamWriter&) = delete;            ///< SliceStreamWriter is not copy-constructible
+  SliceStreamWriter& operator=(const SliceStreamWriter&) = delete; ///< SliceStreamWriter is not copy-assignable
+  SliceStreamWriter(SliceStreamWriter&&) = delete;                 ///< SliceStreamWriter is not move-constructible
+  SliceStreamWriter& operator=(SliceStreamWriter&&) = delete;      ///< SliceStreamWriter is not move-assignable
+
+  /**
+   * @brief Appends the payloads of the Fragments of the TimeSlice to the row datasets of
+   * their SourceIDs, and their entries to the SliceIndex.  A SliceStreamProblem is
+   * thrown, and nothing is written, if a payload is not a whole number of rows.
+   */
+  void write(const daqdataformats::TimeSlice& ts);
+
+  /**
+   * @brief Returns the number of bytes of rows and SliceIndex entries that have been written
+   */
+  size_t get_recorded_size() const { return m_recorded_size; }
+
+  const std::string& get_file_name() const { return m_file_name; }
+
+private:
+  /**
+   * @brief Returns the dataset of the specified name in the group, creating it if needed,
+   * and the number of rows that it has
+   */
+  std::pair<hid_t, uint64_t> open_or_create_dataset(const std::string& dataset_name, // NOLINT(build/unsigned)
+                                                    hid_t type_id,
+                                                    size_t chunk_rows);
+  void append(hid_t dataset_id,
+              hid_t type_id,
+              uint64_t first_row, // NOLINT(build/unsigned)
+              uint64_t row_count, // NOLINT(build/unsigned)
+              const void* data);
+
+  std::string m_file_name;
+  size_t m_row_size;
+  size_t m_chunk_rows;
+  hid_t m_file_id;
+  hid_t m_group_id;
+  hid_t m_row_type;
+  hid_t m_entry_type;
+  hid_t m_slice_index_id;
+  uint64_t m_slice_index_rows; // NOLINT(build/unsigned)
+
+  struct RowDataset
+  {
+    hid_t id;
+    uint64_t rows; // NOLINT(build/unsigned)
+  };
+  std::map<std::pair<uint32_t, uint32_t>, RowDataset> m_row_datasets; // NOLINT(build/unsigned)
+  size_t m_recorded_size;
+};
+
+class SliceStreamReader
+{
+public:
+  /**
+   * @brief SliceStreamReader Constructor.  The file is opened read-only, and its
+   * SliceIndex is read.  A SliceStreamProblem is thrown if the file can't be opened
+   * or if it has no appended TimeSlices.
+   */
+  explicit SliceStreamReader(const std::string& hdf5_file_name);
+
+  ~SliceStreamReader();
+
+  SliceStreamReader(const SliceStreamReader&) = delete;            ///< SliceStreamReader is not copy-constructible
+  SliceStreamReader& operator=(const SliceStreamReader&) = delete; ///< SliceStreamReader is not copy-assignable
+  SliceStreamReader(SliceStreamReader&&) = delete;                 ///< SliceStreamReader is not move-constructible
+  SliceStreamReader& operator=(SliceStreamReader&&) = delete;      ///< SliceStreamReader is not move-assignable
+
+  size_t get_row_size() const { return m_row_size; }
+  const std::vector<slicestream::SliceEntry>& get_slice_index() const { return m_slice_index; }
+  std::vector<daqdataformats::SourceID> get_source_ids() const;
+
+  /**
+   * @brief Reads row_count rows of the specified SourceID, starting at first_row
+   */
+  std::vector<char> read_rows(const daqdataformats::SourceID& source_id,
+                              uint64_t first_row,        // NOLINT(build/unsigned)
+                              uint64_t row_count) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief Reads the rows of the specified SourceID in the specified TimeSlice, which
+   * are empty if the TimeSlice had no Fragment from that SourceID
+   */
+  std::vector<char> read_time_slice_rows(uint64_t timeslice_number, // NOLINT(build/unsigned)
+                                         const daqdataformats::SourceID& source_id) const;
+
+  /**
+   * @brief Reads the rows of the specified SourceID in all of the TimeSlices whose time
+   * windows overlap with [begin, end), with a single read
+   */
+  std::vector<char> read_time_range_rows(const daqdataformats::SourceID& source_id,
+                                         uint64_t begin,     // NOLINT(build/unsigned)
+                                         uint64_t end) const; // NOLINT(build/unsigned)
+
+  const std::string& get_file_name() const { return m_file_name; }
+
+private:
+  std::string m_file_name;
+  hid_t m_file_id;
+  hid_t m_group_id;
+  size_t m_row_size;
+  std::vector<slicestream::SliceEntry> m_slice_index;
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_SLICESTREAMFILE_HPP_
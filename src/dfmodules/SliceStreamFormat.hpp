@@ -0,0 +1,92 @@
+/**
+ * @file SliceStreamFormat.hpp
+ *
+ * This file contains the description of the "appended" TimeSlice layout of the
+ * HDF5 files that the HDF5DataStore writes when it is configured to do so, which
+ * is meant for the continuous TriggerPrimitive stream.  Instead of new groups and
+ * datasets for each TimeSlice, the Fragment payloads of each SourceID, which are
+ * arrays of fixed-size rows (TriggerPrimitives), are appended to one extendible,
+ * chunked dataset per SourceID.  A companion SliceIndex dataset, which is also
+ * extendible, has one entry per TimeSlice and SourceID with the time window of
+ * the Fragment and the range of rows that it was appended as, so that the rows
+ * of a TimeSlice or of a time range can be found without reading the rows.
+ *
+ * All of these datasets are in the s_group_name group at the top level of the
+ * file.  The row datasets have an opaque type of the row size, which is also
+ * stored in the s_row_size_attribute_name attribute of the group.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_SLICESTREAMFORMAT_HPP_
+#define DFMODULES_SRC_DFMODULES_SLICESTREAMFORMAT_HPP_
+
+#include "ers/Issue.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace dunedaq {
+
+// Disable coverage checking LCOV_EXCL_START
+/**
+ * @brief An ERS Issue for problems with reading or writing appended TimeSlices
+ */
+ERS_DECLARE_ISSUE(dfmodules,
+                  SliceStreamProblem,
+                  "A problem was encountered when " << operation << " appended TimeSlices in file \"" << file_name
+                                                    << "\": " << details,
+                  ((std::string)operation)((std::string)file_name)((std::string)details))
+// Re-enable coverage checking LCOV_EXCL_STOP
+
+namespace dfmodules {
+namespace slicestream {
+
+/**
+ * @brief Name of the group that holds the datasets
+ */
+constexpr const char* s_group_name = "TimeSliceStream";
+
+/**
+ * @brief Name of the dataset with the SliceEntries
+ */
+constexpr const char* s_slice_index_dataset_name = "SliceIndex";
+
+/**
+ * @brief Name of the group attribute with the size of the rows, in bytes
+ */
+constexpr const char* s_row_size_attribute_name = "row_size";
+
+/**
+ * @brief Returns the name of the row dataset of the specified SourceID
+ */
+inline std::string
+get_row_dataset_name(uint32_t subsystem, uint32_t element_id) // NOLINT(build/unsigned)
+{
+  return "SourceID_" + std::to_string(subsystem) + "_" + std::to_string(element_id);
+}
+
+/**
+ * @brief The SliceIndex entry of the Fragment of one SourceID in one TimeSlice
+ */
+struct SliceEntry
+{
+  uint64_t timeslice_number = 0; // NOLINT(build/unsigned)
+  uint32_t run_number = 0;       // NOLINT(build/unsigned)
+  uint32_t subsystem = 0;        // NOLINT(build/unsigned) of the SourceID of the Fragment
+  uint32_t element_id = 0;       // NOLINT(build/unsigned) of the SourceID of the Fragment
+  uint32_t fragment_type = 0;    // NOLINT(build/unsigned)
+  uint64_t window_begin = 0;     // NOLINT(build/unsigned) of the Fragment
+  uint64_t window_end = 0;       // NOLINT(build/unsigned) of the Fragment
+  uint64_t first_row = 0;        // NOLINT(build/unsigned) in the row dataset of the SourceID
+  uint64_t row_count = 0;        // NOLINT(build/unsigned)
+};
+static_assert(sizeof(SliceEntry) == 56, "The size of the appended TimeSlice SliceEntry has changed");
+
+} // namespace slicestream
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_SLICESTREAMFORMAT_HPP_
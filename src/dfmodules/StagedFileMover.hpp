@@ -0,0 +1,167 @@
+/**
+ * @file StagedFileMover.hpp StagedFileMover Class
+ *
+ * The StagedFileMover class moves files that have been written to a fast, local
+ * staging directory to a bulk destination directory on a background thread.  The
+ * contents are copied in the kernel (copy_file_range, or sendfile when the two
+ * directories are on different file systems and copy_file_range can't be used),
+ * the copy is synced to disk and its size is checked, and only then is it renamed
+ * to its final name and the staged file deleted.  While a file is being copied, it
+ * has the s_in_progress_suffix suffix in the destination directory.
+ *
+ * The copying can be limited to a maximum rate, so that it does not take the bandwidth
+ * of the bulk storage away from other users.  The limit is not applied while the
+ * staging disk is fuller than the high-water mark, so that the staging disk is
+ * emptied as fast as possible when it fills up.
+ *
+ * A file that can't be moved is reported and left in the staging directory.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_STAGEDFILEMOVER_HPP_
+#define DFMODULES_SRC_DFMODULES_STAGEDFILEMOVER_HPP_
+
+#include "dfmodules/LatencyHistogram.hpp"
+
+#include "opmonlib/InfoCollector.hpp"
+#include "utilities/NamedObject.hpp"
+
+#include "ers/Issue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace dunedaq {
+
+// Disable coverage checking LCOV_EXCL_START
+ERS_DECLARE_ISSUE(dfmodules,
+                  StagedFileMoveProblem,
+                  "A problem was encountered when moving staged file " << file_name << " to " << destination_directory
+                                                                       << ", so it was left in place: " << details,
+                  ((std::string)file_name)((std::string)destination_directory)((std::string)details))
+// Re-enable coverage checking LCOV_EXCL_STOP
+
+namespace dfmodules {
+
+class StagedFileMover : public utilities::NamedObject
+{
+public:
+  /**
+   * @brief Where the files are moved to, and how fast
+   */
+  struct Policy
+  {
+    std::string destination_directory;
+    size_t max_bytes_per_second = 0;      ///< 0 disables the limit
+    double staging_high_water_mark = 1.0; ///< fraction of the staging disk
+    size_t copy_chunk_size = 8 * 1024 * 1024;
+  };
+
+  /**
+   * @brief Suffix of a file while it is being copied to the destination directory
+   */
+  static constexpr const char* s_in_progress_suffix = ".moving";
+
+  /**
+   * @brief StagedFileMover Constructor, which starts the background thread
+   * @param parent_name Name of the object that owns this instance
+   * @param policy The destination directory and the rate limit
+   */
+  StagedFileMover(const std::string& parent_name, const Policy& policy);
+
+  /**
+   * @brief Moves the files that are still queued, without the rate limit, and stops
+   * the background thread
+   */
+  ~StagedFileMover();
+
+  StagedFileMover(const StagedFileMover&) = delete;            ///< StagedFileMover is not copy-constructible
+  StagedFileMover& operator=(const StagedFileMover&) = delete; ///< StagedFileMover is not copy-assignable
+  StagedFileMover(StagedFileMover&&) = delete;                 ///< StagedFileMover is not move-constructible
+  StagedFileMover& operator=(StagedFileMover&&) = delete;      ///< StagedFileMover is not move-assignable
+
+  /**
+   * @brief Queues the specified file, which has been closed, to be moved to the
+   * destination directory.  The files are moved in the order in which they are queued.
+   */
+  void add_file(const std::string& file_name);
+
+  /**
+   * @brief Waits until all of the files that have been queued have been moved, or
+   * have failed to be moved
+   */
+  void wait_until_idle();
+
+  /**
+   * @brief Returns the name that the specified staged file has once it has been moved
+   */
+  std::string get_destination_name(const std::string& file_name) const;
+
+  const Policy& get_policy() const { return m_policy; }
+  size_t get_number_of_queued_files() const;
+  LatencyHistogram& get_move_latency() { return m_move_latency; }
+
+  void get_info(opmonlib::InfoCollector& ci, int level);
+
+private:
+  void do_moves();
+
+  /**
+   * @brief Moves one file.  Problems are reported, rather than thrown, since this
+   * is done on the background thread.
+   * @return whether the file was moved
+   */
+  bool move_file(const std::string& file_name);
+
+  /**
+   * @brief Copies size bytes from in_fd to out_fd, at the configured rate
+   * @return an empty string, or a description of the problem
+   */
+  std::string copy_contents(int in_fd, int out_fd, size_t size, const std::string& staging_directory);
+
+  /**
+   * @brief Waits as long as is needed to keep the copying of a file at the configured
+   * rate, unless the staging disk is above its high-water mark or the mover is stopping
+   */
+  void limit_rate(size_t bytes_copied,
+                  std::chrono::steady_clock::time_point copy_start_time,
+                  const std::string& staging_directory);
+
+  /**
+   * @brief Updates the staging disk usage from the file system of the specified directory
+   * @return whether the usage is above the high-water mark
+   */
+  bool is_above_high_water_mark(const std::string& staging_directory);
+
+  Policy m_policy;
+
+  std::thread m_move_thread;
+  mutable std::mutex m_queue_mutex;
+  std::condition_variable m_queue_cv;
+  std::condition_variable m_idle_cv;
+  std::deque<std::string> m_queue;
+  bool m_move_in_progress;
+  bool m_stop_requested;
+
+  // Monitoring
+  std::atomic<uint64_t> m_files_moved{ 0 };  // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_bytes_moved{ 0 };  // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_failed_moves{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<double> m_staging_disk_usage{ 0.0 };
+  std::atomic<bool> m_above_high_water_mark{ false };
+  LatencyHistogram m_move_latency;
+};
+
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_STAGEDFILEMOVER_HPP_
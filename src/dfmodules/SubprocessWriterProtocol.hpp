@@ -0,0 +1,131 @@
+/**
+ * @file SubprocessWriterProtocol.hpp
+ *
+ * This file contains the description of the messages that the SubprocessDataStore
+ * exchanges with its writer process through two SharedMemoryRings: the request ring
+ * carries commands and serialized records to the writer process, and the reply ring
+ * carries acknowledgements of the commands and write completions back.  The rings are
+ * FIFOs, so all completions of a run are read before the acknowledgement of its
+ * kFinishRun command.
+ *
+ * Records are serialized as a RecordHeader, followed by the TriggerRecordHeader (or
+ * the TimeSliceHeader) and the Fragments, back-to-back, as in a MemoryRecordRing.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef DFMODULES_SRC_DFMODULES_SUBPROCESSWRITERPROTOCOL_HPP_
+#define DFMODULES_SRC_DFMODULES_SUBPROCESSWRITERPROTOCOL_HPP_
+
+#include "dfmodules/SharedMemoryRing.hpp"
+
+#include "daqdataformats/TimeSlice.hpp"
+#include "daqdataformats/TriggerRecord.hpp"
+#include "daqdataformats/Types.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace dunedaq {
+namespace dfmodules {
+namespace subprocesswriter {
+
+/**
+ * @brief Name of the writer executable, which is found in the PATH
+ */
+constexpr const char* s_writer_executable = "dfmodules_subprocess_writer";
+
+enum class MessageType : uint32_t // NOLINT(build/unsigned)
+{
+  // requests, to the writer process
+  kConfigure = 1,     // payload: the JSON configuration of the DataStore of the writer process
+  kPrepareRun = 2,    // payload: RunCommand
+  kTriggerRecord = 3, // payload: a serialized TriggerRecord
+  kTimeSlice = 4,     // payload: a serialized TimeSlice
+  kFinishRun = 5,     // payload: RunCommand
+  kShutdown = 6,      // no payload
+  // replies, from the writer process
+  kAck = 101,       // payload: Ack, followed by the text of the problem, if any
+  kCompletion = 102 // payload: Completion, followed by the text of the problem, if any
+};
+
+struct RunCommand
+{
+  daqdataformats::run_number_t run_number;
+};
+
+struct RecordHeader
+{
+  uint64_t record_number; // NOLINT(build/unsigned) trigger or timeslice number
+  daqdataformats::run_number_t run_number;
+  daqdataformats::sequence_number_t sequence_number;
+  uint16_t reserved;            // NOLINT(build/unsigned)
+  uint64_t header_size;         // NOLINT(build/unsigned) of the TriggerRecordHeader or TimeSliceHeader
+  uint64_t number_of_fragments; // NOLINT(build/unsigned)
+};
+
+struct Ack
+{
+  MessageType command;
+  uint32_t success; // NOLINT(build/unsigned)
+};
+
+struct Completion
+{
+  uint64_t record_number;  // NOLINT(build/unsigned)
+  MessageType record_type; // kTriggerRecord or kTimeSlice
+  daqdataformats::sequence_number_t sequence_number;
+  uint16_t success; // NOLINT(build/unsigned) whether the data has been written; if not, the text says why
+};
+
+/**
+ * @brief Serializes the record into a message in the ring, waiting up to the specified time for space
+ * @return whether the message was written
+ */
+bool
+send_record(SharedMemoryRing& ring, const daqdataformats::TriggerRecord& tr, std::chrono::milliseconds timeout);
+bool
+send_record(SharedMemoryRing& ring, const daqdataformats::TimeSlice& ts, std::chrono::milliseconds timeout);
+
+/**
+ * @brief The size of the message of the record, to check it against the capacity of the ring
+ */
+size_t
+get_message_size(const daqdataformats::TriggerRecord& tr);
+size_t
+get_message_size(const daqdataformats::TimeSlice& ts);
+
+/**
+ * @brief Deserializes the payload of a kTriggerRecord or kTimeSlice message
+ */
+std::unique_ptr<daqdataformats::TriggerRecord>
+make_trigger_record(const char* payload, size_t size);
+std::unique_ptr<daqdataformats::TimeSlice>
+make_time_slice(const char* payload, size_t size);
+
+/**
+ * @brief Writes a message whose payload is a struct, optionally followed by a text
+ */
+template<typename T>
+bool
+send_message(SharedMemoryRing& ring,
+             MessageType type,
+             const T& message,
+             const std::string& text,
+             std::chrono::milliseconds timeout)
+{
+  return ring.write_message(static_cast<uint32_t>(type), // NOLINT(build/unsigned)
+                            { { &message, sizeof(message) }, { text.data(), text.size() } },
+                            timeout);
+}
+
+} // namespace subprocesswriter
+} // namespace dfmodules
+} // namespace dunedaq
+
+#endif // DFMODULES_SRC_DFMODULES_SUBPROCESSWRITERPROTOCOL_HPP_
@@ -0,0 +1,72 @@
+/**
+ * @file DiskSpaceMonitor_test.cxx Test application that tests and demonstrates
+ * the functionality of the DiskSpaceMonitor class.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/DiskSpaceMonitor.hpp"
+
+#define BOOST_TEST_MODULE DiskSpaceMonitor_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+using namespace dunedaq::dfmodules;
+
+BOOST_AUTO_TEST_SUITE(DiskSpaceMonitor_test)
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<DiskSpaceMonitor>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<DiskSpaceMonitor>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<DiskSpaceMonitor>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<DiskSpaceMonitor>);
+}
+
+BOOST_AUTO_TEST_CASE(ValidPath)
+{
+  std::string path = std::filesystem::temp_directory_path().string();
+  DiskSpaceMonitor dsm("test", path, std::chrono::milliseconds(10));
+
+  BOOST_REQUIRE(dsm.is_path_valid());
+  BOOST_REQUIRE_EQUAL(dsm.get_path(), path);
+  BOOST_REQUIRE_GT(dsm.get_total_space(), 0);
+  BOOST_REQUIRE_GE(dsm.get_total_space(), dsm.get_measured_free_space());
+  BOOST_REQUIRE_EQUAL(dsm.get_predicted_free_space(), dsm.get_measured_free_space());
+
+  // writes that are recorded between samples reduce the predicted free space
+  size_t measured = dsm.get_measured_free_space();
+  dsm.record_bytes_written(1000);
+  BOOST_REQUIRE_EQUAL(dsm.get_predicted_free_space(), measured - 1000);
+
+  // a new sample resets the bookkeeping of the written bytes
+  BOOST_REQUIRE(dsm.sample());
+  BOOST_REQUIRE_EQUAL(dsm.get_predicted_free_space(), dsm.get_measured_free_space());
+
+  // the predicted free space never goes below zero
+  dsm.record_bytes_written(dsm.get_measured_free_space() + 1);
+  BOOST_REQUIRE_EQUAL(dsm.get_predicted_free_space(), 0);
+
+  // the monitoring thread takes new samples periodically
+  dsm.start_monitoring();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  dsm.stop_monitoring();
+  BOOST_REQUIRE_EQUAL(dsm.get_predicted_free_space(), dsm.get_measured_free_space());
+}
+
+BOOST_AUTO_TEST_CASE(InvalidPath)
+{
+  DiskSpaceMonitor dsm("test", "/this/path/does/not/exist", std::chrono::milliseconds(10));
+
+  BOOST_REQUIRE(!dsm.is_path_valid());
+  BOOST_REQUIRE_EQUAL(dsm.get_predicted_free_space(), 0);
+  BOOST_REQUIRE(!dsm.sample());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,156 @@
+/**
+ * @file FileSummaryFile_test.cxx Test application that tests and demonstrates
+ * the functionality of the FileSummaryWriter and FileSummaryReader classes.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/FileSummaryFile.hpp"
+#include "dfmodules/RecordIndexFormat.hpp"
+
+#define BOOST_TEST_MODULE FileSummaryFile_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include "hdf5.h"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace dunedaq::dfmodules;
+using namespace dunedaq::daqdataformats;
+
+namespace {
+
+const int s_run_number = 53;
+
+TriggerRecord
+create_trigger_record(uint64_t trig_num, int fragment_size, int element_count) // NOLINT(build/unsigned)
+{
+  TriggerRecordHeaderData trh_data;
+  trh_data.trigger_number = trig_num;
+  trh_data.trigger_timestamp = 1000 + trig_num;
+  trh_data.num_requested_components = element_count;
+  trh_data.run_number = s_run_number;
+  trh_data.sequence_number = 0;
+  trh_data.max_sequence_number = 1;
+  trh_data.element_id = SourceID(SourceID::Subsystem::kTRBuilder, 0);
+  TriggerRecordHeader trh(&trh_data);
+
+  TriggerRecord tr(trh);
+  std::vector<char> dummy_data(fragment_size);
+  for (int ele_num = 0; ele_num < element_count; ++ele_num) {
+    FragmentHeader fh;
+    fh.trigger_number = trig_num;
+    fh.run_number = s_run_number;
+    fh.element_id = SourceID(SourceID::Subsystem::kDetectorReadout, ele_num);
+    auto frag_ptr = std::make_unique<Fragment>(dummy_data.data(), fragment_size);
+    frag_ptr->set_header_fields(fh);
+    tr.add_fragment(std::move(frag_ptr));
+  }
+  return tr;
+}
+
+/**
+ * @brief Creates an empty HDF5 file for a test, and removes it at the end of the test
+ */
+struct TestFile
+{
+  TestFile()
+    : name(std::filesystem::temp_directory_path().string() + "/FileSummaryFile_test_" + std::to_string(getpid()) +
+           ".hdf5")
+  {
+    hid_t file_id = H5Fcreate(name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    H5Fclose(file_id);
+  }
+  ~TestFile() { std::filesystem::remove(name); }
+  std::string name;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(FileSummaryFile_test)
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<FileSummaryWriter>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<FileSummaryWriter>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<FileSummaryWriter>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<FileSummaryWriter>);
+
+  BOOST_REQUIRE(!std::is_copy_constructible_v<FileSummaryReader>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<FileSummaryReader>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<FileSummaryReader>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<FileSummaryReader>);
+}
+
+BOOST_AUTO_TEST_CASE(WriteAndReadBack)
+{
+  TestFile test_file;
+  BOOST_REQUIRE(!FileSummaryReader::has_file_summary(test_file.name));
+
+  FileSummaryWriter writer;
+  TriggerRecord complete_tr = create_trigger_record(1, 100, 3);
+  writer.add(complete_tr);
+  TriggerRecord incomplete_tr = create_trigger_record(2, 200, 2);
+  incomplete_tr.get_header_ref().set_error_bit(TriggerRecordErrorBits::kIncomplete, true);
+  writer.add(incomplete_tr);
+  TimeSlice ts(7, s_run_number);
+  writer.add(ts);
+  writer.write_to_hdf5_file(test_file.name);
+  BOOST_REQUIRE(FileSummaryReader::has_file_summary(test_file.name));
+
+  FileSummaryReader reader(test_file.name);
+  auto const& columns = reader.get_columns();
+  BOOST_REQUIRE_EQUAL(columns.size(), 3);
+  BOOST_REQUIRE_EQUAL(columns.record_number[0], 1);
+  BOOST_REQUIRE_EQUAL(columns.record_number[1], 2);
+  BOOST_REQUIRE_EQUAL(columns.record_number[2], 7);
+  BOOST_REQUIRE_EQUAL(columns.timestamp[1], 1002);
+  BOOST_REQUIRE_EQUAL(columns.fragment_count[0], 3);
+  BOOST_REQUIRE_EQUAL(columns.fragment_count[2], 0);
+  BOOST_REQUIRE_EQUAL(columns.total_bytes[0], complete_tr.get_total_size_bytes());
+  BOOST_REQUIRE_EQUAL(columns.total_bytes[1], incomplete_tr.get_total_size_bytes());
+  BOOST_REQUIRE_EQUAL(columns.error_bits[0], 0);
+  BOOST_REQUIRE_EQUAL(columns.error_bits[1], incomplete_tr.get_header_ref().get_error_bits().to_ulong());
+  BOOST_REQUIRE_NE(columns.error_bits[1], 0);
+  BOOST_REQUIRE_EQUAL(columns.record_type[0], static_cast<uint32_t>(recordindex::RecordType::kTriggerRecord));
+  BOOST_REQUIRE_EQUAL(columns.record_type[2], static_cast<uint32_t>(recordindex::RecordType::kTimeSlice));
+
+  // the summary can only be written once per file
+  BOOST_REQUIRE_THROW(writer.write_to_hdf5_file(test_file.name), FileSummaryProblem);
+}
+
+BOOST_AUTO_TEST_CASE(ColumnsLargerThanCompact)
+{
+  TestFile test_file;
+  FileSummaryWriter writer;
+  const size_t record_count = filesummary::s_max_compact_column_size / sizeof(uint64_t) + 10; // NOLINT
+  TriggerRecord tr = create_trigger_record(1, 10, 1);
+  for (size_t idx = 0; idx < record_count; ++idx) {
+    writer.add(tr);
+  }
+  writer.write_to_hdf5_file(test_file.name);
+
+  FileSummaryReader reader(test_file.name);
+  BOOST_REQUIRE_EQUAL(reader.get_columns().size(), record_count);
+  BOOST_REQUIRE_EQUAL(reader.get_columns().total_bytes.back(), tr.get_total_size_bytes());
+}
+
+BOOST_AUTO_TEST_CASE(FileWithoutSummary)
+{
+  TestFile test_file;
+  BOOST_REQUIRE_THROW(FileSummaryReader reader(test_file.name), FileSummaryProblem);
+  BOOST_REQUIRE_THROW(FileSummaryReader reader(test_file.name + ".missing"), FileSummaryProblem);
+  BOOST_REQUIRE(!FileSummaryReader::has_file_summary(test_file.name + ".missing"));
+
+  FileSummaryWriter writer;
+  BOOST_REQUIRE_THROW(writer.write_to_hdf5_file(test_file.name + ".missing"), FileSummaryProblem);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
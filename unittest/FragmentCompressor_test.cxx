@@ -0,0 +1,127 @@
+/**
+ * @file FragmentCompressor_test.cxx Test application that tests and demonstrates
+ * the functionality of the FragmentCompressor class.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/FragmentCompressor.hpp"
+
+#define BOOST_TEST_MODULE FragmentCompressor_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace dunedaq::dfmodules;
+using namespace dunedaq::daqdataformats;
+
+namespace {
+
+std::unique_ptr<Fragment>
+create_fragment(int element_number, FragmentType fragment_type, int payload_size, bool compressible)
+{
+  std::vector<char> dummy_data(payload_size);
+  std::mt19937 generator(element_number);
+  for (int idx = 0; idx < payload_size; ++idx) {
+    dummy_data[idx] = compressible ? static_cast<char>((idx / 16) % 8) : static_cast<char>(generator());
+  }
+
+  FragmentHeader fh;
+  fh.trigger_number = 1;
+  fh.run_number = 53;
+  fh.fragment_type = static_cast<fragment_type_t>(fragment_type);
+  fh.element_id = SourceID(SourceID::Subsystem::kDetectorReadout, element_number);
+  auto frag_ptr = std::make_unique<Fragment>(dummy_data.data(), payload_size);
+  frag_ptr->set_header_fields(fh);
+  return frag_ptr;
+}
+
+void
+check_fragments_are_equal(const Fragment& expected, const Fragment& actual)
+{
+  BOOST_REQUIRE_EQUAL(expected.get_size(), actual.get_size());
+  BOOST_REQUIRE(std::memcmp(expected.get_storage_location(), actual.get_storage_location(), expected.get_size()) ==
+                0);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(FragmentCompressor_test)
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<FragmentCompressor>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<FragmentCompressor>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<FragmentCompressor>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<FragmentCompressor>);
+}
+
+BOOST_AUTO_TEST_CASE(CompressAndDecompress)
+{
+  auto frag_ptr = create_fragment(1, FragmentType::kWIB, 100000, true);
+  BOOST_REQUIRE(!FragmentCompressor::is_compressed(*frag_ptr));
+
+  for (auto codec : { FragmentCompressor::Codec::kZlib, FragmentCompressor::Codec::kBzip2 }) {
+    auto compressed_ptr = FragmentCompressor::compress_fragment(*frag_ptr, codec, -1);
+    BOOST_REQUIRE(compressed_ptr.get() != nullptr);
+    BOOST_REQUIRE(FragmentCompressor::is_compressed(*compressed_ptr));
+    BOOST_REQUIRE_LT(compressed_ptr->get_size(), frag_ptr->get_size());
+    BOOST_REQUIRE_EQUAL(compressed_ptr->get_trigger_number(), frag_ptr->get_trigger_number());
+    BOOST_REQUIRE_EQUAL(compressed_ptr->get_element_id(), frag_ptr->get_element_id());
+
+    auto decompressed_ptr = FragmentCompressor::decompress_fragment(*compressed_ptr);
+    check_fragments_are_equal(*frag_ptr, *decompressed_ptr);
+  }
+
+  BOOST_REQUIRE_THROW(FragmentCompressor::string_to_codec("no-such-codec"),
+                      dunedaq::dfmodules::InvalidCompressionCodec);
+}
+
+BOOST_AUTO_TEST_CASE(IncompressibleFragmentIsNotCompressed)
+{
+  auto frag_ptr = create_fragment(2, FragmentType::kWIB, 2000, false);
+  BOOST_REQUIRE(FragmentCompressor::compress_fragment(*frag_ptr, FragmentCompressor::Codec::kZlib, 9).get() ==
+                nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(RulesSelectTheCodec)
+{
+  std::vector<FragmentCompressor::Rule> rules;
+  rules.push_back({ fragment_type_to_string(FragmentType::kWIB), "", FragmentCompressor::Codec::kZlib, -1 });
+  rules.push_back({ "", "", FragmentCompressor::Codec::kNone, -1 });
+  FragmentCompressor compressor("test", rules, 3, 1024);
+
+  TriggerRecordHeaderData trh_data;
+  trh_data.trigger_number = 1;
+  trh_data.run_number = 53;
+  trh_data.num_requested_components = 40;
+  TriggerRecordHeader trh(&trh_data);
+  TriggerRecord tr(trh);
+  for (int ele_num = 0; ele_num < 40; ++ele_num) {
+    FragmentType fragment_type = (ele_num % 2) ? FragmentType::kWIB : FragmentType::kTriggerPrimitive;
+    tr.add_fragment(create_fragment(ele_num, fragment_type, 10000, true));
+  }
+  // a WIB fragment that is below the minimum size
+  tr.add_fragment(create_fragment(40, FragmentType::kWIB, 100, true));
+
+  auto compressed_tr = compressor.compress(tr);
+  BOOST_REQUIRE_EQUAL(compressed_tr->get_header_ref().get_trigger_number(), 1);
+  auto const& original_fragments = tr.get_fragments_ref();
+  auto const& compressed_fragments = compressed_tr->get_fragments_ref();
+  BOOST_REQUIRE_EQUAL(compressed_fragments.size(), original_fragments.size());
+  for (size_t idx = 0; idx < original_fragments.size(); ++idx) {
+    bool expect_compression = (idx % 2) && idx < 40;
+    BOOST_REQUIRE_EQUAL(FragmentCompressor::is_compressed(*compressed_fragments[idx]), expect_compression);
+    auto restored_ptr = FragmentCompressor::decompress_fragment(*compressed_fragments[idx]);
+    check_fragments_are_equal(*original_fragments[idx], *restored_ptr);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
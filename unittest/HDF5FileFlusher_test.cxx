@@ -0,0 +1,188 @@
+/**
+ * @file HDF5FileFlusher_test.cxx Test application that tests and demonstrates
+ * the functionality of the HDF5FileFlusher class.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/HDF5FileFlusher.hpp"
+
+#define BOOST_TEST_MODULE HDF5FileFlusher_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace dunedaq::dfmodules;
+
+namespace {
+
+std::string
+get_test_file_name()
+{
+  return std::filesystem::temp_directory_path().string() + "/HDF5FileFlusher_test_" + std::to_string(getpid()) +
+         ".hdf5";
+}
+
+/**
+ * @brief Keeps a new HDF5 file open for the duration of a test, like the HDF5RawDataFile does
+ */
+struct TestFile
+{
+  TestFile()
+    : name(get_test_file_name())
+  {
+    std::filesystem::remove(name);
+    id = H5Fcreate(name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  }
+  ~TestFile()
+  {
+    H5Fclose(id);
+    std::filesystem::remove(name);
+  }
+  std::string name;
+  hid_t id;
+};
+
+uint64_t // NOLINT(build/unsigned)
+get_flush_count(HDF5FileFlusher& flusher)
+{
+  return flusher.get_flush_latency().get_and_reset().count;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(HDF5FileFlusher_test)
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<HDF5FileFlusher>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<HDF5FileFlusher>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<HDF5FileFlusher>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<HDF5FileFlusher>);
+}
+
+BOOST_AUTO_TEST_CASE(FlushingRequested)
+{
+  HDF5FileFlusher::Policy policy;
+  BOOST_REQUIRE(!HDF5FileFlusher::is_flushing_requested(policy));
+  policy.flush_in_background = true;
+  BOOST_REQUIRE(!HDF5FileFlusher::is_flushing_requested(policy));
+  policy.sync_at_close = true;
+  BOOST_REQUIRE(HDF5FileFlusher::is_flushing_requested(policy));
+  policy.sync_at_close = false;
+  policy.bytes_between_flushes = 1048576;
+  BOOST_REQUIRE(HDF5FileFlusher::is_flushing_requested(policy));
+}
+
+BOOST_AUTO_TEST_CASE(RecordAndByteRules)
+{
+  std::mutex hdf5_mutex;
+  TestFile test_file;
+  BOOST_REQUIRE(test_file.id >= 0);
+
+  HDF5FileFlusher::Policy policy;
+  policy.records_between_flushes = 3;
+  policy.bytes_between_flushes = 1000;
+  HDF5FileFlusher flusher("test", policy, hdf5_mutex);
+
+  // nothing is flushed while no file is open
+  flusher.record_write(10, 10000);
+  BOOST_REQUIRE_EQUAL(get_flush_count(flusher), 0);
+
+  flusher.start_file(test_file.name);
+  flusher.record_write(1, 100);
+  flusher.record_write(1, 100);
+  BOOST_REQUIRE_EQUAL(get_flush_count(flusher), 0);
+  flusher.record_write(1, 100);
+  BOOST_REQUIRE_EQUAL(get_flush_count(flusher), 1);
+  BOOST_REQUIRE_EQUAL(flusher.get_sync_latency().get_and_reset().count, 1);
+
+  // the counters start over after a flush
+  flusher.record_write(1, 100);
+  BOOST_REQUIRE_EQUAL(get_flush_count(flusher), 0);
+  flusher.record_write(1, 900);
+  BOOST_REQUIRE_EQUAL(get_flush_count(flusher), 1);
+
+  flusher.finish_file();
+  flusher.record_write(10, 10000);
+  BOOST_REQUIRE_EQUAL(get_flush_count(flusher), 0);
+}
+
+BOOST_AUTO_TEST_CASE(TimeRule)
+{
+  std::mutex hdf5_mutex;
+  TestFile test_file;
+
+  HDF5FileFlusher::Policy policy;
+  policy.time_between_flushes = std::chrono::milliseconds(50);
+  HDF5FileFlusher flusher("test", policy, hdf5_mutex);
+  flusher.start_file(test_file.name);
+
+  flusher.record_write(1, 100);
+  BOOST_REQUIRE_EQUAL(get_flush_count(flusher), 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  flusher.record_write(1, 100);
+  BOOST_REQUIRE_EQUAL(get_flush_count(flusher), 1);
+  flusher.record_write(1, 100);
+  BOOST_REQUIRE_EQUAL(get_flush_count(flusher), 0);
+}
+
+BOOST_AUTO_TEST_CASE(BackgroundFlushes)
+{
+  std::mutex hdf5_mutex;
+  TestFile test_file;
+
+  HDF5FileFlusher::Policy policy;
+  policy.records_between_flushes = 1;
+  policy.flush_in_background = true;
+  HDF5FileFlusher flusher("test", policy, hdf5_mutex);
+  flusher.start_file(test_file.name);
+
+  flusher.record_write(1, 100);
+  uint64_t flush_count = 0; // NOLINT(build/unsigned)
+  for (int attempt = 0; attempt < 100 && flush_count == 0; ++attempt) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    flush_count += get_flush_count(flusher);
+  }
+  BOOST_REQUIRE_EQUAL(flush_count, 1);
+
+  // a flush that is requested just before the file is finished does not outlive the file
+  flusher.record_write(1, 100);
+  flusher.finish_file();
+  BOOST_REQUIRE(get_flush_count(flusher) <= 1);
+}
+
+BOOST_AUTO_TEST_CASE(SyncAtClose)
+{
+  std::mutex hdf5_mutex;
+  std::string file_name;
+  {
+    TestFile test_file;
+    file_name = test_file.name;
+
+    HDF5FileFlusher::Policy policy;
+    HDF5FileFlusher flusher("test", policy, hdf5_mutex);
+    flusher.sync_closed_file(test_file.name);
+    BOOST_REQUIRE_EQUAL(flusher.get_sync_latency().get_and_reset().count, 0);
+
+    policy.sync_at_close = true;
+    HDF5FileFlusher closing_flusher("test", policy, hdf5_mutex);
+    closing_flusher.start_file(test_file.name);
+    closing_flusher.record_write(1000, 1000000);
+    BOOST_REQUIRE_EQUAL(get_flush_count(closing_flusher), 0);
+    closing_flusher.finish_file();
+    closing_flusher.sync_closed_file(test_file.name);
+    BOOST_REQUIRE_EQUAL(closing_flusher.get_sync_latency().get_and_reset().count, 1);
+  }
+  BOOST_REQUIRE(!std::filesystem::exists(file_name));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
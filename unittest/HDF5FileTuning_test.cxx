@@ -0,0 +1,116 @@
+/**
+ * @file HDF5FileTuning_test.cxx Test application that tests and demonstrates
+ * the functionality of the HDF5FileTuning class.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/HDF5FileTuning.hpp"
+
+#define BOOST_TEST_MODULE HDF5FileTuning_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+using namespace dunedaq::dfmodules;
+
+namespace {
+
+std::string
+get_test_file_name()
+{
+  return std::filesystem::temp_directory_path().string() + "/HDF5FileTuning_test_" + std::to_string(getpid()) +
+         ".hdf5";
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(HDF5FileTuning_test)
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<HDF5FileTuning>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<HDF5FileTuning>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<HDF5FileTuning>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<HDF5FileTuning>);
+}
+
+BOOST_AUTO_TEST_CASE(InvalidSettings)
+{
+  HDF5FileTuning::Settings settings;
+  BOOST_REQUIRE(!HDF5FileTuning::is_tuning_requested(settings));
+
+  settings.file_space_strategy = "no-such-strategy";
+  BOOST_REQUIRE_THROW(HDF5FileTuning("test", settings), InvalidHDF5TuningParameter);
+
+  settings.file_space_strategy = "fsm_aggr";
+  settings.page_buffer_size_bytes = 1048576;
+  BOOST_REQUIRE_THROW(HDF5FileTuning("test", settings), InvalidHDF5TuningParameter);
+
+  settings.file_space_strategy = "page";
+  settings.libver_high = "v99";
+  BOOST_REQUIRE_THROW(HDF5FileTuning("test", settings), InvalidHDF5TuningParameter);
+
+  settings.libver_high = "latest";
+  BOOST_REQUIRE(HDF5FileTuning::is_tuning_requested(settings));
+  BOOST_REQUIRE_NO_THROW(HDF5FileTuning("test", settings));
+}
+
+BOOST_AUTO_TEST_CASE(SecondOpenSharesTheTuning)
+{
+  HDF5FileTuning::Settings settings;
+  settings.alignment_bytes = 1048576;
+  settings.alignment_threshold_bytes = 4096;
+  settings.metadata_block_size_bytes = 65536;
+  settings.file_space_strategy = "page";
+  settings.file_space_page_size_bytes = 65536;
+  settings.page_buffer_size_bytes = 1048576;
+  settings.preallocate = true;
+  HDF5FileTuning tuning("test", settings);
+
+  std::string file_name = get_test_file_name();
+  std::filesystem::remove(file_name);
+
+  auto prepared_file = tuning.prepare_file(file_name, 10000000);
+  BOOST_REQUIRE(prepared_file.get() != nullptr);
+
+  // a file that exists already is not touched
+  BOOST_REQUIRE(tuning.prepare_file(file_name, 10000000).get() == nullptr);
+
+  // the second open, with the default property lists, sees the tuned access properties
+  hid_t file_id = H5Fopen(file_name.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+  BOOST_REQUIRE(file_id >= 0);
+  prepared_file.reset();
+
+  hid_t fapl = H5Fget_access_plist(file_id);
+  hsize_t threshold = 0;
+  hsize_t alignment = 0;
+  BOOST_REQUIRE(H5Pget_alignment(fapl, &threshold, &alignment) >= 0);
+  BOOST_REQUIRE_EQUAL(threshold, 4096);
+  BOOST_REQUIRE_EQUAL(alignment, 1048576);
+  hsize_t meta_block_size = 0;
+  BOOST_REQUIRE(H5Pget_meta_block_size(fapl, &meta_block_size) >= 0);
+  BOOST_REQUIRE_EQUAL(meta_block_size, 65536);
+  H5Pclose(fapl);
+
+  hid_t fcpl = H5Fget_create_plist(file_id);
+  H5F_fspace_strategy_t strategy;
+  hbool_t persist = false;
+  hsize_t fs_threshold = 0;
+  BOOST_REQUIRE(H5Pget_file_space_strategy(fcpl, &strategy, &persist, &fs_threshold) >= 0);
+  BOOST_REQUIRE(strategy == H5F_FSPACE_STRATEGY_PAGE);
+  H5Pclose(fcpl);
+
+  BOOST_REQUIRE(H5Fclose(file_id) >= 0);
+
+  tuning.release_unused_space(file_name);
+  BOOST_REQUIRE(std::filesystem::exists(file_name));
+  std::filesystem::remove(file_name);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
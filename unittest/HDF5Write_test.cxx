@@ -8,6 +8,7 @@
  */
 
 #include "dfmodules/DataStore.hpp"
+#include "dfmodules/FileSummaryFile.hpp"
 #include "dfmodules/hdf5datastore/Nljs.hpp"
 #include "dfmodules/hdf5datastore/Structs.hpp"
 
@@ -19,7 +20,9 @@
 
 #include "boost/test/unit_test.hpp"
 
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -372,6 +375,364 @@ BOOST_AUTO_TEST_CASE(FileSizeLimitResultsInMultipleFiles)
   BOOST_REQUIRE_EQUAL(file_list.size(), 3);
 }
 
+BOOST_AUTO_TEST_CASE(BatchWriteResultsInMultipleFiles)
+{
+  std::string file_path(std::filesystem::temp_directory_path());
+  std::string file_prefix = "demo" + std::to_string(getpid()) + "_" + std::string(getenv("USER"));
+
+  const int trigger_count = 15;
+  const int apa_count = 5;
+  const int link_count = 10;
+  const int fragment_size = 10000;
+
+  // Make a hardware map
+  auto hardware_map_file = make_hardware_map(file_path, apa_count, link_count);
+
+  // delete any pre-existing files so that we start with a clean slate
+  std::string delete_pattern = file_prefix + ".*\\.hdf5";
+  delete_files_matching_pattern(file_path, delete_pattern);
+
+  // create the DataStore
+  hdf5datastore::ConfParams config_params;
+  config_params.name = "tempWriter";
+  config_params.directory_path = file_path;
+  config_params.mode = "all-per-file";
+  config_params.max_file_size_bytes = 3000000; // goal is 6 events per file
+  config_params.filename_parameters.overall_prefix = file_prefix;
+  config_params.filename_parameters.writer_identifier = "HDF5Write_test";
+  config_params.file_layout_parameters = create_file_layout_params();
+  config_params.hardware_map_file = hardware_map_file;
+
+  hdf5datastore::data_t hdf5ds_json;
+  hdf5datastore::to_json(hdf5ds_json, config_params);
+
+  std::unique_ptr<DataStore> data_store_ptr;
+  data_store_ptr = make_data_store(hdf5ds_json);
+
+  // write all of the events as a single batch, which needs to be split over several files
+  std::vector<std::unique_ptr<dunedaq::daqdataformats::TriggerRecord>> tr_batch;
+  for (int trigger_number = 1; trigger_number <= trigger_count; ++trigger_number) {
+    tr_batch.push_back(std::make_unique<dunedaq::daqdataformats::TriggerRecord>(
+      create_trigger_record(trigger_number, fragment_size, apa_count * link_count)));
+  }
+  data_store_ptr->write(tr_batch);
+  for (auto const& tr_ptr : tr_batch) {
+    BOOST_REQUIRE(tr_ptr.get() == nullptr);
+  }
+
+  data_store_ptr.reset(); // explicit destruction
+
+  // check that the expected number of files was created
+  std::string search_pattern = file_prefix + ".*\\.hdf5";
+  std::vector<std::string> file_list = get_files_matching_pattern(file_path, search_pattern);
+  // the batch is split at the same places as individual writes would be
+  BOOST_REQUIRE_EQUAL(file_list.size(), 3);
+
+  // clean up the files that were created
+  file_list = delete_files_matching_pattern(file_path, delete_pattern);
+  delete_files_matching_pattern(file_path, "HardwareMap.*\\.txt");
+  BOOST_REQUIRE_EQUAL(file_list.size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(PrecreatedFilesResultInMultipleFiles)
+{
+  std::string file_path(std::filesystem::temp_directory_path());
+  std::string file_prefix = "demo" + std::to_string(getpid()) + "_" + std::string(getenv("USER"));
+
+  const int trigger_count = 15;
+  const int apa_count = 5;
+  const int link_count = 10;
+  const int fragment_size = 10000;
+
+  // Make a hardware map
+  auto hardware_map_file = make_hardware_map(file_path, apa_count, link_count);
+
+  // 5 APAs times 10 links times 10000 bytes per fragment gives 500,000 bytes per TR
+  // So, 15 TRs would give 7,500,000 bytes total.
+
+  // delete any pre-existing files so that we start with a clean slate
+  std::string delete_pattern = file_prefix + ".*\\.hdf5";
+  delete_files_matching_pattern(file_path, delete_pattern);
+
+  // create the DataStore
+  hdf5datastore::ConfParams config_params;
+  config_params.name = "tempWriter";
+  config_params.directory_path = file_path;
+  config_params.mode = "all-per-file";
+  config_params.max_file_size_bytes = 3000000; // goal is 6 events per file
+  config_params.filename_parameters.overall_prefix = file_prefix;
+  config_params.filename_parameters.writer_identifier = "HDF5Write_test";
+  config_params.file_layout_parameters = create_file_layout_params();
+  config_params.hardware_map_file = hardware_map_file;
+  config_params.file_rollover_parameters.precreate_next_file = true;
+  config_params.file_rollover_parameters.precreate_fill_fraction = 0.5;
+  config_params.file_rollover_parameters.close_in_background = true;
+
+  hdf5datastore::data_t hdf5ds_json;
+  hdf5datastore::to_json(hdf5ds_json, config_params);
+
+  std::unique_ptr<DataStore> data_store_ptr;
+  data_store_ptr = make_data_store(hdf5ds_json);
+
+  // write several events, each with several fragments
+  for (int trigger_number = 1; trigger_number <= trigger_count; ++trigger_number)
+    data_store_ptr->write(create_trigger_record(trigger_number, fragment_size, apa_count * link_count));
+
+  data_store_ptr->finish_with_run(53);
+  data_store_ptr.reset(); // explicit destruction
+
+  // check that the expected number of files was created, and that the last
+  // pre-created file, which was never used, has been removed
+  std::string search_pattern = file_prefix + ".*\\.hdf5";
+  std::vector<std::string> file_list = get_files_matching_pattern(file_path, search_pattern);
+  // 7,500,000 bytes stored in files of size 3,000,000 should result in three files.
+  BOOST_REQUIRE_EQUAL(file_list.size(), 3);
+
+  // clean up the files that were created
+  file_list = delete_files_matching_pattern(file_path, delete_pattern);
+  delete_files_matching_pattern(file_path, "HardwareMap.*\\.txt");
+  BOOST_REQUIRE_EQUAL(file_list.size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(BackgroundCloseAtRunStop)
+{
+  std::string file_path(std::filesystem::temp_directory_path());
+  std::string file_prefix = "demo" + std::to_string(getpid()) + "_" + std::string(getenv("USER"));
+
+  const int trigger_count = 5;
+  const int apa_count = 3;
+  const int link_count = 10;
+  const int fragment_size = 10000;
+
+  // Make a hardware map
+  auto hardware_map_file = make_hardware_map(file_path, apa_count, link_count);
+
+  // delete any pre-existing files so that we start with a clean slate
+  std::string delete_pattern = file_prefix + ".*\\.hdf5";
+  delete_files_matching_pattern(file_path, delete_pattern);
+
+  // create the DataStore
+  hdf5datastore::ConfParams config_params;
+  config_params.name = "tempWriter";
+  config_params.directory_path = file_path;
+  config_params.mode = "all-per-file";
+  config_params.max_file_size_bytes = 100000000; // much larger than what we expect, so no second file;
+  config_params.filename_parameters.overall_prefix = file_prefix;
+  config_params.filename_parameters.writer_identifier = "HDF5Write_test";
+  config_params.file_layout_parameters = create_file_layout_params();
+  config_params.hardware_map_file = hardware_map_file;
+  config_params.file_rollover_parameters.close_at_run_stop_in_background = true;
+
+  hdf5datastore::data_t hdf5ds_json;
+  hdf5datastore::to_json(hdf5ds_json, config_params);
+
+  std::unique_ptr<DataStore> data_store_ptr;
+  data_store_ptr = make_data_store(hdf5ds_json);
+
+  data_store_ptr->prepare_for_run(53);
+  for (int trigger_number = 1; trigger_number <= trigger_count; ++trigger_number)
+    data_store_ptr->write(create_trigger_record(trigger_number, fragment_size, apa_count * link_count));
+  data_store_ptr->finish_with_run(53);
+
+  // a new run with the same number waits for the close of the file of the previous one
+  data_store_ptr->prepare_for_run(53);
+  std::vector<std::string> file_list = get_files_matching_pattern(file_path, file_prefix + ".*\\.writing");
+  BOOST_REQUIRE_EQUAL(file_list.size(), 0);
+  file_list = get_files_matching_pattern(file_path, file_prefix + ".*\\.hdf5");
+  BOOST_REQUIRE_EQUAL(file_list.size(), 1);
+  data_store_ptr->finish_with_run(53);
+
+  data_store_ptr.reset(); // explicit destruction
+
+  // clean up the files that were created
+  file_list = delete_files_matching_pattern(file_path, delete_pattern);
+  delete_files_matching_pattern(file_path, "HardwareMap.*\\.txt");
+  BOOST_REQUIRE_EQUAL(file_list.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ClosedFilesAreMovedToBulkStorage)
+{
+  std::string file_path(std::filesystem::temp_directory_path());
+  std::string file_prefix = "demo" + std::to_string(getpid()) + "_" + std::string(getenv("USER"));
+  std::string bulk_dir = file_path + "/" + file_prefix + "_bulk";
+  std::filesystem::create_directories(bulk_dir);
+
+  const int trigger_count = 15;
+  const int apa_count = 5;
+  const int link_count = 10;
+  const int fragment_size = 10000;
+
+  // Make a hardware map
+  auto hardware_map_file = make_hardware_map(file_path, apa_count, link_count);
+
+  // delete any pre-existing files so that we start with a clean slate
+  std::string delete_pattern = file_prefix + ".*\\.hdf5";
+  delete_files_matching_pattern(file_path, delete_pattern);
+
+  // create the DataStore
+  hdf5datastore::ConfParams config_params;
+  config_params.name = "tempWriter";
+  config_params.directory_path = file_path;
+  config_params.mode = "all-per-file";
+  config_params.max_file_size_bytes = 3000000; // goal is 6 events per file
+  config_params.filename_parameters.overall_prefix = file_prefix;
+  config_params.filename_parameters.writer_identifier = "HDF5Write_test";
+  config_params.file_layout_parameters = create_file_layout_params();
+  config_params.hardware_map_file = hardware_map_file;
+  config_params.tiered_storage_parameters.enabled = true;
+  config_params.tiered_storage_parameters.bulk_directory_path = bulk_dir;
+
+  hdf5datastore::data_t hdf5ds_json;
+  hdf5datastore::to_json(hdf5ds_json, config_params);
+
+  std::unique_ptr<DataStore> data_store_ptr;
+  data_store_ptr = make_data_store(hdf5ds_json);
+
+  data_store_ptr->prepare_for_run(53);
+  for (int trigger_number = 1; trigger_number <= trigger_count; ++trigger_number)
+    data_store_ptr->write(create_trigger_record(trigger_number, fragment_size, apa_count * link_count));
+  data_store_ptr->finish_with_run(53);
+  data_store_ptr.reset(); // explicit destruction, which finishes the moves
+
+  // all of the files have been moved from the staging directory to the bulk directory
+  std::vector<std::string> file_list = get_files_matching_pattern(file_path, delete_pattern);
+  BOOST_REQUIRE_EQUAL(file_list.size(), 0);
+  file_list = get_files_matching_pattern(bulk_dir, delete_pattern);
+  BOOST_REQUIRE_EQUAL(file_list.size(), 3);
+
+  // clean up the files that were created
+  std::filesystem::remove_all(bulk_dir);
+  delete_files_matching_pattern(file_path, "HardwareMap.*\\.txt");
+}
+
+BOOST_AUTO_TEST_CASE(FileSummaryIsWrittenAtClose)
+{
+  std::string file_path(std::filesystem::temp_directory_path());
+  std::string file_prefix = "demo" + std::to_string(getpid()) + "_" + std::string(getenv("USER"));
+
+  const int trigger_count = 15;
+  const int apa_count = 5;
+  const int link_count = 10;
+  const int fragment_size = 10000;
+
+  // Make a hardware map
+  auto hardware_map_file = make_hardware_map(file_path, apa_count, link_count);
+
+  // delete any pre-existing files so that we start with a clean slate
+  std::string delete_pattern = file_prefix + ".*\\.hdf5";
+  delete_files_matching_pattern(file_path, delete_pattern);
+
+  // create the DataStore
+  hdf5datastore::ConfParams config_params;
+  config_params.name = "tempWriter";
+  config_params.directory_path = file_path;
+  config_params.mode = "all-per-file";
+  config_params.max_file_size_bytes = 3000000; // goal is 6 events per file
+  config_params.filename_parameters.overall_prefix = file_prefix;
+  config_params.filename_parameters.writer_identifier = "HDF5Write_test";
+  config_params.file_layout_parameters = create_file_layout_params();
+  config_params.hardware_map_file = hardware_map_file;
+  config_params.write_file_summary = true;
+
+  hdf5datastore::data_t hdf5ds_json;
+  hdf5datastore::to_json(hdf5ds_json, config_params);
+
+  std::unique_ptr<DataStore> data_store_ptr;
+  data_store_ptr = make_data_store(hdf5ds_json);
+
+  data_store_ptr->prepare_for_run(53);
+  for (int trigger_number = 1; trigger_number <= trigger_count; ++trigger_number)
+    data_store_ptr->write(create_trigger_record(trigger_number, fragment_size, apa_count * link_count));
+  data_store_ptr->finish_with_run(53);
+  data_store_ptr.reset(); // explicit destruction
+
+  // each file has a summary of its own records, and together they cover all of the records
+  std::vector<std::string> file_list = get_files_matching_pattern(file_path, delete_pattern);
+  BOOST_REQUIRE_EQUAL(file_list.size(), 3);
+  std::vector<uint64_t> record_numbers; // NOLINT(build/unsigned)
+  for (auto const& file_name : file_list) {
+    FileSummaryReader reader(file_name);
+    auto const& columns = reader.get_columns();
+    BOOST_REQUIRE(columns.size() > 0);
+    for (size_t idx = 0; idx < columns.size(); ++idx) {
+      record_numbers.push_back(columns.record_number[idx]);
+      BOOST_REQUIRE_EQUAL(columns.fragment_count[idx], apa_count * link_count);
+      BOOST_REQUIRE(columns.total_bytes[idx] > static_cast<uint64_t>(fragment_size * apa_count * link_count)); // NOLINT
+    }
+  }
+  std::sort(record_numbers.begin(), record_numbers.end());
+  BOOST_REQUIRE_EQUAL(record_numbers.size(), trigger_count);
+  for (int idx = 0; idx < trigger_count; ++idx) {
+    BOOST_REQUIRE_EQUAL(record_numbers[idx], idx + 1);
+  }
+
+  // clean up the files that were created
+  file_list = delete_files_matching_pattern(file_path, delete_pattern);
+  delete_files_matching_pattern(file_path, "HardwareMap.*\\.txt");
+  BOOST_REQUIRE_EQUAL(file_list.size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(FilesAreStripedAcrossDirectories)
+{
+  std::string file_path(std::filesystem::temp_directory_path());
+  std::string file_prefix = "demo" + std::to_string(getpid()) + "_" + std::string(getenv("USER"));
+  std::string first_dir = file_path + "/" + file_prefix + "_stripe0";
+  std::string second_dir = file_path + "/" + file_prefix + "_stripe1";
+  std::filesystem::create_directories(first_dir);
+  std::filesystem::create_directories(second_dir);
+
+  const int trigger_count = 15;
+  const int apa_count = 5;
+  const int link_count = 10;
+  const int fragment_size = 10000;
+
+  // Make a hardware map
+  auto hardware_map_file = make_hardware_map(file_path, apa_count, link_count);
+
+  // create the DataStore
+  hdf5datastore::ConfParams config_params;
+  config_params.name = "tempWriter";
+  config_params.directory_path = file_path;
+  config_params.mode = "all-per-file";
+  config_params.max_file_size_bytes = 3000000; // goal is 6 events per file
+  config_params.filename_parameters.overall_prefix = file_prefix;
+  config_params.filename_parameters.writer_identifier = "HDF5Write_test";
+  config_params.file_layout_parameters = create_file_layout_params();
+  config_params.hardware_map_file = hardware_map_file;
+  hdf5datastore::OutputDirectory output_dir;
+  output_dir.path = first_dir;
+  config_params.striping_parameters.output_directories.push_back(output_dir);
+  output_dir.path = second_dir;
+  config_params.striping_parameters.output_directories.push_back(output_dir);
+
+  hdf5datastore::data_t hdf5ds_json;
+  hdf5datastore::to_json(hdf5ds_json, config_params);
+
+  std::unique_ptr<DataStore> data_store_ptr;
+  data_store_ptr = make_data_store(hdf5ds_json);
+
+  // write several events, each with several fragments
+  data_store_ptr->prepare_for_run(53);
+  for (int trigger_number = 1; trigger_number <= trigger_count; ++trigger_number)
+    data_store_ptr->write(create_trigger_record(trigger_number, fragment_size, apa_count * link_count));
+  data_store_ptr->finish_with_run(53);
+  data_store_ptr.reset(); // explicit destruction
+
+  // 7,500,000 bytes stored in files of size 3,000,000 should result in three files,
+  // which are spread over the two directories with equal weights
+  std::string search_pattern = file_prefix + ".*\\.hdf5";
+  std::vector<std::string> first_file_list = get_files_matching_pattern(first_dir, search_pattern);
+  std::vector<std::string> second_file_list = get_files_matching_pattern(second_dir, search_pattern);
+  BOOST_REQUIRE_EQUAL(first_file_list.size() + second_file_list.size(), 3);
+  BOOST_REQUIRE_GE(first_file_list.size(), 1);
+  BOOST_REQUIRE_GE(second_file_list.size(), 1);
+
+  // clean up the files that were created
+  std::filesystem::remove_all(first_dir);
+  std::filesystem::remove_all(second_dir);
+  delete_files_matching_pattern(file_path, "HardwareMap.*\\.txt");
+}
+
 BOOST_AUTO_TEST_CASE(SmallFileSizeLimitDataBlockListWrite)
 {
   std::string file_path(std::filesystem::temp_directory_path());
@@ -426,4 +787,208 @@ BOOST_AUTO_TEST_CASE(SmallFileSizeLimitDataBlockListWrite)
   BOOST_REQUIRE_EQUAL(file_list.size(), 5);
 }
 
+BOOST_AUTO_TEST_CASE(AsyncWriteOneFile)
+{
+  std::string file_path(std::filesystem::temp_directory_path());
+  std::string file_prefix = "demo" + std::to_string(getpid()) + "_" + std::string(getenv("USER"));
+
+  const int trigger_count = 5;
+  const int apa_count = 3;
+  const int link_count = 1;
+  const int fragment_size = 10 + sizeof(dunedaq::daqdataformats::FragmentHeader);
+
+  // Make a hardware map
+  auto hardware_map_file = make_hardware_map(file_path, apa_count, link_count);
+
+  // delete any pre-existing files so that we start with a clean slate
+  std::string delete_pattern = file_prefix + ".*\\.hdf5";
+  delete_files_matching_pattern(file_path, delete_pattern);
+
+  // create the DataStore
+  hdf5datastore::ConfParams config_params;
+  config_params.name = "tempWriter";
+  config_params.directory_path = file_path;
+  config_params.mode = "all-per-file";
+  config_params.max_file_size_bytes = 100000000; // much larger than what we expect, so no second file;
+  config_params.filename_parameters.overall_prefix = file_prefix;
+  config_params.filename_parameters.writer_identifier = "HDF5Write_test";
+  config_params.file_layout_parameters = create_file_layout_params();
+  config_params.hardware_map_file = hardware_map_file;
+  config_params.async_write_parameters.enabled = true;
+
+  hdf5datastore::data_t hdf5ds_json;
+  hdf5datastore::to_json(hdf5ds_json, config_params);
+
+  std::unique_ptr<DataStore> data_store_ptr;
+  data_store_ptr = make_data_store(hdf5ds_json);
+  data_store_ptr->prepare_for_run(53);
+
+  // write several events, handing ownership of each of them to the DataStore
+  for (int trigger_number = 1; trigger_number <= trigger_count; ++trigger_number) {
+    auto tr_ptr = std::make_unique<dunedaq::daqdataformats::TriggerRecord>(
+      create_trigger_record(trigger_number, fragment_size, apa_count * link_count));
+    data_store_ptr->write(tr_ptr);
+    BOOST_REQUIRE(tr_ptr.get() == nullptr);
+  }
+
+  // finishing the run writes out the queued records and closes the file
+  data_store_ptr->finish_with_run(53);
+
+  std::string search_pattern = file_prefix + ".*\\.writing";
+  std::vector<std::string> file_list = get_files_matching_pattern(file_path, search_pattern);
+  BOOST_REQUIRE_EQUAL(file_list.size(), 0);
+
+  data_store_ptr.reset(); // explicit destruction
+
+  // check that the expected number of files was created
+  search_pattern = file_prefix + ".*\\.hdf5";
+  file_list = get_files_matching_pattern(file_path, search_pattern);
+  BOOST_REQUIRE_EQUAL(file_list.size(), 1);
+
+  // clean up the files that were created
+  file_list = delete_files_matching_pattern(file_path, delete_pattern);
+  delete_files_matching_pattern(file_path, "HardwareMap.*\\.txt");
+  BOOST_REQUIRE_EQUAL(file_list.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ReadBackRecords)
+{
+  std::string file_path(std::filesystem::temp_directory_path());
+  std::string file_prefix = "demo" + std::to_string(getpid()) + "_" + std::string(getenv("USER"));
+
+  const int trigger_count = 15;
+  const int apa_count = 5;
+  const int link_count = 10;
+  const int fragment_size = 10000;
+
+  // Make a hardware map
+  auto hardware_map_file = make_hardware_map(file_path, apa_count, link_count);
+
+  // delete any pre-existing files so that we start with a clean slate
+  std::string delete_pattern = file_prefix + ".*\\.hdf5.*";
+  delete_files_matching_pattern(file_path, delete_pattern);
+
+  // create the DataStore
+  hdf5datastore::ConfParams config_params;
+  config_params.name = "tempWriter";
+  config_params.directory_path = file_path;
+  config_params.mode = "all-per-file";
+  config_params.max_file_size_bytes = 3000000; // goal is 6 events per file
+  config_params.filename_parameters.overall_prefix = file_prefix;
+  config_params.filename_parameters.writer_identifier = "HDF5Write_test";
+  config_params.file_layout_parameters = create_file_layout_params();
+  config_params.hardware_map_file = hardware_map_file;
+  config_params.max_open_files_for_reading = 2;
+
+  hdf5datastore::data_t hdf5ds_json;
+  hdf5datastore::to_json(hdf5ds_json, config_params);
+
+  std::unique_ptr<DataStore> data_store_ptr;
+  data_store_ptr = make_data_store(hdf5ds_json);
+
+  // write several events, each with several fragments, into three files
+  data_store_ptr->prepare_for_run(53);
+  for (int trigger_number = 1; trigger_number <= trigger_count; ++trigger_number)
+    data_store_ptr->write(create_trigger_record(trigger_number, fragment_size, apa_count * link_count));
+  data_store_ptr->finish_with_run(53);
+
+  // all of the records can be found, in order
+  std::vector<DataStore::record_id_t> record_ids = data_store_ptr->get_record_ids(53);
+  BOOST_REQUIRE_EQUAL(record_ids.size(), trigger_count);
+  BOOST_REQUIRE_EQUAL(record_ids.front().first, 1);
+  BOOST_REQUIRE_EQUAL(record_ids.back().first, trigger_count);
+  BOOST_REQUIRE_EQUAL(data_store_ptr->get_record_ids(54).size(), 0);
+
+  // records are read from each of the files, more of them than can be kept open
+  for (int trigger_number : { 14, 2, 8, 3 }) {
+    auto tr_ptr = data_store_ptr->read_trigger_record(53, trigger_number, 0);
+    BOOST_REQUIRE(tr_ptr.get() != nullptr);
+    BOOST_REQUIRE_EQUAL(tr_ptr->get_header_ref().get_trigger_number(), trigger_number);
+    BOOST_REQUIRE_EQUAL(tr_ptr->get_fragments_ref().size(), apa_count * link_count);
+  }
+  BOOST_REQUIRE(data_store_ptr->read_trigger_record(53, trigger_count + 1, 0).get() == nullptr);
+
+  dunedaq::daqdataformats::SourceID source_id(dunedaq::daqdataformats::SourceID::Subsystem::kDetectorReadout, 7);
+  auto frag_ptr = data_store_ptr->read_fragment(53, 5, 0, source_id);
+  BOOST_REQUIRE(frag_ptr.get() != nullptr);
+  BOOST_REQUIRE_EQUAL(frag_ptr->get_trigger_number(), 5);
+  BOOST_REQUIRE_EQUAL(frag_ptr->get_element_id().id, 7);
+  BOOST_REQUIRE_EQUAL(frag_ptr->get_data_size(), fragment_size);
+
+  data_store_ptr.reset(); // explicit destruction
+
+  // clean up the files that were created
+  std::vector<std::string> file_list = delete_files_matching_pattern(file_path, delete_pattern);
+  delete_files_matching_pattern(file_path, "HardwareMap.*\\.txt");
+  BOOST_REQUIRE_EQUAL(file_list.size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(ReadBackCompressedRecords)
+{
+  std::string file_path(std::filesystem::temp_directory_path());
+  std::string file_prefix = "demo" + std::to_string(getpid()) + "_" + std::string(getenv("USER"));
+
+  const int trigger_count = 3;
+  const int apa_count = 2;
+  const int link_count = 5;
+  const int fragment_size = 10000;
+
+  // Make a hardware map
+  auto hardware_map_file = make_hardware_map(file_path, apa_count, link_count);
+
+  // delete any pre-existing files so that we start with a clean slate
+  std::string delete_pattern = file_prefix + ".*\\.hdf5.*";
+  delete_files_matching_pattern(file_path, delete_pattern);
+
+  // create the DataStore, which compresses all of the Fragments
+  hdf5datastore::ConfParams config_params;
+  config_params.name = "tempWriter";
+  config_params.directory_path = file_path;
+  config_params.mode = "all-per-file";
+  config_params.max_file_size_bytes = 100000000;
+  config_params.filename_parameters.overall_prefix = file_prefix;
+  config_params.filename_parameters.writer_identifier = "HDF5Write_test";
+  config_params.file_layout_parameters = create_file_layout_params();
+  config_params.hardware_map_file = hardware_map_file;
+  hdf5datastore::CompressionRule rule;
+  rule.codec = "zlib";
+  config_params.compression_parameters.rules.push_back(rule);
+
+  hdf5datastore::data_t hdf5ds_json;
+  hdf5datastore::to_json(hdf5ds_json, config_params);
+
+  std::unique_ptr<DataStore> data_store_ptr;
+  data_store_ptr = make_data_store(hdf5ds_json);
+
+  data_store_ptr->prepare_for_run(53);
+  for (int trigger_number = 1; trigger_number <= trigger_count; ++trigger_number)
+    data_store_ptr->write(create_trigger_record(trigger_number, fragment_size, apa_count * link_count));
+  data_store_ptr->finish_with_run(53);
+
+  // the Fragments are read back with their original sizes and payloads
+  auto original_tr = create_trigger_record(2, fragment_size, apa_count * link_count);
+  auto tr_ptr = data_store_ptr->read_trigger_record(53, 2, 0);
+  BOOST_REQUIRE(tr_ptr.get() != nullptr);
+  BOOST_REQUIRE_EQUAL(tr_ptr->get_fragments_ref().size(), apa_count * link_count);
+  for (auto const& frag_ptr : tr_ptr->get_fragments_ref()) {
+    auto const& original_frag_ptr = original_tr.get_fragments_ref()[frag_ptr->get_element_id().id];
+    BOOST_REQUIRE_EQUAL(frag_ptr->get_size(), original_frag_ptr->get_size());
+    BOOST_REQUIRE_EQUAL(frag_ptr->get_data_size(), fragment_size);
+    BOOST_REQUIRE(std::memcmp(frag_ptr->get_data(), original_frag_ptr->get_data(), fragment_size) == 0);
+  }
+
+  dunedaq::daqdataformats::SourceID source_id(dunedaq::daqdataformats::SourceID::Subsystem::kDetectorReadout, 7);
+  auto frag_ptr = data_store_ptr->read_fragment(53, 3, 0, source_id);
+  BOOST_REQUIRE(frag_ptr.get() != nullptr);
+  BOOST_REQUIRE_EQUAL(frag_ptr->get_size(), original_tr.get_fragments_ref()[7]->get_size());
+  BOOST_REQUIRE(std::memcmp(frag_ptr->get_data(), original_tr.get_fragments_ref()[7]->get_data(), fragment_size) ==
+                0);
+
+  data_store_ptr.reset(); // explicit destruction
+
+  // clean up the files that were created
+  delete_files_matching_pattern(file_path, delete_pattern);
+  delete_files_matching_pattern(file_path, "HardwareMap.*\\.txt");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
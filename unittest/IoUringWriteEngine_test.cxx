@@ -0,0 +1,117 @@
+/**
+ * @file IoUringWriteEngine_test.cxx Test application that tests and demonstrates
+ * the functionality of the IoUringWriteEngine class.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/IoUringWriteEngine.hpp"
+
+#define BOOST_TEST_MODULE IoUringWriteEngine_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace dunedaq::dfmodules;
+
+namespace {
+
+std::string
+get_test_file_name()
+{
+  return std::filesystem::temp_directory_path().string() + "/IoUringWriteEngine_test_" + std::to_string(getpid()) +
+         ".bin";
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(IoUringWriteEngine_test)
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<IoUringWriteEngine>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<IoUringWriteEngine>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<IoUringWriteEngine>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<IoUringWriteEngine>);
+}
+
+BOOST_AUTO_TEST_CASE(WritesAndSyncs)
+{
+  if (!IoUringWriteEngine::is_supported()) {
+    BOOST_TEST_MESSAGE("io_uring is not available, skipping the test");
+    return;
+  }
+
+  // the buffer size is rounded up to a multiple of the page size
+  IoUringWriteEngine engine("test", 2, 3, 5000);
+  BOOST_REQUIRE_EQUAL(engine.get_number_of_buffers(), 3);
+  BOOST_REQUIRE_EQUAL(engine.get_buffer_size(), 8192);
+
+  std::string file_name = get_test_file_name();
+  int fd = ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  BOOST_REQUIRE(fd >= 0);
+
+  // more requests than the queue depth, so that a submission needs to wait for room
+  for (size_t idx = 0; idx < engine.get_number_of_buffers(); ++idx) {
+    std::memset(engine.get_buffer(idx), 'a' + static_cast<int>(idx), engine.get_buffer_size());
+    engine.submit_write(fd, idx, engine.get_buffer_size(), idx * engine.get_buffer_size(), idx);
+  }
+  engine.submit_sync(fd, 100);
+
+  std::vector<IoUringWriteEngine::Completion> completions;
+  while (completions.size() < 4) {
+    auto new_completions = engine.reap(1);
+    completions.insert(completions.end(), new_completions.begin(), new_completions.end());
+  }
+  BOOST_REQUIRE_EQUAL(engine.get_number_in_flight(), 0);
+  BOOST_REQUIRE(engine.reap(1).empty());
+
+  // the sync is ordered after the writes
+  BOOST_REQUIRE_EQUAL(completions.back().tag, 100);
+  BOOST_REQUIRE_EQUAL(completions.back().result, 0);
+  for (size_t idx = 0; idx < 3; ++idx) {
+    BOOST_REQUIRE_EQUAL(completions[idx].result, static_cast<int>(engine.get_buffer_size()));
+  }
+  ::close(fd);
+
+  std::ifstream stream(file_name, std::ios::binary);
+  std::vector<char> contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+  BOOST_REQUIRE_EQUAL(contents.size(), 3 * engine.get_buffer_size());
+  for (size_t idx = 0; idx < 3; ++idx) {
+    BOOST_REQUIRE_EQUAL(contents[idx * engine.get_buffer_size()], 'a' + static_cast<int>(idx));
+    BOOST_REQUIRE_EQUAL(contents[(idx + 1) * engine.get_buffer_size() - 1], 'a' + static_cast<int>(idx));
+  }
+  std::filesystem::remove(file_name);
+}
+
+BOOST_AUTO_TEST_CASE(FailedWrite)
+{
+  if (!IoUringWriteEngine::is_supported()) {
+    BOOST_TEST_MESSAGE("io_uring is not available, skipping the test");
+    return;
+  }
+
+  IoUringWriteEngine engine("test", 4, 1, 4096);
+  BOOST_REQUIRE_THROW(engine.submit_write(-1, 1, 4096, 0, 1), IoUringProblem);
+  BOOST_REQUIRE_THROW(engine.submit_write(-1, 0, 8192, 0, 1), IoUringProblem);
+
+  // a write to an invalid file descriptor fails in its completion
+  engine.submit_write(-1, 0, 4096, 0, 7);
+  auto completions = engine.reap(1);
+  BOOST_REQUIRE_EQUAL(completions.size(), 1);
+  BOOST_REQUIRE_EQUAL(completions[0].tag, 7);
+  BOOST_REQUIRE(completions[0].result < 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
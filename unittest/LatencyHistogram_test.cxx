@@ -0,0 +1,176 @@
+/**
+ * @file LatencyHistogram_test.cxx Test application that tests and demonstrates
+ * the functionality of the LatencyHistogram class.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/LatencyHistogram.hpp"
+
+#define BOOST_TEST_MODULE LatencyHistogram_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::dfmodules;
+
+BOOST_AUTO_TEST_SUITE(LatencyHistogram_test)
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<LatencyHistogram>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<LatencyHistogram>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<LatencyHistogram>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<LatencyHistogram>);
+}
+
+BOOST_AUTO_TEST_CASE(BucketIndex)
+{
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_bucket_index(0), 0);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_bucket_index(9), 0);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_bucket_index(10), 1);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_bucket_index(999), 2);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_bucket_index(1000), 3);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_bucket_index(999999), 5);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_bucket_index(1000000), 6);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_bucket_index(1000000000), 6);
+}
+
+BOOST_AUTO_TEST_CASE(FineBucketIndex)
+{
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_fine_bucket_index(0), 0);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_fine_bucket_index(9), 0);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_fine_bucket_index(10), 1);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_fine_bucket_index(99), 8);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_fine_bucket_index(100), 9);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_fine_bucket_index(9999999), 48);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_fine_bucket_index(10000000), 49);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::get_fine_bucket_index(1000000000), 49);
+}
+
+BOOST_AUTO_TEST_CASE(Percentiles)
+{
+  LatencyHistogram histogram;
+
+  // 1..1000 microseconds
+  for (int duration_us = 1; duration_us <= 1000; ++duration_us) {
+    histogram.record(std::chrono::microseconds(duration_us));
+  }
+  auto snapshot = histogram.get_and_reset();
+  BOOST_REQUIRE_EQUAL(snapshot.count, 1000);
+  // the estimates are the upper edges of the fine buckets, which are about 33% apart
+  BOOST_REQUIRE_GE(snapshot.p50_us, 500);
+  BOOST_REQUIRE_LE(snapshot.p50_us, 500 * 4 / 3);
+  BOOST_REQUIRE_GE(snapshot.p90_us, 900);
+  BOOST_REQUIRE_LE(snapshot.p90_us, 1000);
+  BOOST_REQUIRE_GE(snapshot.p99_us, 990);
+  BOOST_REQUIRE_LE(snapshot.p99_us, 1000);
+
+  // a single slow sample shows up in the 99th percentile only
+  for (int idx = 0; idx < 98; ++idx) {
+    histogram.record(std::chrono::microseconds(20));
+  }
+  histogram.record(std::chrono::milliseconds(50));
+  histogram.record(std::chrono::seconds(20));
+  snapshot = histogram.get_and_reset();
+  BOOST_REQUIRE_GE(snapshot.p50_us, 20);
+  BOOST_REQUIRE_LE(snapshot.p50_us, 20 * 4 / 3);
+  BOOST_REQUIRE_EQUAL(snapshot.p90_us, snapshot.p50_us);
+  BOOST_REQUIRE_GE(snapshot.p99_us, 50000);
+  BOOST_REQUIRE_LE(snapshot.p99_us, 50000 * 4 / 3);
+  BOOST_REQUIRE_EQUAL(snapshot.max_us, 20000000);
+
+  snapshot = histogram.get_and_reset();
+  BOOST_REQUIRE_EQUAL(snapshot.p50_us, 0);
+  BOOST_REQUIRE_EQUAL(snapshot.p99_us, 0);
+}
+
+BOOST_AUTO_TEST_CASE(RecordAndReset)
+{
+  LatencyHistogram histogram;
+
+  auto snapshot = histogram.get_and_reset();
+  BOOST_REQUIRE_EQUAL(snapshot.count, 0);
+  BOOST_REQUIRE_EQUAL(snapshot.min_us, 0);
+  BOOST_REQUIRE_EQUAL(snapshot.max_us, 0);
+
+  histogram.record(std::chrono::microseconds(5));
+  histogram.record(std::chrono::microseconds(50));
+  histogram.record(std::chrono::milliseconds(5));
+  histogram.record(std::chrono::seconds(2));
+  snapshot = histogram.get_and_reset();
+  BOOST_REQUIRE_EQUAL(snapshot.count, 4);
+  BOOST_REQUIRE_EQUAL(snapshot.sum_us, 2005055);
+  BOOST_REQUIRE_EQUAL(snapshot.min_us, 5);
+  BOOST_REQUIRE_EQUAL(snapshot.max_us, 2000000);
+  BOOST_REQUIRE_EQUAL(snapshot.bucket_counts[0], 1);
+  BOOST_REQUIRE_EQUAL(snapshot.bucket_counts[1], 1);
+  BOOST_REQUIRE_EQUAL(snapshot.bucket_counts[2], 0);
+  BOOST_REQUIRE_EQUAL(snapshot.bucket_counts[3], 1);
+  BOOST_REQUIRE_EQUAL(snapshot.bucket_counts[6], 1);
+
+  snapshot = histogram.get_and_reset();
+  BOOST_REQUIRE_EQUAL(snapshot.count, 0);
+  BOOST_REQUIRE_EQUAL(snapshot.sum_us, 0);
+}
+
+BOOST_AUTO_TEST_CASE(RecordFromSeveralThreads)
+{
+  LatencyHistogram histogram;
+  std::vector<std::thread> threads;
+  for (int thread_idx = 0; thread_idx < 4; ++thread_idx) {
+    threads.emplace_back([&histogram, thread_idx]() {
+      for (int idx = 0; idx < 10000; ++idx) {
+        histogram.record(std::chrono::microseconds(thread_idx * 100 + 1));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto snapshot = histogram.get_and_reset();
+  BOOST_REQUIRE_EQUAL(snapshot.count, 40000);
+  BOOST_REQUIRE_EQUAL(snapshot.min_us, 1);
+  BOOST_REQUIRE_EQUAL(snapshot.max_us, 301);
+  BOOST_REQUIRE_EQUAL(snapshot.bucket_counts[0], 10000);
+  BOOST_REQUIRE_EQUAL(snapshot.bucket_counts[2], 30000);
+}
+
+BOOST_AUTO_TEST_CASE(ResetWhileRecording)
+{
+  LatencyHistogram histogram;
+  std::atomic<bool> keep_recording(true);
+  std::vector<std::thread> threads;
+  for (int thread_idx = 0; thread_idx < 4; ++thread_idx) {
+    threads.emplace_back([&histogram, &keep_recording, thread_idx]() {
+      while (keep_recording.load()) {
+        histogram.record(std::chrono::microseconds(thread_idx * 100 + 1));
+      }
+    });
+  }
+
+  // every snapshot that has samples also has their range, and the percentiles are within it
+  uint64_t total_count = 0; // NOLINT(build/unsigned)
+  for (int idx = 0; idx < 10000; ++idx) {
+    auto snapshot = histogram.get_and_reset();
+    total_count += snapshot.count;
+    if (snapshot.count > 0) {
+      BOOST_REQUIRE_LE(snapshot.min_us, snapshot.max_us);
+      BOOST_REQUIRE_GE(snapshot.p50_us, snapshot.min_us);
+      BOOST_REQUIRE_LE(snapshot.p99_us, snapshot.max_us);
+    }
+  }
+  keep_recording = false;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  BOOST_REQUIRE_GT(total_count, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,223 @@
+/**
+ * @file MemoryRecordRing_test.cxx Test application that tests and demonstrates
+ * the functionality of the MemoryRecordRing class.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/MemoryRecordRing.hpp"
+
+#define BOOST_TEST_MODULE MemoryRecordRing_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::dfmodules;
+using namespace dunedaq::daqdataformats;
+
+namespace {
+
+const int s_run_number = 53;
+
+std::unique_ptr<Fragment>
+create_fragment(uint64_t trig_num, int element_number, int fragment_size) // NOLINT(build/unsigned)
+{
+  std::vector<char> dummy_data(fragment_size);
+  for (int idx = 0; idx < fragment_size; ++idx) {
+    dummy_data[idx] = static_cast<char>((trig_num + element_number + idx) % 128);
+  }
+
+  FragmentHeader fh;
+  fh.trigger_number = trig_num;
+  fh.trigger_timestamp = 1000 + trig_num;
+  fh.run_number = s_run_number;
+  fh.element_id = SourceID(SourceID::Subsystem::kDetectorReadout, element_number);
+  auto frag_ptr = std::make_unique<Fragment>(dummy_data.data(), fragment_size);
+  frag_ptr->set_header_fields(fh);
+  return frag_ptr;
+}
+
+TriggerRecord
+create_trigger_record(uint64_t trig_num, int fragment_size, int element_count) // NOLINT(build/unsigned)
+{
+  TriggerRecordHeaderData trh_data;
+  trh_data.trigger_number = trig_num;
+  trh_data.trigger_timestamp = 1000 + trig_num;
+  trh_data.num_requested_components = element_count;
+  trh_data.run_number = s_run_number;
+  trh_data.sequence_number = 0;
+  trh_data.max_sequence_number = 1;
+  trh_data.element_id = SourceID(SourceID::Subsystem::kTRBuilder, 0);
+  TriggerRecordHeader trh(&trh_data);
+
+  TriggerRecord tr(trh);
+  for (int ele_num = 0; ele_num < element_count; ++ele_num) {
+    tr.add_fragment(create_fragment(trig_num, ele_num, fragment_size));
+  }
+  return tr;
+}
+
+TimeSlice
+create_time_slice(uint64_t ts_num, int fragment_size, int element_count) // NOLINT(build/unsigned)
+{
+  TimeSliceHeader tsh;
+  tsh.timeslice_number = ts_num;
+  tsh.run_number = s_run_number;
+  tsh.element_id = SourceID(SourceID::Subsystem::kTRBuilder, 0);
+
+  TimeSlice ts(tsh);
+  for (int ele_num = 0; ele_num < element_count; ++ele_num) {
+    ts.add_fragment(create_fragment(ts_num, ele_num, fragment_size));
+  }
+  return ts;
+}
+
+void
+check_fragments_are_equal(const std::vector<std::unique_ptr<Fragment>>& expected,
+                          const std::vector<std::unique_ptr<Fragment>>& actual)
+{
+  BOOST_REQUIRE_EQUAL(expected.size(), actual.size());
+  for (size_t idx = 0; idx < expected.size(); ++idx) {
+    BOOST_REQUIRE_EQUAL(expected[idx]->get_size(), actual[idx]->get_size());
+    BOOST_REQUIRE(std::memcmp(expected[idx]->get_storage_location(),
+                              actual[idx]->get_storage_location(),
+                              expected[idx]->get_size()) == 0);
+  }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(MemoryRecordRing_test)
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<MemoryRecordRing>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<MemoryRecordRing>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<MemoryRecordRing>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<MemoryRecordRing>);
+}
+
+BOOST_AUTO_TEST_CASE(AddAndGetRecords)
+{
+  MemoryRecordRing ring("test", 1000000, 0);
+
+  auto tr = create_trigger_record(1, 1000, 3);
+  ring.add(tr);
+  auto ts = create_time_slice(7, 500, 2);
+  ring.add(ts);
+
+  auto entries = ring.list_entries();
+  BOOST_REQUIRE_EQUAL(entries.size(), 2);
+  BOOST_REQUIRE(entries[0].record_type == MemoryRecordRing::RecordType::kTriggerRecord);
+  BOOST_REQUIRE_EQUAL(entries[0].record_number, 1);
+  BOOST_REQUIRE_EQUAL(entries[0].run_number, s_run_number);
+  BOOST_REQUIRE(entries[1].record_type == MemoryRecordRing::RecordType::kTimeSlice);
+  BOOST_REQUIRE_EQUAL(entries[1].record_number, 7);
+
+  auto tr_copy = ring.get_trigger_record(1, 0);
+  BOOST_REQUIRE(tr_copy.get() != nullptr);
+  BOOST_REQUIRE_EQUAL(tr_copy->get_header_ref().get_trigger_number(), 1);
+  BOOST_REQUIRE_EQUAL(tr_copy->get_header_ref().get_num_requested_components(), 3);
+  check_fragments_are_equal(tr.get_fragments_ref(), tr_copy->get_fragments_ref());
+
+  auto ts_copy = ring.get_time_slice(7);
+  BOOST_REQUIRE(ts_copy.get() != nullptr);
+  BOOST_REQUIRE_EQUAL(ts_copy->get_header().timeslice_number, 7);
+  check_fragments_are_equal(ts.get_fragments_ref(), ts_copy->get_fragments_ref());
+
+  BOOST_REQUIRE(ring.get_trigger_record(2, 0).get() == nullptr);
+  BOOST_REQUIRE(ring.get_time_slice(1).get() == nullptr);
+
+  ring.clear();
+  BOOST_REQUIRE_EQUAL(ring.list_entries().size(), 0);
+  BOOST_REQUIRE(ring.get_latest_trigger_record().get() == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(OldestRecordsAreDropped)
+{
+  // limit on the number of records
+  MemoryRecordRing count_ring("count_test", 1000000, 4);
+  for (uint64_t trig_num = 1; trig_num <= 10; ++trig_num) { // NOLINT(build/unsigned)
+    count_ring.add(create_trigger_record(trig_num, 1000, 2));
+  }
+  auto entries = count_ring.list_entries();
+  BOOST_REQUIRE_EQUAL(entries.size(), 4);
+  BOOST_REQUIRE_EQUAL(entries.front().record_number, 7);
+  BOOST_REQUIRE_EQUAL(count_ring.get_latest_trigger_record()->get_header_ref().get_trigger_number(), 10);
+
+  // limit on the number of bytes, with records that wrap around the end of the buffer
+  auto probe = create_trigger_record(0, 1000, 2);
+  MemoryRecordRing probe_ring("probe", 1000000, 0);
+  probe_ring.add(probe);
+  size_t record_size = probe_ring.list_entries().front().size_bytes;
+
+  MemoryRecordRing byte_ring("byte_test", (7 * record_size) / 2, 0);
+  for (uint64_t trig_num = 1; trig_num <= 20; ++trig_num) { // NOLINT(build/unsigned)
+    auto tr = create_trigger_record(trig_num, 1000, 2);
+    byte_ring.add(tr);
+    entries = byte_ring.list_entries();
+    BOOST_REQUIRE_GE(entries.size(), 1);
+    BOOST_REQUIRE_LE(entries.size(), 3);
+    BOOST_REQUIRE_EQUAL(entries.back().record_number, trig_num);
+    for (auto const& entry : entries) {
+      auto tr_copy = byte_ring.get_trigger_record(entry.record_number, 0);
+      BOOST_REQUIRE(tr_copy.get() != nullptr);
+      check_fragments_are_equal(create_trigger_record(entry.record_number, 1000, 2).get_fragments_ref(),
+                                tr_copy->get_fragments_ref());
+    }
+  }
+
+  BOOST_REQUIRE_THROW(byte_ring.add(create_trigger_record(21, 10000, 2)), RecordTooLargeForRing);
+}
+
+BOOST_AUTO_TEST_CASE(ReadNextRecord)
+{
+  MemoryRecordRing ring("test", 1000000, 0);
+  uint64_t next_index = 0; // NOLINT(build/unsigned)
+  BOOST_REQUIRE(ring.read_next_trigger_record(next_index, std::chrono::milliseconds(10)).get() == nullptr);
+
+  std::thread producer([&]() {
+    for (uint64_t trig_num = 1; trig_num <= 5; ++trig_num) { // NOLINT(build/unsigned)
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      ring.add(create_trigger_record(trig_num, 1000, 2));
+      ring.add(create_time_slice(trig_num, 100, 1));
+    }
+  });
+
+  for (uint64_t trig_num = 1; trig_num <= 5; ++trig_num) { // NOLINT(build/unsigned)
+    auto tr_ptr = ring.read_next_trigger_record(next_index, std::chrono::milliseconds(5000));
+    BOOST_REQUIRE(tr_ptr.get() != nullptr);
+    BOOST_REQUIRE_EQUAL(tr_ptr->get_header_ref().get_trigger_number(), trig_num);
+  }
+  producer.join();
+  BOOST_REQUIRE(ring.read_next_trigger_record(next_index, std::chrono::milliseconds(10)).get() == nullptr);
+
+  uint64_t ts_index = 0; // NOLINT(build/unsigned)
+  auto ts_ptr = ring.read_next_time_slice(ts_index, std::chrono::milliseconds(10));
+  BOOST_REQUIRE(ts_ptr.get() != nullptr);
+  BOOST_REQUIRE_EQUAL(ts_ptr->get_header().timeslice_number, 1);
+}
+
+BOOST_AUTO_TEST_CASE(FindRingByName)
+{
+  BOOST_REQUIRE(MemoryRecordRing::find("no_such_ring").get() == nullptr);
+
+  auto ring = MemoryRecordRing::create("named_ring", 100000, 10);
+  BOOST_REQUIRE_EQUAL(MemoryRecordRing::find("named_ring").get(), ring.get());
+
+  auto replacement = MemoryRecordRing::create("named_ring", 100000, 10);
+  BOOST_REQUIRE_EQUAL(MemoryRecordRing::find("named_ring").get(), replacement.get());
+
+  replacement.reset();
+  BOOST_REQUIRE(MemoryRecordRing::find("named_ring").get() == nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
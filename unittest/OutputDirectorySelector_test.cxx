@@ -0,0 +1,123 @@
+/**
+ * @file OutputDirectorySelector_test.cxx Test application that tests and demonstrates
+ * the functionality of the OutputDirectorySelector class.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/OutputDirectorySelector.hpp"
+
+#define BOOST_TEST_MODULE OutputDirectorySelector_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace dunedaq::dfmodules;
+
+namespace {
+std::vector<OutputDirectorySelector::DirectoryConfig>
+make_directory_list()
+{
+  std::string tmp_path = std::filesystem::temp_directory_path().string();
+  return { { tmp_path, 2 }, { tmp_path + "/.", 1 }, { "/this/path/does/not/exist", 1 } };
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(OutputDirectorySelector_test)
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<OutputDirectorySelector>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<OutputDirectorySelector>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<OutputDirectorySelector>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<OutputDirectorySelector>);
+}
+
+BOOST_AUTO_TEST_CASE(WeightedRoundRobin)
+{
+  OutputDirectorySelector selector(
+    "test", make_directory_list(), std::chrono::milliseconds(1000), 0, std::chrono::milliseconds(60000));
+  BOOST_REQUIRE_EQUAL(selector.get_number_of_directories(), 3);
+
+  std::vector<size_t> invalid_directories = selector.reset();
+  BOOST_REQUIRE_EQUAL(invalid_directories.size(), 1);
+  BOOST_REQUIRE_EQUAL(invalid_directories[0], 2);
+
+  // the directory with weight 2 is chosen twice as often, and the invalid directory is never chosen
+  std::map<size_t, int> selection_counts;
+  for (int idx = 0; idx < 30; ++idx) {
+    auto selected = selector.select(1);
+    BOOST_REQUIRE(selected.has_value());
+    ++selection_counts[*selected];
+  }
+  BOOST_REQUIRE_EQUAL(selection_counts[0], 20);
+  BOOST_REQUIRE_EQUAL(selection_counts[1], 10);
+  BOOST_REQUIRE_EQUAL(selection_counts[2], 0);
+
+  // no directory has this much free space
+  BOOST_REQUIRE(!selector.select(std::numeric_limits<size_t>::max()).has_value());
+  BOOST_REQUIRE(!selector.is_usable(0, std::numeric_limits<size_t>::max()));
+}
+
+BOOST_AUTO_TEST_CASE(PeekAndCommit)
+{
+  OutputDirectorySelector selector(
+    "test", make_directory_list(), std::chrono::milliseconds(1000), 0, std::chrono::milliseconds(60000));
+  selector.reset();
+
+  // peeking does not move the rotation on, and committing the peeked directory is the same as selecting it
+  std::map<size_t, int> selection_counts;
+  for (int idx = 0; idx < 30; ++idx) {
+    auto peeked = selector.peek(1);
+    BOOST_REQUIRE(peeked.has_value());
+    BOOST_REQUIRE_EQUAL(*selector.peek(1), *peeked);
+    if (idx % 2 == 0) {
+      selector.commit(*peeked, 1);
+      ++selection_counts[*peeked];
+    } else {
+      auto selected = selector.select(1);
+      BOOST_REQUIRE(selected.has_value());
+      BOOST_REQUIRE_EQUAL(*selected, *peeked);
+      ++selection_counts[*selected];
+    }
+  }
+  BOOST_REQUIRE_EQUAL(selection_counts[0], 20);
+  BOOST_REQUIRE_EQUAL(selection_counts[1], 10);
+
+  BOOST_REQUIRE(!selector.peek(std::numeric_limits<size_t>::max()).has_value());
+}
+
+BOOST_AUTO_TEST_CASE(SlowDirectoryIsTakenOutOfRotation)
+{
+  OutputDirectorySelector selector(
+    "test", make_directory_list(), std::chrono::milliseconds(1000), 1000000, std::chrono::milliseconds(60000));
+  selector.reset();
+  BOOST_REQUIRE(selector.is_usable(0, 1));
+
+  // writes at a fast rate keep the directory in the rotation
+  selector.record_write(0, 10000000, std::chrono::seconds(2));
+  BOOST_REQUIRE(selector.is_usable(0, 1));
+
+  // 1000 bytes in 1 second is below the minimum rate of 1 MB/s
+  selector.record_write(0, 1000, std::chrono::seconds(1));
+  BOOST_REQUIRE(!selector.is_usable(0, 1));
+  for (int idx = 0; idx < 5; ++idx) {
+    auto selected = selector.select(1);
+    BOOST_REQUIRE(selected.has_value());
+    BOOST_REQUIRE_EQUAL(*selected, 1);
+  }
+
+  // the start of a new run puts the directory back into the rotation
+  selector.reset();
+  BOOST_REQUIRE(selector.is_usable(0, 1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
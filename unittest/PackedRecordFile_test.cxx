@@ -0,0 +1,203 @@
+/**
+ * @file PackedRecordFile_test.cxx Test application that tests and demonstrates
+ * the functionality of the PackedRecordWriter and PackedRecordReader classes.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/PackedRecordFile.hpp"
+
+#define BOOST_TEST_MODULE PackedRecordFile_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace dunedaq::dfmodules;
+using namespace dunedaq::daqdataformats;
+
+namespace {
+
+const int s_run_number = 53;
+
+std::unique_ptr<Fragment>
+create_fragment(uint64_t trig_num, int element_number, int fragment_size) // NOLINT(build/unsigned)
+{
+  std::vector<char> dummy_data(fragment_size);
+  for (int idx = 0; idx < fragment_size; ++idx) {
+    dummy_data[idx] = static_cast<char>((trig_num + element_number + idx) % 128);
+  }
+
+  FragmentHeader fh;
+  fh.trigger_number = trig_num;
+  fh.trigger_timestamp = 1000 + trig_num;
+  fh.run_number = s_run_number;
+  fh.element_id = SourceID(SourceID::Subsystem::kDetectorReadout, element_number);
+  auto frag_ptr = std::make_unique<Fragment>(dummy_data.data(), fragment_size);
+  frag_ptr->set_header_fields(fh);
+  return frag_ptr;
+}
+
+TriggerRecord
+create_trigger_record(uint64_t trig_num, int fragment_size, int element_count) // NOLINT(build/unsigned)
+{
+  TriggerRecordHeaderData trh_data;
+  trh_data.trigger_number = trig_num;
+  trh_data.trigger_timestamp = 1000 + trig_num;
+  trh_data.num_requested_components = element_count;
+  trh_data.run_number = s_run_number;
+  trh_data.sequence_number = 0;
+  trh_data.max_sequence_number = 1;
+  trh_data.element_id = SourceID(SourceID::Subsystem::kTRBuilder, 0);
+  TriggerRecordHeader trh(&trh_data);
+
+  TriggerRecord tr(trh);
+  for (int ele_num = 0; ele_num < element_count; ++ele_num) {
+    tr.add_fragment(create_fragment(trig_num, ele_num, fragment_size));
+  }
+  return tr;
+}
+
+bool
+are_fragments_equal(const Fragment& expected, const Fragment& actual)
+{
+  return expected.get_size() == actual.get_size() &&
+         std::memcmp(expected.get_storage_location(), actual.get_storage_location(), expected.get_size()) == 0;
+}
+
+/**
+ * @brief Creates an empty HDF5 file for a test, and removes it at the end of the test
+ */
+struct TestFile
+{
+  TestFile()
+    : name(std::filesystem::temp_directory_path().string() + "/PackedRecordFile_test_" + std::to_string(getpid()) +
+           ".hdf5")
+  {
+    hid_t file_id = H5Fcreate(name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    H5Fclose(file_id);
+  }
+  ~TestFile() { std::filesystem::remove(name); }
+  std::string name;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(PackedRecordFile_test)
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<PackedRecordWriter>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<PackedRecordWriter>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<PackedRecordWriter>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<PackedRecordWriter>);
+
+  BOOST_REQUIRE(!std::is_copy_constructible_v<PackedRecordReader>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<PackedRecordReader>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<PackedRecordReader>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<PackedRecordReader>);
+}
+
+BOOST_AUTO_TEST_CASE(WriteAndReadBack)
+{
+  TestFile test_file;
+  BOOST_REQUIRE(!PackedRecordReader::is_packed_file(test_file.name));
+
+  const int fragment_size = 1000;
+  const int trigger_count = 3;
+  std::vector<TriggerRecord> trigger_records;
+  for (int trig_num = 1; trig_num <= trigger_count; ++trig_num) {
+    // the last TriggerRecord has an index table that is too large for the compact layout
+    trigger_records.push_back(create_trigger_record(trig_num, fragment_size, trig_num < trigger_count ? 5 : 1100));
+  }
+  TimeSlice time_slice(17, s_run_number);
+  time_slice.add_fragment(create_fragment(17, 0, 2 * fragment_size));
+
+  size_t total_size = 0;
+  {
+    PackedRecordWriter writer(test_file.name);
+    for (auto const& tr : trigger_records) {
+      writer.write(tr, "TriggerRecord" + std::to_string(tr.get_header_ref().get_trigger_number()));
+      total_size += tr.get_header_ref().get_total_size_bytes();
+      for (auto const& frag_ptr : tr.get_fragments_ref()) {
+        total_size += frag_ptr->get_size();
+      }
+    }
+    writer.write(time_slice, "TimeSlice17");
+    total_size += sizeof(TimeSliceHeader) + time_slice.get_fragments_ref()[0]->get_size();
+    BOOST_REQUIRE_EQUAL(writer.get_recorded_size(), total_size);
+
+    // a record can only be written once
+    BOOST_REQUIRE_THROW(writer.write(trigger_records[0], "TriggerRecord1"), PackedRecordProblem);
+  }
+  BOOST_REQUIRE(PackedRecordReader::is_packed_file(test_file.name));
+
+  PackedRecordReader reader(test_file.name);
+  BOOST_REQUIRE_EQUAL(reader.get_record_ids().size(), trigger_count + 1);
+  for (auto const& tr : trigger_records) {
+    PackedRecordReader::record_id_t record_id = std::make_pair(tr.get_header_ref().get_trigger_number(), 0);
+    BOOST_REQUIRE(reader.has_record(record_id));
+
+    auto index = reader.get_index(record_id);
+    BOOST_REQUIRE_EQUAL(index.size(), tr.get_fragments_ref().size() + 1);
+    BOOST_REQUIRE(index[0].entry_type == packedrecord::EntryType::kRecordHeader);
+    BOOST_REQUIRE_EQUAL(index[1].offset, tr.get_header_ref().get_total_size_bytes());
+
+    auto tr_ptr = reader.read_trigger_record(record_id);
+    BOOST_REQUIRE_EQUAL(tr_ptr->get_header_ref().get_total_size_bytes(), tr.get_header_ref().get_total_size_bytes());
+    BOOST_REQUIRE(std::memcmp(tr_ptr->get_header_ref().get_storage_location(),
+                              tr.get_header_ref().get_storage_location(),
+                              tr.get_header_ref().get_total_size_bytes()) == 0);
+    BOOST_REQUIRE_EQUAL(tr_ptr->get_fragments_ref().size(), tr.get_fragments_ref().size());
+    for (size_t idx = 0; idx < tr.get_fragments_ref().size(); ++idx) {
+      BOOST_REQUIRE(are_fragments_equal(*tr.get_fragments_ref()[idx], *tr_ptr->get_fragments_ref()[idx]));
+    }
+  }
+
+  auto ts_ptr = reader.read_time_slice(17);
+  BOOST_REQUIRE_EQUAL(ts_ptr->get_header().timeslice_number, 17);
+  BOOST_REQUIRE_EQUAL(ts_ptr->get_fragments_ref().size(), 1);
+  BOOST_REQUIRE(are_fragments_equal(*time_slice.get_fragments_ref()[0], *ts_ptr->get_fragments_ref()[0]));
+
+  BOOST_REQUIRE(!reader.has_record(std::make_pair(4, 0)));
+  BOOST_REQUIRE_THROW(reader.read_trigger_record(std::make_pair(4, 0)), PackedRecordProblem);
+  BOOST_REQUIRE_THROW(reader.read_trigger_record(std::make_pair(17, 0)), PackedRecordProblem);
+}
+
+BOOST_AUTO_TEST_CASE(ReadSingleFragments)
+{
+  TestFile test_file;
+  TriggerRecord tr = create_trigger_record(5, 300, 20);
+  {
+    PackedRecordWriter writer(test_file.name);
+    writer.write(tr, "TriggerRecord5");
+  }
+
+  PackedRecordReader reader(test_file.name);
+  auto frag_ptr = reader.read_fragment(std::make_pair(5, 0), SourceID(SourceID::Subsystem::kDetectorReadout, 13));
+  BOOST_REQUIRE(frag_ptr.get() != nullptr);
+  BOOST_REQUIRE(are_fragments_equal(*tr.get_fragments_ref()[13], *frag_ptr));
+
+  BOOST_REQUIRE(reader.read_fragment(std::make_pair(5, 0), SourceID(SourceID::Subsystem::kDetectorReadout, 20)).get() ==
+                nullptr);
+  BOOST_REQUIRE(reader.read_fragment(std::make_pair(5, 0), SourceID(SourceID::Subsystem::kTRBuilder, 13)).get() ==
+                nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(FileWithoutPackedRecords)
+{
+  TestFile test_file;
+  BOOST_REQUIRE_THROW(PackedRecordReader reader(test_file.name), PackedRecordProblem);
+  BOOST_REQUIRE_THROW(PackedRecordReader reader(test_file.name + ".missing"), PackedRecordProblem);
+  BOOST_REQUIRE_THROW(PackedRecordWriter writer(test_file.name + ".missing"), PackedRecordProblem);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
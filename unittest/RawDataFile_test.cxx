@@ -0,0 +1,248 @@
+/**
+ * @file RawDataFile_test.cxx Test application that tests and demonstrates
+ * the functionality of the RawDataFileWriter and RawDataFileReader classes.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/RawDataFileReader.hpp"
+#include "dfmodules/RawDataFileWriter.hpp"
+
+#define BOOST_TEST_MODULE RawDataFile_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace dunedaq::dfmodules;
+using namespace dunedaq::daqdataformats;
+
+namespace {
+
+const int s_run_number = 53;
+
+std::unique_ptr<Fragment>
+create_fragment(uint64_t trig_num, int element_number, int fragment_size) // NOLINT(build/unsigned)
+{
+  std::vector<char> dummy_data(fragment_size);
+  for (int idx = 0; idx < fragment_size; ++idx) {
+    dummy_data[idx] = static_cast<char>((trig_num + element_number + idx) % 128);
+  }
+
+  FragmentHeader fh;
+  fh.trigger_number = trig_num;
+  fh.trigger_timestamp = 1000 + trig_num;
+  fh.run_number = s_run_number;
+  fh.element_id = SourceID(SourceID::Subsystem::kDetectorReadout, element_number);
+  auto frag_ptr = std::make_unique<Fragment>(dummy_data.data(), fragment_size);
+  frag_ptr->set_header_fields(fh);
+  return frag_ptr;
+}
+
+TriggerRecord
+create_trigger_record(uint64_t trig_num, int fragment_size, int element_count) // NOLINT(build/unsigned)
+{
+  TriggerRecordHeaderData trh_data;
+  trh_data.trigger_number = trig_num;
+  trh_data.trigger_timestamp = 1000 + trig_num;
+  trh_data.num_requested_components = element_count;
+  trh_data.run_number = s_run_number;
+  trh_data.sequence_number = 0;
+  trh_data.max_sequence_number = 1;
+  trh_data.element_id = SourceID(SourceID::Subsystem::kTRBuilder, 0);
+  TriggerRecordHeader trh(&trh_data);
+
+  TriggerRecord tr(trh);
+  for (int ele_num = 0; ele_num < element_count; ++ele_num) {
+    tr.add_fragment(create_fragment(trig_num, ele_num, fragment_size));
+  }
+  return tr;
+}
+
+void
+check_fragments_are_equal(const std::vector<std::unique_ptr<Fragment>>& expected,
+                          const std::vector<std::unique_ptr<Fragment>>& actual)
+{
+  BOOST_REQUIRE_EQUAL(expected.size(), actual.size());
+  for (size_t idx = 0; idx < expected.size(); ++idx) {
+    BOOST_REQUIRE_EQUAL(expected[idx]->get_size(), actual[idx]->get_size());
+    BOOST_REQUIRE(std::memcmp(expected[idx]->get_storage_location(),
+                              actual[idx]->get_storage_location(),
+                              expected[idx]->get_size()) == 0);
+  }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(RawDataFile_test)
+
+BOOST_AUTO_TEST_CASE(WriteAndReadBack)
+{
+  std::string file_name = std::filesystem::temp_directory_path().string() + "/RawDataFile_test_" +
+                          std::to_string(getpid()) + ".bin";
+
+  rawdatafile::FileHeader file_header;
+  file_header.run_number = s_run_number;
+  file_header.file_index = 2;
+  rawdatafile::copy_string(file_header.writer_identifier, "rawdatafile_test");
+
+  const int fragment_size = 5000;
+  const int element_count = 7;
+  const int trigger_count = 5;
+  std::vector<TriggerRecord> trigger_records;
+  for (int trig_num = 1; trig_num <= trigger_count; ++trig_num) {
+    trigger_records.push_back(create_trigger_record(trig_num, fragment_size, element_count));
+  }
+  TimeSlice time_slice(17, s_run_number);
+  time_slice.add_fragment(create_fragment(17, 0, 2 * fragment_size));
+
+  // a small buffer is used, so that the fragments cross buffer boundaries
+  size_t total_size = sizeof(file_header);
+  {
+    RawDataFileWriter writer(file_name, file_header, 8192, true);
+    BOOST_REQUIRE(std::filesystem::exists(writer.get_in_progress_file_name()));
+    for (auto const& tr : trigger_records) {
+      total_size += writer.write(tr);
+    }
+    total_size += writer.write(time_slice);
+    BOOST_REQUIRE_EQUAL(writer.get_recorded_size(), total_size);
+    writer.close();
+    BOOST_REQUIRE(!writer.is_open());
+  }
+  BOOST_REQUIRE(std::filesystem::exists(file_name));
+  BOOST_REQUIRE_EQUAL(std::filesystem::file_size(file_name), total_size);
+
+  RawDataFileReader reader(file_name);
+  BOOST_REQUIRE_EQUAL(reader.get_file_header().run_number, s_run_number);
+  BOOST_REQUIRE_EQUAL(reader.get_file_header().file_index, 2);
+  BOOST_REQUIRE_EQUAL(std::string(reader.get_file_header().writer_identifier), "rawdatafile_test");
+
+  for (auto const& expected_tr : trigger_records) {
+    BOOST_REQUIRE(reader.read_next_block());
+    BOOST_REQUIRE(reader.get_block_header().block_type == rawdatafile::BlockType::kTriggerRecord);
+    BOOST_REQUIRE_EQUAL(reader.get_block_header().record_number, expected_tr.get_header_ref().get_trigger_number());
+    auto tr_ptr = reader.get_trigger_record();
+    BOOST_REQUIRE_EQUAL(tr_ptr->get_header_ref().get_trigger_number(),
+                        expected_tr.get_header_ref().get_trigger_number());
+    BOOST_REQUIRE_EQUAL(tr_ptr->get_header_ref().get_run_number(), s_run_number);
+    check_fragments_are_equal(expected_tr.get_fragments_ref(), tr_ptr->get_fragments_ref());
+  }
+
+  BOOST_REQUIRE(reader.read_next_block());
+  BOOST_REQUIRE(reader.get_block_header().block_type == rawdatafile::BlockType::kTimeSlice);
+  BOOST_REQUIRE_THROW(reader.get_trigger_record(), dunedaq::dfmodules::RawDataFileProblem);
+  auto ts_ptr = reader.get_time_slice();
+  BOOST_REQUIRE_EQUAL(ts_ptr->get_header().timeslice_number, 17);
+  check_fragments_are_equal(time_slice.get_fragments_ref(), ts_ptr->get_fragments_ref());
+
+  BOOST_REQUIRE(!reader.read_next_block());
+
+  std::filesystem::remove(file_name);
+}
+
+BOOST_AUTO_TEST_CASE(WriteThroughIoUringWithSyncs)
+{
+  if (!IoUringWriteEngine::is_supported()) {
+    BOOST_TEST_MESSAGE("io_uring is not available, skipping the test");
+    return;
+  }
+  std::string file_name = std::filesystem::temp_directory_path().string() + "/RawDataFile_test_io_uring_" +
+                          std::to_string(getpid()) + ".bin";
+
+  // two small buffers, so that the writer needs to wait for buffers to become free,
+  // and syncs in the middle of a buffer, so that partial blocks are written again later
+  IoUringWriteEngine engine("test", 4, 2, 8192);
+  rawdatafile::FileHeader file_header;
+  std::vector<TriggerRecord> trigger_records;
+  for (int trig_num = 1; trig_num <= 6; ++trig_num) {
+    trigger_records.push_back(create_trigger_record(trig_num, 3000, 3));
+  }
+  {
+    RawDataFileWriter writer(file_name, file_header, 0, true, ".writing", &engine);
+    for (auto const& tr : trigger_records) {
+      writer.write(tr);
+      size_t recorded_size = writer.get_recorded_size();
+      writer.sync();
+      while (writer.is_sync_in_flight()) {
+        writer.poll_completions();
+      }
+      BOOST_REQUIRE_EQUAL(writer.get_durable_size(), recorded_size);
+    }
+    writer.close();
+    BOOST_REQUIRE_EQUAL(writer.get_durable_size(), writer.get_recorded_size());
+    BOOST_REQUIRE_EQUAL(engine.get_number_in_flight(), 0);
+  }
+
+  RawDataFileReader reader(file_name);
+  for (auto const& expected_tr : trigger_records) {
+    BOOST_REQUIRE(reader.read_next_block());
+    auto tr_ptr = reader.get_trigger_record();
+    BOOST_REQUIRE_EQUAL(tr_ptr->get_header_ref().get_trigger_number(),
+                        expected_tr.get_header_ref().get_trigger_number());
+    check_fragments_are_equal(expected_tr.get_fragments_ref(), tr_ptr->get_fragments_ref());
+  }
+  BOOST_REQUIRE(!reader.read_next_block());
+
+  std::filesystem::remove(file_name);
+}
+
+BOOST_AUTO_TEST_CASE(SyncWithoutIoUring)
+{
+  std::string file_name = std::filesystem::temp_directory_path().string() + "/RawDataFile_test_sync_" +
+                          std::to_string(getpid()) + ".bin";
+
+  rawdatafile::FileHeader file_header;
+  {
+    RawDataFileWriter writer(file_name, file_header, 8192, true);
+    writer.write(create_trigger_record(1, 1000, 2));
+    BOOST_REQUIRE_EQUAL(writer.get_durable_size(), 0);
+    writer.sync();
+    BOOST_REQUIRE_EQUAL(writer.get_durable_size(), writer.get_recorded_size());
+    writer.write(create_trigger_record(2, 1000, 2));
+    writer.close();
+  }
+
+  RawDataFileReader reader(file_name);
+  BOOST_REQUIRE(reader.read_next_block());
+  BOOST_REQUIRE(reader.read_next_block());
+  BOOST_REQUIRE_EQUAL(reader.get_trigger_record()->get_header_ref().get_trigger_number(), 2);
+  BOOST_REQUIRE(!reader.read_next_block());
+
+  std::filesystem::remove(file_name);
+}
+
+BOOST_AUTO_TEST_CASE(TruncatedFile)
+{
+  std::string file_name = std::filesystem::temp_directory_path().string() + "/RawDataFile_test_truncated_" +
+                          std::to_string(getpid()) + ".bin";
+
+  rawdatafile::FileHeader file_header;
+  {
+    RawDataFileWriter writer(file_name, file_header, 8192, false, "");
+    writer.write(create_trigger_record(1, 1000, 2));
+    writer.write(create_trigger_record(2, 1000, 2));
+  }
+  std::filesystem::resize_file(file_name, std::filesystem::file_size(file_name) - 100);
+
+  RawDataFileReader reader(file_name);
+  BOOST_REQUIRE(reader.read_next_block());
+  BOOST_REQUIRE_EQUAL(reader.get_trigger_record()->get_fragments_ref().size(), 2);
+  BOOST_REQUIRE_THROW(reader.read_next_block(), dunedaq::dfmodules::RawDataFileProblem);
+
+  std::filesystem::remove(file_name);
+}
+
+BOOST_AUTO_TEST_CASE(InvalidFile)
+{
+  BOOST_REQUIRE_THROW(RawDataFileReader("/this/path/does/not/exist.bin"), dunedaq::dfmodules::RawDataFileProblem);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,164 @@
+/**
+ * @file RecordIndex_test.cxx Test application that tests and demonstrates
+ * the functionality of the RecordIndexWriter and RecordIndexReader classes.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/RecordIndexFile.hpp"
+
+#define BOOST_TEST_MODULE RecordIndex_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include "hdf5.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace dunedaq::dfmodules;
+
+namespace {
+
+std::string
+get_test_file_name(const std::string& suffix)
+{
+  return std::filesystem::temp_directory_path().string() + "/RecordIndex_test_" + std::to_string(getpid()) + suffix;
+}
+
+recordindex::Entry
+make_entry(uint64_t record_number, uint32_t sequence_number) // NOLINT(build/unsigned)
+{
+  recordindex::Entry entry;
+  entry.record_number = record_number;
+  entry.sequence_number = sequence_number;
+  entry.timestamp = 1000 + record_number;
+  entry.trigger_type = 1;
+  entry.size_bytes = 100 * record_number;
+  recordindex::copy_group_path(entry.group_path,
+                               "TriggerRecord" + std::to_string(record_number) + "." + std::to_string(sequence_number));
+  return entry;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(RecordIndex_test)
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<RecordIndexWriter>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<RecordIndexWriter>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<RecordIndexWriter>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<RecordIndexWriter>);
+
+  BOOST_REQUIRE(!std::is_copy_constructible_v<RecordIndexReader>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<RecordIndexReader>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<RecordIndexReader>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<RecordIndexReader>);
+}
+
+BOOST_AUTO_TEST_CASE(GroupPath)
+{
+  recordindex::Entry entry;
+  recordindex::copy_group_path(entry.group_path, std::string(100, 'x'));
+  BOOST_REQUIRE_EQUAL(std::string(entry.group_path).size(), recordindex::s_max_group_path_length - 1);
+}
+
+BOOST_AUTO_TEST_CASE(WriteAndRead)
+{
+  std::string file_name = get_test_file_name(".index");
+  recordindex::FileHeader header;
+  header.run_number = 53;
+  header.file_index = 2;
+  {
+    RecordIndexWriter writer(file_name, header);
+    for (uint64_t record_number = 1; record_number <= 5; ++record_number) { // NOLINT(build/unsigned)
+      writer.append(make_entry(record_number, 0));
+    }
+    writer.append(make_entry(5, 1));
+    BOOST_REQUIRE_EQUAL(writer.get_entries().size(), 6);
+  }
+
+  RecordIndexReader reader(file_name);
+  BOOST_REQUIRE_EQUAL(reader.get_file_header().run_number, 53);
+  BOOST_REQUIRE_EQUAL(reader.get_file_header().file_index, 2);
+  BOOST_REQUIRE_EQUAL(reader.get_file_header().entry_size, sizeof(recordindex::Entry));
+  BOOST_REQUIRE_EQUAL(reader.get_entries().size(), 6);
+
+  const recordindex::Entry* entry = reader.find_entry(5, 1);
+  BOOST_REQUIRE(entry != nullptr);
+  BOOST_REQUIRE_EQUAL(entry->size_bytes, 500);
+  BOOST_REQUIRE_EQUAL(std::string(entry->group_path), "TriggerRecord5.1");
+  BOOST_REQUIRE(reader.find_entry(6, 0) == nullptr);
+
+  std::remove(file_name.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(TornTail)
+{
+  std::string file_name = get_test_file_name(".index");
+  {
+    RecordIndexWriter writer(file_name, recordindex::FileHeader());
+    writer.append(make_entry(1, 0));
+    writer.append(make_entry(2, 0));
+  }
+  // simulate a writer that crashed in the middle of appending the last entry
+  std::filesystem::resize_file(file_name, std::filesystem::file_size(file_name) - 10);
+
+  RecordIndexReader reader(file_name);
+  BOOST_REQUIRE_EQUAL(reader.get_entries().size(), 1);
+  BOOST_REQUIRE(reader.find_entry(1, 0) != nullptr);
+  BOOST_REQUIRE(reader.find_entry(2, 0) == nullptr);
+
+  std::filesystem::resize_file(file_name, 10);
+  BOOST_REQUIRE_THROW(RecordIndexReader{ file_name }, dunedaq::dfmodules::RecordIndexProblem);
+
+  std::remove(file_name.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(InFileDataset)
+{
+  std::string index_file_name = get_test_file_name(".index");
+  std::string hdf5_file_name = get_test_file_name(".hdf5");
+
+  // the dataset is written while another handle to the HDF5 file is open, as in the HDF5DataStore
+  hid_t file_id = H5Fcreate(hdf5_file_name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  BOOST_REQUIRE(file_id >= 0);
+  {
+    RecordIndexWriter writer(index_file_name, recordindex::FileHeader());
+    writer.append(make_entry(7, 0));
+    writer.append(make_entry(8, 0));
+    writer.write_to_hdf5_file(hdf5_file_name);
+  }
+  H5Fclose(file_id);
+
+  file_id = H5Fopen(hdf5_file_name.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  BOOST_REQUIRE(file_id >= 0);
+  hid_t dataset_id = H5Dopen2(file_id, recordindex::s_dataset_name, H5P_DEFAULT);
+  BOOST_REQUIRE(dataset_id >= 0);
+  hid_t space_id = H5Dget_space(dataset_id);
+  hsize_t dims[1] = { 0 };
+  H5Sget_simple_extent_dims(space_id, dims, nullptr);
+  BOOST_REQUIRE_EQUAL(dims[0], 2);
+
+  hid_t read_type = H5Tcreate(H5T_COMPOUND, sizeof(uint64_t)); // NOLINT(build/unsigned)
+  H5Tinsert(read_type, "record_number", 0, H5T_NATIVE_UINT64);
+  std::vector<uint64_t> record_numbers(2); // NOLINT(build/unsigned)
+  BOOST_REQUIRE(H5Dread(dataset_id, read_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, record_numbers.data()) >= 0);
+  BOOST_REQUIRE_EQUAL(record_numbers[0], 7);
+  BOOST_REQUIRE_EQUAL(record_numbers[1], 8);
+
+  H5Tclose(read_type);
+  H5Sclose(space_id);
+  H5Dclose(dataset_id);
+  H5Fclose(file_id);
+  std::remove(index_file_name.c_str());
+  std::remove(hdf5_file_name.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,298 @@
+/**
+ * @file SharedMemoryRing_test.cxx Test application that tests and demonstrates
+ * the functionality of the SharedMemoryRing class and of the serialization of
+ * records that the SubprocessDataStore sends through it.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/SharedMemoryRing.hpp"
+#include "dfmodules/SubprocessWriterProtocol.hpp"
+
+#define BOOST_TEST_MODULE SharedMemoryRing_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace dunedaq::dfmodules;
+using namespace dunedaq::daqdataformats;
+
+namespace {
+
+const int s_run_number = 53;
+const std::chrono::milliseconds s_no_wait(0);
+const std::chrono::milliseconds s_long_wait(5000);
+
+std::unique_ptr<Fragment>
+create_fragment(uint64_t trig_num, int element_number, int fragment_size) // NOLINT(build/unsigned)
+{
+  std::vector<char> dummy_data(fragment_size);
+  for (int idx = 0; idx < fragment_size; ++idx) {
+    dummy_data[idx] = static_cast<char>((trig_num + element_number + idx) % 128);
+  }
+
+  FragmentHeader fh;
+  fh.trigger_number = trig_num;
+  fh.trigger_timestamp = 1000 + trig_num;
+  fh.run_number = s_run_number;
+  fh.element_id = SourceID(SourceID::Subsystem::kDetectorReadout, element_number);
+  auto frag_ptr = std::make_unique<Fragment>(dummy_data.data(), fragment_size);
+  frag_ptr->set_header_fields(fh);
+  return frag_ptr;
+}
+
+TriggerRecord
+create_trigger_record(uint64_t trig_num, int fragment_size, int element_count) // NOLINT(build/unsigned)
+{
+  TriggerRecordHeaderData trh_data;
+  trh_data.trigger_number = trig_num;
+  trh_data.trigger_timestamp = 1000 + trig_num;
+  trh_data.num_requested_components = element_count;
+  trh_data.run_number = s_run_number;
+  trh_data.sequence_number = 0;
+  trh_data.max_sequence_number = 1;
+  trh_data.element_id = SourceID(SourceID::Subsystem::kTRBuilder, 0);
+  TriggerRecordHeader trh(&trh_data);
+
+  TriggerRecord tr(trh);
+  for (int ele_num = 0; ele_num < element_count; ++ele_num) {
+    tr.add_fragment(create_fragment(trig_num, ele_num, fragment_size));
+  }
+  return tr;
+}
+
+void
+check_fragments_are_equal(const std::vector<std::unique_ptr<Fragment>>& expected,
+                          const std::vector<std::unique_ptr<Fragment>>& actual)
+{
+  BOOST_REQUIRE_EQUAL(expected.size(), actual.size());
+  for (size_t idx = 0; idx < expected.size(); ++idx) {
+    BOOST_REQUIRE_EQUAL(expected[idx]->get_size(), actual[idx]->get_size());
+    BOOST_REQUIRE(std::memcmp(expected[idx]->get_storage_location(),
+                              actual[idx]->get_storage_location(),
+                              expected[idx]->get_size()) == 0);
+  }
+}
+
+std::string
+read_text_message(SharedMemoryRing& ring, uint32_t& type) // NOLINT(build/unsigned)
+{
+  size_t size = 0;
+  const char* payload = ring.peek_message(type, size, s_long_wait);
+  BOOST_REQUIRE(payload != nullptr);
+  std::string text(payload, size);
+  ring.consume_message();
+  return text;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(SharedMemoryRing_test)
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<SharedMemoryRing>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<SharedMemoryRing>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<SharedMemoryRing>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<SharedMemoryRing>);
+}
+
+BOOST_AUTO_TEST_CASE(WriteAndReadMessages)
+{
+  SharedMemoryRing ring("test", 10000);
+  BOOST_REQUIRE_EQUAL(ring.get_capacity(), 3 * 4096);
+  BOOST_REQUIRE_EQUAL(ring.get_used_bytes(), 0);
+
+  uint32_t type = 0; // NOLINT(build/unsigned)
+  size_t size = 0;
+  BOOST_REQUIRE(ring.peek_message(type, size, s_no_wait) == nullptr);
+
+  std::string first("first"), second("second part");
+  BOOST_REQUIRE(ring.write_message(1, { { first.data(), first.size() }, { second.data(), second.size() } }, s_no_wait));
+  BOOST_REQUIRE(ring.write_message(2, {}, s_no_wait));
+  BOOST_REQUIRE_EQUAL(ring.get_used_bytes(),
+                      SharedMemoryRing::get_message_size(first.size() + second.size()) +
+                        SharedMemoryRing::get_message_size(0));
+
+  BOOST_REQUIRE_EQUAL(read_text_message(ring, type), first + second);
+  BOOST_REQUIRE_EQUAL(type, 1);
+  BOOST_REQUIRE_EQUAL(read_text_message(ring, type), "");
+  BOOST_REQUIRE_EQUAL(type, 2);
+  BOOST_REQUIRE_EQUAL(ring.get_used_bytes(), 0);
+  BOOST_REQUIRE(ring.peek_message(type, size, s_no_wait) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(MessagesWrapAroundTheEndOfTheRing)
+{
+  SharedMemoryRing ring("wrap_test", 4096);
+  std::vector<char> data(1000);
+  for (int msg_num = 0; msg_num < 50; ++msg_num) {
+    std::fill(data.begin(), data.end(), static_cast<char>(msg_num));
+    BOOST_REQUIRE(ring.write_message(msg_num, { { data.data(), data.size() } }, s_no_wait));
+    if (msg_num % 2 == 1) {
+      for (int expected_num = msg_num - 1; expected_num <= msg_num; ++expected_num) {
+        uint32_t type = 0; // NOLINT(build/unsigned)
+        size_t size = 0;
+        const char* payload = ring.peek_message(type, size, s_no_wait);
+        BOOST_REQUIRE(payload != nullptr);
+        BOOST_REQUIRE_EQUAL(type, expected_num);
+        BOOST_REQUIRE_EQUAL(size, data.size());
+        BOOST_REQUIRE_EQUAL(payload[0], static_cast<char>(expected_num));
+        BOOST_REQUIRE_EQUAL(payload[size - 1], static_cast<char>(expected_num));
+        ring.consume_message();
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FullRing)
+{
+  SharedMemoryRing ring("full_test", 4096);
+  std::vector<char> data(1000);
+  int written_count = 0;
+  while (ring.write_message(0, { { data.data(), data.size() } }, s_no_wait)) {
+    ++written_count;
+  }
+  BOOST_REQUIRE_EQUAL(written_count, 4);
+
+  auto start_time = std::chrono::steady_clock::now();
+  BOOST_REQUIRE(!ring.write_message(0, { { data.data(), data.size() } }, std::chrono::milliseconds(50)));
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start_time >= std::chrono::milliseconds(50));
+
+  // the writer wakes up as soon as the reader releases a message
+  std::thread reader([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint32_t type = 0; // NOLINT(build/unsigned)
+    size_t size = 0;
+    ring.peek_message(type, size, s_no_wait);
+    ring.consume_message();
+  });
+  BOOST_REQUIRE(ring.write_message(0, { { data.data(), data.size() } }, s_long_wait));
+  reader.join();
+
+  std::vector<char> too_large(4096);
+  BOOST_REQUIRE_THROW(ring.write_message(0, { { too_large.data(), too_large.size() } }, s_no_wait),
+                      MessageTooLargeForSharedMemoryRing);
+
+  ring.close();
+  BOOST_REQUIRE(ring.is_closed());
+  BOOST_REQUIRE(!ring.write_message(0, { { data.data(), data.size() } }, s_long_wait));
+}
+
+BOOST_AUTO_TEST_CASE(ChildProcess)
+{
+  SharedMemoryRing request_ring("requests", 8192);
+  SharedMemoryRing reply_ring("replies", 4096);
+
+  pid_t child_pid = fork();
+  BOOST_REQUIRE(child_pid >= 0);
+  if (child_pid == 0) {
+    // the child attaches to the inherited file descriptors, as the writer process does,
+    // and echoes each request in upper case, until the parent closes the request ring
+    int exit_code = 0;
+    try {
+      auto child_requests = SharedMemoryRing::attach("child_requests", dup(request_ring.get_fd()));
+      auto child_replies = SharedMemoryRing::attach("child_replies", dup(reply_ring.get_fd()));
+      while (true) {
+        uint32_t type = 0; // NOLINT(build/unsigned)
+        size_t size = 0;
+        const char* payload = child_requests->peek_message(type, size, s_long_wait);
+        if (payload == nullptr) {
+          break;
+        }
+        std::string reply(payload, size);
+        child_requests->consume_message();
+        for (auto& character : reply) {
+          character = static_cast<char>(std::toupper(character));
+        }
+        if (!child_replies->write_message(type, { { reply.data(), reply.size() } }, s_long_wait)) {
+          exit_code = 2;
+          break;
+        }
+      }
+    } catch (...) {
+      exit_code = 1;
+    }
+    _exit(exit_code);
+  }
+
+  const int message_count = 200;
+  std::thread writer([&]() {
+    for (int msg_num = 0; msg_num < message_count; ++msg_num) {
+      std::string request = "message " + std::to_string(msg_num) + std::string(msg_num * 10, 'x');
+      request_ring.write_message(msg_num, { { request.data(), request.size() } }, s_long_wait);
+    }
+  });
+  for (int msg_num = 0; msg_num < message_count; ++msg_num) {
+    uint32_t type = 0; // NOLINT(build/unsigned)
+    BOOST_REQUIRE_EQUAL(read_text_message(reply_ring, type),
+                        "MESSAGE " + std::to_string(msg_num) + std::string(msg_num * 10, 'X'));
+    BOOST_REQUIRE_EQUAL(type, msg_num);
+  }
+  writer.join();
+
+  request_ring.close();
+  int status = 0;
+  BOOST_REQUIRE_EQUAL(waitpid(child_pid, &status, 0), child_pid);
+  BOOST_REQUIRE(WIFEXITED(status));
+  BOOST_REQUIRE_EQUAL(WEXITSTATUS(status), 0);
+}
+
+BOOST_AUTO_TEST_CASE(SerializedRecords)
+{
+  SharedMemoryRing ring("record_test", 1000000);
+
+  auto tr = create_trigger_record(17, 1000, 3);
+  BOOST_REQUIRE(subprocesswriter::send_record(ring, tr, s_no_wait));
+  BOOST_REQUIRE_EQUAL(ring.get_used_bytes(), subprocesswriter::get_message_size(tr));
+
+  TimeSliceHeader tsh;
+  tsh.timeslice_number = 8;
+  tsh.run_number = s_run_number;
+  TimeSlice ts(tsh);
+  ts.add_fragment(create_fragment(8, 0, 500));
+  BOOST_REQUIRE(subprocesswriter::send_record(ring, ts, s_no_wait));
+
+  uint32_t type = 0; // NOLINT(build/unsigned)
+  size_t size = 0;
+  const char* payload = ring.peek_message(type, size, s_no_wait);
+  BOOST_REQUIRE(payload != nullptr);
+  BOOST_REQUIRE_EQUAL(type, static_cast<uint32_t>(subprocesswriter::MessageType::kTriggerRecord)); // NOLINT
+  auto tr_copy = subprocesswriter::make_trigger_record(payload, size);
+  ring.consume_message();
+  BOOST_REQUIRE_EQUAL(tr_copy->get_header_ref().get_trigger_number(), 17);
+  check_fragments_are_equal(tr.get_fragments_ref(), tr_copy->get_fragments_ref());
+
+  payload = ring.peek_message(type, size, s_no_wait);
+  BOOST_REQUIRE(payload != nullptr);
+  BOOST_REQUIRE_EQUAL(type, static_cast<uint32_t>(subprocesswriter::MessageType::kTimeSlice)); // NOLINT
+  auto ts_copy = subprocesswriter::make_time_slice(payload, size);
+  ring.consume_message();
+  BOOST_REQUIRE_EQUAL(ts_copy->get_header().timeslice_number, 8);
+  check_fragments_are_equal(ts.get_fragments_ref(), ts_copy->get_fragments_ref());
+
+  subprocesswriter::Completion completion{ 17, subprocesswriter::MessageType::kTriggerRecord, 0, 1 };
+  BOOST_REQUIRE(
+    subprocesswriter::send_message(ring, subprocesswriter::MessageType::kCompletion, completion, "", s_no_wait));
+  payload = ring.peek_message(type, size, s_no_wait);
+  BOOST_REQUIRE(payload != nullptr);
+  BOOST_REQUIRE_EQUAL(size, sizeof(completion));
+  subprocesswriter::Completion completion_copy;
+  std::memcpy(&completion_copy, payload, sizeof(completion_copy));
+  BOOST_REQUIRE_EQUAL(completion_copy.record_number, 17);
+  BOOST_REQUIRE_EQUAL(completion_copy.success, 1);
+  ring.consume_message();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,199 @@
+/**
+ * @file SliceStreamFile_test.cxx Test application that tests and demonstrates
+ * the functionality of the SliceStreamWriter and SliceStreamReader classes.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/SliceStreamFile.hpp"
+
+#define BOOST_TEST_MODULE SliceStreamFile_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace dunedaq::dfmodules;
+using namespace dunedaq::daqdataformats;
+
+namespace {
+
+const int s_run_number = 53;
+const size_t s_row_size = 24;
+const uint64_t s_slice_length = 1000; // NOLINT(build/unsigned)
+
+/**
+ * @brief Returns the rows of the specified TimeSlice and element, with a different count per slice
+ */
+std::vector<char>
+create_rows(uint64_t ts_num, int element_number) // NOLINT(build/unsigned)
+{
+  std::vector<char> rows(((ts_num + element_number) % 4 + 1) * s_row_size);
+  for (size_t idx = 0; idx < rows.size(); ++idx) {
+    rows[idx] = static_cast<char>((ts_num * 7 + element_number + idx) % 128);
+  }
+  return rows;
+}
+
+std::unique_ptr<Fragment>
+create_fragment(uint64_t ts_num, int element_number, const std::vector<char>& payload) // NOLINT(build/unsigned)
+{
+  FragmentHeader fh;
+  fh.trigger_number = ts_num;
+  fh.trigger_timestamp = ts_num * s_slice_length;
+  fh.window_begin = ts_num * s_slice_length;
+  fh.window_end = (ts_num + 1) * s_slice_length;
+  fh.run_number = s_run_number;
+  fh.element_id = SourceID(SourceID::Subsystem::kTrigger, element_number);
+  auto frag_ptr = std::make_unique<Fragment>(const_cast<char*>(payload.data()), payload.size()); // NOLINT
+  frag_ptr->set_header_fields(fh);
+  return frag_ptr;
+}
+
+TimeSlice
+create_time_slice(uint64_t ts_num, int element_count) // NOLINT(build/unsigned)
+{
+  TimeSlice ts(ts_num, s_run_number);
+  for (int ele_num = 0; ele_num < element_count; ++ele_num) {
+    ts.add_fragment(create_fragment(ts_num, ele_num, create_rows(ts_num, ele_num)));
+  }
+  return ts;
+}
+
+/**
+ * @brief Creates an empty HDF5 file for a test, and removes it at the end of the test
+ */
+struct TestFile
+{
+  TestFile()
+    : name(std::filesystem::temp_directory_path().string() + "/SliceStreamFile_test_" + std::to_string(getpid()) +
+           ".hdf5")
+  {
+    hid_t file_id = H5Fcreate(name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    H5Fclose(file_id);
+  }
+  ~TestFile() { std::filesystem::remove(name); }
+  std::string name;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(SliceStreamFile_test)
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<SliceStreamWriter>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<SliceStreamWriter>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<SliceStreamWriter>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<SliceStreamWriter>);
+
+  BOOST_REQUIRE(!std::is_copy_constructible_v<SliceStreamReader>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<SliceStreamReader>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<SliceStreamReader>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<SliceStreamReader>);
+}
+
+BOOST_AUTO_TEST_CASE(AppendAndReadBack)
+{
+  TestFile test_file;
+  const int element_count = 3;
+  const uint64_t slice_count = 20; // NOLINT(build/unsigned)
+
+  size_t total_size = 0;
+  {
+    // small chunks, so that the rows of a slice can span chunks
+    SliceStreamWriter writer(test_file.name, s_row_size, 5 * s_row_size);
+    for (uint64_t ts_num = 1; ts_num <= slice_count / 2; ++ts_num) { // NOLINT(build/unsigned)
+      writer.write(create_time_slice(ts_num, element_count));
+      for (int ele_num = 0; ele_num < element_count; ++ele_num) {
+        total_size += create_rows(ts_num, ele_num).size() + sizeof(slicestream::SliceEntry);
+      }
+    }
+    BOOST_REQUIRE_EQUAL(writer.get_recorded_size(), total_size);
+  }
+  {
+    // a second writer continues where the first one stopped
+    SliceStreamWriter writer(test_file.name, s_row_size, 5 * s_row_size);
+    for (uint64_t ts_num = slice_count / 2 + 1; ts_num <= slice_count; ++ts_num) { // NOLINT(build/unsigned)
+      writer.write(create_time_slice(ts_num, element_count));
+    }
+    BOOST_REQUIRE_THROW(SliceStreamWriter(test_file.name, s_row_size + 1, 1024), SliceStreamProblem);
+  }
+
+  SliceStreamReader reader(test_file.name);
+  BOOST_REQUIRE_EQUAL(reader.get_row_size(), s_row_size);
+  BOOST_REQUIRE_EQUAL(reader.get_slice_index().size(), slice_count * element_count);
+  BOOST_REQUIRE_EQUAL(reader.get_source_ids().size(), element_count);
+
+  for (uint64_t ts_num = 1; ts_num <= slice_count; ++ts_num) { // NOLINT(build/unsigned)
+    for (int ele_num = 0; ele_num < element_count; ++ele_num) {
+      auto rows = reader.read_time_slice_rows(ts_num, SourceID(SourceID::Subsystem::kTrigger, ele_num));
+      BOOST_REQUIRE(rows == create_rows(ts_num, ele_num));
+    }
+  }
+  BOOST_REQUIRE(reader.read_time_slice_rows(slice_count + 1, SourceID(SourceID::Subsystem::kTrigger, 0)).empty());
+  BOOST_REQUIRE(reader.read_time_slice_rows(1, SourceID(SourceID::Subsystem::kTrigger, element_count)).empty());
+}
+
+BOOST_AUTO_TEST_CASE(ReadTimeRange)
+{
+  TestFile test_file;
+  {
+    SliceStreamWriter writer(test_file.name, s_row_size, 4096);
+    for (uint64_t ts_num = 1; ts_num <= 10; ++ts_num) { // NOLINT(build/unsigned)
+      writer.write(create_time_slice(ts_num, 2));
+    }
+  }
+
+  SliceStreamReader reader(test_file.name);
+  SourceID source_id(SourceID::Subsystem::kTrigger, 1);
+
+  // the range overlaps with TimeSlices 3, 4, and 5
+  auto rows = reader.read_time_range_rows(source_id, 3 * s_slice_length + 10, 5 * s_slice_length + 1);
+  std::vector<char> expected_rows;
+  for (uint64_t ts_num = 3; ts_num <= 5; ++ts_num) { // NOLINT(build/unsigned)
+    auto slice_rows = create_rows(ts_num, 1);
+    expected_rows.insert(expected_rows.end(), slice_rows.begin(), slice_rows.end());
+  }
+  BOOST_REQUIRE(rows == expected_rows);
+
+  BOOST_REQUIRE(reader.read_time_range_rows(source_id, 20 * s_slice_length, 30 * s_slice_length).empty());
+  BOOST_REQUIRE_THROW(reader.read_rows(source_id, 0, 1000), SliceStreamProblem);
+}
+
+BOOST_AUTO_TEST_CASE(PartialRows)
+{
+  TestFile test_file;
+  TimeSlice ts(1, s_run_number);
+  std::vector<char> payload(s_row_size);
+  ts.add_fragment(create_fragment(1, 0, payload));
+  payload.resize(s_row_size + 1);
+  ts.add_fragment(create_fragment(1, 1, payload));
+  {
+    SliceStreamWriter writer(test_file.name, s_row_size, 4096);
+    BOOST_REQUIRE_THROW(writer.write(ts), SliceStreamProblem);
+    BOOST_REQUIRE_EQUAL(writer.get_recorded_size(), 0);
+  }
+
+  // nothing was written for the valid Fragment either
+  SliceStreamReader reader(test_file.name);
+  BOOST_REQUIRE(reader.get_slice_index().empty());
+}
+
+BOOST_AUTO_TEST_CASE(FileWithoutTimeSlices)
+{
+  TestFile test_file;
+  BOOST_REQUIRE_THROW(SliceStreamReader reader(test_file.name), SliceStreamProblem);
+  BOOST_REQUIRE_THROW(SliceStreamReader reader(test_file.name + ".missing"), SliceStreamProblem);
+  BOOST_REQUIRE_THROW(SliceStreamWriter writer(test_file.name + ".missing", s_row_size, 4096), SliceStreamProblem);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,187 @@
+/**
+ * @file StagedFileMover_test.cxx Test application that tests and demonstrates
+ * the functionality of the StagedFileMover class.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dfmodules/StagedFileMover.hpp"
+
+#define BOOST_TEST_MODULE StagedFileMover_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace dunedaq::dfmodules;
+
+namespace {
+
+/**
+ * @brief Creates a staging and a destination directory for a test, and removes them at the end of the test
+ */
+struct TestDirectories
+{
+  TestDirectories()
+    : staging(std::filesystem::temp_directory_path().string() + "/StagedFileMover_test_" + std::to_string(getpid()) +
+              "_staging")
+    , destination(std::filesystem::temp_directory_path().string() + "/StagedFileMover_test_" +
+                  std::to_string(getpid()) + "_destination")
+  {
+    std::filesystem::remove_all(staging);
+    std::filesystem::remove_all(destination);
+    std::filesystem::create_directories(staging);
+    std::filesystem::create_directories(destination);
+  }
+  ~TestDirectories()
+  {
+    std::filesystem::remove_all(staging);
+    std::filesystem::remove_all(destination);
+  }
+  std::string staging;
+  std::string destination;
+};
+
+std::vector<char>
+create_contents(size_t size, int seed)
+{
+  std::vector<char> contents(size);
+  for (size_t idx = 0; idx < size; ++idx) {
+    contents[idx] = static_cast<char>((idx * 13 + seed) % 128);
+  }
+  return contents;
+}
+
+std::string
+write_file(const std::string& directory, const std::string& name, const std::vector<char>& contents)
+{
+  std::string file_name = directory + "/" + name;
+  std::ofstream out(file_name, std::ios::binary);
+  out.write(contents.data(), contents.size());
+  return file_name;
+}
+
+std::vector<char>
+read_file(const std::string& file_name)
+{
+  std::ifstream in(file_name, std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(StagedFileMover_test)
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<StagedFileMover>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<StagedFileMover>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<StagedFileMover>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<StagedFileMover>);
+}
+
+BOOST_AUTO_TEST_CASE(MoveFiles)
+{
+  TestDirectories dirs;
+  StagedFileMover::Policy policy;
+  policy.destination_directory = dirs.destination;
+  policy.copy_chunk_size = 4096;
+  StagedFileMover mover("test", policy);
+
+  std::vector<std::vector<char>> contents;
+  std::vector<std::string> file_names;
+  for (int idx = 0; idx < 3; ++idx) {
+    contents.push_back(create_contents(10000 * (idx + 1) + idx, idx));
+    file_names.push_back(write_file(dirs.staging, "file" + std::to_string(idx) + ".hdf5", contents.back()));
+    mover.add_file(file_names.back());
+  }
+  // an empty file is moved, too
+  file_names.push_back(write_file(dirs.staging, "empty.hdf5", std::vector<char>()));
+  contents.push_back(std::vector<char>());
+  mover.add_file(file_names.back());
+  mover.wait_until_idle();
+
+  BOOST_REQUIRE_EQUAL(mover.get_number_of_queued_files(), 0);
+  BOOST_REQUIRE_EQUAL(mover.get_move_latency().get_and_reset().count, file_names.size());
+  for (size_t idx = 0; idx < file_names.size(); ++idx) {
+    BOOST_REQUIRE(!std::filesystem::exists(file_names[idx]));
+    std::string destination_name = mover.get_destination_name(file_names[idx]);
+    BOOST_REQUIRE_EQUAL(destination_name,
+                        dirs.destination + "/" + std::filesystem::path(file_names[idx]).filename().string());
+    BOOST_REQUIRE(read_file(destination_name) == contents[idx]);
+    BOOST_REQUIRE(!std::filesystem::exists(destination_name + StagedFileMover::s_in_progress_suffix));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(LimitRate)
+{
+  TestDirectories dirs;
+  StagedFileMover::Policy policy;
+  policy.destination_directory = dirs.destination;
+  policy.max_bytes_per_second = 1000000;
+  policy.copy_chunk_size = 50000;
+  StagedFileMover mover("test", policy);
+
+  // 300,000 bytes at 1,000,000 bytes per second take at least 0.3 seconds
+  auto start_time = std::chrono::steady_clock::now();
+  mover.add_file(write_file(dirs.staging, "limited.hdf5", create_contents(300000, 1)));
+  mover.wait_until_idle();
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start_time >= std::chrono::milliseconds(290));
+  BOOST_REQUIRE(std::filesystem::exists(dirs.destination + "/limited.hdf5"));
+
+  // above the high-water mark (any disk usage is above 0), the rate is not limited
+  policy.staging_high_water_mark = 0.0;
+  policy.max_bytes_per_second = 1000;
+  StagedFileMover unlimited_mover("test", policy);
+  start_time = std::chrono::steady_clock::now();
+  unlimited_mover.add_file(write_file(dirs.staging, "unlimited.hdf5", create_contents(300000, 2)));
+  unlimited_mover.wait_until_idle();
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start_time < std::chrono::seconds(60));
+  BOOST_REQUIRE(std::filesystem::exists(dirs.destination + "/unlimited.hdf5"));
+}
+
+BOOST_AUTO_TEST_CASE(FailedMovesLeaveTheStagedFile)
+{
+  TestDirectories dirs;
+  StagedFileMover::Policy policy;
+  policy.destination_directory = dirs.destination + "/missing";
+  StagedFileMover mover("test", policy);
+
+  std::vector<char> contents = create_contents(5000, 3);
+  std::string file_name = write_file(dirs.staging, "kept.hdf5", contents);
+  mover.add_file(file_name);
+  mover.add_file(dirs.staging + "/missing.hdf5");
+  mover.wait_until_idle();
+
+  BOOST_REQUIRE(read_file(file_name) == contents);
+  BOOST_REQUIRE_EQUAL(mover.get_move_latency().get_and_reset().count, 0);
+}
+
+BOOST_AUTO_TEST_CASE(DestructorMovesQueuedFiles)
+{
+  TestDirectories dirs;
+  StagedFileMover::Policy policy;
+  policy.destination_directory = dirs.destination;
+  policy.max_bytes_per_second = 1000;
+  policy.copy_chunk_size = 4096;
+  {
+    StagedFileMover mover("test", policy);
+    for (int idx = 0; idx < 3; ++idx) {
+      mover.add_file(write_file(dirs.staging, "queued" + std::to_string(idx) + ".hdf5", create_contents(20000, idx)));
+    }
+  }
+  for (int idx = 0; idx < 3; ++idx) {
+    BOOST_REQUIRE(std::filesystem::exists(dirs.destination + "/queued" + std::to_string(idx) + ".hdf5"));
+    BOOST_REQUIRE(!std::filesystem::exists(dirs.staging + "/queued" + std::to_string(idx) + ".hdf5"));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()